@@ -0,0 +1,134 @@
+/*****************************************************************************
+ * Benchmarks the BLAS / LAPACK routines that dominate Moby's dense linear
+ * algebra (gemm, potrf, and gesvd) at the problem sizes that Moby uses,
+ * comparing the linked libraries against a library loaded at runtime.
+ *
+ * syntax: blas-bench [library] [threads]
+ ****************************************************************************/
+
+#include <sys/time.h>
+#include <cstdlib>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <Moby/MatrixN.h>
+#include <Moby/LinAlg.h>
+#include <Moby/BLASBackend.h>
+
+using namespace Moby;
+
+// the matrix sizes to benchmark: spatial quantities, generalized coordinates
+// of a 30 DoF humanoid, and dense impact problems of a few hundred variables
+static const unsigned SIZES[] = { 6, 12, 30, 60, 120, 250, 500 };
+static const unsigned NSIZES = sizeof(SIZES)/sizeof(unsigned);
+
+// the benchmarked routines
+static const unsigned NROUTINES = 3;
+static const char* ROUTINES[NROUTINES] = { "gemm", "potrf", "gesvd" };
+
+/// Gets the current wall-clock time in seconds
+static double get_time()
+{
+  timeval t;
+  gettimeofday(&t, NULL);
+  return t.tv_sec + t.tv_usec * 1e-6;
+}
+
+/// Gets a matrix of uniform random numbers in [-1, 1]
+static MatrixN random_matrix(unsigned n)
+{
+  MatrixN A(n, n);
+  for (unsigned i=0; i< n*n; i++)
+    A.data()[i] = (Real) rand()/RAND_MAX*2 - 1;
+  return A;
+}
+
+/// Gets the number of repetitions that keeps a run near a fixed flop count
+static unsigned get_reps(unsigned n)
+{
+  const unsigned FLOPS = 50000000;
+  return std::max((unsigned) 3, FLOPS/(n*n*n));
+}
+
+/// Times one of the routines on n x n matrices, returning seconds per call
+static double time_routine(unsigned routine, unsigned n)
+{
+  const unsigned REPS = get_reps(n);
+  MatrixN A = random_matrix(n), B = random_matrix(n), C, U, V, work;
+  VectorN S;
+
+  // make A symmetric positive definite for the Cholesky factorization
+  if (routine == 1)
+  {
+    A.transpose_mult(A, C);
+    for (unsigned i=0; i< n; i++)
+      C(i,i) += (Real) n;
+    A.copy_from(C);
+  }
+
+  double elapsed = 0.0;
+  for (unsigned r=0; r< REPS; r++)
+  {
+    work.copy_from(A);
+    double t0 = get_time();
+    switch (routine)
+    {
+      case 0: work.mult(B, C); break;
+      case 1: LinAlg::factor_chol(work); break;
+      case 2: LinAlg::svd1(work, U, S, V); break;
+    }
+    elapsed += get_time() - t0;
+  }
+
+  return elapsed/REPS;
+}
+
+/// Times every routine at every size using the current backend
+static void time_all(double times[NROUTINES][NSIZES])
+{
+  for (unsigned i=0; i< NROUTINES; i++)
+    for (unsigned j=0; j< NSIZES; j++)
+      times[i][j] = time_routine(i, SIZES[j]);
+}
+
+int main(int argc, char* argv[])
+{
+  double linked[NROUTINES][NSIZES], loaded[NROUTINES][NSIZES];
+
+  // time the linked libraries
+  time_all(linked);
+
+  // time the library given on the command line, if any
+  bool compare = false;
+  if (argc > 1)
+  {
+    if (!BLASBackend::load(argv[1]))
+      return -1;
+    if (argc > 2)
+      BLASBackend::set_num_threads(std::atoi(argv[2]));
+    time_all(loaded);
+    compare = true;
+  }
+
+  // output the results (in microseconds per call)
+  std::cout << "routine     n      linked (us)";
+  if (compare)
+    std::cout << "  " << BLASBackend::get_name() << " (us)  speedup";
+  std::cout << std::endl;
+  for (unsigned i=0; i< NROUTINES; i++)
+    for (unsigned j=0; j< NSIZES; j++)
+    {
+      std::cout << std::setw(7) << std::left << ROUTINES[i] << std::right;
+      std::cout << std::setw(6) << SIZES[j];
+      std::cout << std::setw(17) << std::fixed << std::setprecision(2) << linked[i][j]*1e6;
+      if (compare)
+      {
+        std::cout << std::setw(17) << loaded[i][j]*1e6;
+        std::cout << std::setw(9) << linked[i][j]/loaded[i][j];
+      }
+      std::cout << std::endl;
+    }
+
+  return 0;
+}
+
@@ -11,6 +11,8 @@
 #include <boost/enable_shared_from_this.hpp>
 #include <list>
 #include <vector>
+#include <string>
+#include <limits>
 #include <Moby/Types.h>
 #include <Moby/Vector3.h>
 #include <Moby/Polyhedron.h>
@@ -20,6 +22,12 @@ class SoSeparator;
 namespace Moby {
 
 /// An adaptively-sampled distance field using an octree representation 
+/**
+ * ADFs may be saved to and loaded from either a text format (save_to_file() /
+ * load_from_file()) or a compact binary format (save_to_binary_file() /
+ * load_from_binary_file()); the latter is read via a memory mapping and is
+ * considerably faster to load.  The binary format uses the native byte order.
+ */
 class ADF : public boost::enable_shared_from_this<ADF>
 {
   public:
@@ -37,7 +45,8 @@ class ADF : public boost::enable_shared_from_this<ADF>
     void get_bounds(Vector3& lo, Vector3& hi) const;
     void set_bounds(const Vector3& lo_bound, const Vector3& hi_bound);
     static boost::shared_ptr<ADF> build_ADF(Polyhedron& poly, unsigned max_recursion, Real epsilon, Real max_pos_dist = -1.0, Real max_neg_dist = std::numeric_limits<Real>::max());
-    static boost::shared_ptr<ADF> build_ADF(const Vector3& lo, const Vector3& hi, Real (*dfn)(const Vector3&, void*), unsigned max_recursion, Real epsilon, Real max_pos_dist = -1.0, Real max_neg_dist = std::numeric_limits<Real>::max(), void* data = NULL);
+    static boost::shared_ptr<ADF> build_ADF(const Vector3& lo, const Vector3& hi, Real (*dfn)(const Vector3&, void*), unsigned max_recursion, Real epsilon, Real max_pos_dist = -1.0, Real max_neg_dist = std::numeric_limits<Real>::max(), void* data = NULL, const std::string& checkpoint_filename = std::string());
+    static void refine_ADF(boost::shared_ptr<ADF> root, Real (*dfn)(const Vector3&, void*), unsigned max_recursion, Real epsilon, Real max_neg_dist = std::numeric_limits<Real>::max(), void* data = NULL, const std::string& checkpoint_filename = std::string());
     const std::vector<Real>& get_distances() const { return _distances; }
     static boost::shared_ptr<ADF> intersect(boost::shared_ptr<ADF> adf1, boost::shared_ptr<ADF> adf2, Real epsilon, unsigned recursion_limit);
     bool contains(const Vector3& point) const;
@@ -49,6 +58,8 @@ class ADF : public boost::enable_shared_from_this<ADF>
     bool intersect_seg_iso_surface(const LineSeg3& seg, Vector3& isect) const;
     void save_to_file(const std::string& filename) const;
     static boost::shared_ptr<ADF> load_from_file(const std::string& filename);
+    void save_to_binary_file(const std::string& filename) const;
+    static boost::shared_ptr<ADF> load_from_binary_file(const std::string& filename);
     SoSeparator* render() const;
     void subdivide(Real (*dfn)(const Vector3&, void*), void*);
     void subdivide();
@@ -67,6 +78,8 @@ class ADF : public boost::enable_shared_from_this<ADF>
     const std::vector<boost::shared_ptr<ADF> >& get_children() const { return _children; }
 
   private:
+    class SampleCache;
+
     static Real trimesh_distance_function(const Vector3& pt, void* data);
     void render(SoSeparator* separator) const;
     void render2(SoSeparator* separator) const;
@@ -74,6 +87,9 @@ class ADF : public boost::enable_shared_from_this<ADF>
     static Real tri_linear_interp(const std::vector<Vector3ConstPtr>& x, const std::vector<Real>& q, const Vector3& p);
     boost::shared_ptr<ADF> is_cell_occupied(const Vector3& point) const;
     unsigned get_sub_volume_idx(const Vector3& point) const;
+    bool needs_subdivision(unsigned max_recursion, Real epsilon, Real max_neg_dist, Real (*dfn)(const Vector3&, void*), void* data, SampleCache* cache) const;
+    void subdivide(Real (*dfn)(const Vector3&, void*), void* data, SampleCache* cache);
+    static Real calc_sample(const Vector3& point, Real (*dfn)(const Vector3&, void*), void* data, SampleCache* cache);
 
     static const unsigned OCT_CHILDREN = 8;
     static const unsigned BOX_VERTICES = 8;
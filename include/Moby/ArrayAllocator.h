@@ -0,0 +1,73 @@
+/****************************************************************************
+ * Copyright 2011 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#ifndef _ARRAY_ALLOCATOR_H
+#define _ARRAY_ALLOCATOR_H
+
+#include <cstddef>
+#include <boost/shared_ptr.hpp>
+#include <boost/shared_array.hpp>
+#include <Moby/Types.h>
+
+namespace Moby {
+
+/// Interface for allocators of the Real arrays underlying VectorN and MatrixN
+/**
+ * VectorN and MatrixN (and their subclasses) obtain all of their storage
+ * through create(), which draws from the allocator installed with
+ * set_default(); PoolArrayAllocator is installed initially.  Arrays keep a
+ * reference to the allocator that created them, so the default may be
+ * replaced while arrays are live (though not while other threads are
+ * allocating).  Allocators deal in raw storage only: create() constructs
+ * the elements (and the array's deleter destroys them) when Real is not
+ * trivially constructible (e.g., in arbitrary precision builds).
+ */
+class ArrayAllocator
+{
+  public:
+    virtual ~ArrayAllocator() {}
+
+    /// Allocates uninitialized storage for n Real values (n > 0)
+    virtual Real* allocate(unsigned n) = 0;
+
+    /// Returns an array of n Real values previously obtained from allocate()
+    virtual void deallocate(Real* x, unsigned n) = 0;
+
+    static boost::shared_array<Real> create(unsigned n);
+    static void set_default(boost::shared_ptr<ArrayAllocator> allocator);
+    static boost::shared_ptr<ArrayAllocator> get_default();
+    static unsigned long get_num_allocations();
+    static void reset_num_allocations();
+
+  protected:
+    static void* heap_allocate(std::size_t bytes);
+    static void heap_deallocate(void* x);
+}; // end class
+
+/// The default allocator: per-thread size-class free lists
+/**
+ * Blocks are rounded up to a power of two and returned to a free list
+ * belonging to the thread that releases them, so a loop that repeatedly
+ * creates and destroys temporaries of the same sizes stops touching the heap
+ * after its first iteration.  Each thread retains at most 32MB of free
+ * blocks (blocks of more than 2MB are never retained); release_free_lists()
+ * returns the calling thread's blocks to the heap.  The free lists are
+ * thread-specific only in OpenMP and THREADSAFE builds.
+ */
+class PoolArrayAllocator : public ArrayAllocator
+{
+  public:
+    virtual Real* allocate(unsigned n);
+    virtual void deallocate(Real* x, unsigned n);
+    static void* allocate_bytes(std::size_t bytes);
+    static void deallocate_bytes(void* x);
+    static void release_free_lists();
+}; // end class
+
+} // end namespace
+
+#endif
+
@@ -0,0 +1,95 @@
+/****************************************************************************
+ * Copyright 2011 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#ifndef _BLAS_BACKEND_H
+#define _BLAS_BACKEND_H
+
+#include <string>
+#include <Moby/cblas.h>
+
+namespace Moby {
+
+/// Dispatch table for the BLAS and LAPACK routines behind CBLAS and LinAlg
+/**
+ * The level 2 and 3 BLAS routines and the LAPACK factorizations that
+ * dominate Moby's dense linear algebra are called through this table.
+ * Initially the table holds the routines of the BLAS / LAPACK libraries that
+ * Moby was linked against (selected at configure time); load() rebinds it to
+ * the routines exported by another shared library (e.g., OpenBLAS or MKL), and
+ * reset() restores the linked routines.  Routines that a loaded library does
+ * not export keep their linked versions.  If the environment variable
+ * MOBY_BLAS_LIBRARY names a library when Moby is loaded, that library is
+ * loaded automatically.  The table must not be changed while other threads
+ * are calling into it.  (Arbitrary precision builds always use the bundled
+ * routines.)
+ */
+class BLASBackend
+{
+  public:
+    typedef void (*DGEMM)(enum CBLAS_ORDER, enum CBLAS_TRANSPOSE, enum CBLAS_TRANSPOSE, int, int, int, double, const double*, int, const double*, int, double, double*, int);
+    typedef void (*SGEMM)(enum CBLAS_ORDER, enum CBLAS_TRANSPOSE, enum CBLAS_TRANSPOSE, int, int, int, float, const float*, int, const float*, int, float, float*, int);
+    typedef void (*DGEMV)(enum CBLAS_ORDER, enum CBLAS_TRANSPOSE, int, int, double, const double*, int, const double*, int, double, double*, int);
+    typedef void (*SGEMV)(enum CBLAS_ORDER, enum CBLAS_TRANSPOSE, int, int, float, const float*, int, const float*, int, float, float*, int);
+    typedef void (*DTRSM)(enum CBLAS_ORDER, enum CBLAS_SIDE, enum CBLAS_UPLO, enum CBLAS_TRANSPOSE, enum CBLAS_DIAG, int, int, double, const double*, int, double*, int);
+    typedef void (*STRSM)(enum CBLAS_ORDER, enum CBLAS_SIDE, enum CBLAS_UPLO, enum CBLAS_TRANSPOSE, enum CBLAS_DIAG, int, int, float, const float*, int, float*, int);
+    typedef int (*DPOTRF)(char*, int*, double*, int*, int*);
+    typedef int (*SPOTRF)(char*, int*, float*, int*, int*);
+    typedef int (*DPOTRS)(char*, int*, int*, double*, int*, double*, int*, int*);
+    typedef int (*SPOTRS)(char*, int*, int*, float*, int*, float*, int*, int*);
+    typedef int (*DGETRF)(int*, int*, double*, int*, int*, int*);
+    typedef int (*SGETRF)(int*, int*, float*, int*, int*, int*);
+    typedef int (*DGETRS)(char*, int*, int*, double*, int*, int*, double*, int*, int*);
+    typedef int (*SGETRS)(char*, int*, int*, float*, int*, int*, float*, int*, int*);
+    typedef int (*DGESVD)(char*, char*, int*, int*, double*, int*, double*, double*, int*, double*, int*, double*, int*, int*);
+    typedef int (*SGESVD)(char*, char*, int*, int*, float*, int*, float*, float*, int*, float*, int*, float*, int*, int*);
+    typedef int (*DGESDD)(char*, int*, int*, double*, int*, double*, double*, int*, double*, int*, double*, int*, int*, int*);
+    typedef int (*SGESDD)(char*, int*, int*, float*, int*, float*, float*, int*, float*, int*, float*, int*, int*, int*);
+    typedef int (*DSYEVD)(char*, char*, int*, double*, int*, double*, double*, int*, int*, int*, int*);
+    typedef int (*SSYEVD)(char*, char*, int*, float*, int*, float*, float*, int*, int*, int*, int*);
+    typedef void (*SET_NUM_THREADS)(int);
+
+    /// The dispatched routines
+    struct Routines
+    {
+      DGEMM dgemm;
+      SGEMM sgemm;
+      DGEMV dgemv;
+      SGEMV sgemv;
+      DTRSM dtrsm;
+      STRSM strsm;
+      DPOTRF dpotrf;
+      SPOTRF spotrf;
+      DPOTRS dpotrs;
+      SPOTRS spotrs;
+      DGETRF dgetrf;
+      SGETRF sgetrf;
+      DGETRS dgetrs;
+      SGETRS sgetrs;
+      DGESVD dgesvd;
+      SGESVD sgesvd;
+      DGESDD dgesdd;
+      SGESDD sgesdd;
+      DSYEVD dsyevd;
+      SSYEVD ssyevd;
+      SET_NUM_THREADS set_num_threads;
+    };
+
+    /// Gets the routines currently in use
+    static const Routines& routines() { return _routines; }
+
+    static bool load(const std::string& library);
+    static void reset();
+    static const std::string& get_name();
+    static void set_num_threads(int n);
+
+  private:
+    static Routines _routines;
+}; // end class
+
+} // end namespace
+
+#endif
+
@@ -0,0 +1,67 @@
+/****************************************************************************
+ * Copyright 2011 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#ifndef _BASIS_LU_H
+#define _BASIS_LU_H
+
+#include <vector>
+#include <Moby/MatrixN.h>
+
+namespace Moby {
+
+/// LU factorization of a pivoting basis matrix with product-form updates
+/**
+ * Pivoting methods (e.g., Lemke's algorithm) replace one column of the basis
+ * matrix B at each iteration.  Rather than refactoring B after each
+ * replacement, the LU factorization of a previous basis is kept along with
+ * the eta vectors of the replacements (product form of the inverse), so
+ * solves cost O(n^2 + k*n) for k replacements instead of O(n^3).  B is
+ * refactored after a fixed number of replacements or when a replacement is
+ * numerically unstable.
+ */
+class BasisLU
+{
+  public:
+    BasisLU() { _factored = false; _neta = 0; }
+    void set_basis(const MatrixN& B);
+    bool factor();
+    bool solve(VectorN& xb);
+    void replace_column(unsigned i, const VectorN& a, const VectorN& d);
+
+    /// Gets the basis matrix
+    const MatrixN& get_basis() const { return _B; }
+
+    /// Gets the dimension of the basis matrix
+    unsigned size() const { return _B.rows(); }
+
+    /// Gets the number of column replacements since the last factorization
+    unsigned num_updates() const { return _neta; }
+
+  private:
+    /// The basis matrix
+    MatrixN _B;
+
+    /// The LU factorization of the basis at the last refactorization
+    MatrixN _LU;
+
+    /// The pivots of the LU factorization
+    std::vector<int> _ipiv;
+
+    /// The replaced columns and eta vectors of the updates
+    std::vector<unsigned> _eta_idx;
+    std::vector<VectorN> _eta;
+
+    /// The number of updates since the last factorization
+    unsigned _neta;
+
+    /// Indicates whether _LU and the eta vectors represent the basis
+    bool _factored;
+}; // end class
+
+} // end namespace
+
+#endif
+
@@ -16,6 +16,7 @@
 #include <Moby/CollisionDetection.h>
 #include <Moby/ThickTriangle.h>
 #include <Moby/BV.h>
+#include <Moby/SweepAndPrune.h>
 #include <Moby/Integrator.h>
 
 namespace Moby {
@@ -62,7 +63,17 @@ class C2ACCD : public CollisionDetection
         unsigned tri_idx;             // the index of this triangle
     };
 
-    Real calc_dist(boost::shared_ptr<SSR> a, boost::shared_ptr<SSR> b, const Matrix4& aTb, Vector3& cpa, Vector3& cpb) const;
+    /// Closest features of a pair of SSR leafs found during conservative advancement
+    struct CAFeatures
+    {
+      boost::shared_ptr<SSR> ssr_a;    // leaf of the first geometry's tree
+      boost::shared_ptr<SSR> ssr_b;    // leaf of the second geometry's tree
+      unsigned tri_a;                  // closest triangle in ssr_a
+      unsigned tri_b;                  // closest triangle in ssr_b
+    };
+
+    Real calc_dist(boost::shared_ptr<SSR> a, boost::shared_ptr<SSR> b, const Matrix4& aTb, Vector3& cpa, Vector3& cpb, unsigned& tri_a, unsigned& tri_b) const;
+    void remove_CA_fronts(CollisionGeometryPtr cg);
     static bool query_intersect_seg_tri(const LineSeg3& seg, const Triangle& tri, Real& t, Vector3& p);
     void determine_contacts(CollisionGeometryPtr a, CollisionGeometryPtr b, Real toc, std::vector<Event>& contacts) const;
     bool check_collision(CollisionGeometryPtr a, CollisionGeometryPtr b, std::vector<std::pair<unsigned, unsigned> >& colliding_tris) const;
@@ -70,9 +81,11 @@ class C2ACCD : public CollisionDetection
     Real do_CAStep(Real dist, const Vector3& dab, CollisionGeometryPtr a, CollisionGeometryPtr b, boost::shared_ptr<SSR> ssr_a, boost::shared_ptr<SSR> ssr_b);
     Real calc_mu(Real dist, const Vector3& n, CollisionGeometryPtr g, boost::shared_ptr<SSR> ssr, bool positive);
     void add_rigid_body_model(RigidBodyPtr body);
-    bool intersect_BV_trees(boost::shared_ptr<BV> a, boost::shared_ptr<BV> b, const Matrix4& aTb, CollisionGeometryPtr geom_a, CollisionGeometryPtr geom_b);
+    bool intersect_BV_trees(boost::shared_ptr<BV> a, boost::shared_ptr<BV> b, const Matrix4& aTb, CollisionGeometryPtr geom_a, CollisionGeometryPtr geom_b, std::list<CollidingTriPair>& tris);
+    static bool check_pair(void* data, CollisionGeometryPtr g1, CollisionGeometryPtr g2, const Matrix4& g1Tg2, std::list<CollidingTriPair>& tris);
     void check_vertices(Real dt, CollisionGeometryPtr a, CollisionGeometryPtr b, BVPtr ob, const std::vector<const Vector3*>& a_verts, const Matrix4& bTa_t0, const std::pair<Vector3, Vector3>& a_vel, const std::pair<Vector3, Vector3>& b_vel, Real& earliest, std::vector<Event>& local_contacts) const;
-    void check_geoms(Real dt, CollisionGeometryPtr a, CollisionGeometryPtr b, const std::vector<std::pair<DynamicBodyPtr, VectorN> >& q0, const std::vector<std::pair<DynamicBodyPtr, VectorN> >& q1, std::vector<Event>& contacts); 
+    void check_geoms(Real dt, CollisionGeometryPtr a, CollisionGeometryPtr b, const VectorN& qa0, const VectorN& qa1, const VectorN& qb0, const VectorN& qb1, std::vector<Event>& contacts); 
+    void broad_phase(const std::vector<std::pair<DynamicBodyPtr, VectorN> >& q0, const std::vector<std::pair<DynamicBodyPtr, VectorN> >& q1, std::vector<std::pair<CollisionGeometryPtr, CollisionGeometryPtr> >& to_check);
     void build_BV_tree(CollisionGeometryPtr geom);
     bool split(BVPtr source, BVPtr& tgt1, BVPtr& tgt2, const Vector3& axis, bool deformable);
     void split_tris(const Vector3& point, const Vector3& normal, const IndexedTriArray& orig_mesh, const std::list<unsigned>& ofacets, std::list<unsigned>& pfacets, std::list<unsigned>& nfacets);
@@ -84,7 +97,6 @@ class C2ACCD : public CollisionDetection
     void determine_closest_features(const Triangle& ta, const Triangle& tb, Triangle::FeatureType& fa, Triangle::FeatureType& fb, std::vector<Vector3>& contact_points) const;
     void determine_closest_tris(CollisionGeometryPtr a, CollisionGeometryPtr b, const Matrix4& aTb, std::vector<std::pair<Triangle, Triangle> >& closest_tris) const;
     static DynamicBodyPtr get_super_body(CollisionGeometryPtr a);
-    static unsigned find_body(const std::vector<std::pair<DynamicBodyPtr, VectorN> >& q, DynamicBodyPtr body);
 
     template <class OutputIterator>
     OutputIterator intersect_BV_leafs(BVPtr a, BVPtr b, const Matrix4& aTb, CollisionGeometryPtr geom_a, CollisionGeometryPtr geom_b, OutputIterator output_begin) const;
@@ -100,6 +112,16 @@ class C2ACCD : public CollisionDetection
 
     // mapping from BVs to triangles contained within
     std::map<BVPtr, std::pair<boost::shared_ptr<const IndexedTriArray>, std::list<unsigned> > > _meshes;
+
+    // the broad phase
+    SweepAndPrune _sweep_and_prune;
+
+    // lock for the conservative advancement fronts
+    pthread_mutex_t _ca_fronts_mutex;
+
+    // SSR leaf pairs (and closest triangles) that determined the last
+    // conservative advancement step for each pair of geometries
+    std::map<std::pair<CollisionGeometryPtr, CollisionGeometryPtr>, std::vector<CAFeatures> > _ca_fronts;
 }; // end class
 
 // include inline functions
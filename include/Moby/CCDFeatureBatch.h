@@ -0,0 +1,74 @@
+/****************************************************************************
+ * Copyright 2011 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#ifndef _CCD_FEATURE_BATCH_H
+#define _CCD_FEATURE_BATCH_H
+
+#include <vector>
+#include <Moby/Types.h>
+#include <Moby/Vector3.h>
+#include <Moby/Triangle.h>
+
+namespace Moby {
+
+/// A batch of vertex / face and edge / edge features for continuous collision checking
+/**
+ * Each feature is four points moving at constant velocities: a vertex and
+ * the three vertices of a triangle, or the two endpoints of each of two
+ * edges.  The features first touch at the earliest time at which the four
+ * points are coplanar (a root of a cubic polynomial) and the vertex lies
+ * in the triangle (or the edges cross).  Points are stored in
+ * structure-of-arrays form so that the cubics and the inside tests are
+ * solved for four features at a time with AVX2 when Moby is built with
+ * AVX2 support and Real is double; otherwise a scalar kernel is used.
+ */
+class CCDFeatureBatch
+{
+  public:
+    enum FeatureType { eVertexFace, eEdgeEdge };
+
+    CCDFeatureBatch() { }
+    void clear();
+    void reserve(unsigned n);
+    void add_vertex_face(const Vector3& p, const Vector3& pdot, const Triangle& t, const Vector3& adot, const Vector3& bdot, const Vector3& cdot);
+    void add_edge_edge(const Vector3& p0, const Vector3& p0dot, const Vector3& p1, const Vector3& p1dot, const Vector3& q0, const Vector3& q0dot, const Vector3& q1, const Vector3& q1dot);
+    void calc_first_isects(Real dt, std::vector<Real>& toi) const;
+    void calc_contact(unsigned i, Real t, Vector3& point, Vector3& normal) const;
+
+    /// Gets the number of features in the batch
+    unsigned size() const { return _type.size(); }
+
+    /// Gets the type of the i'th feature
+    FeatureType get_type(unsigned i) const { return _type[i]; }
+
+  private:
+    // number of bisections used to locate a root of a cubic
+    static const unsigned NBISECTIONS = 48;
+
+    void add(FeatureType type, const Vector3* x, const Vector3* xdot);
+    Vector3 get_point(unsigned k, unsigned i, Real t) const;
+    void calc_first_isects_scalar(unsigned begin, unsigned end, Real dt, Real* toi) const;
+    #if defined(__AVX2__) && defined(BUILD_DOUBLE)
+    void calc_first_isects_AVX2(unsigned begin, unsigned end, Real dt, Real* toi) const;
+    #endif
+
+    /// The type of each feature
+    std::vector<FeatureType> _type;
+
+    /// Whether each feature is an edge / edge feature (1.0) or not (0.0)
+    std::vector<Real> _ee;
+
+    /// Coordinate j of point k of each feature
+    std::vector<Real> _x[4][3];
+
+    /// Coordinate j of the velocity of point k of each feature
+    std::vector<Real> _xdot[4][3];
+}; // end class
+
+} // end namespace
+
+#endif
+
@@ -9,6 +9,7 @@
 
 #include <Moby/SpatialRBInertia.h>
 #include <Moby/MatrixN.h>
+#include <Moby/MixedSolver.h>
 
 namespace Moby {
 
@@ -52,9 +53,12 @@ class CRBAlgorithm
     /// The joint space inertia matrix H (fixed base) or augmented matrix [I_0^c K; K^s H] (floating base, see [Featherstone 1987], p. 123) used to compute forward dynamics for floating bases
     MatrixN _M;
 
-    /// A factorization (or possibly inverse) of the matrix M; note that we compute this b/c we generally may need to solve multiple systems of linear equations using this matrix as a LHS at different times -- always in global frame
+    /// The pseudo-inverse of the matrix M, if M is rank-deficient
     MatrixN _fM;
 
+    /// The (Cholesky) factorization of M; note that we compute this b/c we generally may need to solve multiple systems of linear equations using this matrix as a LHS at different times -- always in global frame
+    MixedSolver _M_solver;
+
     /// Determines whether the system of equations for forward dynamics is rank-deficient
      bool _rank_deficient;
 
@@ -0,0 +1,53 @@
+/****************************************************************************
+ * Copyright 2011 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public 
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#ifndef _CSR_ADJACENCY_H
+#define _CSR_ADJACENCY_H
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+namespace Moby {
+
+/// Adjacency relation stored in compressed sparse row form
+/**
+ * The elements adjacent to row i are indices[offsets[i]] ... 
+ * indices[offsets[i+1]-1], stored contiguously and in ascending order.  
+ * Rows are returned as pairs of pointers, so they can be traversed with 
+ * BOOST_FOREACH.
+ */
+struct CSRAdjacency
+{
+  typedef std::pair<const unsigned*, const unsigned*> Row;
+
+  /// Offsets of each row into indices (size is one more than the number of rows)
+  std::vector<unsigned> offsets;
+
+  /// The adjacent elements of all rows, concatenated
+  std::vector<unsigned> indices;
+
+  /// Gets the number of rows
+  unsigned size() const { return (offsets.empty()) ? 0 : offsets.size() - 1; }
+
+  /// Gets the number of elements adjacent to row i
+  unsigned degree(unsigned i) const { return offsets[i+1] - offsets[i]; }
+
+  /// Gets the elements adjacent to row i
+  Row row(unsigned i) const 
+  { 
+    const unsigned* base = (indices.empty()) ? NULL : &indices.front();
+    return std::make_pair(base + offsets[i], base + offsets[i+1]); 
+  }
+
+  /// Determines whether element j is adjacent to row i (in logarithmic time)
+  bool contains(unsigned i, unsigned j) const { Row r = row(i); return std::binary_search(r.first, r.second, j); }
+}; // end struct
+
+} // end namespace
+
+#endif
+
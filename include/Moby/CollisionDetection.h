@@ -16,6 +16,7 @@
 #include <Moby/Matrix4.h>
 #include <Moby/RigidBody.h>
 #include <Moby/DeformableBody.h>
+#include <Moby/SweepAndPrune.h>
 
 namespace Moby {
 
@@ -36,6 +37,15 @@ struct CollidingTriPair
   const IndexedTriArray* mesh2;  // second triangle mesh
 };
 
+/// Structure for holding the result of casting a ray against the collision geometries
+struct RayCastHit
+{
+  CollisionGeometryPtr geom;     // geometry hit first by the ray (null if none)
+  Real dist;                     // distance along the ray to the hit
+  Vector3 point;                 // point of the hit (global frame)
+  Vector3 normal;                // normal to the geometry at the hit (global frame)
+};
+
 /// Defines an abstract collision detection mechanism
 /**
  * Contact finding and collision detection are two separate, but related, 
@@ -68,6 +78,8 @@ class CollisionDetection : public virtual Base
     virtual void set_enabled(BasePtr b1, BasePtr b2, bool enabled);
     virtual void set_enabled(BasePtr b, bool enabled);
     bool is_checked(CollisionGeometryPtr cg1, CollisionGeometryPtr cg2) const;
+    bool is_collision_incremental();
+    void ray_cast_batch(const std::vector<std::pair<Vector3, Vector3> >& rays, Real max_dist, std::vector<RayCastHit>& hits);
 
     /// Get the shared pointer for this
     boost::shared_ptr<CollisionDetection> get_this() { return boost::dynamic_pointer_cast<CollisionDetection>(shared_from_this()); }
@@ -106,6 +118,9 @@ class CollisionDetection : public virtual Base
      *        bodies is less than epsilon
      * \note implementing classes must store the colliding pairs in 
      *         _colliding_pairs
+     * \note if return_all_contacts is <b>false</b>, implementations may stop
+     *         checking once a colliding pair has been found, so that not all
+     *         colliding pairs are reported
      */
     virtual bool is_collision(Real epsilon = 0.0) = 0;
 
@@ -162,6 +177,15 @@ class CollisionDetection : public virtual Base
 
   protected:
 
+    /// Checks a pair of geometries for intersection (see check_pairs())
+    /**
+     * \param data the data passed to check_pairs()
+     * \param g1Tg2 the transform from g2's frame to g1's frame
+     * \param tris intersecting pairs of triangles are appended to this list
+     * \return <b>true</b> if the geometries intersect
+     */
+    typedef bool (*PairCheck)(void* data, CollisionGeometryPtr g1, CollisionGeometryPtr g2, const Matrix4& g1Tg2, std::list<CollidingTriPair>& tris);
+
     template <class OutputIterator>
     OutputIterator get_single_bodies(OutputIterator output_begin) const;
 
@@ -172,9 +196,22 @@ class CollisionDetection : public virtual Base
     OutputIterator get_dynamic_bodies(OutputIterator output_begin) const;
 
     static Real calc_distance(CollisionGeometryPtr a, CollisionGeometryPtr b, const Matrix4& aTb, Vector3& cpa, Vector3& cpb); 
+    static void calc_AABB(CollisionGeometryPtr geom, BVPtr root, Vector3& lo, Vector3& hi);
+    static void calc_swept_AABBs(const std::vector<std::pair<DynamicBodyPtr, VectorN> >& q0, const std::vector<std::pair<DynamicBodyPtr, VectorN> >& q1, const std::vector<CollisionGeometryPtr>& geoms, const std::vector<BVPtr>& roots, std::vector<std::pair<Vector3, Vector3> >& bounds);
+    static void schedule_pairs(const std::vector<std::pair<unsigned, unsigned> >& body_pairs, std::vector<std::vector<unsigned> >& batches);
+    static bool query_intersect(CollisionGeometryPtr a, CollisionGeometryPtr b, const Matrix4& aTb);
+    void get_checked_pairs(std::vector<std::pair<CollisionGeometryPtr, CollisionGeometryPtr> >& pairs);
+    bool check_pairs(PairCheck check, void* data);
 
     /// The set of geometries checked by the collision detector
     std::set<CollisionGeometryPtr> _geoms;
+
+  private:
+    /// Relative transforms of the pairs found not to be intersecting by the last call to is_collision_incremental()
+    std::map<sorted_pair<CollisionGeometryPtr>, Matrix4> _validated;
+
+    /// The broad phase for is_collision_incremental()
+    SweepAndPrune _validation_broad_phase;
 }; // end class
 
 #include "CollisionDetection.inl"
@@ -0,0 +1,95 @@
+/****************************************************************************
+ * Copyright 2011 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#ifndef _COLLISION_QUERY_H
+#define _COLLISION_QUERY_H
+
+#include <map>
+#include <vector>
+#include <utility>
+#include <Moby/Types.h>
+#include <Moby/Vector3.h>
+#include <Moby/Matrix4.h>
+#include <Moby/Triangle.h>
+
+namespace Moby {
+
+class CollisionDetection;
+
+/// Answers collision and distance queries for a fixed set of geometries at arbitrary poses of their bodies
+/**
+ * The bounding volume hierarchies and triangles of the geometries are copied
+ * when the object is constructed.  Queries take a configuration--the pose
+ * (transform from body frame to global frame) of each body returned by
+ * get_bodies()--and never modify bodies, geometries, or primitives, so
+ * queries (for example, those issued by a motion planner that evaluates
+ * many candidate configurations) may be made from multiple threads at once.
+ * Geometries that are not attached to a rigid body (e.g., those of 
+ * deformable bodies) keep their pose at construction.
+ * \note geometries are treated as rigid; deformable geometries keep their
+ *       shape at construction
+ */
+class CollisionQuery
+{
+  public:
+    CollisionQuery(const CollisionDetection& cd);
+    CollisionQuery(const std::vector<CollisionGeometryPtr>& geoms);
+    void set_enabled(CollisionGeometryPtr g1, CollisionGeometryPtr g2, bool enabled);
+    void get_current_configuration(std::vector<Matrix4>& config) const;
+    bool is_collision(const std::vector<Matrix4>& config) const;
+    Real calc_distance(const std::vector<Matrix4>& config) const;
+    void check_collisions(const std::vector<std::vector<Matrix4> >& configs, std::vector<bool>& colliding) const;
+    void calc_distances(const std::vector<std::vector<Matrix4> >& configs, std::vector<Real>& distances) const;
+
+    /// Gets the bodies whose poses make up a configuration (in order)
+    const std::vector<RigidBodyPtr>& get_bodies() const { return _bodies; }
+
+    /// Gets the geometries that are queried
+    const std::vector<CollisionGeometryPtr>& get_geometries() const { return _geoms; }
+
+  private:
+    /// A node of a bounding volume hierarchy, with the data needed for queries
+    struct Node
+    {
+      BVPtr bv;                       // the bounding volume
+      Vector3 center;                 // the center of a sphere bounding the node
+      Real radius;                    // the radius of the sphere
+      std::vector<unsigned> children; // the indices of the child nodes
+      std::vector<Triangle> tris;     // the triangles of a leaf
+    };
+
+    /// Indicates that a geometry is not attached to a rigid body
+    static const unsigned NO_BODY;
+
+    void add_geometry(CollisionGeometryPtr geom);
+    static unsigned build_nodes(PrimitivePtr primitive, BVPtr bv, std::vector<Node>& nodes, std::vector<Vector3>& verts);
+    void calc_transforms(const std::vector<Matrix4>& config, std::vector<Matrix4>& transforms) const;
+    bool is_collision(unsigned a, unsigned b, const Matrix4& aTb) const;
+    Real calc_distance(unsigned a, unsigned b, const Matrix4& aTb, Real max_dist) const;
+
+    /// The geometries
+    std::vector<CollisionGeometryPtr> _geoms;
+
+    /// The rigid bodies
+    std::vector<RigidBodyPtr> _bodies;
+
+    /// The index of the body of each geometry (or NO_BODY)
+    std::vector<unsigned> _body_index;
+
+    /// The transform from the geometry frame to the body frame (or to the global frame if there is no body) of each geometry
+    std::vector<Matrix4> _bTg;
+
+    /// The flattened bounding volume hierarchy of each geometry; node zero is the root
+    std::vector<std::vector<Node> > _nodes;
+
+    /// The pairs of geometries (indices into _geoms) that are checked
+    std::vector<std::pair<unsigned, unsigned> > _pairs;
+}; // end class
+
+} // end namespace
+
+#endif
+
@@ -89,6 +89,10 @@ class CompGeom
     static Real calc_closest_points(const LineSeg3& s1, const LineSeg3& s2, Vector3& p1, Vector3& p2); 
     static bool query_intersect_tri_tri(const Triangle& t1, const Triangle& t2);
     static PolygonLocationType in_tri(const Triangle& t, const Vector3& p, Real tol = NEAR_ZERO);
+    static Real orient_2D(const Vector2& a, const Vector2& b, const Vector2& c);
+    static Real orient_3D(const Vector3& a, const Vector3& b, const Vector3& c, const Vector3& d);
+    static Real in_circle(const Vector2& a, const Vector2& b, const Vector2& c, const Vector2& d);
+    static Real in_sphere(const Vector3& a, const Vector3& b, const Vector3& c, const Vector3& d, const Vector3& e);
 
     /// Returns a if b > 0, -a if b < 0, and 0 if b = 0
     static Real sgn(Real a, Real b, Real tol = NEAR_ZERO) { if (b > NEAR_ZERO) return a; else if (b < -NEAR_ZERO) return -a; else return 0.0; }
@@ -252,6 +256,11 @@ class CompGeom
     static bool test_edge_tri(const Vector3& a, const Vector3& b, const Triangle& t, unsigned i0, unsigned i1);
     static bool test_point_in_tri(const Vector3& p, const Triangle& t, unsigned i0, unsigned i1);
     static bool test_coplanar_tri_tri(const Vector3& N, const Triangle& t1, const Triangle& t2);
+    static bool query_intersect_tri_tri(const Vector3& p1, const Vector3& q1, const Vector3& r1, const Vector3& p2, const Vector3& q2, const Vector3& r2, Real dp2, Real dq2, Real dr2, const Triangle& t1, const Triangle& t2);
+    static bool check_min_max(const Vector3& p1, const Vector3& q1, const Vector3& r1, const Vector3& p2, const Vector3& q2, const Vector3& r2);
+    static bool query_intersect_coplanar_tri_tri(const Triangle& t1, const Triangle& t2);
+    static bool query_intersect_tri_tri_sep_axes(const Triangle& t1, const Triangle& t2);
+    static void calc_convex_hull_2D(std::vector<Vector2*>& points, std::vector<Vector2*>& hull);
 
     #ifdef THREADSAFE
     static pthread_mutex_t _qhull_mutex;
@@ -1636,7 +1636,7 @@ bool CompGeomSpecOne<InputIterator, Vector2>::ccw(InputIterator begin, InputIter
   return true;
 }
 
-/// Calculates the convex hull of a set of points in 2D using quickhull
+/// Calculates the convex hull of a set of points in 2D (see calc_convex_hull_2D())
 /**
  * \param source_begin an iterator to the beginning of a container of Vector2*
  * \param source_end an iterator pointing to the end of a container of Vector2*
@@ -1648,148 +1648,20 @@ bool CompGeomSpecOne<InputIterator, Vector2>::ccw(InputIterator begin, InputIter
 template <class InputIterator, class OutputIterator>
 OutputIterator CompGeomSpecTwo<InputIterator, OutputIterator, Vector2>::calc_convex_hull(InputIterator source_begin, InputIterator source_end, OutputIterator target_begin)
 {
-  const unsigned X = 0, Y = 1;
-  int exit_code;
-  int curlong, totlong;
-  char flags[] = "qhull Fx";
-  FILE* outfile, * errfile;
-  
   FILE_LOG(LOG_COMPGEOM) << "computing 2D convex hull of following points:" << std::endl;
   for (InputIterator i = source_begin; i != source_end; i++)
     FILE_LOG(LOG_COMPGEOM) << "  " << *i << std::endl;
- 
-  // setup constants for qhull
-  const int DIM = 2;
-  const int N_POINTS = (int) std::distance(source_begin, source_end);
-  const boolT IS_MALLOC = false;
-  if (N_POINTS <= 2)
-    return target_begin;
-  
-  // setup qhull outputs
-  if (LOGGING(LOG_COMPGEOM))
-  {
-    outfile=stdout;  
-    errfile=stderr;
-  }
-  else
-  {
-    outfile=NULL;
-    errfile=fopen("/dev/null", "w");
-    assert(errfile);
-  } 
 
- 
-  // setup the points
-  SAFESTATIC std::vector<coordT> qhull_points;
-  qhull_points.resize(N_POINTS*DIM);
-  coordT* points_begin = &qhull_points.front();
-  std::map<coordT*, Vector2*> vertex_map;
-  unsigned j=0;
+  // compute the hull
+  std::vector<Vector2*> points, hull;
   for (InputIterator i = source_begin; i != source_end; i++)
-  {
-    qhull_points[j] = (*i)[X];
-    qhull_points[j+1] = (*i)[Y];
-    vertex_map[points_begin+j] = &(*i);
-    j += DIM;
-  }
-
-  // lock the qhull mutex -- qhull is non-reentrant
-  #ifdef THREADSAFE
-  pthread_mutex_lock(&CompGeom::_qhull_mutex);
-  #endif  
-
-  // execute qhull  
-  exit_code = qh_new_qhull(DIM, N_POINTS, points_begin, IS_MALLOC, flags, outfile, errfile);
-  if (exit_code != 0)
-  {
-    // points are not collinear.. unsure of the error...
-    FILE_LOG(LOG_COMPGEOM) << "CompGeom::calc_convex_hull_2D() - unable to execute qhull on points:" << std::endl;
-    for (InputIterator i = source_begin; i != source_end; i++)
-      FILE_LOG(LOG_COMPGEOM) << "  " << *i << std::endl;
-
-    // free qhull memory
-    qh_freeqhull(!qh_ALL);
-    qh_memfreeshort(&curlong, &totlong);
+    points.push_back(&(*i));
+  CompGeom::calc_convex_hull_2D(points, hull);
 
-    // release the mutex, since we're not using qhull anymore
-    #ifdef THREADSAFE
-    pthread_mutex_unlock(&CompGeom::_qhull_mutex);
-    #endif
-
-    // close the error stream, if necessary
-    if (!LOGGING(LOG_COMPGEOM))
-      fclose(errfile);
-
-    return target_begin;
-  }
-
-  // ordered list of edges
-  std::map<Vector2*, std::list<Vector2*> > edges;
-  
-  // iterate through all facets  
-  for (facetT* facet=qh facet_list;facet && facet->next;facet=facet->next)
-  {
-    // setup a list of vertices for the facet
-    std::list<Vector2*> facet_vertices;
-    
-    // get all vertices in the facet
-    vertexT* vertex;
-    for (vertexT** vertex_pointer = (vertexT**)& ((facet->vertices)->e[0].p); (vertex = (*vertex_pointer++));)
-      facet_vertices.push_back(vertex_map[vertex->point]);
-    
-    // should be exactly two vertices in the list
-    assert(facet_vertices.size() == 2);
-    
-    // store the edge in the list of edges
-    edges[facet_vertices.front()].push_back(facet_vertices.back());
-    edges[facet_vertices.back()].push_back(facet_vertices.front());
-  }    
-  
-  // free qhull memory
-  qh_freeqhull(!qh_ALL);
-  qh_memfreeshort(&curlong, &totlong);
-
-  // release the qhull mutex
-  #ifdef THREADSAFE
-  pthread_mutex_unlock(&CompGeom::_qhull_mutex);
-  #endif  
-
-  // construct the set of processed vertex
-  std::set<Vector2*> processed;
-  
-  // construct the hull; compute the area at the same time of the 2D polygon
-  Vector2* current_vertex = edges.begin()->first;
-  std::list<Vector2> hull;
-
-  while (true)
-  {
-    // add the current vertex to the list
-    hull.push_back(*current_vertex);
-    
-    // mark this vertex as processed
-    processed.insert(current_vertex);
-    
-    // get adjacent vertices
-    std::list<Vector2*>& adj_v = edges[current_vertex];
-    
-    // see which vertices have been processed
-    if (processed.find(adj_v.front()) == processed.end())
-      current_vertex = adj_v.front();
-    else if (processed.find(adj_v.back()) == processed.end())
-      current_vertex = adj_v.back();
-    else
-      break;    
-  }
-
-  // close the error stream, if necessary
-  if (!LOGGING(LOG_COMPGEOM))
-    fclose(errfile);
-
-  // reverse the hull if necessary
-  if (!CompGeom::ccw(hull.begin(), hull.end()))  
-    return std::copy(hull.rbegin(), hull.rend(), target_begin);    
-  else
-    return std::copy(hull.begin(), hull.end(), target_begin);
+  // output the hull (in ccw order)
+  for (unsigned i=0; i< hull.size(); i++)
+    *target_begin++ = *hull[i];
+  return target_begin;
 }
 
 /*****************************************************************************
@@ -2347,7 +2219,7 @@ bool CompGeomSpecOne<InputIterator, Vector2*>::is_convex_polygon(InputIterator b
   return true;
 }
 
-/// Calculates the convex hull of a set of points in 2D using quickhull
+/// Calculates the convex hull of a set of points in 2D (see calc_convex_hull_2D())
 /**
  * \param source_begin an iterator to the beginning of a container of Vector2*
  * \param source_end an iterator pointing to the end of a container of Vector2*
@@ -2359,147 +2231,16 @@ bool CompGeomSpecOne<InputIterator, Vector2*>::is_convex_polygon(InputIterator b
 template <class InputIterator, class OutputIterator>
 OutputIterator CompGeomSpecTwo<InputIterator, OutputIterator, Vector2*>::calc_convex_hull(InputIterator source_begin, InputIterator source_end, OutputIterator target_begin)
 {
-  const unsigned X = 0, Y = 1;
-  int exit_code;
-  int curlong, totlong;
-  char flags[] = "qhull Fx";
-  FILE* outfile, * errfile;
-  
   FILE_LOG(LOG_COMPGEOM) << "computing 2D convex hull of following points:" << std::endl;
   for (InputIterator i = source_begin; i != source_end; i++)
-    FILE_LOG(LOG_COMPGEOM) << "  " << *i << std::endl;
-  
-  // setup qhull outputs
-  if (LOGGING(LOG_COMPGEOM))
-  {
-    outfile=stdout;  
-    errfile=stderr;
-  }
-  else
-  {
-    outfile=NULL;
-    errfile=fopen("/dev/null", "w");
-    assert(errfile);
-  } 
-
-  // setup constants for qhull
-  const int DIM = 2;
-  const int N_POINTS = (int) std::distance(source_begin, source_end);
-  const boolT IS_MALLOC = false;
-  assert(N_POINTS > 2);
-  
-  // setup the points
-  std::map<coordT*, Vector2*> vertex_map;
-  SAFESTATIC std::vector<coordT> qhull_points;
-  qhull_points.resize(N_POINTS*DIM);
-  coordT* points_begin = &qhull_points.front();
-  unsigned j=0;
-  for (InputIterator i = source_begin; i != source_end; i++)
-  {
-    qhull_points[j] = (**i)[X];
-    qhull_points[j+1] = (**i)[Y];
-    vertex_map[points_begin+j] = *i;
-    j += DIM;
-  }
-
-  // lock the qhull mutex -- qhull is non-reentrant
-  #ifdef THREADSAFE
-  pthread_mutex_lock(&CompGeom::_qhull_mutex);
-  #endif  
-
-  // execute qhull  
-  exit_code = qh_new_qhull(DIM, N_POINTS, points_begin, IS_MALLOC, flags, outfile, errfile);
-  if (exit_code != 0)
-  {
-    // points are not collinear.. unsure of the error...
-    FILE_LOG(LOG_COMPGEOM) << "CompGeom::calc_convex_hull_2D() - unable to execute qhull on points:" << std::endl;
-    for (InputIterator i = source_begin; i != source_end; i++)
-      FILE_LOG(LOG_COMPGEOM) << "  " << *i << std::endl;
-
-    // free qhull memory
-    qh_freeqhull(!qh_ALL);
-    qh_memfreeshort(&curlong, &totlong);
-
-    // release the mutex, since we're not using qhull anymore
-    #ifdef THREADSAFE
-    pthread_mutex_unlock(&CompGeom::_qhull_mutex);
-    #endif
-
-    // close the error stream, if necessary
-    if (!LOGGING(LOG_COMPGEOM))
-      fclose(errfile);
-
-    throw NumericalException(); 
-    return target_begin;
-  }
-
-  // ordered list of edges
-  std::map<Vector2*, std::list<Vector2*> > edges;
-  
-  // iterate through all facets  
-  for (facetT* facet=qh facet_list;facet && facet->next;facet=facet->next)
-  {
-    // setup a list of vertices for the facet
-    std::list<Vector2*> facet_vertices;
-    
-    // get all vertices in the facet
-    vertexT* vertex;
-    for (vertexT** vertex_pointer = (vertexT**)& ((facet->vertices)->e[0].p); (vertex = (*vertex_pointer++));)
-      facet_vertices.push_back(vertex_map[vertex->point]);
-    
-    // should be exactly two vertices in the list
-    assert(facet_vertices.size() == 2);
-    
-    // store the edge in the list of edges
-    edges[facet_vertices.front()].push_back(facet_vertices.back());
-    edges[facet_vertices.back()].push_back(facet_vertices.front());
-  }    
-  
-  // free qhull memory
-  qh_freeqhull(!qh_ALL);
-  qh_memfreeshort(&curlong, &totlong);
-
-  // release the qhull mutex
-  #ifdef THREADSAFE
-  pthread_mutex_unlock(&CompGeom::_qhull_mutex);
-  #endif  
-
-  // construct the set of processed vertex
-  std::set<Vector2*> processed;
-  
-  // construct the hull; compute the area at the same time of the 2D polygon
-  Vector2* current_vertex = edges.begin()->first;
-  std::list<Vector2*> hull;
-
-  while (true)
-  {
-    // add the current vertex to the list
-    hull.push_back(current_vertex);
-    
-    // mark this vertex as processed
-    processed.insert(current_vertex);
-    
-    // get adjacent vertices
-    std::list<Vector2*>& adj_v = edges[current_vertex];
-    
-    // see which vertices have been processed
-    if (processed.find(adj_v.front()) == processed.end())
-      current_vertex = adj_v.front();
-    else if (processed.find(adj_v.back()) == processed.end())
-      current_vertex = adj_v.back();
-    else
-      break;    
-  }
+    FILE_LOG(LOG_COMPGEOM) << "  " << **i << std::endl;
 
-  // close the error stream, if necessary
-  if (!LOGGING(LOG_COMPGEOM))
-    fclose(errfile);
+  // compute the hull
+  std::vector<Vector2*> points(source_begin, source_end), hull;
+  CompGeom::calc_convex_hull_2D(points, hull);
 
-  // reverse the hull if necessary
-  if (!CompGeom::ccw(hull.begin(), hull.end()))  
-    return std::copy(hull.rbegin(), hull.rend(), target_begin);    
-  else
-    return std::copy(hull.begin(), hull.end(), target_begin);
+  // output the hull (in ccw order)
+  return std::copy(hull.begin(), hull.end(), target_begin);
 }
 
 /*****************************************************************************
@@ -2987,10 +2728,10 @@ OutputIterator CompGeom::intersect_polygons(InputIterator pbegin, InputIterator
     Vector2 AX = pbegin[a] - pbegin[a1];
     Vector2 BX = qbegin[b] - qbegin[b1];
 
-    // determine signs of cross-products
-    OrientationType cross = area_sign(origin, AX, BX);
-    OrientationType aHB = area_sign(qbegin[b1], qbegin[b], pbegin[a]);
-    OrientationType bHA = area_sign(pbegin[a1], pbegin[a], qbegin[b]);
+    // determine signs of cross-products (exactly)
+    OrientationType cross = area_sign(origin, AX, BX, 0.0);
+    OrientationType aHB = area_sign(qbegin[b1], qbegin[b], pbegin[a], 0.0);
+    OrientationType bHA = area_sign(pbegin[a1], pbegin[a], qbegin[b], 0.0);
     
     // if A and B intersect, update inflag
     Vector2 p, q;
@@ -3099,15 +2840,16 @@ OutputIterator CompGeom::intersect_tris(const Triangle& t1, const Triangle& t2,
   }
 }
 
-/// Calculates the convex hull of a set of points in 2D using quickhull
+/// Calculates the convex hull of a set of points in 2D
 /**
  * \param source_begin an iterator to the beginning of a container of Vector2 
  *        or Vector2*
  * \param source_end an iterator pointing to the end of a container of Vector2
  *        or Vector2*
  * \param target_begin an iterator to the beginning of a container of indices;
- *         on return, contains the convex hull (NOTE: size of this container
- *         must be as large as the source container)
+ *         on return, contains the vertices of the convex hull in ccw order
+ *         (NOTE: size of this container must be as large as the source 
+ *         container); nothing is output if the points are collinear
  * \return the new end of the target container
  */
 template <class ForwardIterator, class OutputIterator>
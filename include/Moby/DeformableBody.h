@@ -87,6 +87,17 @@ class DeformableBody : public SingleBody
     /// Gets the shared pointer for <b>this</b>
     DeformableBodyPtr get_this() { return boost::dynamic_pointer_cast<DeformableBody>(shared_from_this()); }
 
+    /// Sets the volume growth ratio that triggers rebuilding the bounding volume hierarchy
+    /**
+     * When the nodes move, the AABB hierarchy is refit; it is rebuilt from 
+     * scratch only once the total volume of its boxes exceeds the total 
+     * volume at the last rebuild by this factor.
+     */
+    void set_bv_rebuild_threshold(Real threshold) { _bv_rebuild_threshold = threshold; }
+
+    /// Gets the volume growth ratio that triggers rebuilding the bounding volume hierarchy
+    Real get_bv_rebuild_threshold() const { return _bv_rebuild_threshold; }
+
   protected:
     virtual const Matrix4* get_visualization_transform() { return &IDENTITY_4x4; }
     void calc_com_and_vels();
@@ -140,6 +151,7 @@ class DeformableBody : public SingleBody
 
   private:
     AABBPtr build_AABB_tree(std::map<BVPtr, std::list<unsigned> >& aabb_tetra_map);
+    Real refit_AABB_tree();
     void split_tetra(const Vector3& point, unsigned axis, const std::list<unsigned>& otetra, std::list<unsigned>& ptetra, std::list<unsigned>& ntetra);
     bool split(AABBPtr source, AABBPtr& tgt1, AABBPtr& tgt2, unsigned axis, const std::list<unsigned>& tetra, std::list<unsigned>& ptetra, std::list<unsigned>& ntetra);
 
@@ -158,6 +170,12 @@ class DeformableBody : public SingleBody
     /// The mapping from AABB leafs to tetra contained within
     std::map<BVPtr, std::list<unsigned> > _aabb_tetra_map;
 
+    /// The total volume of the boxes in the AABB hierarchy when last built
+    Real _hroot_volume;
+
+    /// The volume growth ratio that triggers rebuilding the AABB hierarchy 
+    Real _bv_rebuild_threshold;
+
     /// The triangle mesh primitive used for the collision geometry
     boost::shared_ptr<TriangleMeshPrimitive> _cgeom_primitive;
 
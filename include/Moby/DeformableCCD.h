@@ -50,6 +50,9 @@ class DeformableCCD : public CollisionDetection
     /// The tolerance below which subdivision does not occur
     Real eps_tolerance;
 
+    /// Determines whether deformable bodies are checked for self-collision
+    bool self_collisions;
+
   private:
 
     // the 3 axes
@@ -92,6 +95,13 @@ class DeformableCCD : public CollisionDetection
       Vector3 d;          // direction to compute deviation
     };
 
+    /// Normal cone bounding the normals of the triangles in a BV over a step
+    struct NormalCone
+    {
+      Vector3 axis;      // the (unit) axis of the cone
+      Real angle;        // the half-angle of the cone (>= pi/2 if unbounded)
+    };
+
     /// Structure used for BV processing
     struct BVProcess
     {
@@ -112,7 +122,12 @@ class DeformableCCD : public CollisionDetection
     void add_rigid_body_model(RigidBodyPtr body);
     Real determine_TOI(Real t0, Real tf, const DStruct* ds, Vector3& pt, Vector3& normal) const;
     BVPtr get_vel_exp_BV(CollisionGeometryPtr g, BVPtr bv, const Vector3& lv, const Vector3& av);
-    bool intersect_BV_trees(boost::shared_ptr<BV> a, boost::shared_ptr<BV> b, const Matrix4& aTb, CollisionGeometryPtr geom_a, CollisionGeometryPtr geom_b);
+    bool intersect_BV_trees(boost::shared_ptr<BV> a, boost::shared_ptr<BV> b, const Matrix4& aTb, CollisionGeometryPtr geom_a, CollisionGeometryPtr geom_b, std::list<CollidingTriPair>& tris);
+    static bool check_pair(void* data, CollisionGeometryPtr g1, CollisionGeometryPtr g2, const Matrix4& g1Tg2, std::list<CollidingTriPair>& tris);
+    static NormalCone merge_cones(const NormalCone& c1, const NormalCone& c2);
+    static Real calc_dist_2D(const LineSeg2& s1, const LineSeg2& s2);
+    static void calc_normal_cones(CollisionGeometryPtr cg, BVPtr root, Real max_mvmt, std::map<BVPtr, NormalCone>& cones);
+    static bool is_self_collision_free(CollisionGeometryPtr cg, BVPtr bv, const NormalCone& cone, Real max_mvmt);
     static Event create_contact(Real toi, CollisionGeometryPtr a, CollisionGeometryPtr b, const Vector3& point, const Vector3& normal);
     void check_vertices(Real dt, CollisionGeometryPtr a, CollisionGeometryPtr b, BVPtr ob, const std::vector<const Vector3*>& a_verts, const Matrix4& bTa_t0, const std::pair<Vector3, Vector3>& a_vel, const std::pair<Vector3, Vector3>& b_vel, Real& earliest, std::vector<Event>& local_contacts, bool self_check) const;
     void check_geoms(Real dt, CollisionGeometryPtr a, CollisionGeometryPtr b, const Matrix4& aTb_t0, const Matrix4& bTa_t0, const std::pair<Vector3, Vector3>& a_vel, const std::pair<Vector3, Vector3>& b_vel, std::vector<Event>& contacts); 
@@ -9,6 +9,7 @@ template <class InputIterator>
 DeformableCCD::DeformableCCD(InputIterator begin, InputIterator end) 
 {
   eps_tolerance = std::sqrt(std::numeric_limits<Real>::epsilon()); 
+  self_collisions = false;
   while (begin != end) 
     add_dynamic_body(*begin++); 
 }
@@ -0,0 +1,55 @@
+/****************************************************************************
+ * Copyright 2011 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#ifndef _DELASSUS_OPERATOR_H
+#define _DELASSUS_OPERATOR_H
+
+#include <Moby/DynamicBody.h>
+#include <Moby/SparseMatrixN.h>
+
+namespace Moby {
+
+/// Applies the Delassus operator J*inv(M)*J' of a body without forming it
+/**
+ * inv(M) is applied using the body's dynamics algorithm (e.g., the
+ * articulated body algorithm) through
+ * DynamicBody::solve_generalized_inertia(), so neither M nor J*inv(M)*J' is
+ * ever formed.  To use with the Krylov solvers, set the operator of a
+ * KrylovParams to DelassusOperator::mult and its data to a pointer to this
+ * object.
+ */
+class DelassusOperator
+{
+  public:
+    /// Constructs the operator for the given Jacobian and body
+    /**
+     * \param J the Jacobian, whose columns correspond to the generalized
+     *        coordinates of the body; J must outlive this object
+     * \param body the body whose generalized inertia M is used
+     * \param gctype the generalized coordinate type of the columns of J
+     */
+    DelassusOperator(const SparseMatrixN& J, DynamicBodyPtr body, DynamicBody::GeneralizedCoordinateType gctype = DynamicBody::eAxisAngle) : _J(J), _body(body), _gctype(gctype) { }
+
+    /// Operator callback that computes y = J*inv(M)*J'*x (op is a DelassusOperator*)
+    static void mult(const VectorN& x, VectorN& y, void* op)
+    {
+      DelassusOperator& d = *((DelassusOperator*) op);
+      d._J.transpose_mult(x, d._JTx);
+      d._body->solve_generalized_inertia(d._gctype, d._JTx, d._iM_JTx);
+      d._J.mult(d._iM_JTx, y);
+    }
+
+  private:
+    const SparseMatrixN& _J;
+    DynamicBodyPtr _body;
+    DynamicBody::GeneralizedCoordinateType _gctype;
+    VectorN _JTx, _iM_JTx;
+}; // end class
+
+} // end namespace
+
+#endif
+
@@ -117,6 +117,16 @@ class EventDrivenSimulator : public Simulator
     /// System time spent by event handling on the last step
     Real event_stime;
 
+    /// The number of event checks between checks for interpenetration
+    /**
+     * Interpenetration is checked only in debug builds; zero disables
+     * the checks.
+     */
+    unsigned validation_interval;
+
+    /// Whether checks for interpenetration re-test only pairs of geometries that may have changed
+    bool incremental_validation;
+
   private:
     void preprocess_event(Event& e);
     void check_violation();
@@ -137,6 +147,9 @@ class EventDrivenSimulator : public Simulator
     /// Determines whether the simulation constraints have been violated
     bool _simulation_violated;
 
+    /// The number of event checks since the last check for interpenetration
+    unsigned _validation_counter;
+
     /// The vector of events
     std::vector<Event> _events;
 
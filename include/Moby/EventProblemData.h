@@ -33,6 +33,9 @@ struct EventProblemData
     N_CONSTRAINT_DOF_IMP = q.N_CONSTRAINT_DOF_IMP;
     use_kappa = q.use_kappa;
     kappa = q.kappa;
+    use_ip_solver = q.use_ip_solver;
+    ip_max_iterations = q.ip_max_iterations;
+    ip_eps = q.ip_eps;
 
     // copy indices
     ALPHA_C_IDX = q.ALPHA_C_IDX;
@@ -104,6 +107,9 @@ struct EventProblemData
     N_LIMITS = N_CONSTRAINT_DOF_IMP = 0;
     use_kappa = false;
     kappa = (Real) 0.0;
+    use_ip_solver = false;
+    ip_max_iterations = 100;
+    ip_eps = (Real) 1e-6;
 
     // clear all indices
     N_VARS = 0;
@@ -279,6 +285,13 @@ struct EventProblemData
   // determines whether to use kappa term
   bool use_kappa;
 
+  // determines whether to solve the QP using the interior-point solver
+  bool use_ip_solver;
+
+  // the maximum number of iterations and tolerance for the interior-point solver
+  unsigned ip_max_iterations;
+  Real ip_eps;
+
   // impulse magnitudes determined by solve_qp()
   VectorN alpha_c, beta_c, alpha_l, beta_t, alpha_x, beta_x;
 
@@ -16,6 +16,7 @@
 #include <Moby/CollisionDetection.h>
 #include <Moby/ThickTriangle.h>
 #include <Moby/BV.h>
+#include <Moby/SweepAndPrune.h>
 #include <Moby/Integrator.h>
 
 namespace Moby {
@@ -51,20 +52,6 @@ class GeneralizedCCD : public CollisionDetection
 
   private:
 
-    // the 3 axes
-    enum AxisType { eXAxis, eYAxis, eZAxis };
-
-    // structure for doing broad phase collision detection
-    struct BoundsStruct
-    {
-      bool end;                   // bounds is for start or end
-      CollisionGeometryPtr geom;  // the geometry
-      Vector3 xd;                 // the linear velocity of the rigid body
-      Vector3 omega;              // the angular velocity of the rigid body
-      BVPtr bv;                   // the unexpanded bounding volume
-      bool operator<(const BoundsStruct& bs) const { return (!end && bs.end); } 
-    };
-
     // structure passed to determine_TOI
     struct DStruct
     {
@@ -111,19 +98,14 @@ class GeneralizedCCD : public CollisionDetection
     void add_rigid_body_model(RigidBodyPtr body);
     Real determine_TOI(Real t0, Real tf, const DStruct* ds, Vector3& pt, Vector3& normal) const;
     BVPtr get_vel_exp_BV(CollisionGeometryPtr g, BVPtr bv, const Vector3& lv, const Vector3& av);
-    bool intersect_BV_trees(boost::shared_ptr<BV> a, boost::shared_ptr<BV> b, const Matrix4& aTb, CollisionGeometryPtr geom_a, CollisionGeometryPtr geom_b);
+    bool intersect_BV_trees(boost::shared_ptr<BV> a, boost::shared_ptr<BV> b, const Matrix4& aTb, CollisionGeometryPtr geom_a, CollisionGeometryPtr geom_b, std::list<CollidingTriPair>& tris);
+    static bool check_pair(void* data, CollisionGeometryPtr g1, CollisionGeometryPtr g2, const Matrix4& g1Tg2, std::list<CollidingTriPair>& tris);
     static Event create_contact(Real toi, CollisionGeometryPtr a, CollisionGeometryPtr b, const Vector3& point, const Vector3& normal);
     void check_vertices(Real dt, CollisionGeometryPtr a, CollisionGeometryPtr b, BVPtr ob, const std::vector<const Vector3*>& a_verts, const Matrix4& bTa_t0, const std::pair<Vector3, Vector3>& a_vel, const std::pair<Vector3, Vector3>& b_vel, Real& earliest, std::vector<Event>& local_contacts) const;
     void check_geoms(Real dt, CollisionGeometryPtr a, CollisionGeometryPtr b, const Matrix4& aTb_t0, const Matrix4& bTa_t0, const std::pair<Vector3, Vector3>& a_vel, const std::pair<Vector3, Vector3>& b_vel, std::vector<Event>& contacts); 
     void broad_phase(const std::map<SingleBodyPtr, std::pair<Vector3, Vector3> >& vel_map, std::vector<std::pair<CollisionGeometryPtr, CollisionGeometryPtr> >& to_check);
-    void sort_AABBs(const std::map<SingleBodyPtr, std::pair<Vector3, Vector3> >& vel_map);
-    void update_bounds_vector(std::vector<std::pair<Real, BoundsStruct> >& bounds, const std::map<SingleBodyPtr, std::pair<Vector3, Vector3> >& vel_map, AxisType axis);
-    void build_bv_vector(const std::map<SingleBodyPtr, std::pair<Vector3, Vector3> >& vel_map, std::vector<std::pair<Real, BoundsStruct> >& bounds);
     std::map<SingleBodyPtr, std::pair<Vector3, Vector3> > get_velocities(const std::vector<std::pair<DynamicBodyPtr, VectorN> >& q0, const std::vector<std::pair<DynamicBodyPtr, VectorN> >& q1, Real dt) const;
 
-    template <class RandomAccessIterator>
-    void insertion_sort(RandomAccessIterator begin, RandomAccessIterator end);
-
     template <class OutputIterator>
     OutputIterator intersect_BV_leafs(BVPtr a, BVPtr b, const Matrix4& aTb, CollisionGeometryPtr geom_a, CollisionGeometryPtr geom_b, OutputIterator output_begin) const;
 
@@ -136,17 +118,8 @@ class GeneralizedCCD : public CollisionDetection
     // lock for the velocity-expanded BVs
     pthread_mutex_t _ve_BVs_mutex;
 
-    /// AABB bounds (x-axis)
-    std::vector<std::pair<Real, BoundsStruct> > _x_bounds;
-
-    /// AABB bounds (y-axis)
-    std::vector<std::pair<Real, BoundsStruct> > _y_bounds;
-
-    /// AABB bounds (z-axis)
-    std::vector<std::pair<Real, BoundsStruct> > _z_bounds;
-
-    /// Indicates when bounds vectors need to be rebuilt
-    bool _rebuild_bounds_vecs;
+    /// The broad phase
+    SweepAndPrune _sweep_and_prune;
 
     /// Maximum depth of OBB expansions (default is inf)
     unsigned _max_dexp;
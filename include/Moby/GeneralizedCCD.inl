@@ -74,27 +74,3 @@ OutputIterator GeneralizedCCD::intersect_BV_leafs(BVPtr a, BVPtr b, const Matrix
   return output_begin;
 } 
 
-/// Does insertion sort -- custom comparison function not supported (uses operator<)
-template <class BidirectionalIterator>
-void GeneralizedCCD::insertion_sort(BidirectionalIterator first, BidirectionalIterator last)
-{
-  // safety check; exit if nothing to do
-  if (first == last)
-    return;
-
-  BidirectionalIterator min = first;
-
-  // loop
-  BidirectionalIterator i = first;
-  i++;
-  for (; i != last; i++)
-    if (*i < *min)
-      min = i;
-
-  // swap the iterators
-  std::iter_swap(first, min);
-  while (++first != last)
-    for (BidirectionalIterator j = first; *j < *(j-1); --j)
-      std::iter_swap((j-1), j);
-}
-
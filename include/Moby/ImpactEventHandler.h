@@ -139,6 +139,7 @@ class ImpactEventHandler
     static void solve_qp_work(EventProblemData& epd, VectorN& z);
     static void solve_qp_work_general(EventProblemData& epd, VectorN& z);
     static void solve_qp_work_ijoints(EventProblemData& epd, VectorN& z);
+    static bool solve_qp_work_ip(const EventProblemData& epd, const MatrixN& H, const VectorN& c, const MatrixN& A, const VectorN& nb, const std::vector<unsigned>& P, VectorN& z);
     static Real calc_ke(EventProblemData& epd, const VectorN& z);
     static bool opt_satisfied(const EventProblemData& q, const std::vector<bool>& working_set, Real& KE, VectorN& x, unsigned j);
     static void update_problem(const EventProblemData& qorig, EventProblemData& qnew);
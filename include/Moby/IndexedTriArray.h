@@ -10,6 +10,8 @@
 #include <iostream>
 #include <cmath>
 #include <list>
+#include <map>
+#include <vector>
 #include <string>
 #include <boost/foreach.hpp>
 #include <Moby/sorted_pair>
@@ -17,6 +19,7 @@
 #include <Moby/Triangle.h>
 #include <Moby/InvalidIndexException.h>
 #include <Moby/IndexedTri.h>
+#include <Moby/CSRAdjacency.h>
 
 namespace Moby {
 
@@ -43,7 +46,11 @@ class IndexedTriArray
     IndexedTriArray rotate_scale(const Matrix3& T) const;
     IndexedTriArray translate(const Vector3& v) const;
     IndexedTriArray compress_vertices() const;
+    static IndexedTriArray read_from_file(const std::string& filename, Real weld_tol = 0.0);
     static IndexedTriArray read_from_obj(const std::string& filename);
+    static IndexedTriArray read_from_stl(const std::string& filename, Real weld_tol = 0.0);
+    static IndexedTriArray read_from_ply(const std::string& filename);
+    static bool is_mesh_file(const std::string& filename);
     static void write_to_obj(const IndexedTriArray& mesh, const std::string& filename);
     void write_to_obj(const std::string& filename) const { write_to_obj(*this, filename); }
     static IndexedTriArray merge(const IndexedTriArray& mesh1, const IndexedTriArray& mesh2, Real equal_tol = 0.0);
@@ -51,10 +58,17 @@ class IndexedTriArray
     std::vector<std::list<unsigned> > determine_vertex_edge_map() const;
     std::vector<std::list<unsigned> > determine_vertex_facet_map() const;
     std::map<sorted_pair<unsigned>, std::list<unsigned> > determine_edge_facet_map() const;
+    CSRAdjacency calc_vertex_facet_adjacency() const;
+    CSRAdjacency calc_vertex_edge_adjacency() const;
+    void calc_edge_facet_adjacency(std::vector<sorted_pair<unsigned> >& edges, CSRAdjacency& edge_facets) const;
+    static unsigned find_edge(const std::vector<sorted_pair<unsigned> >& edges, unsigned v1, unsigned v2);
     void calc_volume_ints(Real volume_ints[10]) const;
 
-    /// Gets the indices of facets incident to a vertex
-    const std::list<unsigned>& get_incident_facets(unsigned i) const { if (i >= _vertices->size()) throw InvalidIndexException(); return (*_incident_facets)[i]; }
+    /// Gets the (ascending) indices of facets incident to a vertex
+    CSRAdjacency::Row get_incident_facets(unsigned i) const { if (i >= _vertices->size()) throw InvalidIndexException(); return _incident_facets->row(i); }
+
+    /// Gets the facets incident to every vertex
+    const CSRAdjacency& get_vertex_facet_adjacency() const { return *_incident_facets; }
 
     /// Gets the pointer to the vector of facets
     boost::shared_ptr<const std::vector<IndexedTri> > get_facets_pointer() const { return _facets; }
@@ -76,9 +90,12 @@ class IndexedTriArray
 
   private:
     void determine_coplanar_features();
+    static bool coplanar_facets(CSRAdjacency::Row facets, const std::vector<IndexedTri>& f, const std::vector<Vector3>& v);
     static bool query_intersect_tri_tri(const Triangle& t1, const Triangle& t2);
     void validate() const;
     void calc_incident_facets();
+    static IndexedTriArray create_from_parsed(boost::shared_ptr<std::vector<Vector3> > vertices, boost::shared_ptr<std::vector<IndexedTri> > facets, const std::string& filename);
+    static void weld_vertices(const std::vector<double>& xyz, Real tol, std::vector<Vector3>& vertices, std::vector<unsigned>& vmap);
 
     /// Sorted vector of coplanar edges (all facets touching each edge are coplanar)
     std::vector<sorted_pair<unsigned> > _coplanar_edges;
@@ -88,7 +105,7 @@ class IndexedTriArray
 
     boost::shared_ptr<const std::vector<IndexedTri> > _facets;
     boost::shared_ptr<const std::vector<Vector3> > _vertices;
-    boost::shared_ptr<const std::vector<std::list<unsigned > > > _incident_facets;
+    boost::shared_ptr<const CSRAdjacency> _incident_facets;
 }; // end class
 
 // include inline methods
@@ -0,0 +1,136 @@
+/****************************************************************************
+ * Copyright 2011 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#ifndef _KRYLOV_H
+#define _KRYLOV_H
+
+#include <vector>
+#include <limits>
+#include <Moby/Constants.h>
+#include <Moby/SparseMatrixN.h>
+#include <Moby/MatrixN.h>
+
+namespace Moby {
+
+/// Parameters, operators, and statistics for the Krylov subspace solvers
+/**
+ * The coefficient matrix is only accessed through the operator callbacks, so
+ * it need never be formed.  Each callback receives the corresponding data
+ * pointer as its last argument.
+ */
+struct KrylovParams
+{
+  KrylovParams();
+  KrylovParams(unsigned n, void (*mult)(const VectorN&, VectorN&, void*), void* data);
+
+  /// The number of columns of the coefficient matrix A
+  unsigned n;
+
+  /// Computes y = A*x
+  void (*mult)(const VectorN& x, VectorN& y, void* data);
+
+  /// Computes y = A'*x (needed only by lsqr())
+  void (*transpose_mult)(const VectorN& x, VectorN& y, void* data);
+
+  /// The data passed to mult() and transpose_mult()
+  void* data;
+
+  /// Computes z = inv(P)*r for a symmetric positive definite preconditioner P (NULL if unpreconditioned)
+  void (*precond)(const VectorN& r, VectorN& z, void* data);
+
+  /// The data passed to precond()
+  void* precond_data;
+
+  /// The tolerance on the residual norm, relative to the norm of the right hand side
+  /**
+   * minres() measures both norms in the norm defined by the inverse of the
+   * preconditioner.
+   */
+  Real tol;
+
+  /// The damping parameter (lsqr() minimizes ||A*x - b||^2 + damp^2*||x||^2)
+  Real damp;
+
+  /// The maximum number of iterations
+  unsigned max_iterations;
+
+  /// The number of iterations performed (on return)
+  unsigned iterations;
+
+  /// The (estimated) relative residual norm (on return)
+  Real residual;
+};
+
+/// Krylov subspace solvers for linear systems given by operators
+/**
+ * pcg() solves symmetric positive definite systems, minres() solves symmetric
+ * (possibly indefinite or singular) systems, and lsqr() solves least squares
+ * problems.  The initial iterate is taken from x if it has the proper size
+ * and is zero otherwise.  Each solver returns <b>true</b> if the relative
+ * residual tolerance was met within the iteration budget.
+ */
+class Krylov
+{
+  public:
+    static bool pcg(KrylovParams& params, const VectorN& b, VectorN& x);
+    static bool minres(KrylovParams& params, const VectorN& b, VectorN& x);
+    static bool lsqr(KrylovParams& params, const VectorN& b, VectorN& x);
+    static void mult_dense(const VectorN& x, VectorN& y, void* A);
+    static void transpose_mult_dense(const VectorN& x, VectorN& y, void* A);
+    static void mult_sparse(const VectorN& x, VectorN& y, void* A);
+    static void transpose_mult_sparse(const VectorN& x, VectorN& y, void* A);
+}; // end class
+
+/// Jacobi (diagonal) preconditioner
+class JacobiPreconditioner
+{
+  public:
+    JacobiPreconditioner() { }
+    JacobiPreconditioner(const VectorN& diag) { set(diag); }
+    void set(const VectorN& diag);
+    void set(const SparseMatrixN& A);
+    static void apply(const VectorN& r, VectorN& z, void* precond);
+
+  private:
+    VectorN _inv_diag;
+}; // end class
+
+/// Incomplete Cholesky (zero fill) preconditioner for sparse matrices
+/**
+ * Computes L*L' ~= A + alpha*diag(A), where L has the nonzero structure of
+ * the lower triangle of A; the shift alpha is zero unless the factorization
+ * breaks down, in which case it is increased until the factorization
+ * succeeds.  Both triangles of A must be stored.
+ */
+class IncompleteCholesky
+{
+  public:
+    IncompleteCholesky() { _n = 0; _shift = (Real) 0.0; }
+    IncompleteCholesky(const SparseMatrixN& A) { factor(A); }
+    bool factor(const SparseMatrixN& A);
+    static void apply(const VectorN& r, VectorN& z, void* precond);
+
+    /// Gets the diagonal shift alpha used by the last factorization
+    Real get_shift() const { return _shift; }
+
+  private:
+    bool factor(const SparseMatrixN& A, Real shift);
+
+    /// The dimension of the factored matrix
+    unsigned _n;
+
+    /// The row pointers, column indices, and values of L (by rows; the diagonal is last in each row)
+    std::vector<unsigned> _ptr, _indices;
+    std::vector<Real> _data;
+
+    /// The diagonal shift
+    Real _shift;
+}; // end class
+
+} // end namespace
+
+#endif
+
@@ -16,6 +16,8 @@
 #include <Moby/Vector3.h>
 #include <Moby/Matrix3.h>
 #include <Moby/SpatialTransform.h>
+#include <Moby/SparseCholesky.h>
+#include <Moby/Krylov.h>
 #include <Moby/ArticulatedBody.h>
 
 namespace Moby {
@@ -143,12 +145,14 @@ class MCArticulatedBody : public ArticulatedBody
     void calc_Dx_iM_DxT(MatrixN& Dx_iM_DxT) const;
     void calc_Dx_iM(SparseJacobian& Dx_iM) const;
     MatrixN& calc_Jx_iM_JyT(const SparseJacobian& Jx, const SparseJacobian& Jy, MatrixN& Jx_iM_JyT) const;
+    SparseMatrixN& calc_Jx_iM_JyT(const SparseJacobian& Jx, const SparseJacobian& Jy, SparseMatrixN& Jx_iM_JyT) const;
+    SparseMatrixN& to_sparse(const SparseJacobian& J, bool scale_iM, SparseMatrixN& Js) const;
     void get_sub_jacobian(const std::vector<unsigned>& rows, const SparseJacobian& J, SparseJacobian& Jx);
     static void increment_dof(RigidBodyPtr rb1, RigidBodyPtr rb2, unsigned k, Real h);
     virtual VectorN& solve_generalized_inertia(DynamicBody::GeneralizedCoordinateType gctype, const VectorN& b, VectorN& x);
     virtual MatrixN& solve_generalized_inertia(DynamicBody::GeneralizedCoordinateType gctype, const MatrixN& B, MatrixN& X);
     void select_sub_contact_Jacobians(const EventProblemData& q, SparseJacobian& Jc_sub, SparseJacobian& Dc_sub) const;
-    VectorN& solve_Jx_iM_JxT(const VectorN& rhs, VectorN& x) const;
+    VectorN& solve_Jx_iM_JxT(const VectorN& rhs, VectorN& x);
 
     /// The last-computed generalized velocity (in axis-angle representation)
     VectorN _xd;
@@ -162,8 +166,14 @@ class MCArticulatedBody : public ArticulatedBody
     /// The matrix J*iM*J' 
     MatrixN _Jx_iM_JxT;
 
-    /// The factorization or regularized inverse of Jx*iM*Jx'
-    MatrixN _inv_Jx_iM_JxT;
+    /// The constraint Jacobian over the generalized coordinates (used if Jx*iM*Jx' is rank deficient)
+    SparseMatrixN _sJx;
+
+    /// The Jacobi preconditioner for Jx*iM*Jx' (used if it is rank deficient)
+    JacobiPreconditioner _Jx_iM_JxT_precond;
+
+    /// The sparse factorization of Jx*iM*Jx' (used if it is not rank deficient)
+    SparseCholesky _Jx_iM_JxT_chol;
 
     /// Indicates whether J*iM*J' is rank deficient
     bool _rank_def;
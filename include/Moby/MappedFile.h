@@ -0,0 +1,51 @@
+/****************************************************************************
+ * Copyright 2011 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public 
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#ifndef _MAPPED_FILE_H
+#define _MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+
+namespace Moby {
+
+/// A read-only, memory-mapped file
+/**
+ * The file is mapped on construction and unmapped on destruction; the 
+ * contents are accessible through begin() / end() for the lifetime of the
+ * object.  Construction throws std::runtime_error if the file cannot be 
+ * opened or mapped.
+ */
+class MappedFile
+{
+  public:
+    MappedFile(const std::string& filename);
+    ~MappedFile();
+
+    /// Gets a pointer to the first byte of the file 
+    const char* begin() const { return _data; }
+
+    /// Gets a pointer one past the last byte of the file
+    const char* end() const { return _data + _size; }
+
+    /// Gets the size of the file (in bytes)
+    std::size_t size() const { return _size; }
+
+  private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    /// Pointer to the mapped data (NULL if the file is empty)
+    const char* _data;
+
+    /// The size of the mapping
+    std::size_t _size;
+}; // end class
+
+} // end namespace
+
+#endif
+
@@ -88,7 +88,7 @@ class MatrixN
     static MatrixN& transpose(const MatrixN& m, MatrixN& result);
     virtual MatrixN& operator=(const MatrixN& source);
     virtual MatrixN& operator=(MatrixN& source);
-    VectorN operator*(const VectorN& v) const { return mult(v); }
+    MatrixVectorNProduct<MatrixN> operator*(const VectorN& v) const { return MatrixVectorNProduct<MatrixN>(*this, v); }
     static MatrixN& mult(const MatrixN& m1, const MatrixN& m2, MatrixN& result) { return m1.mult(m2, result); }
     MatrixN mult(const MatrixN& m) const;
     MatrixN mult_transpose(const MatrixN& m) const;
@@ -42,7 +42,7 @@ class MatrixNN : public MatrixN
     static MatrixN& diag_mult_transpose(const VectorN& d, const MatrixN& m, MatrixN& result);
     MatrixNN operator*(Real scalar) const { return MatrixNN(MatrixN::operator*(scalar)); }
     MatrixN operator*(const MatrixN& m) const { return MatrixN::operator*(m); }
-    VectorN operator*(const VectorN& v) const { return MatrixN::operator*(v); }
+    MatrixVectorNProduct<MatrixN> operator*(const VectorN& v) const { return MatrixN::operator*(v); }
     Vector2 operator*(const Vector2& v) const;
     Vector3 operator*(const Vector3& v) const;
     MatrixNN& set_zero() { MatrixN::set_zero(); return *this; }
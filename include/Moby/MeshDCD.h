@@ -16,6 +16,7 @@
 #include <Moby/CollisionDetection.h>
 #include <Moby/ThickTriangle.h>
 #include <Moby/BV.h>
+#include <Moby/SweepAndPrune.h>
 #include <Moby/Integrator.h>
 
 namespace Moby {
@@ -58,30 +59,28 @@ class MeshDCD : public CollisionDetection
     Real calc_first_isect(const Triangle& t, const LineSeg3& s1, const LineSeg3& s2, Vector3& p1, Vector3& p2); 
   private:
     Real intersect_rect(const Vector3& normal, const Vector3& axis1, const Vector3& axis2, const LineSeg3& rs1, const LineSeg3& rs2, const LineSeg3& s, Vector3& isect1, Vector3& isect2);
-    static unsigned determine_cubic_roots(Real a, Real b, Real c, Real x[3]);
     void add_rigid_body_model(RigidBodyPtr body);
-    bool intersect_BV_trees(boost::shared_ptr<BV> a, boost::shared_ptr<BV> b, const Matrix4& aTb, CollisionGeometryPtr geom_a, CollisionGeometryPtr geom_b);
+    bool intersect_BV_trees(boost::shared_ptr<BV> a, boost::shared_ptr<BV> b, const Matrix4& aTb, CollisionGeometryPtr geom_a, CollisionGeometryPtr geom_b, std::list<CollidingTriPair>& tris);
+    static bool check_pair(void* data, CollisionGeometryPtr g1, CollisionGeometryPtr g2, const Matrix4& g1Tg2, std::list<CollidingTriPair>& tris);
     static Event create_contact(Real toi, CollisionGeometryPtr a, CollisionGeometryPtr b, const Vector3& point, const Vector3& vpoint, const Triangle& t);
-    void check_geoms(Real dt, CollisionGeometryPtr a, CollisionGeometryPtr b, const std::vector<std::pair<DynamicBodyPtr, VectorN> >& q0, const std::vector<std::pair<DynamicBodyPtr, VectorN> >& q1, std::vector<Event>& contacts); 
-    void check_geom(Real dt, CollisionGeometryPtr cg, const std::vector<std::pair<DynamicBodyPtr, VectorN> >& q0, const std::vector<std::pair<DynamicBodyPtr, VectorN> >& q1, std::vector<Event>& contacts); 
-    void broad_phase(std::vector<std::pair<CollisionGeometryPtr, CollisionGeometryPtr> >& to_check);
+    static Event create_contact(Real toi, CollisionGeometryPtr a, CollisionGeometryPtr b, const Vector3& point, const Vector3& normal);
+    void check_geoms(Real dt, CollisionGeometryPtr a, CollisionGeometryPtr b, const VectorN& qa0, const VectorN& qa1, const VectorN& qb0, const VectorN& qb1, std::vector<Event>& contacts); 
+    void check_geom(Real dt, CollisionGeometryPtr cg, const VectorN& qa, const VectorN& qb, std::vector<Event>& contacts); 
+    void broad_phase(const std::vector<std::pair<DynamicBodyPtr, VectorN> >& q0, const std::vector<std::pair<DynamicBodyPtr, VectorN> >& q1, std::vector<std::pair<CollisionGeometryPtr, CollisionGeometryPtr> >& to_check);
     void determine_contacts_rigid(CollisionGeometryPtr a, CollisionGeometryPtr b, Real t, Real dt, std::vector<Event>& contacts);
     void determine_contacts_deformable(CollisionGeometryPtr a, CollisionGeometryPtr b, Real t, Real dt, std::vector<Event>& contacts);
-    void determine_contacts_rigid_deformable(CollisionGeometryPtr a, CollisionGeometryPtr b, Real t, Real dt, std::vector<Event>& contacts);
-    void determine_contacts_deformable_rigid(CollisionGeometryPtr a, CollisionGeometryPtr b, Real t, Real dt, std::vector<Event>& contacts);
+    static void calc_swept_vertices(CollisionGeometryPtr cg, Real t, std::vector<Vector3>& x, std::vector<Vector3>& xdot, std::vector<std::pair<Vector3, Vector3> >& bounds);
     Real calc_first_isect(const Triangle& t, const LineSeg3& seg, Vector3& p);
-    static Real calc_first_isect(const Vector3& p, const Vector3& pdot, const Triangle& t, const Vector3& adot, const Vector3& bdot, const Vector3& cdot, Real dt);
     static Real calc_param(const LineSeg3& seg, const Vector3& p);
     bool is_collision(CollisionGeometryPtr a, CollisionGeometryPtr b);
     bool is_collision(CollisionGeometryPtr cg);
     static DynamicBodyPtr get_super_body(CollisionGeometryPtr a);
-    static unsigned find_body(const std::vector<std::pair<DynamicBodyPtr, VectorN> >& q, DynamicBodyPtr body);
 
     template <class OutputIterator>
     OutputIterator intersect_BV_leafs(BVPtr a, BVPtr b, const Matrix4& aTb, CollisionGeometryPtr geom_a, CollisionGeometryPtr geom_b, OutputIterator output_begin) const;
 
-    /// Indicates when bounds vectors need to be rebuilt
-    bool _rebuild_bounds_vecs;
+    /// The broad phase
+    SweepAndPrune _sweep_and_prune;
 
 }; // end class
 
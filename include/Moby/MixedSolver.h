@@ -0,0 +1,83 @@
+/****************************************************************************
+ * Copyright 2011 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#ifndef _MIXED_SOLVER_H
+#define _MIXED_SOLVER_H
+
+#include <vector>
+#include <Moby/MatrixN.h>
+
+namespace Moby {
+
+/// Solves systems of linear equations using mixed precision factorizations
+/**
+ * When Moby is built with USE_MIXED_PRECISION (double precision builds
+ * only), large matrices are factored (Cholesky for symmetric positive
+ * definite matrices, LU otherwise) in single precision, which halves the
+ * memory traffic and doubles the SIMD width of the factorization, and
+ * solutions are iteratively refined using residuals computed in double
+ * precision.  A matrix is refactored in double precision if refinement fails
+ * to converge (i.e., if it is too ill-conditioned for a single precision
+ * factorization); if LinAlg::cond() then flags it as ill-conditioned in
+ * double precision as well, residuals are computed in extended precision
+ * (LongReal).  Small matrices, and all matrices in other builds, are factored
+ * in working precision without refinement.
+ */
+class MixedSolver
+{
+  public:
+    enum MatrixType { eGeneral, ePositiveDefinite };
+    enum Precision { eSingle, eWorking, eExtended };
+    MixedSolver();
+    bool factor(const MatrixN& A, MatrixType type = eGeneral);
+    VectorN& solve(VectorN& xb) const;
+    MatrixN& solve(MatrixN& XB) const;
+
+    /// Gets the precision that the last factored matrix is solved in
+    Precision get_precision() const { return _precision; }
+
+    /// Gets the dimension of the last factored matrix
+    unsigned size() const { return _n; }
+
+    /// The maximum number of refinement steps per solve
+    unsigned max_refinements;
+
+  private:
+    bool factor_single();
+    bool factor_working();
+    void solve_factored(VectorN& x) const;
+    void calc_residual(const VectorN& b, const VectorN& x, VectorN& r) const;
+    bool refine(const VectorN& b, VectorN& x) const;
+
+    /// The dimension of the factored matrix
+    unsigned _n;
+
+    /// The type of the factored matrix
+    MatrixType _type;
+
+    /// The precision of the factorization (and residuals)
+    Precision _precision;
+
+    /// The factored matrix (needed to compute residuals)
+    MatrixN _A;
+
+    /// The infinity norm of the factored matrix
+    Real _A_norm_inf;
+
+    /// The working precision factorization
+    MatrixN _fA;
+
+    /// The single precision factorization
+    std::vector<float> _sA;
+
+    /// The pivots of the LU factorization
+    std::vector<int> _ipiv;
+}; // end class
+
+} // end namespace
+
+#endif
+
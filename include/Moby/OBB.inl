@@ -236,16 +236,19 @@ OBB OBB::calc_min_volume_OBB(ForwardIterator begin, ForwardIterator end)
   // triangles to a list that indicates processing should not occur)
   const IndexedTriArray& hull_mesh = hull->get_mesh();
   std::vector<bool> process(hull_mesh.num_tris(), true);
-  std::map<sorted_pair<unsigned>, std::list<unsigned> > ef_map = hull_mesh.determine_edge_facet_map();
-  for (std::map<sorted_pair<unsigned>, std::list<unsigned> >::const_iterator i = ef_map.begin(); i != ef_map.end(); i++)
+  std::vector<sorted_pair<unsigned> > edges;
+  CSRAdjacency ef_map;
+  hull_mesh.calc_edge_facet_adjacency(edges, ef_map);
+  for (unsigned i=0; i< edges.size(); i++)
   {
     // if the edge is not coplanar, keep processing through the edges
-    if (!hull_mesh.is_coplanar(i->first.first, i->first.second))
+    if (!hull_mesh.is_coplanar(edges[i].first, edges[i].second))
       continue;
 
     // it is coplanar, indicate all but the first triangle in the list should
     // not be processed
-    for (std::list<unsigned>::const_iterator j = i->second.begin()++; j != i->second.end(); j++)
+    CSRAdjacency::Row facets = ef_map.row(i);
+    for (const unsigned* j = facets.first+1; j < facets.second; j++)
       process[*j] = false;
   }
 
@@ -366,19 +369,20 @@ OBB OBB::calc_min_volume_OBB(ForwardIterator begin, ForwardIterator end)
   // edges of the convex hull.  For each triple of orthogonal edges, compute
   // the minimum volume box for that coordinate frame by projecting the points
   // onto the axes of the frame
-  std::vector<std::list<unsigned> > ve_map = hull_mesh.determine_vertex_edge_map();
+  CSRAdjacency ve_map = hull_mesh.calc_vertex_edge_adjacency();
   for (unsigned i=0; i< ve_map.size(); i++)
   {
-    // get the list of incident vertices as a vector
-    std::vector<unsigned> ivs(ve_map[i].begin(), ve_map[i].end());
+    // get the (unique) incident vertices
+    const unsigned* ivs = ve_map.row(i).first;
+    const unsigned NIVS = ve_map.degree(i);
 
     // if- for some reason- there are fewer than three edges in the vector,
     // move onto next vertex
-    if (ivs.size() < 3)
+    if (NIVS < 3)
       continue;
 
     // process each combination of three vertices
-    for (unsigned j=0; j< ivs.size(); j++)
+    for (unsigned j=0; j< NIVS; j++)
     {
       // determine edge 1
       Vector3 d1 = hull_verts[ivs[j]] - hull_verts[i];
@@ -387,7 +391,7 @@ OBB OBB::calc_min_volume_OBB(ForwardIterator begin, ForwardIterator end)
         continue;
       d1 /= d1_len;
 
-      for (unsigned k=j+1; k< ivs.size(); k++)
+      for (unsigned k=j+1; k< NIVS; k++)
       {
         // determine edge 2
         Vector3 d2 = hull_verts[ivs[k]] - hull_verts[i];
@@ -400,7 +404,7 @@ OBB OBB::calc_min_volume_OBB(ForwardIterator begin, ForwardIterator end)
         if (std::fabs(d1.dot(d2)) > NEAR_ZERO)
           continue;
 
-        for (unsigned m=k+1; m< ivs.size(); m++)
+        for (unsigned m=k+1; m< NIVS; m++)
         {
           // determine edge 3
           Vector3 d3 = hull_verts[ivs[m]] - hull_verts[i];
@@ -1,70 +1,94 @@
 /****************************************************************************
  * Copyright 2006 Evan Drumwright
- * This library is distributed under the terms of the GNU Lesser General Public 
+ * This library is distributed under the terms of the GNU Lesser General Public
  * License (found in COPYING).
  ****************************************************************************/
 
 #ifndef _MOBY_OCTREE_H_
 #define _MOBY_OCTREE_H_
 
-#include <boost/shared_ptr.hpp>
-#include <boost/enable_shared_from_this.hpp>
-#include <list>
+#include <stdint.h>
+#include <vector>
+#include <utility>
 #include <Moby/Types.h>
 #include <Moby/Vector3.h>
 
 namespace Moby {
 
-/// A generic octree
-class Octree : public boost::enable_shared_from_this<Octree>
+/// A generic (linear) octree
+/**
+ * The octree is stored without pointers: each inserted point is mapped to
+ * the leaf cell that contains it, and the cell is identified by a 64-bit
+ * Morton key (the interleaved bits of the integer coordinates of the cell).
+ * Points are stored sorted by key, so that the points within any octree
+ * node are contiguous and can be found by binary search.  Leaf cells are
+ * the smallest cells (obtained by successively halving the bounds) whose
+ * side length (along x) is at least the minimum resolution; at most 21
+ * levels are used.
+ *
+ * Each point is identified by the order in which it was inserted (starting
+ * at zero), which allows the octree to serve as a broad phase for point
+ * sets (e.g., the particles of a deformable body) via get_points().
+ */
+class Octree
 {
 	public:
 		Octree();
 		Octree(Real minres);
 		Octree(Real minres, const Vector3& lo_bounds, const Vector3& hi_bounds);
-		Octree(boost::shared_ptr<Octree> parent, Real minres, const Vector3& lo_bounds, const Vector3& hi_bounds);
 		void insert(const Vector3& point);
+		void insert(const std::vector<Vector3>& points);
 		bool clear_cell(const Vector3& point);
-		OctreePtr is_cell_occupied(const Vector3& point) const;
+		bool is_cell_occupied(const Vector3& point) const;
+		void is_cell_occupied(const std::vector<Vector3>& points, std::vector<bool>& occupied) const;
 		bool is_occupied(const Vector3& lo_bounds, const Vector3& hi_bounds) const;
+		void is_occupied(const std::vector<std::pair<Vector3, Vector3> >& regions, std::vector<bool>& occupied) const;
+		void get_points(const Vector3& lo_bounds, const Vector3& hi_bounds, std::vector<unsigned>& points) const;
 		void set_bounds(const Vector3& lo_bounds, const Vector3& hi_bounds);
 		void get_bounds(Vector3& lo_bounds, Vector3& hi_bounds) const;
 		void reset();
 
-		/// Gets the vector of children of this octree node
-		const std::vector<OctreePtr>& get_children() const { return _children; }
-
-		/// Sets the parent of this octree
-		void set_parent(OctreePtr parent) { _parent = parent; }
-
-		/// Gets the parent of this octree
-		OctreePtr get_parent() const { return (_parent.expired()) ? OctreePtr() : OctreePtr(_parent); }
-
-		/// Gets the number of points in this octree node
-		unsigned get_num_points() const { return _num_points; }
+		/// Gets the number of points in the octree
+		unsigned get_num_points() const { return _points.size(); }
 
 		/// Gets the minimum resolution for this octree
 		Real get_min_res() const { return _minres; }
 
-		/// Sets the minimum resolution for this octree
-		void set_min_res(Real minres) { _minres = minres; }
+		/// Sets the minimum resolution for this octree (resets the octree)
+		void set_min_res(Real minres) { _minres = minres; reset(); }
 
-		/// Determines whether this octree node is a leaf
-		bool is_leaf() const { return _children.empty(); }
+		/// Gets the number of levels below the root
+		unsigned get_depth() const { return _depth; }
 
 	private:
-		enum BBQueryType { eOutside, ePartiallyInside, eFullyInside };
-		static const unsigned OCT_CHILDREN = 8;
-		std::vector<OctreePtr> _children;
-		boost::weak_ptr<Octree> _parent;
+		/// A point in the octree
+		struct Point
+		{
+			uint64_t key;     // the Morton key of the leaf cell of the point
+			unsigned id;      // the order in which the point was inserted
+
+			bool operator<(const Point& p) const { return key < p.key; }
+		};
+
+		static const unsigned MAX_DEPTH = 21;
+		void update_depth();
+		bool calc_cell(const Vector3& point, unsigned cell[3]) const;
+		bool calc_cell_range(const Vector3& lo_bounds, const Vector3& hi_bounds, unsigned lo[3], unsigned hi[3]) const;
+		uint64_t calc_key(const Vector3& point) const;
+		bool find_points(const unsigned lo[3], const unsigned hi[3], std::vector<std::pair<unsigned, unsigned> >* ranges) const;
+		static uint64_t spread_bits(uint64_t x);
+		static uint64_t calc_key(const unsigned cell[3]);
+		static void radix_sort(std::vector<Point>& points, unsigned nbits);
+
+		/// The points, sorted by key (points with equal keys are in the order that they were inserted)
+		std::vector<Point> _points;
+
+		/// The number of points inserted since the last reset (used to identify points)
+		unsigned _num_inserted;
+
 		Vector3 _bounds_lo, _bounds_hi;
-		unsigned _num_points;
 		Real _minres;
-
-		static BBQueryType within_bounding_box(const std::pair<Vector3, Vector3>& query, const std::pair<Vector3, Vector3>& reference);
-		static bool within_bounding_box(const Vector3& query, const std::pair<Vector3, Vector3>& reference);
-		unsigned get_sub_volume_idx(const Vector3& point) const;
-		bool subdivide();
+		unsigned _depth;
 }; // end class
 
 } // end namespace
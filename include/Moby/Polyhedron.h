@@ -54,8 +54,8 @@ class Polyhedron
     template <class InputIterator1, class InputIterator2>
     Polyhedron(InputIterator1 verts_begin, InputIterator1 verts_end, InputIterator2 facets_begin, InputIterator2 facets_end);
 
-    /// Gets the list of facets coincident to the i'th facet
-    const std::list<unsigned>& get_incident_facets(unsigned i) const { return _mesh.get_incident_facets(i); } 
+    /// Gets the (ascending) indices of facets incident to the i'th vertex
+    CSRAdjacency::Row get_incident_facets(unsigned i) const { return _mesh.get_incident_facets(i); } 
  
     /// Gets the signed distance and closest facet to a point
     Real calc_signed_distance(const Vector3& point, unsigned& closest_facet);
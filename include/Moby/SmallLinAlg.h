@@ -0,0 +1,167 @@
+/****************************************************************************
+ * Copyright 2011 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#ifndef _SMALL_LINALG_H
+#define _SMALL_LINALG_H
+
+#include <cmath>
+#include <Moby/Types.h>
+
+namespace Moby {
+
+/// Fixed-size Cholesky and LDL' kernels for N x N matrices, N <= 6
+/**
+ * LinAlg::factor_chol(), LinAlg::solve_chol_fast(), LinAlg::factor_LDL(), and
+ * LinAlg::solve_LDL_fast() dispatch to these kernels for matrices no larger
+ * than 6x6, which are common in the dynamics algorithms (e.g., the joint-space
+ * articulated inertias of FSABAlgorithm) and for which LAPACK call overhead
+ * dominates.  Because N is a compile-time constant, the compiler fully
+ * unrolls the loops.  Matrices are
+ * column-major arrays with leading dimension N and use the same storage as
+ * the corresponding LAPACK routines: the Cholesky factor is upper triangular
+ * (A = U'*U, as xPOTRF with UPLO='U') and the LDL' factorization is packed
+ * lower triangular (as xSPTRF with UPLO='L').
+ */
+template <unsigned N>
+class SmallLinAlg
+{
+  public:
+    /// Computes the Cholesky factorization A = U'*U in place
+    /**
+     * \param A a symmetric matrix (only the upper triangle is referenced);
+     *        the upper triangle holds U on return (the strict lower
+     *        triangle is not modified)
+     * \return <b>true</b> if A is positive definite, <b>false</b> otherwise
+     */
+    static bool factor_chol(Real* A)
+    {
+      for (unsigned j=0; j< N; j++)
+      {
+        Real* Aj = A + j*N;
+        for (unsigned i=0; i< j; i++)
+        {
+          const Real* Ai = A + i*N;
+          Real s = Aj[i];
+          for (unsigned k=0; k< i; k++)
+            s -= Ai[k]*Aj[k];
+          Aj[i] = s/Ai[i];
+        }
+        Real d = Aj[j];
+        for (unsigned k=0; k< j; k++)
+          d -= Aj[k]*Aj[k];
+
+        // this test also catches NaN
+        if (!(d > (Real) 0.0))
+          return false;
+        Aj[j] = std::sqrt(d);
+      }
+
+      return true;
+    }
+
+    /// Solves U'*U*x = b in place, using the factor from factor_chol()
+    /**
+     * \param U the Cholesky factor computed by factor_chol()
+     * \param xb the right hand side on input, the solution x on return
+     */
+    static void solve_chol(const Real* U, Real* xb)
+    {
+      // solve U'*y = b
+      for (unsigned i=0; i< N; i++)
+      {
+        const Real* Ui = U + i*N;
+        Real s = xb[i];
+        for (unsigned k=0; k< i; k++)
+          s -= Ui[k]*xb[k];
+        xb[i] = s/Ui[i];
+      }
+
+      // solve U*x = y
+      for (unsigned i=N; i-- > 0; )
+      {
+        Real s = xb[i];
+        for (unsigned k=i+1; k< N; k++)
+          s -= U[k*N+i]*xb[k];
+        xb[i] = s/U[i*N+i];
+      }
+    }
+
+    /// Computes the LDL' factorization of a symmetric positive definite matrix
+    /**
+     * The factorization is computed without pivoting, so it is attempted only
+     * for positive definite matrices (for which it is stable); LinAlg falls
+     * back to the Bunch-Kaufman factorization of xSPTRF when it fails.
+     * \param A a symmetric matrix (only the lower triangle is referenced)
+     * \param LD the packed lower triangular factorization on return: the
+     *        diagonal holds D and the strict lower triangle holds the
+     *        unit lower triangular L (equivalent to xSPTRF output with no
+     *        interchanges); LD may not overlap A
+     * \return <b>true</b> if every pivot is positive, <b>false</b> otherwise
+     */
+    static bool factor_LDL(const Real* A, Real* LD)
+    {
+      for (unsigned j=0; j< N; j++)
+      {
+        // compute the pivot
+        Real d = A[j*N+j];
+        for (unsigned k=0; k< j; k++)
+          d -= LD[packed(j,k)]*LD[packed(j,k)]*LD[packed(k,k)];
+        if (!(d > (Real) 0.0))
+          return false;
+        LD[packed(j,j)] = d;
+
+        // compute column j of L
+        for (unsigned i=j+1; i< N; i++)
+        {
+          Real s = A[j*N+i];
+          for (unsigned k=0; k< j; k++)
+            s -= LD[packed(i,k)]*LD[packed(j,k)]*LD[packed(k,k)];
+          LD[packed(i,j)] = s/d;
+        }
+      }
+
+      return true;
+    }
+
+    /// Solves L*D*L'*x = b in place, using the factorization from factor_LDL()
+    /**
+     * \param LD the packed factorization computed by factor_LDL()
+     * \param xb the right hand side on input, the solution x on return
+     */
+    static void solve_LDL(const Real* LD, Real* xb)
+    {
+      // solve L*y = b
+      for (unsigned i=1; i< N; i++)
+      {
+        Real s = xb[i];
+        for (unsigned k=0; k< i; k++)
+          s -= LD[packed(i,k)]*xb[k];
+        xb[i] = s;
+      }
+
+      // solve D*z = y
+      for (unsigned i=0; i< N; i++)
+        xb[i] /= LD[packed(i,i)];
+
+      // solve L'*x = z
+      for (unsigned i=N-1; i-- > 0; )
+      {
+        Real s = xb[i];
+        for (unsigned k=i+1; k< N; k++)
+          s -= LD[packed(k,i)]*xb[k];
+        xb[i] = s;
+      }
+    }
+
+  private:
+    /// Gets the index of element (i,j), i >= j, of a packed lower triangle
+    static unsigned packed(unsigned i, unsigned j) { return i + j*(2*N-j-1)/2; }
+}; // end class
+
+} // end namespace
+
+#endif
+
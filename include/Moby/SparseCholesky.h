@@ -0,0 +1,75 @@
+/****************************************************************************
+ * Copyright 2011 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#ifndef _SPARSE_CHOLESKY_H
+#define _SPARSE_CHOLESKY_H
+
+#include <vector>
+#include <Moby/SparseMatrixN.h>
+#include <Moby/MatrixN.h>
+
+namespace Moby {
+
+/// Sparse Cholesky factorization of a symmetric positive definite matrix
+/**
+ * Factors P*A*P' = L*L', where P is a fill-reducing (minimum degree)
+ * permutation and L is lower triangular, stored by columns.  The
+ * factorization is split into a symbolic phase, which computes the ordering,
+ * elimination tree, and nonzero structure of L, and a left-looking numeric
+ * phase.  The symbolic phase is only repeated when the nonzero structure of
+ * A changes, so refactoring matrices with fixed structure (e.g., the
+ * constraint matrices of a mechanism over a simulation) is inexpensive.
+ * Both triangles of A must be stored.
+ */
+class SparseCholesky
+{
+  public:
+    SparseCholesky();
+    bool factor(const SparseMatrixN& A);
+    void analyze(const SparseMatrixN& A);
+    VectorN& solve(VectorN& xb) const;
+    MatrixN& solve(MatrixN& XB) const;
+    static void calc_min_degree_ordering(const SparseMatrixN& A, std::vector<unsigned>& perm);
+
+    /// Gets the dimension of the factored matrix
+    unsigned size() const { return _n; }
+
+    /// Gets the number of nonzeros in the factor L
+    unsigned num_elements() const { return _Li.size(); }
+
+  private:
+    bool same_structure(const SparseMatrixN& A) const;
+    void solve(Real* x) const;
+
+    /// The dimension of the factored matrix
+    unsigned _n;
+
+    /// The row pointers and column indices of the analyzed matrix
+    std::vector<unsigned> _Aptr, _Aindices;
+
+    /// The fill-reducing permutation (row i of P*A*P' is row _perm[i] of A)
+    std::vector<unsigned> _perm;
+
+    /// The inverse of the fill-reducing permutation
+    std::vector<unsigned> _pinv;
+
+    /// The column pointers of L (the diagonal is the first entry in a column)
+    std::vector<unsigned> _Lp;
+
+    /// The row indices of L
+    std::vector<unsigned> _Li;
+
+    /// The values of L
+    std::vector<Real> _Lx;
+
+    /// Indicates whether the last numeric factorization succeeded
+    bool _factored;
+}; // end class
+
+} // end namespace
+
+#endif
+
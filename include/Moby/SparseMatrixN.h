@@ -22,6 +22,7 @@ class SparseMatrixN
     SparseMatrixN(unsigned m, unsigned n, const std::map<std::pair<unsigned, unsigned>, Real>& values);
     SparseMatrixN(unsigned m, unsigned n, boost::shared_array<unsigned> ptr, boost::shared_array<unsigned> indices, boost::shared_array<Real> data);
     SparseMatrixN(const MatrixN& m);
+    SparseMatrixN(const MatrixN& m, Real tol);
     static SparseMatrixN identity(unsigned n);
     VectorN& mult(const VectorN& x, VectorN& result) const;
     VectorN& transpose_mult(const VectorN& x, VectorN& result) const;
@@ -33,8 +34,13 @@ class SparseMatrixN
     MatrixN transpose_mult(const MatrixN& m) const;
     MatrixN& transpose_mult_transpose(const MatrixN& m, MatrixN& result) const;
     MatrixN transpose_mult_transpose(const MatrixN& m) const;
+    SparseMatrixN& mult(const SparseMatrixN& m, SparseMatrixN& result) const;
+    SparseMatrixN& mult_transpose(const SparseMatrixN& m, SparseMatrixN& result) const;
+    SparseMatrixN& transpose(SparseMatrixN& result) const;
+    static SparseMatrixN transpose(const SparseMatrixN& m);
     unsigned rows() const { return _rows; }
     unsigned columns() const { return _columns; }
+    unsigned num_elements() const { return (_ptr) ? _ptr[_rows] : 0; }
     SparseMatrixN get_sub_mat(unsigned rstart, unsigned rend, unsigned cstart, unsigned cend) const;
     SparseVectorN& get_row(unsigned i, SparseVectorN& row) const;
     SparseVectorN get_row(unsigned i) const;
@@ -49,6 +55,7 @@ class SparseMatrixN
     SparseMatrixN& negate();
     static SparseMatrixN& outer_square(const VectorN& g, SparseMatrixN& result);
     static SparseMatrixN& outer_square(const SparseVectorN& v, SparseMatrixN& result);
+    static SparseMatrixN& outer_square(const SparseMatrixN& A, const VectorN& d, SparseMatrixN& result);
     MatrixN to_dense() const;
     MatrixN& to_dense(MatrixN& m) const;
 
@@ -61,7 +68,9 @@ class SparseMatrixN
     unsigned _columns;
 
   private:
+    static SparseMatrixN& mult(const SparseMatrixN& A, const Real* d, const SparseMatrixN& B, SparseMatrixN& result);
     void set(unsigned rows, unsigned columns, const std::map<std::pair<unsigned, unsigned>, Real>& values);
+    void set(const MatrixN& m, Real tol);
 }; // end class
 
 std::ostream& operator<<(std::ostream& out, const SparseMatrixN& s);
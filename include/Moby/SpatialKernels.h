@@ -0,0 +1,302 @@
+/****************************************************************************
+ * Copyright 2011 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#ifndef _SPATIAL_KERNELS_H
+#define _SPATIAL_KERNELS_H
+
+#include <Moby/Types.h>
+
+// select the instruction set used by the kernels at compile time
+#if defined(BUILD_DOUBLE) && defined(__AVX2__)
+#define MOBY_SPATIAL_AVX_DOUBLE
+#include <immintrin.h>
+#elif defined(BUILD_DOUBLE) && defined(__SSE2__)
+#define MOBY_SPATIAL_SSE_DOUBLE
+#include <emmintrin.h>
+#elif defined(BUILD_SINGLE) && defined(__SSE__)
+#define MOBY_SPATIAL_SSE_FLOAT
+#include <xmmintrin.h>
+#endif
+
+namespace Moby {
+
+/// Fixed-size kernels for the 3x3 and 6x6 products underlying spatial algebra
+/**
+ * All matrices are column-major arrays (as stored by Matrix3, SMatrix6, and
+ * SMatrix6N) and, unless noted, outputs must not overlap inputs.  The 6x6
+ * products are implemented with AVX2 (double), SSE2 (double), or SSE (float)
+ * when Moby is compiled for those instruction sets and with unrolled scalar
+ * code otherwise; the 3x3 kernels are unrolled scalar code, which the
+ * compiler schedules better than masked vector loads and stores.  These
+ * replace BLAS calls, whose overhead dominates products this small.
+ */
+class SpatialKernels
+{
+  public:
+    static void mult3x3(const Real* A, const Real* B, Real* C);
+    static void mult3(const Real* A, const Real* x, Real* y);
+    static void transpose_mult3(const Real* A, const Real* x, Real* y);
+    static void transpose_mult3x3(const Real* A, const Real* B, Real* C);
+    static void mult_transpose3x3(const Real* A, const Real* B, Real* C);
+    static void skew_mult3x3(const Real* r, const Real* B, Real* C);
+    static void mult_skew3x3(const Real* A, const Real* r, Real* C);
+    static void mult6x6(const Real* A, const Real* B, Real* C);
+    static void mult6(const Real* A, const Real* x, Real* y);
+    static void spatial_transform(const Real* E, const Real* r, const Real* v, Real* y);
+    static void spatial_cross(const Real* a, const Real* b, Real* y);
+    static void rb_inertia_mult(Real m, const Real* h, const Real* J, const Real* v, Real* y);
+    static void ab_inertia_mult(const Real* M, const Real* H, const Real* J, const Real* v, Real* y);
+
+    /// Computes c = a x b for 3-dimensional arrays
+    static void cross(const Real* a, const Real* b, Real* c)
+    {
+      c[0] = a[1]*b[2] - a[2]*b[1];
+      c[1] = a[2]*b[0] - a[0]*b[2];
+      c[2] = a[0]*b[1] - a[1]*b[0];
+    }
+
+}; // end class
+
+/// Computes C = A*B for 3x3 matrices
+inline void SpatialKernels::mult3x3(const Real* A, const Real* B, Real* C)
+{
+  for (unsigned j=0; j< 3; j++)
+    mult3(A, B+j*3, C+j*3);
+}
+
+/// Computes y = A*x for a 3x3 matrix A
+inline void SpatialKernels::mult3(const Real* A, const Real* x, Real* y)
+{
+  y[0] = A[0]*x[0] + A[3]*x[1] + A[6]*x[2];
+  y[1] = A[1]*x[0] + A[4]*x[1] + A[7]*x[2];
+  y[2] = A[2]*x[0] + A[5]*x[1] + A[8]*x[2];
+}
+
+/// Computes y = A'*x for a 3x3 matrix A
+inline void SpatialKernels::transpose_mult3(const Real* A, const Real* x, Real* y)
+{
+  y[0] = A[0]*x[0] + A[1]*x[1] + A[2]*x[2];
+  y[1] = A[3]*x[0] + A[4]*x[1] + A[5]*x[2];
+  y[2] = A[6]*x[0] + A[7]*x[1] + A[8]*x[2];
+}
+
+/// Computes C = A'*B for 3x3 matrices
+inline void SpatialKernels::transpose_mult3x3(const Real* A, const Real* B, Real* C)
+{
+  for (unsigned j=0; j< 3; j++)
+    transpose_mult3(A, B+j*3, C+j*3);
+}
+
+/// Computes C = A*B' for 3x3 matrices
+inline void SpatialKernels::mult_transpose3x3(const Real* A, const Real* B, Real* C)
+{
+  for (unsigned j=0; j< 3; j++)
+  {
+    C[j*3]   = A[0]*B[j] + A[3]*B[j+3] + A[6]*B[j+6];
+    C[j*3+1] = A[1]*B[j] + A[4]*B[j+3] + A[7]*B[j+6];
+    C[j*3+2] = A[2]*B[j] + A[5]*B[j+3] + A[8]*B[j+6];
+  }
+}
+
+/// Computes C = rx*B, where rx is the skew-symmetric (cross product) matrix of r
+inline void SpatialKernels::skew_mult3x3(const Real* r, const Real* B, Real* C)
+{
+  for (unsigned j=0; j< 3; j++)
+    cross(r, B+j*3, C+j*3);
+}
+
+/// Computes C = A*rx, where rx is the skew-symmetric (cross product) matrix of r
+inline void SpatialKernels::mult_skew3x3(const Real* A, const Real* r, Real* C)
+{
+  // columns of rx are (0, r2, -r1), (-r2, 0, r0), and (r1, -r0, 0)
+  for (unsigned i=0; i< 3; i++)
+  {
+    C[i]   = r[2]*A[i+3] - r[1]*A[i+6];
+    C[i+3] = r[0]*A[i+6] - r[2]*A[i];
+    C[i+6] = r[1]*A[i]   - r[0]*A[i+3];
+  }
+}
+
+/// Computes C = A*B for 6x6 matrices
+inline void SpatialKernels::mult6x6(const Real* A, const Real* B, Real* C)
+{
+  #if defined(MOBY_SPATIAL_AVX_DOUBLE)
+  // rows 0-3 of each column of A in a 256-bit register, rows 4-5 in a 128-bit
+  __m256d lo[6];
+  __m128d hi[6];
+  for (unsigned k=0; k< 6; k++)
+  {
+    lo[k] = _mm256_loadu_pd(A+k*6);
+    hi[k] = _mm_loadu_pd(A+k*6+4);
+  }
+  for (unsigned j=0; j< 6; j++)
+  {
+    const Real* b = B+j*6;
+    __m256d clo = _mm256_mul_pd(lo[0], _mm256_broadcast_sd(b));
+    __m128d chi = _mm_mul_pd(hi[0], _mm_set1_pd(b[0]));
+    for (unsigned k=1; k< 6; k++)
+    {
+      clo = _mm256_add_pd(clo, _mm256_mul_pd(lo[k], _mm256_broadcast_sd(b+k)));
+      chi = _mm_add_pd(chi, _mm_mul_pd(hi[k], _mm_set1_pd(b[k])));
+    }
+    _mm256_storeu_pd(C+j*6, clo);
+    _mm_storeu_pd(C+j*6+4, chi);
+  }
+  #elif defined(MOBY_SPATIAL_SSE_DOUBLE)
+  for (unsigned j=0; j< 6; j++)
+  {
+    const Real* b = B+j*6;
+    __m128d c0 = _mm_setzero_pd(), c1 = _mm_setzero_pd(), c2 = _mm_setzero_pd();
+    for (unsigned k=0; k< 6; k++)
+    {
+      const __m128d bk = _mm_set1_pd(b[k]);
+      c0 = _mm_add_pd(c0, _mm_mul_pd(_mm_loadu_pd(A+k*6), bk));
+      c1 = _mm_add_pd(c1, _mm_mul_pd(_mm_loadu_pd(A+k*6+2), bk));
+      c2 = _mm_add_pd(c2, _mm_mul_pd(_mm_loadu_pd(A+k*6+4), bk));
+    }
+    _mm_storeu_pd(C+j*6, c0);
+    _mm_storeu_pd(C+j*6+2, c1);
+    _mm_storeu_pd(C+j*6+4, c2);
+  }
+  #elif defined(MOBY_SPATIAL_SSE_FLOAT)
+  for (unsigned j=0; j< 6; j++)
+  {
+    const Real* b = B+j*6;
+    __m128 clo = _mm_setzero_ps(), chi = _mm_setzero_ps();
+    for (unsigned k=0; k< 6; k++)
+    {
+      const __m128 bk = _mm_set1_ps(b[k]);
+      clo = _mm_add_ps(clo, _mm_mul_ps(_mm_loadu_ps(A+k*6), bk));
+      chi = _mm_add_ps(chi, _mm_mul_ps(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*) (A+k*6+4)), bk));
+    }
+    _mm_storeu_ps(C+j*6, clo);
+    _mm_storel_pi((__m64*) (C+j*6+4), chi);
+  }
+  #else
+  for (unsigned j=0; j< 6; j++)
+    mult6(A, B+j*6, C+j*6);
+  #endif
+}
+
+/// Computes y = A*x for a 6x6 matrix A
+inline void SpatialKernels::mult6(const Real* A, const Real* x, Real* y)
+{
+  #if defined(MOBY_SPATIAL_AVX_DOUBLE)
+  __m256d ylo = _mm256_mul_pd(_mm256_loadu_pd(A), _mm256_broadcast_sd(x));
+  __m128d yhi = _mm_mul_pd(_mm_loadu_pd(A+4), _mm_set1_pd(x[0]));
+  for (unsigned k=1; k< 6; k++)
+  {
+    ylo = _mm256_add_pd(ylo, _mm256_mul_pd(_mm256_loadu_pd(A+k*6), _mm256_broadcast_sd(x+k)));
+    yhi = _mm_add_pd(yhi, _mm_mul_pd(_mm_loadu_pd(A+k*6+4), _mm_set1_pd(x[k])));
+  }
+  _mm256_storeu_pd(y, ylo);
+  _mm_storeu_pd(y+4, yhi);
+  #elif defined(MOBY_SPATIAL_SSE_DOUBLE)
+  __m128d y0 = _mm_setzero_pd(), y1 = _mm_setzero_pd(), y2 = _mm_setzero_pd();
+  for (unsigned k=0; k< 6; k++)
+  {
+    const __m128d xk = _mm_set1_pd(x[k]);
+    y0 = _mm_add_pd(y0, _mm_mul_pd(_mm_loadu_pd(A+k*6), xk));
+    y1 = _mm_add_pd(y1, _mm_mul_pd(_mm_loadu_pd(A+k*6+2), xk));
+    y2 = _mm_add_pd(y2, _mm_mul_pd(_mm_loadu_pd(A+k*6+4), xk));
+  }
+  _mm_storeu_pd(y, y0);
+  _mm_storeu_pd(y+2, y1);
+  _mm_storeu_pd(y+4, y2);
+  #elif defined(MOBY_SPATIAL_SSE_FLOAT)
+  __m128 ylo = _mm_setzero_ps(), yhi = _mm_setzero_ps();
+  for (unsigned k=0; k< 6; k++)
+  {
+    const __m128 xk = _mm_set1_ps(x[k]);
+    ylo = _mm_add_ps(ylo, _mm_mul_ps(_mm_loadu_ps(A+k*6), xk));
+    yhi = _mm_add_ps(yhi, _mm_mul_ps(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*) (A+k*6+4)), xk));
+  }
+  _mm_storeu_ps(y, ylo);
+  _mm_storel_pi((__m64*) (y+4), yhi);
+  #else
+  for (unsigned i=0; i< 6; i++)
+    y[i] = A[i]*x[0] + A[i+6]*x[1] + A[i+12]*x[2] + A[i+18]*x[3] + A[i+24]*x[4] + A[i+30]*x[5];
+  #endif
+}
+
+/// Applies the spatial transform (E, r) to the spatial vector v
+/**
+ * Computes y = [E*top; E*bottom - r x (E*top)], where v = [top; bottom].
+ * Unlike the other kernels, y may alias v.
+ */
+inline void SpatialKernels::spatial_transform(const Real* E, const Real* r, const Real* v, Real* y)
+{
+  Real Etop[3], Ebot[3];
+  mult3(E, v, Etop);
+  mult3(E, v+3, Ebot);
+
+  // compute the result
+  y[0] = Etop[0];
+  y[1] = Etop[1];
+  y[2] = Etop[2];
+  y[3] = Ebot[0] - (r[1]*Etop[2] - r[2]*Etop[1]);
+  y[4] = Ebot[1] - (r[2]*Etop[0] - r[0]*Etop[2]);
+  y[5] = Ebot[2] - (r[0]*Etop[1] - r[1]*Etop[0]);
+}
+
+/// Computes the spatial cross product y = a x b, as defined in [Featherstone, 87], p. 29
+/**
+ * y = [atop x btop; abot x btop + atop x bbot]
+ */
+inline void SpatialKernels::spatial_cross(const Real* a, const Real* b, Real* y)
+{
+  Real c1[3], c2[3];
+  cross(a, b, y);
+  cross(a+3, b, c1);
+  cross(a, b+3, c2);
+  y[3] = c1[0] + c2[0];
+  y[4] = c1[1] + c2[1];
+  y[5] = c1[2] + c2[2];
+}
+
+/// Multiplies the spatial rigid body inertia (m, h, J) by the spatial vector v
+/**
+ * Computes y = [m*bottom - h x top; J*top + h x bottom], where
+ * v = [top; bottom]; y may alias v.
+ */
+inline void SpatialKernels::rb_inertia_mult(Real m, const Real* h, const Real* J, const Real* v, Real* y)
+{
+  Real htop[3], hbot[3], Jtop[3];
+  cross(h, v, htop);
+  cross(h, v+3, hbot);
+  mult3(J, v, Jtop);
+  y[0] = v[3]*m - htop[0];
+  y[1] = v[4]*m - htop[1];
+  y[2] = v[5]*m - htop[2];
+  y[3] = Jtop[0] + hbot[0];
+  y[4] = Jtop[1] + hbot[1];
+  y[5] = Jtop[2] + hbot[2];
+}
+
+/// Multiplies the spatial articulated body inertia (M, H, J) by the spatial vector v
+/**
+ * Computes y = [H'*top + M*bottom; J*top + H*bottom], where
+ * v = [top; bottom]; y may alias v.
+ */
+inline void SpatialKernels::ab_inertia_mult(const Real* M, const Real* H, const Real* J, const Real* v, Real* y)
+{
+  Real HTtop[3], Mbot[3], Jtop[3], Hbot[3];
+  transpose_mult3(H, v, HTtop);
+  mult3(M, v+3, Mbot);
+  mult3(J, v, Jtop);
+  mult3(H, v+3, Hbot);
+  y[0] = HTtop[0] + Mbot[0];
+  y[1] = HTtop[1] + Mbot[1];
+  y[2] = HTtop[2] + Mbot[2];
+  y[3] = Jtop[0] + Hbot[0];
+  y[4] = Jtop[1] + Hbot[1];
+  y[5] = Jtop[2] + Hbot[2];
+}
+
+} // end namespace
+
+#endif
+
@@ -0,0 +1,136 @@
+/****************************************************************************
+ * Copyright 2011 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#ifndef _STRUCTURED_QP_H
+#define _STRUCTURED_QP_H
+
+#include <vector>
+#include <Moby/MatrixN.h>
+#include <Moby/SparseMatrixN.h>
+
+namespace Moby {
+
+/// Interior-point solver for convex QPs with block-arrow structure
+/**
+ * Solves the convex quadratic program
+ * <pre>
+ *   minimize     1/2 x'*H*x + c'*x
+ *   subject to   x >= 0
+ *                (H*x + c)_i >= 0 for all i in P
+ *                A*x >= b
+ * </pre>
+ * using Mehrotra's predictor-corrector primal-dual method.  This is the
+ * form of the impact QP, in which H*x + c are the post-impact velocities
+ * and the rows of A are (mostly) the friction cone constraints of the
+ * individual contacts.
+ *
+ * The reduced KKT matrix H + inv(X)*Z + G'*inv(S)*Lambda*G (G the
+ * constraint matrix) is never formed for large problems.  Instead, rows of A
+ * with small, disjoint supports (e.g., the friction constraints of a single
+ * contact) yield a block diagonal matrix D, and everything else (H, which
+ * couples the contacts through the bodies and has rank at most six times the
+ * number of bodies, the rows of H indexed by P, and the remaining rows of A)
+ * is collected into a low rank term U*U'.  H is factored once per problem
+ * using a pivoted Cholesky factorization, D is factored block by block,
+ * and D + U*U' is inverted using the Sherman-Morrison-Woodbury formula,
+ * which is used to precondition conjugate gradient solves with the exact
+ * KKT matrix.  When H is truncated to its low rank factor L, L*L' stands in
+ * for H throughout the solve.  If the low rank term is not small relative to
+ * the problem size, or if conjugate gradient stalls (the preconditioner
+ * becomes ill-conditioned as the iterates approach the boundary), the KKT
+ * matrix is formed and factored densely instead, with the primal
+ * regularization increased as necessary.
+ */
+class StructuredQP
+{
+  public:
+    StructuredQP();
+    bool solve(const MatrixN& H, const VectorN& c, const std::vector<unsigned>& P, const SparseMatrixN& A, const VectorN& b, VectorN& x, VectorN& lambda);
+
+    /// Gets the number of iterations performed by the last call to solve()
+    unsigned get_iterations() const { return _iterations; }
+
+    /// The maximum number of iterations (default 100)
+    unsigned max_iterations;
+
+    /// The tolerance on the average complementarity and the residuals (default NEAR_ZERO)
+    Real eps;
+
+  private:
+    void setup_blocks();
+    void factor_H();
+    bool factor_KKT();
+    bool factor_dense();
+    void form_dense();
+    bool factor_low_rank();
+    void calc_low_rank_middle(MatrixN& W);
+    bool solve_KKT(const VectorN& r, VectorN& dx);
+    void solve_blocks(Real* x, bool transpose) const;
+    void mult_H(const VectorN& x, VectorN& y) const;
+    void mult_G(const VectorN& x, const VectorN& Hx, VectorN& g) const;
+    void mult_GT(const VectorN& v, VectorN& result) const;
+    bool calc_step(const VectorN& xz_x, const VectorN& sl_s, VectorN& dx, VectorN& dz, VectorN& ds, VectorN& dlambda);
+    static void mult_KKT(const VectorN& x, VectorN& y, void* data);
+    static void precond_KKT(const VectorN& r, VectorN& z, void* data);
+
+    /// The problem being solved
+    const MatrixN* _H;
+    const SparseMatrixN* _A;
+    const std::vector<unsigned>* _P;
+
+    /// The number of iterations performed by the last call to solve()
+    unsigned _iterations;
+
+    /// The primal regularization added to the KKT matrix (and its initial value for each factorization)
+    Real _delta, _delta0;
+
+    /// The diagonal scaling matrices inv(X)*Z and inv(S)*Lambda
+    VectorN _dx, _ds;
+
+    /// The primal residual G*x + h - s
+    VectorN _rp;
+
+    /// The dual residual H*x + c - z - G'*lambda
+    VectorN _rd;
+
+    /// The variables of each diagonal block
+    std::vector<std::vector<unsigned> > _block_vars;
+
+    /// The rows of A contributing to each diagonal block
+    std::vector<std::vector<unsigned> > _block_rows;
+
+    /// The block of each variable and its index within the block
+    std::vector<unsigned> _var_block, _var_pos;
+
+    /// The rows of A contributing to the low rank term
+    std::vector<unsigned> _coupling_rows;
+
+    /// The Cholesky factorizations of the diagonal blocks
+    std::vector<MatrixN> _blocks;
+
+    /// Determines whether the KKT matrix is formed and factored densely
+    bool _dense;
+
+    /// Determines whether H is represented by its low rank factor
+    bool _low_rank;
+
+    /// The low rank factor of H (H ~= L*L') and its rows indexed by P
+    MatrixN _L, _LP;
+
+    /// The low rank term U, inv(R')*U for D = R'*R, and the capacitance matrix I + U'*inv(D)*U (factored)
+    MatrixN _U, _W, _C;
+
+    /// The dense KKT matrix (factored)
+    MatrixN _K;
+
+    /// Work variables
+    MatrixN _workM, _workM2;
+}; // end class
+
+} // end namespace
+
+#endif
+
@@ -0,0 +1,58 @@
+/****************************************************************************
+ * Copyright 2011 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#ifndef _SWEEP_AND_PRUNE_H
+#define _SWEEP_AND_PRUNE_H
+
+#include <vector>
+#include <utility>
+#include <Moby/Types.h>
+#include <Moby/Vector3.h>
+
+namespace Moby {
+
+/// Broad phase that finds pairs of geometries with overlapping axis-aligned bounds
+/**
+ * Endpoints of the bounds are kept sorted along all three axes between
+ * calls.  When the set of geometries is unchanged from the previous call,
+ * the (nearly sorted) endpoints are updated using insertion sort, which runs
+ * in nearly linear time when the bounds move coherently.  The sweep is done
+ * along the axis on which the bounds are most spread out; overlap on the
+ * remaining two axes is tested directly for each candidate.
+ */
+class SweepAndPrune
+{
+  public:
+    SweepAndPrune() { }
+    void reset();
+    void find_overlaps(const std::vector<CollisionGeometryPtr>& geoms, const std::vector<std::pair<Vector3, Vector3> >& bounds, std::vector<std::pair<CollisionGeometryPtr, CollisionGeometryPtr> >& overlaps);
+
+  private:
+    /// An endpoint of a bound along one axis
+    struct Endpoint
+    {
+      Real value;       // the coordinate of the endpoint
+      unsigned idx;     // the index of the geometry
+      bool end;         // whether this is the upper endpoint
+
+      // lower endpoints precede upper endpoints at equal coordinates, so
+      // touching bounds are reported as overlapping
+      bool operator<(const Endpoint& e) const { return value < e.value || (value == e.value && !end && e.end); }
+    };
+
+    static void insertion_sort(std::vector<Endpoint>& endpoints);
+
+    /// The geometries from the last call to find_overlaps()
+    std::vector<CollisionGeometryPtr> _geoms;
+
+    /// The sorted endpoints along each axis
+    std::vector<Endpoint> _endpoints[3];
+}; // end class
+
+} // end namespace
+
+#endif
+
@@ -13,12 +13,26 @@
 #include <cmath>
 #include <list>
 #include <string>
+#include <boost/weak_ptr.hpp>
 #include <Moby/Types.h>
 #include <Moby/Primitive.h>
 
+#ifdef THREADSAFE
+#include <pthread.h>
+#endif
+
 namespace Moby {
 
 /// Represents a triangle mesh "primitive" for inertia properties, collision detection, and visualization
+/**
+ * Rigid (non-deformable) triangle mesh primitives are instanced: primitives
+ * that load the same file (with the same centering and transform) share a 
+ * single immutable IndexedTriArray, and primitives that use the same mesh 
+ * with the same intersection tolerance and edge sample length share a single
+ * bounding volume hierarchy.  Each instance keeps only its transform, its
+ * mass properties, and per-instance scratch data.  Changing the transform of
+ * an instance gives it its own copy of the mesh (copy-on-write).
+ */
 class TriangleMeshPrimitive : public Primitive
 {
   public: 
@@ -36,6 +50,7 @@ class TriangleMeshPrimitive : public Primitive
     virtual boost::shared_ptr<void> save_state() const;
     virtual void load_state(boost::shared_ptr<void> state);
     virtual BVPtr get_BVH_root();
+    static void clear_instance_cache();
     virtual void get_vertices(BVPtr bv, std::vector<const Vector3*>& vertices);
     virtual bool point_inside(BVPtr bv, const Vector3& p, Vector3& normal) const;
     virtual bool intersect_seg(BVPtr bv, const LineSeg3& seg, Real& t, Vector3& isect, Vector3& normal) const;
@@ -49,15 +64,13 @@ class TriangleMeshPrimitive : public Primitive
 
   private:
     void center();
+    void load_mesh(const std::string& filename, bool center);
     virtual void calc_mass_properties();
 
     /// Determines whether we convexify the mesh for inertial calculations
     bool _convexify_inertia;
 
-    /// The root bounding volume around the primitive; can differ based on whether the geometry is deformable
-    BVPtr _root;
-    
-    /// The underlying mesh
+    /// The underlying mesh (possibly shared with other instances)
     /**
      * \note the mesh changes when the primitive's transform changes
      */
@@ -75,15 +88,47 @@ class TriangleMeshPrimitive : public Primitive
         unsigned tri_idx;             // the index of this triangle
     };
 
-    struct TriangleMeshPrimitiveState
+    /// Bounding volume hierarchy and associated mesh data (immutable once built, shareable between instances)
+    struct MeshBVH
     {
-      boost::shared_ptr<void> pstate;  // state information for the primitive object
-      BVPtr rootBVH;     // root of the bounding volume hierarchy
+      boost::shared_ptr<const IndexedTriArray> mesh; // mesh the BVH was built over
+      Real intersection_tolerance;   // tolerance used to fatten BVs and vertices
+      Real edge_sample_length;       // edge sample length used for vertices
+
+      /// The root bounding volume; can differ based on whether the geometry is deformable
+      BVPtr root;
+
+      /// Mapping from BVs to triangles contained within
       std::map<BVPtr, std::list<unsigned> > mesh_tris;
+
+      /// Mapping from BVs to the sub meshes returned by get_sub_mesh() (built with the hierarchy so that lookups are read-only)
+      std::map<BVPtr, std::pair<boost::shared_ptr<const IndexedTriArray>, std::list<unsigned> > > sub_meshes;
+
+      /// Vertices used by get_vertices() [and referenced by mesh_vertices]
+      std::vector<Vector3> vertices;
+
+      /// Mapping from BVs to vertex indices contained within
       std::map<BVPtr, std::list<unsigned> > mesh_vertices;
+
+      /// Mapping from BV leafs to thick triangles
       std::map<BVPtr, std::list<boost::shared_ptr<AThickTri> > > tris;
     };
 
+    /// Key identifying a mesh loaded from a file
+    struct MeshFileKey
+    {
+      std::string filename;  // the name of the file the mesh was read from
+      bool center;           // whether the mesh was centered 
+      Matrix4 T;             // the transform of the primitive at load time
+      bool operator<(const MeshFileKey& k) const;
+    };
+
+    struct TriangleMeshPrimitiveState
+    {
+      boost::shared_ptr<void> pstate;  // state information for the primitive object
+      boost::shared_ptr<MeshBVH> bvh;  // the bounding volume hierarchy
+    };
+
     void construct_mesh_vertices(boost::shared_ptr<const IndexedTriArray> mesh);
     void build_BB_tree();
     void split_tris(const Vector3& point, const Vector3& normal, const IndexedTriArray& orig_mesh, const std::list<unsigned>& ofacets, std::list<unsigned>& pfacets, std::list<unsigned>& nfacets);
@@ -93,20 +138,18 @@ class TriangleMeshPrimitive : public Primitive
     template <class InputIterator, class OutputIterator>
     static OutputIterator get_vertices(const IndexedTriArray& tris, InputIterator fselect_begin, InputIterator fselect_end, OutputIterator output);
 
-    /// Mapping from BVs to triangles contained within
-    std::map<BVPtr, std::list<unsigned> > _mesh_tris;
-
-    /// Vertices used by get_vertices() [and referenced by _mesh_vertices]
-    boost::shared_ptr<std::vector<Vector3> > _vertices;
+    /// The bounding volume hierarchy (possibly shared with other instances)
+    boost::shared_ptr<MeshBVH> _bvh;
 
-    /// Mapping from BVs to vertex indices contained within
-    std::map<BVPtr, std::list<unsigned> > _mesh_vertices;
+    /// Meshes loaded from files, shared among instances
+    static std::map<MeshFileKey, boost::weak_ptr<const IndexedTriArray> > _mesh_cache;
 
-    /// Mapping from BV leafs to thick triangles
-    std::map<BVPtr, std::list<boost::shared_ptr<AThickTri> > > _tris;
+    /// Bounding volume hierarchies built for rigid meshes, shared among instances
+    static std::map<const IndexedTriArray*, std::list<boost::weak_ptr<MeshBVH> > > _bvh_cache;
 
-    /// List of triangles covered by a bounding volume
-    std::pair<boost::shared_ptr<const IndexedTriArray>, std::list<unsigned> > _smesh;
+    #ifdef THREADSAFE
+    static pthread_mutex_t _instance_mutex;
+    #endif
 
     /// Mapping from Vector3 pointers to mesh vertex indices
     std::map<const Vector3*, unsigned> _mesh_vertex_map;
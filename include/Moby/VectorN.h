@@ -12,6 +12,8 @@
 #include <boost/shared_array.hpp>
 #include <Moby/cblas.h>
 #include <Moby/Types.h>
+#include <Moby/ArrayAllocator.h>
+#include <Moby/VectorNExpr.h>
 #include <Moby/Vector2.h>
 #include <Moby/Vector3.h>
 #include <Moby/SVector6.h>
@@ -23,7 +25,11 @@ namespace Moby {
 class MatrixN;
   
 /// A generic N-dimensional floating point vector
-class VectorN
+/**
+ * Arithmetic operators on vectors return lazily evaluated expressions (see
+ * VectorNExpr) that are evaluated without temporaries on assignment.
+ */
+class VectorN : public VectorNExpr<VectorN>
 {
   public:
     template <class ForwardIterator>
@@ -38,6 +44,10 @@ class VectorN
     VectorN(const SVector6& v);
     VectorN(unsigned N, const Real* array);
     VectorN(unsigned N, boost::shared_array<Real> array);
+
+    template <class E>
+    VectorN(const VectorNExpr<E>& e);
+
     static VectorN construct_variable(unsigned N, ...);
     virtual ~VectorN() {}
     virtual Real dot(const VectorN& v) const { return dot(*this, v); }
@@ -73,15 +83,20 @@ class VectorN
     VectorN& operator=(const Vector3& source);
     VectorN& operator=(VectorN& source);
     VectorN& operator=(const VectorN& source);
-    VectorN operator+(const VectorN& v) const;
     VectorN& operator+=(const VectorN& v);
-    VectorN operator-(const VectorN& v) const;
     VectorN& operator-=(const VectorN& v);
-    VectorN operator*(Real scalar) const;
     VectorN& operator*=(Real scalar);
-    VectorN operator/(Real scalar) const;
     VectorN& operator/=(Real scalar) { return operator*=(1.0/scalar); }
-    VectorN operator-() const;
+
+    template <class E>
+    VectorN& operator=(const VectorNExpr<E>& e);
+
+    template <class E>
+    VectorN& operator+=(const VectorNExpr<E>& e);
+
+    template <class E>
+    VectorN& operator-=(const VectorNExpr<E>& e);
+
     Real& operator[](const unsigned i) { assert(i < _len); return _data[i]; }
     Real operator[](const unsigned i) const { assert(i < _len); return _data[i]; }
     Real* data() { return _data.get(); }
@@ -149,6 +164,7 @@ std::ostream& operator<<(std::ostream& out, const VectorN& v);
 std::istream& operator>>(std::istream& in, VectorN& v);
 
 // include inline functions
+#include "VectorNExpr.inl"
 #include "VectorN.inl"
 
 } // end namespace
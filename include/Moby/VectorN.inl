@@ -4,8 +4,6 @@
  * License (found in COPYING).
  ****************************************************************************/
 
-inline VectorN operator*(Real scalar, const VectorN& v) { return v * scalar; }
-
 /// Gets a sub-vector from this vector
 template <class V>
 V& VectorN::get_sub_vec(unsigned start, unsigned end, V& v) const
@@ -42,8 +40,8 @@ VectorN& VectorN::set_sub_vec(unsigned start, const V& v)
   if (SZ == 0)
     return *this;
 
-  // copy using BLAS
-  CBLAS::copy(SZ, v.data(), 1, _data.get()+start, 1);
+  // copy using BLAS (expressions are evaluated in place)
+  copy_to_array(&v, v, _data.get()+start);
 
   return *this;
 }
@@ -55,7 +53,7 @@ VectorN::VectorN(ForwardIterator begin, ForwardIterator end)
   // setup the vector
   _len = std::distance(begin, end);
   _capacity = _len;
-  _data = boost::shared_array<Real>(new Real[_len]);
+  _data = ArrayAllocator::create(_len);
 
   // copy the elements
   std::copy(begin, end, this->begin());
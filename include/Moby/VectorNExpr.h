@@ -0,0 +1,50 @@
+/****************************************************************************
+ * Copyright 2011 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#ifndef _VECTORN_EXPR_H
+#define _VECTORN_EXPR_H
+
+#include <Moby/Types.h>
+
+namespace Moby {
+
+class VectorN;
+
+/// Base class for lazily evaluated VectorN expressions
+/**
+ * Arithmetic on VectorN objects (sums, differences, scaling, negation,
+ * and products of a MatrixN with a VectorN) builds a lightweight expression
+ * object instead of a temporary vector; the expression is evaluated in a
+ * single fused loop (or a single BLAS call) when it is assigned to, or
+ * used to construct, a VectorN.  Expressions hold references to their
+ * operands, so they must be consumed within the statement that creates them.
+ *
+ * Expression classes E provide size(), prepare() (called once before
+ * evaluation), and coeff(i) (valid after prepare()).  Expressions do not
+ * provide element access, which would evaluate the entire expression for
+ * each element; evaluate the expression into a VectorN first instead.
+ */
+template <class E>
+class VectorNExpr
+{
+  public:
+    /// Gets the expression as its derived type
+    const E& self() const { return static_cast<const E&>(*this); }
+
+    /// Gets the number of elements in the result of the expression
+    unsigned size() const { return self().size(); }
+
+    Real norm() const;
+    Real norm_sq() const;
+    Real norm1() const;
+    Real norm_inf() const;
+    Real dot(const VectorN& v) const;
+}; // end class
+
+} // end namespace
+
+#endif
+
@@ -0,0 +1,425 @@
+/****************************************************************************
+ * Copyright 2011 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+/// Leaf of a VectorN expression
+class VectorNRef
+{
+  public:
+    VectorNRef(const VectorN& v) : _v(v), _data(NULL) { }
+    unsigned size() const { return _v.size(); }
+    void prepare() const { _data = _v.data(); }
+    Real coeff(unsigned i) const { return _data[i]; }
+    bool aliases(const VectorN& v) const { return &_v == &v; }
+
+  private:
+    const VectorN& _v;
+    mutable const Real* _data;
+}; // end class
+
+/// Determines how an operand is stored within an expression
+/**
+ * VectorN operands are referenced through a VectorNRef; expressions are
+ * stored by value.
+ */
+template <class E>
+struct VectorNExprStorage
+{
+  typedef E type;
+};
+
+template <>
+struct VectorNExprStorage<VectorN>
+{
+  typedef VectorNRef type;
+};
+
+/// Addition operator for VectorNBinaryExpr
+struct VectorNAddOp
+{
+  static Real apply(Real a, Real b) { return a + b; }
+  static Real sign() { return (Real) 1.0; }
+};
+
+/// Subtraction operator for VectorNBinaryExpr
+struct VectorNSubOp
+{
+  static Real apply(Real a, Real b) { return a - b; }
+  static Real sign() { return (Real) -1.0; }
+};
+
+/// Element-wise sum or difference of two VectorN expressions
+template <class L, class R, class Op>
+class VectorNBinaryExpr : public VectorNExpr<VectorNBinaryExpr<L, R, Op> >
+{
+  public:
+    typedef typename VectorNExprStorage<L>::type LType;
+    typedef typename VectorNExprStorage<R>::type RType;
+
+    VectorNBinaryExpr(const L& l, const R& r) : _l(l), _r(r)
+    {
+      if (l.size() != r.size())
+        throw MissizeException();
+    }
+
+    unsigned size() const { return _l.size(); }
+    void prepare() const { _l.prepare(); _r.prepare(); }
+    Real coeff(unsigned i) const { return Op::apply(_l.coeff(i), _r.coeff(i)); }
+    const LType& lhs() const { return _l; }
+    const RType& rhs() const { return _r; }
+
+  private:
+    LType _l;
+    RType _r;
+}; // end class
+
+/// A VectorN expression multiplied by a scalar
+template <class E>
+class VectorNScaledExpr : public VectorNExpr<VectorNScaledExpr<E> >
+{
+  public:
+    typedef typename VectorNExprStorage<E>::type EType;
+
+    VectorNScaledExpr(const E& e, Real scalar) : _e(e), _scalar(scalar) { }
+    unsigned size() const { return _e.size(); }
+    void prepare() const { _e.prepare(); }
+    Real coeff(unsigned i) const { return _scalar * _e.coeff(i); }
+
+  private:
+    EType _e;
+    Real _scalar;
+}; // end class
+
+/// The product of a matrix and a VectorN, scaled by a scalar
+/**
+ * When this expression is assigned to (or accumulated into) a vector that
+ * it does not reference, it is evaluated by a single call to gemv; when it
+ * is nested within another expression, it is evaluated into a temporary by
+ * prepare().
+ */
+template <class M>
+class MatrixVectorNProduct : public VectorNExpr<MatrixVectorNProduct<M> >
+{
+  public:
+    MatrixVectorNProduct(const M& m, const VectorN& x, Real alpha = (Real) 1.0) : _m(m), _x(x), _alpha(alpha)
+    {
+      if (m.columns() != x.size())
+        throw MissizeException();
+    }
+
+    unsigned size() const { return _m.rows(); }
+    void prepare() const { _result.resize(_m.rows()); gemv(_result, (Real) 0.0); }
+    Real coeff(unsigned i) const { return _result.data()[i]; }
+    bool aliases(const VectorN& v) const { return &_x == &v; }
+    Real alpha() const { return _alpha; }
+    const M& matrix() const { return _m; }
+    const VectorN& vector() const { return _x; }
+
+    /// Computes y = alpha*m*x + beta*y (y must be properly sized and must not be x)
+    void gemv(VectorN& y, Real beta) const
+    {
+      const unsigned ROWS = _m.rows(), COLS = _m.columns();
+      if (ROWS == 0)
+        return;
+      if (COLS == 0)
+      {
+        if (beta == (Real) 0.0)
+          y.set_zero();
+        else
+          y *= beta;
+        return;
+      }
+      CBLAS::gemv(CblasColMajor, CblasNoTrans, ROWS, COLS, _alpha, _m.data(), ROWS, _x.data(), 1, beta, y.data(), 1);
+    }
+
+  private:
+    const M& _m;
+    const VectorN& _x;
+    Real _alpha;
+    mutable VectorN _result;
+}; // end class
+
+/// Adds two VectorN expressions
+template <class L, class R>
+inline VectorNBinaryExpr<L, R, VectorNAddOp> operator+(const VectorNExpr<L>& l, const VectorNExpr<R>& r)
+{
+  return VectorNBinaryExpr<L, R, VectorNAddOp>(l.self(), r.self());
+}
+
+/// Subtracts two VectorN expressions
+template <class L, class R>
+inline VectorNBinaryExpr<L, R, VectorNSubOp> operator-(const VectorNExpr<L>& l, const VectorNExpr<R>& r)
+{
+  return VectorNBinaryExpr<L, R, VectorNSubOp>(l.self(), r.self());
+}
+
+/// Multiplies a VectorN expression by a scalar
+template <class E>
+inline VectorNScaledExpr<E> operator*(const VectorNExpr<E>& e, Real scalar)
+{
+  return VectorNScaledExpr<E>(e.self(), scalar);
+}
+
+/// Multiplies a VectorN expression by a scalar
+template <class E>
+inline VectorNScaledExpr<E> operator*(Real scalar, const VectorNExpr<E>& e)
+{
+  return VectorNScaledExpr<E>(e.self(), scalar);
+}
+
+/// Divides a VectorN expression by a scalar (same as expression * 1/scalar)
+template <class E>
+inline VectorNScaledExpr<E> operator/(const VectorNExpr<E>& e, Real scalar)
+{
+  return VectorNScaledExpr<E>(e.self(), (Real) 1.0/scalar);
+}
+
+/// Negates a VectorN expression
+template <class E>
+inline VectorNScaledExpr<E> operator-(const VectorNExpr<E>& e)
+{
+  return VectorNScaledExpr<E>(e.self(), (Real) -1.0);
+}
+
+/// Multiplies a matrix-vector product by a scalar (folded into the product)
+template <class M>
+inline MatrixVectorNProduct<M> operator*(const MatrixVectorNProduct<M>& p, Real scalar)
+{
+  return MatrixVectorNProduct<M>(p.matrix(), p.vector(), p.alpha()*scalar);
+}
+
+/// Multiplies a matrix-vector product by a scalar (folded into the product)
+template <class M>
+inline MatrixVectorNProduct<M> operator*(Real scalar, const MatrixVectorNProduct<M>& p)
+{
+  return MatrixVectorNProduct<M>(p.matrix(), p.vector(), p.alpha()*scalar);
+}
+
+/// Divides a matrix-vector product by a scalar (folded into the product)
+template <class M>
+inline MatrixVectorNProduct<M> operator/(const MatrixVectorNProduct<M>& p, Real scalar)
+{
+  return MatrixVectorNProduct<M>(p.matrix(), p.vector(), p.alpha()/scalar);
+}
+
+/// Negates a matrix-vector product (folded into the product)
+template <class M>
+inline MatrixVectorNProduct<M> operator-(const MatrixVectorNProduct<M>& p)
+{
+  return MatrixVectorNProduct<M>(p.matrix(), p.vector(), -p.alpha());
+}
+
+/// Evaluates an expression into a vector using a single fused loop
+/**
+ * The expression is prepared before y is resized: products that reference y
+ * are then already evaluated into their temporaries, and any VectorN leaf
+ * that is y has the size of the result, so resizing y does not move it.
+ */
+template <class E>
+void evaluate_fused(VectorN& y, const E& e)
+{
+  const unsigned N = e.size();
+  e.prepare();
+  y.resize(N);
+  Real* data = y.data();
+  for (unsigned i=0; i< N; i++)
+    data[i] = e.coeff(i);
+}
+
+/// Evaluates an expression into a vector
+template <class E>
+void evaluate(VectorN& y, const E& e)
+{
+  evaluate_fused(y, e);
+}
+
+/// Evaluates a matrix-vector product into a vector using gemv
+template <class M>
+void evaluate(VectorN& y, const MatrixVectorNProduct<M>& p)
+{
+  if (p.aliases(y))
+  {
+    evaluate_fused(y, p);
+    return;
+  }
+
+  y.resize(p.size());
+  p.gemv(y, (Real) 0.0);
+}
+
+/// Evaluates (matrix * vector) +/- expression using a single gemv
+template <class M, class R, class Op>
+void evaluate(VectorN& y, const VectorNBinaryExpr<MatrixVectorNProduct<M>, R, Op>& e)
+{
+  if (e.lhs().aliases(y))
+  {
+    evaluate_fused(y, e);
+    return;
+  }
+
+  // y = r; y = alpha*A*x + sign*y
+  evaluate(y, e.rhs());
+  e.lhs().gemv(y, Op::sign());
+}
+
+/// Evaluates expression +/- (matrix * vector) using a single gemv
+template <class L, class M, class Op>
+void evaluate(VectorN& y, const VectorNBinaryExpr<L, MatrixVectorNProduct<M>, Op>& e)
+{
+  if (e.rhs().aliases(y))
+  {
+    evaluate_fused(y, e);
+    return;
+  }
+
+  // y = l; y += sign*alpha*A*x
+  evaluate(y, e.lhs());
+  MatrixVectorNProduct<M>(e.rhs().matrix(), e.rhs().vector(), Op::sign()*e.rhs().alpha()).gemv(y, (Real) 1.0);
+}
+
+/// Evaluates (matrix * vector) +/- (matrix * vector) using two gemv calls
+template <class M1, class M2, class Op>
+void evaluate(VectorN& y, const VectorNBinaryExpr<MatrixVectorNProduct<M1>, MatrixVectorNProduct<M2>, Op>& e)
+{
+  if (e.lhs().aliases(y) || e.rhs().aliases(y))
+  {
+    evaluate_fused(y, e);
+    return;
+  }
+
+  evaluate(y, e.lhs());
+  MatrixVectorNProduct<M2>(e.rhs().matrix(), e.rhs().vector(), Op::sign()*e.rhs().alpha()).gemv(y, (Real) 1.0);
+}
+
+/// Evaluates y += scalar*e using a single fused loop
+template <class E>
+void evaluate_add_fused(VectorN& y, const E& e, Real scalar)
+{
+  const unsigned N = e.size();
+  if (N != y.size())
+    throw MissizeException();
+  e.prepare();
+  Real* data = y.data();
+  for (unsigned i=0; i< N; i++)
+    data[i] += scalar * e.coeff(i);
+}
+
+/// Evaluates y += scalar*e
+template <class E>
+void evaluate_add(VectorN& y, const E& e, Real scalar)
+{
+  evaluate_add_fused(y, e, scalar);
+}
+
+/// Evaluates y += scalar*A*x using a single gemv
+template <class M>
+void evaluate_add(VectorN& y, const MatrixVectorNProduct<M>& p, Real scalar)
+{
+  if (p.aliases(y))
+  {
+    evaluate_add_fused(y, p, scalar);
+    return;
+  }
+
+  if (p.size() != y.size())
+    throw MissizeException();
+  MatrixVectorNProduct<M>(p.matrix(), p.vector(), scalar*p.alpha()).gemv(y, (Real) 1.0);
+}
+
+/// Copies a vector-like object (providing size() and data()) to an array
+template <class V>
+inline void copy_to_array(const void*, const V& v, Real* y)
+{
+  CBLAS::copy(v.size(), v.data(), 1, y, 1);
+}
+
+/// Evaluates an expression into an array using a single fused loop
+template <class E, class V>
+inline void copy_to_array(const VectorNExpr<E>*, const V& v, Real* y)
+{
+  const E& e = v.self();
+  const unsigned N = e.size();
+  e.prepare();
+  for (unsigned i=0; i< N; i++)
+    y[i] = e.coeff(i);
+}
+
+/// Copies a vector to an array
+inline void copy_to_array(const VectorN*, const VectorN& v, Real* y)
+{
+  CBLAS::copy(v.size(), v.data(), 1, y, 1);
+}
+
+/// Constructs a vector by evaluating an expression
+template <class E>
+VectorN::VectorN(const VectorNExpr<E>& e)
+{
+  _len = 0;
+  _capacity = 0;
+  evaluate(*this, e.self());
+}
+
+/// Assigns this vector to the result of an expression
+/**
+ * The expression may reference this vector.
+ */
+template <class E>
+VectorN& VectorN::operator=(const VectorNExpr<E>& e)
+{
+  evaluate(*this, e.self());
+  return *this;
+}
+
+/// Adds the result of an expression to this vector in place
+template <class E>
+VectorN& VectorN::operator+=(const VectorNExpr<E>& e)
+{
+  evaluate_add(*this, e.self(), (Real) 1.0);
+  return *this;
+}
+
+/// Subtracts the result of an expression from this vector in place
+template <class E>
+VectorN& VectorN::operator-=(const VectorNExpr<E>& e)
+{
+  evaluate_add(*this, e.self(), (Real) -1.0);
+  return *this;
+}
+
+/// Computes the l2-norm of the result of the expression
+template <class E>
+Real VectorNExpr<E>::norm() const
+{
+  return VectorN(*this).norm();
+}
+
+/// Computes the squared l2-norm of the result of the expression
+template <class E>
+Real VectorNExpr<E>::norm_sq() const
+{
+  return VectorN(*this).norm_sq();
+}
+
+/// Computes the l1-norm of the result of the expression
+template <class E>
+Real VectorNExpr<E>::norm1() const
+{
+  return VectorN(*this).norm1();
+}
+
+/// Computes the infinity-norm of the result of the expression
+template <class E>
+Real VectorNExpr<E>::norm_inf() const
+{
+  return VectorN(*this).norm_inf();
+}
+
+/// Computes the dot product of the result of the expression and a vector
+template <class E>
+Real VectorNExpr<E>::dot(const VectorN& v) const
+{
+  return VectorN(*this).dot(v);
+}
+
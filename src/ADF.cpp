@@ -4,6 +4,8 @@
  * License (found in COPYING).
  ****************************************************************************/
 
+#include <stdint.h>
+#include <cstring>
 #include <fstream>
 #include <set>
 #include <cmath>
@@ -11,6 +13,9 @@
 #include <limits>
 #include <list>
 #include <stack>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #ifdef USE_INVENTOR
 #include <Inventor/nodes/SoBaseColor.h>
@@ -24,6 +29,7 @@
 #include <Moby/Log.h>
 #include <Moby/CompGeom.h>
 #include <Moby/Polyhedron.h>
+#include <Moby/MappedFile.h>
 #include <Moby/ADF.h>
 
 using namespace boost;
@@ -37,7 +43,7 @@ using namespace Moby;
 ADF::ADF()
 {
   // set the bounds to +/- infinity
-  set_bounds(ONES_3 * -std::numeric_limits<Real>::max(), ONES_3 * std::numeric_limits<Real>::max());
+  set_bounds(Vector3(1.0, 1.0, 1.0) * -std::numeric_limits<Real>::max(), Vector3(1.0, 1.0, 1.0) * std::numeric_limits<Real>::max());
   _distances = std::vector<Real>(BOX_VERTICES, std::numeric_limits<Real>::max());
 }
 
@@ -255,7 +261,9 @@ shared_ptr<ADF> ADF::build_ADF(Polyhedron& poly, unsigned max_recursion, Real ep
 /**
  * \param lo the lower bounds
  * \param hi the upper bounds
- * \param dfn the distance function 
+ * \param dfn the distance function; cells are subdivided in parallel (if
+ *         OpenMP is enabled), so dfn must be safe to call from multiple 
+ *         threads at once
  * \param max_recursion the maximum recursion level within the ADF octree
  * \param epsilon the tolerance below which subdivision stops
  * \param max_pos_dist the maximum positive (external) distance to build the 
@@ -263,9 +271,13 @@ shared_ptr<ADF> ADF::build_ADF(Polyhedron& poly, unsigned max_recursion, Real ep
  *         is computed to be 1% of the diagonal of the bounding box
  * \param max_neg_dist the maximum negative (internal) distance to build the 
  *         ADF; default value is infinity
+ * \param checkpoint_filename if non-empty, the ADF is saved (in binary 
+ *         format) to this file as each level of the octree is completed;
+ *         construction can be resumed by loading the file and calling
+ *         refine_ADF()
  * \return a shared pointer to the constructed ADF octree
  */
-shared_ptr<ADF> ADF::build_ADF(const Vector3& lo, const Vector3& hi, Real (*dfn)(const Vector3&, void*), unsigned max_recursion, Real epsilon, Real max_pos_dist, Real max_neg_dist, void* data)
+shared_ptr<ADF> ADF::build_ADF(const Vector3& lo, const Vector3& hi, Real (*dfn)(const Vector3&, void*), unsigned max_recursion, Real epsilon, Real max_pos_dist, Real max_neg_dist, void* data, const std::string& checkpoint_filename)
 {
   const unsigned X = 0, Y = 1, Z = 2;
   const Real COMPUTED_EXTRA = 0.01;
@@ -295,78 +307,255 @@ shared_ptr<ADF> ADF::build_ADF(const Vector3& lo, const Vector3& hi, Real (*dfn)
   root->set_bounds(new_lo, new_hi);
   root->set_distances(dfn, data);
 
-  // setup a queue for processing
-  std::queue<shared_ptr<ADF> > q;
-  q.push(root);
+  // subdivide the root as necessary
+  refine_ADF(root, dfn, max_recursion, epsilon, max_neg_dist, data, checkpoint_filename);
 
-  while (!q.empty())
+  return root;
+}
+
+/// Caches samples of the distance function on the lattice of the finest cells of an ADF
+/**
+ * Neighboring cells share corners, face centers, and edge centers, and the
+ * samples used to test a cell against the tolerance are exactly the new 
+ * vertices created when that cell is subdivided; the cache ensures that the
+ * distance function is evaluated only once for each such point.  Points are
+ * identified by their (rounded) integer coordinates on the lattice of cells at
+ * the maximum recursion level.  The cache may be used from multiple threads.
+ */
+class ADF::SampleCache
+{
+  public:
+    SampleCache(const Vector3& lo, const Vector3& hi, unsigned max_recursion, Real (*dfn)(const Vector3&, void*), void* data);
+    ~SampleCache();
+    Real calc_distance(const Vector3& point);
+
+  private:
+    /// The maximum recursion level for which points can be keyed (21 bits per coordinate)
+    static const unsigned MAX_LEVELS = 20;
+
+    bool calc_key(const Vector3& point, uint64_t& key) const;
+
+    Real (*_dfn)(const Vector3&, void*);
+    void* _data;
+    Vector3 _lo, _h;
+    bool _enabled;
+    std::map<uint64_t, Real> _distances;
+    #ifdef _OPENMP
+    omp_lock_t _lock;
+    #endif
+}; // end class
+
+/// Constructs a sample cache for the ADF with given root bounds and maximum recursion level 
+ADF::SampleCache::SampleCache(const Vector3& lo, const Vector3& hi, unsigned max_recursion, Real (*dfn)(const Vector3&, void*), void* data)
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+
+  _dfn = dfn;
+  _data = data;
+  _lo = lo;
+
+  // points can only be keyed if the lattice is not too fine
+  _enabled = (max_recursion <= MAX_LEVELS);
+  if (_enabled)
   {
-    // get the element off of the front of the queue
-    shared_ptr<ADF> cell = q.front();
-    q.pop();
+    const Real CELLS = (Real) ((uint64_t) 1 << max_recursion);
+    _h = Vector3((hi[X] - lo[X])/CELLS, (hi[Y] - lo[Y])/CELLS, (hi[Z] - lo[Z])/CELLS);
+    for (unsigned i=0; i< 3; i++)
+      if (!(_h[i] > 0.0 && _h[i] < std::numeric_limits<Real>::max()))
+        _enabled = false;
+  }
 
-    // if it's not possible to subdivide the current cell any more, continue
-    if (cell->get_recursion_level() == max_recursion)
-      continue;
+  #ifdef _OPENMP
+  omp_init_lock(&_lock);
+  #endif
+}
 
-    // if cell is completely inside, continue
-    bool completely_inside = true;
-    for (unsigned i=0; i< BOX_VERTICES; i++)
-      if (cell->get_distances()[i] > -max_neg_dist)
-      {
-        completely_inside = false;
-        break;
-      }
-    if (completely_inside)
-      continue;
+ADF::SampleCache::~SampleCache()
+{
+  #ifdef _OPENMP
+  omp_destroy_lock(&_lock);
+  #endif
+}
 
-    // get samples over this cell
-    std::vector<Vector3> samples;
-    cell->get_samples(samples);
+/// Computes the key of a point on the lattice
+/**
+ * \return <b>false</b> if the point does not lie (to within one hundredth of
+ *         a lattice cell) on the lattice
+ */
+bool ADF::SampleCache::calc_key(const Vector3& point, uint64_t& key) const
+{
+  const Real TOL = 1e-2;
+  const uint64_t MASK = ((uint64_t) 1 << (MAX_LEVELS+1)) - 1;
 
-    // otherwise, check whether the cell's distances within desired tolerance
-    Real mean_err = 0;
-    bool within_tol = true;
-    for (unsigned i=0; i< samples.size(); i++)
-    {              
-      Real calc_dist = cell->calc_signed_distance(samples[i]);
-      Real true_dist = dfn(samples[i], data);
-      FILE_LOG(LOG_ADF) << " sample: " << samples[i] << std::endl;
-      FILE_LOG(LOG_ADF) << "   true distance: " << true_dist << std::endl;
-      FILE_LOG(LOG_ADF) << "   calculated distance: " << calc_dist << std::endl;
-      mean_err += std::fabs(calc_dist - true_dist);
-      if (std::fabs(calc_dist - true_dist) > epsilon)
+  key = 0;
+  for (unsigned i=0; i< 3; i++)
+  {
+    Real x = (point[i] - _lo[i])/_h[i];
+    Real xr = std::floor(x + 0.5);
+    if (xr < 0.0 || std::fabs(x - xr) > TOL)
+      return false;
+    uint64_t c = (uint64_t) xr;
+    if (c > MASK)
+      return false;
+    key |= c << ((MAX_LEVELS+1)*i);
+  }
+
+  return true;
+}
+
+/// Computes the distance at a point, using the cached value if available
+Real ADF::SampleCache::calc_distance(const Vector3& point)
+{
+  // if the point cannot be keyed, evaluate the distance function directly
+  uint64_t key;
+  if (!_enabled || !calc_key(point, key))
+    return _dfn(point, _data);
+
+  // look for the point in the cache
+  #ifdef _OPENMP
+  omp_set_lock(&_lock);
+  #endif
+  std::map<uint64_t, Real>::const_iterator i = _distances.find(key);
+  bool found = (i != _distances.end());
+  Real dist = (found) ? i->second : (Real) 0.0;
+  #ifdef _OPENMP
+  omp_unset_lock(&_lock);
+  #endif
+  if (found)
+    return dist;
+
+  // evaluate the distance function outside of the lock (another thread may 
+  // evaluate the same point concurrently; the results are identical) 
+  dist = _dfn(point, _data);
+  #ifdef _OPENMP
+  omp_set_lock(&_lock);
+  #endif
+  _distances[key] = dist;
+  #ifdef _OPENMP
+  omp_unset_lock(&_lock);
+  #endif
+
+  return dist;
+}
+
+/// Computes the distance function at a point, using the sample cache (if any)
+Real ADF::calc_sample(const Vector3& point, Real (*dfn)(const Vector3&, void*), void* data, SampleCache* cache)
+{
+  return (cache) ? cache->calc_distance(point) : dfn(point, data);
+}
+
+/// Refines (subdivides the leaves of) an ADF until all cells are within tolerance
+/**
+ * Cells are processed level by level; the cells of each level are tested
+ * and subdivided in parallel (if OpenMP is enabled), so dfn must be safe to
+ * call from multiple threads at once.  Samples of the distance function are
+ * shared between neighboring cells.  Since refinement proceeds from the 
+ * current leaves, an ADF that was only partially built (e.g., one loaded from
+ * a checkpoint file) can be completed by calling this method.
+ * \param root the root of the ADF (distances of the leaves must be set)
+ * \param dfn the distance function
+ * \param max_recursion the maximum recursion level within the ADF octree
+ * \param epsilon the tolerance below which subdivision stops
+ * \param max_neg_dist the maximum negative (internal) distance to refine
+ * \param checkpoint_filename if non-empty, the ADF is saved (in binary 
+ *         format) to this file after each level is completed
+ */
+void ADF::refine_ADF(shared_ptr<ADF> root, Real (*dfn)(const Vector3&, void*), unsigned max_recursion, Real epsilon, Real max_neg_dist, void* data, const std::string& checkpoint_filename)
+{
+  // setup the sample cache
+  SampleCache cache(root->_lo_bounds, root->_hi_bounds, max_recursion, dfn, data);
+
+  // the cells to be processed are initially the leaves of the ADF
+  std::list<shared_ptr<ADF> > leafs;
+  root->get_all_leaf_nodes(leafs);
+  std::vector<shared_ptr<ADF> > cells(leafs.begin(), leafs.end());
+
+  while (!cells.empty())
+  {
+    // test and subdivide all cells in parallel
+    const int NCELLS = (int) cells.size();
+    std::vector<unsigned char> subdivided(NCELLS, 0);
+    #pragma omp parallel for schedule(dynamic)
+    for (int i=0; i< NCELLS; i++)
+    {
+      if (!cells[i]->needs_subdivision(max_recursion, epsilon, max_neg_dist, dfn, data, &cache))
+        continue;
+
+      // subdivide the cell
+      cells[i]->subdivide(dfn, data, &cache);
+      subdivided[i] = 1;
+    }
+
+    // the children of subdivided cells are processed next
+    std::vector<shared_ptr<ADF> > next;
+    for (int i=0; i< NCELLS; i++)
+    {
+      if (!subdivided[i])
+        continue;
+
+      const std::vector<shared_ptr<ADF> >& children = cells[i]->get_children();
+      next.insert(next.end(), children.begin(), children.end());
+
+      FILE_LOG(LOG_ADF) << "subdivided cell: " << std::endl << *cells[i];
+      FILE_LOG(LOG_ADF) << "children: " << std::endl;
+      for (unsigned j=0; j< OCT_CHILDREN; j++)
       {
-        within_tol = false;
-        break;
+        FILE_LOG(LOG_ADF) << "  child " << j << ": " << std::endl;
+        FILE_LOG(LOG_ADF) << *children[j] << std::endl;
       }
     }
+    cells.swap(next);
 
-    mean_err /= samples.size();
-    FILE_LOG(LOG_ADF) << " ADF cell at level " << cell->get_recursion_level() << " mean error: " << mean_err << std::endl;
+    // save a checkpoint, if desired 
+    if (!checkpoint_filename.empty() && !cells.empty())
+      root->save_to_binary_file(checkpoint_filename);
+  }
+}
 
-    // if the cell is within tolerance, don't need to subdivide
-    if (within_tol)
-      continue;
+/// Determines whether this cell must be subdivided for its distances to be within tolerance
+bool ADF::needs_subdivision(unsigned max_recursion, Real epsilon, Real max_neg_dist, Real (*dfn)(const Vector3&, void*), void* data, SampleCache* cache) const
+{
+  // if it's not possible to subdivide the current cell any more, quit
+  if (get_recursion_level() >= max_recursion)
+    return false;
 
-    // subdivide the cell
-    cell->subdivide(dfn, data);
+  // if cell is completely inside, quit 
+  bool completely_inside = true;
+  for (unsigned i=0; i< BOX_VERTICES; i++)
+    if (_distances[i] > -max_neg_dist)
+    {
+      completely_inside = false;
+      break;
+    }
+  if (completely_inside)
+    return false;
 
-    // add children to the queue for processing
-    const std::vector<shared_ptr<ADF> >& children = cell->get_children();
-    for (unsigned i=0; i< OCT_CHILDREN; i++)
-      q.push(children[i]);
-  
-    FILE_LOG(LOG_ADF) << "subdivided cell: " << std::endl << *cell;
-    FILE_LOG(LOG_ADF) << "children: " << std::endl;
-    for (unsigned i=0; i< OCT_CHILDREN; i++)
+  // get samples over this cell
+  std::vector<Vector3> samples;
+  get_samples(samples);
+
+  // otherwise, check whether the cell's distances within desired tolerance
+  Real mean_err = 0;
+  bool within_tol = true;
+  for (unsigned i=0; i< samples.size(); i++)
+  {              
+    Real calc_dist = calc_signed_distance(samples[i]);
+    Real true_dist = calc_sample(samples[i], dfn, data, cache);
+    FILE_LOG(LOG_ADF) << " sample: " << samples[i] << std::endl;
+    FILE_LOG(LOG_ADF) << "   true distance: " << true_dist << std::endl;
+    FILE_LOG(LOG_ADF) << "   calculated distance: " << calc_dist << std::endl;
+    mean_err += std::fabs(calc_dist - true_dist);
+    if (std::fabs(calc_dist - true_dist) > epsilon)
     {
-      FILE_LOG(LOG_ADF) << "  child " << i << ": " << std::endl;
-      FILE_LOG(LOG_ADF) << *children[i] << std::endl;
+      within_tol = false;
+      break;
     }
   }
 
-  return root;
+  mean_err /= samples.size();
+  FILE_LOG(LOG_ADF) << " ADF cell at level " << get_recursion_level() << " mean error: " << mean_err << std::endl;
+
+  return !within_tol;
 }
 
 /// Determines whether the given point is within this ADF's bounding box
@@ -1227,6 +1416,12 @@ _children[2] = shared_ptr<ADF>(new ADF(shared_from_this(),  box_2_verts));
 
 /// Subdivides this ADF cell and computes distance quickly for children using mesh
 void ADF::subdivide(Real (*dfn)(const Vector3&, void*), void* data)
+{
+  subdivide(dfn, data, NULL);
+}
+
+/// Subdivides this ADF cell, computing distances for the children using the distance function and the sample cache (if any)
+void ADF::subdivide(Real (*dfn)(const Vector3&, void*), void* data, SampleCache* cache)
 {
   const unsigned X = 0, Y = 1, Z = 2;
 
@@ -1298,25 +1493,25 @@ void ADF::subdivide(Real (*dfn)(const Vector3&, void*), void* data)
   Vector3ConstPtr u(new Vector3(midx, _hi_bounds[Y], _lo_bounds[Z]));
   
   // compute necessary distances
-  Real a_d = dfn(*a, data);
-  Real b_d = dfn(*b, data);
-  Real c_d = dfn(*c, data);
-  Real d_d = dfn(*d, data);
-  Real e_d = dfn(*e, data);
-  Real f_d = dfn(*f, data);
-  Real g_d = dfn(*g, data);
-  Real i_d = dfn(*i, data);
-  Real j_d = dfn(*j, data);
-  Real k_d = dfn(*k, data);
-  Real m_d = dfn(*m, data);
-  Real n_d = dfn(*n, data);
-  Real o_d = dfn(*o, data);
-  Real p_d = dfn(*p, data);
-  Real q_d = dfn(*q, data);
-  Real r_d = dfn(*r, data);
-  Real s_d = dfn(*s, data);
-  Real t_d = dfn(*t, data);
-  Real u_d = dfn(*u, data);
+  Real a_d = calc_sample(*a, dfn, data, cache);
+  Real b_d = calc_sample(*b, dfn, data, cache);
+  Real c_d = calc_sample(*c, dfn, data, cache);
+  Real d_d = calc_sample(*d, dfn, data, cache);
+  Real e_d = calc_sample(*e, dfn, data, cache);
+  Real f_d = calc_sample(*f, dfn, data, cache);
+  Real g_d = calc_sample(*g, dfn, data, cache);
+  Real i_d = calc_sample(*i, dfn, data, cache);
+  Real j_d = calc_sample(*j, dfn, data, cache);
+  Real k_d = calc_sample(*k, dfn, data, cache);
+  Real m_d = calc_sample(*m, dfn, data, cache);
+  Real n_d = calc_sample(*n, dfn, data, cache);
+  Real o_d = calc_sample(*o, dfn, data, cache);
+  Real p_d = calc_sample(*p, dfn, data, cache);
+  Real q_d = calc_sample(*q, dfn, data, cache);
+  Real r_d = calc_sample(*r, dfn, data, cache);
+  Real s_d = calc_sample(*s, dfn, data, cache);
+  Real t_d = calc_sample(*t, dfn, data, cache);
+  Real u_d = calc_sample(*u, dfn, data, cache);
 
   // box 0
   std::vector<Vector3ConstPtr> box_0_verts;
@@ -1663,6 +1858,195 @@ shared_ptr<ADF> ADF::load_from_file(const std::string& filename)
   return root;
 }
 
+/// Header of the binary ADF format
+struct ADFBinaryHeader
+{
+  char magic[4];          // "MADF"
+  uint32_t version;       // format version
+  uint32_t num_vertices;  // number of vertices
+  uint32_t num_cells;     // number of cells
+};
+
+/// A cell in the binary ADF format
+/**
+ * Cells are stored in breadth-first order, so the children of a cell are
+ * stored contiguously; the root (cell zero) is never a child, so a first 
+ * child index of zero indicates a leaf.
+ */
+struct ADFBinaryCell
+{
+  uint32_t vertices[8];   // indices of the vertices of the cell
+  uint32_t first_child;   // index of the first child (zero for a leaf)
+  uint32_t unused;        // padding (for alignment of the distances)
+  double distances[8];    // distances at the vertices of the cell
+};
+
+/// Version of the binary ADF format
+static const uint32_t ADF_BINARY_VERSION = 1;
+
+/// Saves this ADF to a file using a compact binary format
+/**
+ * The file contains a header, followed by the vertices (three doubles per
+ * vertex) and the cells (in breadth-first order).  The format uses the 
+ * native byte order and may be loaded with load_from_binary_file().
+ */
+void ADF::save_to_binary_file(const std::string& filename) const
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+
+  // get the cells in breadth-first order
+  std::vector<shared_ptr<const ADF> > cells;
+  cells.push_back(shared_from_this());
+  for (unsigned i=0; i< cells.size(); i++)
+    for (unsigned j=0; j< cells[i]->_children.size(); j++)
+      cells.push_back(cells[i]->_children[j]);
+
+  // compose the map of vertices
+  std::map<Vector3ConstPtr, uint32_t> vertices;
+  std::vector<Vector3ConstPtr> verts;
+  for (unsigned i=0; i< cells.size(); i++)
+    for (unsigned j=0; j< BOX_VERTICES; j++)
+      if (vertices.find(cells[i]->_vertices[j]) == vertices.end())
+      {
+        vertices[cells[i]->_vertices[j]] = verts.size();
+        verts.push_back(cells[i]->_vertices[j]);
+      }
+
+  // open the file
+  std::ofstream out(filename.c_str(), std::ios::out | std::ios::binary);
+  if (!out.is_open())
+    throw std::runtime_error(std::string("ADF::save_to_binary_file() - unable to open ") + filename);
+
+  // write the header
+  ADFBinaryHeader header;
+  std::memcpy(header.magic, "MADF", 4);
+  header.version = ADF_BINARY_VERSION;
+  header.num_vertices = verts.size();
+  header.num_cells = cells.size();
+  out.write((const char*) &header, sizeof(ADFBinaryHeader));
+
+  // write the vertices
+  for (unsigned i=0; i< verts.size(); i++)
+  {
+    double v[3] = { (*verts[i])[X], (*verts[i])[Y], (*verts[i])[Z] };
+    out.write((const char*) v, sizeof(v));
+  }
+
+  // write the cells; children are stored contiguously in breadth-first order
+  uint32_t next_child = 1;
+  for (unsigned i=0; i< cells.size(); i++)
+  {
+    ADFBinaryCell cell;
+    for (unsigned j=0; j< BOX_VERTICES; j++)
+    {
+      cell.vertices[j] = vertices[cells[i]->_vertices[j]];
+      cell.distances[j] = cells[i]->_distances[j];
+    }
+    cell.unused = 0;
+    if (cells[i]->_children.empty())
+      cell.first_child = 0;
+    else
+    {
+      cell.first_child = next_child;
+      next_child += cells[i]->_children.size();
+    }
+    out.write((const char*) &cell, sizeof(ADFBinaryCell));
+  }
+
+  // close the file
+  out.close();
+  if (out.fail())
+    throw std::runtime_error(std::string("ADF::save_to_binary_file() - unable to write ") + filename);
+
+  FILE_LOG(LOG_ADF) << cells.size() << " cells written" << std::endl;
+}
+
+/// Reads an ADF tree from a file written by save_to_binary_file()
+shared_ptr<ADF> ADF::load_from_binary_file(const std::string& filename)
+{
+  // map the file
+  MappedFile file(filename);
+
+  // read and verify the header
+  ADFBinaryHeader header;
+  if (file.size() < sizeof(ADFBinaryHeader))
+    throw std::runtime_error(std::string("ADF::load_from_binary_file() - not an ADF file: ") + filename);
+  std::memcpy(&header, file.begin(), sizeof(ADFBinaryHeader));
+  if (std::memcmp(header.magic, "MADF", 4) != 0)
+    throw std::runtime_error(std::string("ADF::load_from_binary_file() - not an ADF file: ") + filename);
+  if (header.version != ADF_BINARY_VERSION)
+    throw std::runtime_error(std::string("ADF::load_from_binary_file() - unsupported version in ") + filename);
+  const std::size_t EXPECTED = sizeof(ADFBinaryHeader) + (std::size_t) header.num_vertices*3*sizeof(double) + (std::size_t) header.num_cells*sizeof(ADFBinaryCell);
+  if (header.num_cells == 0 || file.size() != EXPECTED)
+    throw std::runtime_error(std::string("ADF::load_from_binary_file() - truncated or corrupt file ") + filename);
+
+  // read the vertices
+  const char* p = file.begin() + sizeof(ADFBinaryHeader);
+  std::vector<Vector3ConstPtr> vertices(header.num_vertices);
+  for (unsigned i=0; i< header.num_vertices; i++, p += 3*sizeof(double))
+  {
+    double v[3];
+    std::memcpy(v, p, sizeof(v));
+    vertices[i] = Vector3ConstPtr(new Vector3(v[0], v[1], v[2]));
+  }
+
+  // read the cells; parents always precede their children
+  const char* cell_data = p;
+  std::vector<shared_ptr<ADF> > cells(header.num_cells);
+  std::vector<Vector3ConstPtr> cell_verts(BOX_VERTICES);
+  for (unsigned i=0; i< header.num_cells; i++)
+  {
+    ADFBinaryCell cell;
+    std::memcpy(&cell, cell_data + i*sizeof(ADFBinaryCell), sizeof(ADFBinaryCell));
+
+    // the root is created here; all other cells are created by their parents
+    if (i == 0)
+    {
+      for (unsigned j=0; j< BOX_VERTICES; j++)
+      {
+        if (cell.vertices[j] >= header.num_vertices)
+          throw std::runtime_error(std::string("ADF::load_from_binary_file() - invalid vertex index in ") + filename);
+        cell_verts[j] = vertices[cell.vertices[j]];
+      }
+      cells[i] = shared_ptr<ADF>(new ADF(shared_ptr<ADF>(), cell_verts));
+    }
+    else if (!cells[i])
+      throw std::runtime_error(std::string("ADF::load_from_binary_file() - cell without parent in ") + filename);
+
+    // set the distances
+    cells[i]->_distances = std::vector<Real>(cell.distances, cell.distances+BOX_VERTICES);
+
+    // if this is a leaf, there is nothing more to do
+    if (cell.first_child == 0)
+      continue;
+
+    // create the children
+    if (cell.first_child <= i || cell.first_child > header.num_cells - OCT_CHILDREN)
+      throw std::runtime_error(std::string("ADF::load_from_binary_file() - invalid child index in ") + filename);
+    cells[i]->_children = std::vector<shared_ptr<ADF> >(OCT_CHILDREN);
+    for (unsigned j=0; j< OCT_CHILDREN; j++)
+    {
+      const unsigned cidx = cell.first_child + j;
+      ADFBinaryCell child;
+      std::memcpy(&child, cell_data + cidx*sizeof(ADFBinaryCell), sizeof(ADFBinaryCell));
+      for (unsigned k=0; k< BOX_VERTICES; k++)
+      {
+        if (child.vertices[k] >= header.num_vertices)
+          throw std::runtime_error(std::string("ADF::load_from_binary_file() - invalid vertex index in ") + filename);
+        cell_verts[k] = vertices[child.vertices[k]];
+      }
+      if (cells[cidx])
+        throw std::runtime_error(std::string("ADF::load_from_binary_file() - cell with multiple parents in ") + filename);
+      cells[cidx] = shared_ptr<ADF>(new ADF(cells[i], cell_verts));
+      cells[i]->_children[j] = cells[cidx];
+    }
+  }
+
+  FILE_LOG(LOG_ADF) << header.num_cells << " cells read" << std::endl;
+
+  return cells.front();
+}
+
 /// Sets the distances of all vertices of this cell
 void ADF::set_distances(Real (*dfn)(const Vector3&, void*), void* data)
 {
@@ -0,0 +1,385 @@
+/****************************************************************************
+ * Copyright 2011 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+#include <stdexcept>
+#include <boost/type_traits/has_trivial_constructor.hpp>
+#include <boost/type_traits/has_trivial_destructor.hpp>
+#if defined(_OPENMP) || defined(THREADSAFE)
+#include <pthread.h>
+#endif
+#include <Moby/ArrayAllocator.h>
+
+using namespace Moby;
+using boost::shared_ptr;
+using boost::shared_array;
+
+// every block is preceded by a header holding its size class (and, while it
+// sits on a free list, the next block); the header keeps payloads aligned
+// to 16 bytes
+static const std::size_t HEADER_BYTES = 16;
+
+// payload size of the smallest size class (in bytes); class k holds blocks
+// of MIN_BLOCK_BYTES*2^k bytes
+static const std::size_t MIN_BLOCK_BYTES = 32;
+
+// number of size classes (the largest holds 2MB blocks)
+static const unsigned NUM_CLASSES = 17;
+
+// pseudo size class for blocks that bypass the free lists
+static const unsigned LARGE_BLOCK = NUM_CLASSES;
+
+// the number of bytes that each free list may retain (at least
+// MIN_CACHED_BLOCKS blocks are retained, subject to THREAD_CACHE_BYTES)
+static const std::size_t CLASS_CACHE_BYTES = 1 << 22;
+static const unsigned MIN_CACHED_BLOCKS = 4;
+
+// the number of bytes that all of a thread's free lists may retain; this
+// bounds the memory held (but not in use) by the pool at 32MB per thread
+static const std::size_t THREAD_CACHE_BYTES = 1 << 25;
+
+// the number of times that the heap has been accessed
+static unsigned long _num_allocations = 0;
+
+/// Block header
+struct BlockHeader
+{
+  unsigned size_class;
+  BlockHeader* next;
+};
+
+/// The free lists belonging to a single thread
+struct ThreadCache
+{
+  ThreadCache()
+  {
+    bytes = 0;
+    for (unsigned i=0; i< NUM_CLASSES; i++)
+    {
+      free_lists[i] = NULL;
+      counts[i] = 0;
+    }
+  }
+
+  BlockHeader* free_lists[NUM_CLASSES];
+  unsigned counts[NUM_CLASSES];
+  std::size_t bytes;
+};
+
+/// Destroys the first n elements of an array (if Real has a nontrivial destructor)
+static void destroy_elements(Real* x, unsigned n)
+{
+  if (!boost::has_trivial_destructor<Real>::value)
+    for (unsigned i=0; i< n; i++)
+      x[i].~Real();
+}
+
+/// Deleter that returns an array to the allocator that created it
+class ArrayDeleter
+{
+  public:
+    ArrayDeleter(shared_ptr<ArrayAllocator> allocator, unsigned n) : _allocator(allocator), _n(n) { }
+    void operator()(Real* x) { destroy_elements(x, _n); _allocator->deallocate(x, _n); }
+
+  private:
+    shared_ptr<ArrayAllocator> _allocator;
+    unsigned _n;
+};
+
+/// Standard allocator that draws from the pool; used for shared_array control blocks
+template <class T>
+class PoolStdAllocator
+{
+  public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+    template <class U> struct rebind { typedef PoolStdAllocator<U> other; };
+
+    PoolStdAllocator() { }
+    template <class U> PoolStdAllocator(const PoolStdAllocator<U>&) { }
+    pointer address(reference x) const { return &x; }
+    const_pointer address(const_reference x) const { return &x; }
+    pointer allocate(size_type n, const void* = 0) { return (pointer) PoolArrayAllocator::allocate_bytes(n*sizeof(T)); }
+    void deallocate(pointer x, size_type) { PoolArrayAllocator::deallocate_bytes(x); }
+    size_type max_size() const { return ((size_type) -1)/sizeof(T); }
+    void construct(pointer x, const T& v) { new ((void*) x) T(v); }
+    void destroy(pointer x) { x->~T(); }
+    template <class U> bool operator==(const PoolStdAllocator<U>&) const { return true; }
+    template <class U> bool operator!=(const PoolStdAllocator<U>&) const { return false; }
+};
+
+/// Gets the size class for a block of the given size
+static unsigned get_size_class(std::size_t bytes)
+{
+  std::size_t sz = MIN_BLOCK_BYTES;
+  for (unsigned k=0; k< NUM_CLASSES; k++, sz <<= 1)
+    if (bytes <= sz)
+      return k;
+
+  return LARGE_BLOCK;
+}
+
+/// Gets the payload size of blocks in the given size class
+static std::size_t get_class_bytes(unsigned k)
+{
+  return MIN_BLOCK_BYTES << k;
+}
+
+/// Gets the maximum number of blocks that a free list may retain
+static unsigned get_max_cached(unsigned k)
+{
+  return std::max((std::size_t) MIN_CACHED_BLOCKS, CLASS_CACHE_BYTES/get_class_bytes(k));
+}
+
+#if defined(_OPENMP) || defined(THREADSAFE)
+static pthread_key_t _cache_key;
+static pthread_once_t _cache_key_once = PTHREAD_ONCE_INIT;
+
+/// Returns all memory held by a thread's cache to the heap (called on thread exit)
+static void destroy_cache(void* data)
+{
+  ThreadCache* cache = (ThreadCache*) data;
+  for (unsigned k=0; k< NUM_CLASSES; k++)
+    while (cache->free_lists[k])
+    {
+      BlockHeader* h = cache->free_lists[k];
+      cache->free_lists[k] = h->next;
+      std::free(h);
+    }
+  delete cache;
+}
+
+/// Creates the thread-specific key for the caches
+static void create_cache_key()
+{
+  pthread_key_create(&_cache_key, &destroy_cache);
+}
+#endif
+
+/// Gets the calling thread's cache
+/**
+ * Caches are thread-specific in OpenMP and THREADSAFE builds; other builds
+ * share a single cache and so must not allocate from multiple threads.
+ * \note caches are never destroyed (except on exit of threads other than the
+ *       main thread), so arrays with static storage duration may safely be
+ *       released after this translation unit's statics are destroyed
+ */
+static ThreadCache& get_cache()
+{
+  #if defined(_OPENMP) || defined(THREADSAFE)
+  pthread_once(&_cache_key_once, &create_cache_key);
+  ThreadCache* cache = (ThreadCache*) pthread_getspecific(_cache_key);
+  if (!cache)
+  {
+    cache = new ThreadCache;
+    pthread_setspecific(_cache_key, cache);
+  }
+  return *cache;
+  #else
+  static ThreadCache* cache = new ThreadCache;
+  return *cache;
+  #endif
+}
+
+/// Gets the default allocator (constructed on first use, never destroyed)
+static shared_ptr<ArrayAllocator>& default_allocator()
+{
+  static shared_ptr<ArrayAllocator>* allocator = new shared_ptr<ArrayAllocator>(new PoolArrayAllocator);
+  return *allocator;
+}
+
+/// Creates an array of n Real values using the default allocator
+/**
+ * The elements are default constructed if Real is not trivially
+ * constructible (they are left uninitialized otherwise, as with new Real[n]).
+ * \return an empty array if n is zero
+ */
+shared_array<Real> ArrayAllocator::create(unsigned n)
+{
+  if (n == 0)
+    return shared_array<Real>();
+
+  shared_ptr<ArrayAllocator> allocator = default_allocator();
+  Real* x = allocator->allocate(n);
+
+  // construct the elements, if necessary
+  if (!boost::has_trivial_constructor<Real>::value)
+  {
+    unsigned i = 0;
+    try
+    {
+      for (; i< n; i++)
+        new ((void*) (x+i)) Real;
+    }
+    catch (...)
+    {
+      destroy_elements(x, i);
+      allocator->deallocate(x, n);
+      throw;
+    }
+  }
+
+  return shared_array<Real>(x, ArrayDeleter(allocator, n), PoolStdAllocator<Real>());
+}
+
+/// Sets the allocator used by create()
+/**
+ * \note this should not be called while other threads may be allocating
+ */
+void ArrayAllocator::set_default(shared_ptr<ArrayAllocator> allocator)
+{
+  if (!allocator)
+    throw std::runtime_error("ArrayAllocator::set_default() - allocator is NULL!");
+  default_allocator() = allocator;
+}
+
+/// Gets the allocator used by create()
+shared_ptr<ArrayAllocator> ArrayAllocator::get_default()
+{
+  return default_allocator();
+}
+
+/// Gets the number of heap allocations made by allocators (and control blocks) since the last reset
+/**
+ * Allocations satisfied from a free list are not counted, so the count does
+ * not change over an allocation-free step.
+ */
+unsigned long ArrayAllocator::get_num_allocations()
+{
+  return _num_allocations;
+}
+
+/// Resets the heap allocation counter
+void ArrayAllocator::reset_num_allocations()
+{
+  _num_allocations = 0;
+}
+
+/// Allocates memory from the heap and counts the allocation
+/**
+ * \throw std::bad_alloc if the memory could not be allocated
+ */
+void* ArrayAllocator::heap_allocate(std::size_t bytes)
+{
+  void* x = std::malloc(bytes);
+  if (!x)
+    throw std::bad_alloc();
+
+  #if defined(_OPENMP)
+  #pragma omp atomic
+  _num_allocations++;
+  #elif defined(THREADSAFE)
+  __sync_fetch_and_add(&_num_allocations, 1);
+  #else
+  _num_allocations++;
+  #endif
+
+  return x;
+}
+
+/// Returns memory obtained from heap_allocate() to the heap
+void ArrayAllocator::heap_deallocate(void* x)
+{
+  std::free(x);
+}
+
+/// Allocates uninitialized storage for n Real values
+Real* PoolArrayAllocator::allocate(unsigned n)
+{
+  return (Real*) allocate_bytes(sizeof(Real)*n);
+}
+
+/// Returns an array of n Real values to the calling thread's free lists
+void PoolArrayAllocator::deallocate(Real* x, unsigned)
+{
+  deallocate_bytes(x);
+}
+
+/// Allocates a block of the given size from the calling thread's free lists
+void* PoolArrayAllocator::allocate_bytes(std::size_t bytes)
+{
+  // blocks too large for the free lists come straight from the heap
+  const unsigned K = get_size_class(bytes);
+  if (K == LARGE_BLOCK)
+  {
+    BlockHeader* h = (BlockHeader*) heap_allocate(HEADER_BYTES + bytes);
+    h->size_class = LARGE_BLOCK;
+    return (char*) h + HEADER_BYTES;
+  }
+
+  // reuse a block if possible
+  ThreadCache& cache = get_cache();
+  BlockHeader* h = cache.free_lists[K];
+  if (h)
+  {
+    cache.free_lists[K] = h->next;
+    cache.counts[K]--;
+    cache.bytes -= get_class_bytes(K);
+  }
+  else
+  {
+    h = (BlockHeader*) heap_allocate(HEADER_BYTES + get_class_bytes(K));
+    h->size_class = K;
+  }
+
+  return (char*) h + HEADER_BYTES;
+}
+
+/// Returns a block obtained from allocate_bytes()
+/**
+ * Blocks go to the calling thread's free lists (or the heap, if the free list
+ * or the thread's cache is full).
+ */
+void PoolArrayAllocator::deallocate_bytes(void* x)
+{
+  if (!x)
+    return;
+
+  BlockHeader* h = (BlockHeader*) ((char*) x - HEADER_BYTES);
+  const unsigned K = h->size_class;
+  if (K == LARGE_BLOCK)
+  {
+    heap_deallocate(h);
+    return;
+  }
+
+  ThreadCache& cache = get_cache();
+  const std::size_t BYTES = get_class_bytes(K);
+  if (cache.counts[K] >= get_max_cached(K) || cache.bytes + BYTES > THREAD_CACHE_BYTES)
+  {
+    heap_deallocate(h);
+    return;
+  }
+  h->next = cache.free_lists[K];
+  cache.free_lists[K] = h;
+  cache.counts[K]++;
+  cache.bytes += BYTES;
+}
+
+/// Returns all blocks on the calling thread's free lists to the heap
+void PoolArrayAllocator::release_free_lists()
+{
+  ThreadCache& cache = get_cache();
+  for (unsigned k=0; k< NUM_CLASSES; k++)
+  {
+    while (cache.free_lists[k])
+    {
+      BlockHeader* h = cache.free_lists[k];
+      cache.free_lists[k] = h->next;
+      heap_deallocate(h);
+    }
+    cache.counts[k] = 0;
+  }
+  cache.bytes = 0;
+}
+
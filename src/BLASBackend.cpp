@@ -0,0 +1,149 @@
+/****************************************************************************
+ * Copyright 2011 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#include <dlfcn.h>
+#include <cstdlib>
+#include <iostream>
+#include <Moby/cblas.h>
+#include "clapack.h"
+#include <Moby/Constants.h>
+#include <Moby/Log.h>
+#include <Moby/BLASBackend.h>
+
+using namespace Moby;
+
+// the table is initialized statically, so it is valid during the dynamic
+// initialization of other translation units
+BLASBackend::Routines BLASBackend::_routines = {
+  &cblas_dgemm, &cblas_sgemm, &cblas_dgemv, &cblas_sgemv,
+  &cblas_dtrsm, &cblas_strsm, &dpotrf_, &spotrf_, &dpotrs_, &spotrs_,
+  &dgetrf_, &sgetrf_, &dgetrs_, &sgetrs_, &dgesvd_, &sgesvd_,
+  &dgesdd_, &sgesdd_, &dsyevd_, &ssyevd_, NULL };
+
+/// The routines of the libraries that Moby was linked against
+static const BLASBackend::Routines LINKED_ROUTINES = BLASBackend::routines();
+
+/// The handle of the loaded library (NULL if the linked routines are in use)
+static void* _handle = NULL;
+
+/// The name of the loaded library
+static std::string _name = "linked";
+
+/// Rebinds a routine to a symbol in a library, if the library exports it
+/**
+ * \return 1 if the symbol was found, 0 otherwise
+ */
+template <class F>
+static unsigned bind(void* handle, const char* symbol, F& routine)
+{
+  void* f = dlsym(handle, symbol);
+  if (!f)
+    return 0;
+  routine = (F) f;
+  return 1;
+}
+
+/// Loads the library named by MOBY_BLAS_LIBRARY (if any) when Moby is loaded
+class EnvironmentLoader
+{
+  public:
+    EnvironmentLoader()
+    {
+      const char* library = std::getenv("MOBY_BLAS_LIBRARY");
+      if (library && *library)
+        BLASBackend::load(library);
+    }
+};
+
+static EnvironmentLoader _environment_loader;
+
+/// Rebinds the table to the routines exported by the given shared library
+/**
+ * \param library the file name or path of a BLAS / LAPACK shared library
+ *        (e.g., "libopenblas.so.0" or "libmkl_rt.so")
+ * \return <b>true</b> if the library was loaded and exports at least one of
+ *         the dispatched routines; otherwise, the table is left unchanged
+ */
+bool BLASBackend::load(const std::string& library)
+{
+  void* handle = dlopen(library.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (!handle)
+  {
+    std::cerr << "BLASBackend::load() - cannot load library: " << dlerror() << std::endl;
+    return false;
+  }
+
+  // bind whatever routines the library exports; the rest remain linked
+  Routines r = LINKED_ROUTINES;
+  unsigned found = 0;
+  found += bind(handle, "cblas_dgemm", r.dgemm);
+  found += bind(handle, "cblas_sgemm", r.sgemm);
+  found += bind(handle, "cblas_dgemv", r.dgemv);
+  found += bind(handle, "cblas_sgemv", r.sgemv);
+  found += bind(handle, "cblas_dtrsm", r.dtrsm);
+  found += bind(handle, "cblas_strsm", r.strsm);
+  found += bind(handle, "dpotrf_", r.dpotrf);
+  found += bind(handle, "spotrf_", r.spotrf);
+  found += bind(handle, "dpotrs_", r.dpotrs);
+  found += bind(handle, "spotrs_", r.spotrs);
+  found += bind(handle, "dgetrf_", r.dgetrf);
+  found += bind(handle, "sgetrf_", r.sgetrf);
+  found += bind(handle, "dgetrs_", r.dgetrs);
+  found += bind(handle, "sgetrs_", r.sgetrs);
+  found += bind(handle, "dgesvd_", r.dgesvd);
+  found += bind(handle, "sgesvd_", r.sgesvd);
+  found += bind(handle, "dgesdd_", r.dgesdd);
+  found += bind(handle, "sgesdd_", r.sgesdd);
+  found += bind(handle, "dsyevd_", r.dsyevd);
+  found += bind(handle, "ssyevd_", r.ssyevd);
+  if (found == 0)
+  {
+    std::cerr << "BLASBackend::load() - no BLAS / LAPACK routines found in " << library << std::endl;
+    dlclose(handle);
+    return false;
+  }
+
+  // thread count control is vendor specific
+  if (!bind(handle, "openblas_set_num_threads", r.set_num_threads))
+    bind(handle, "MKL_Set_Num_Threads", r.set_num_threads);
+
+  FILE_LOG(LOG_LINALG) << "BLASBackend::load() - using " << found << " routines from " << library << std::endl;
+
+  // switch to the new table and release any previously loaded library
+  _routines = r;
+  if (_handle)
+    dlclose(_handle);
+  _handle = handle;
+  _name = library;
+  return true;
+}
+
+/// Restores the routines of the libraries that Moby was linked against
+void BLASBackend::reset()
+{
+  _routines = LINKED_ROUTINES;
+  if (_handle)
+    dlclose(_handle);
+  _handle = NULL;
+  _name = "linked";
+}
+
+/// Gets the name of the loaded library ("linked" if none is loaded)
+const std::string& BLASBackend::get_name()
+{
+  return _name;
+}
+
+/// Sets the number of threads used by the loaded library
+/**
+ * \note this has no effect unless the loaded library is OpenBLAS or MKL
+ */
+void BLASBackend::set_num_threads(int n)
+{
+  if (_routines.set_num_threads)
+    _routines.set_num_threads(n);
+}
+
@@ -0,0 +1,114 @@
+/****************************************************************************
+ * Copyright 2011 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#include <cmath>
+#include <Moby/Constants.h>
+#include <Moby/Log.h>
+#include <Moby/LinAlg.h>
+#include <Moby/MissizeException.h>
+#include <Moby/NonsquareMatrixException.h>
+#include <Moby/BasisLU.h>
+
+using namespace Moby;
+
+/// The maximum number of column replacements between refactorizations
+static const unsigned MAX_UPDATES = 50;
+
+/// Sets the basis matrix
+/**
+ * The factorization is computed on the next call to solve().
+ */
+void BasisLU::set_basis(const MatrixN& B)
+{
+  if (B.rows() != B.columns())
+    throw NonsquareMatrixException();
+
+  _B.copy_from(B);
+  _neta = 0;
+  _factored = false;
+}
+
+/// Refactors the basis matrix
+/**
+ * \return <b>false</b> if the basis matrix is singular
+ */
+bool BasisLU::factor()
+{
+  _neta = 0;
+  _LU.copy_from(_B);
+  _factored = LinAlg::factor_LU(_LU, _ipiv);
+  if (!_factored)
+    FILE_LOG(LOG_LINALG) << "BasisLU::factor() - basis is singular" << std::endl;
+  return _factored;
+}
+
+/// Solves B*x = b
+/**
+ * The basis is refactored first if necessary.
+ * \param xb the right hand side on input, the solution x on return (xb is
+ *        unchanged if the basis is singular)
+ * \return <b>false</b> if the basis matrix is singular
+ */
+bool BasisLU::solve(VectorN& xb)
+{
+  if (xb.size() != _B.rows())
+    throw MissizeException();
+  if (!_factored && !factor())
+    return false;
+
+  // solve using the factorization of the old basis
+  LinAlg::solve_LU_fast(_LU, false, _ipiv, xb);
+
+  // apply the inverses of the eta matrices in order
+  const unsigned n = xb.size();
+  for (unsigned k=0; k< _neta; k++)
+  {
+    const unsigned i = _eta_idx[k];
+    const Real* eta = _eta[k].begin();
+    const Real xi = xb[i]/eta[i];
+    for (unsigned j=0; j< n; j++)
+      xb[j] -= eta[j]*xi;
+    xb[i] = xi;
+  }
+
+  return true;
+}
+
+/// Replaces a column of the basis matrix
+/**
+ * \param i the index of the column to replace
+ * \param a the new column
+ * \param d inv(B)*a for the basis B before the replacement, as computed by
+ *        solve(); if the basis is not factored, d is not used
+ */
+void BasisLU::replace_column(unsigned i, const VectorN& a, const VectorN& d)
+{
+  _B.set_column(i, a);
+  if (!_factored)
+    return;
+
+  // refactor (on the next solve) if there have been too many updates or if
+  // the new basis would be nearly singular with respect to the old one
+  if (_neta == MAX_UPDATES || !(std::fabs(d[i]) > NEAR_ZERO*d.norm_inf()))
+  {
+    _factored = false;
+    return;
+  }
+
+  // store the eta vector
+  if (_eta.size() == _neta)
+  {
+    _eta.push_back(d);
+    _eta_idx.push_back(i);
+  }
+  else
+  {
+    _eta[_neta].copy_from(d);
+    _eta_idx[_neta] = i;
+  }
+  _neta++;
+}
+
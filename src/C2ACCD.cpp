@@ -12,6 +12,7 @@
 #include <queue>
 #include <boost/tuple/tuple.hpp>
 #include <boost/tuple/tuple_comparison.hpp>
+#include <boost/unordered_map.hpp>
 #include <Moby/CompGeom.h>
 #include <Moby/CollisionDetection.h>
 #include <Moby/LinAlg.h>
@@ -48,6 +49,7 @@ using std::priority_queue;
 using std::pair;
 using std::make_pair;
 using std::stack;
+using boost::unordered_map;
 
 /// For Alistair's priority queue modification
 struct SSRPair
@@ -84,6 +86,7 @@ C2ACCD::C2ACCD()
   eps_tolerance = 1e-5;
   alpha_tolerance = 1e-2;
   pthread_mutex_init(&_contact_mutex, NULL);
+  pthread_mutex_init(&_ca_fronts_mutex, NULL);
   return_all_contacts = true;
 }
 
@@ -91,6 +94,7 @@ void C2ACCD::add_collision_geometry(CollisionGeometryPtr cg)
 {
   CollisionDetection::add_collision_geometry(cg);
   build_BV_tree(cg);
+  remove_CA_fronts(cg);
 }
 
 void C2ACCD::add_rigid_body(RigidBodyPtr rb)
@@ -106,11 +110,25 @@ void C2ACCD::add_articulated_body(ArticulatedBodyPtr abody, bool disable_adjacen
 void C2ACCD::remove_collision_geometry(CollisionGeometryPtr cg)
 {
   CollisionDetection::remove_collision_geometry(cg);
+  remove_CA_fronts(cg);
 }
 
 void C2ACCD::remove_all_collision_geometries()
 {
   CollisionDetection::remove_all_collision_geometries();
+  _ca_fronts.clear();
+}
+
+/// Removes the cached conservative advancement fronts of all pairs that include the given geometry
+void C2ACCD::remove_CA_fronts(CollisionGeometryPtr cg)
+{
+  for (map<pair<CollisionGeometryPtr, CollisionGeometryPtr>, vector<CAFeatures> >::iterator i = _ca_fronts.begin(); i != _ca_fronts.end(); )
+  {
+    if (i->first.first == cg || i->first.second == cg)
+      _ca_fronts.erase(i++);
+    else
+      i++;
+  }
 }
 
 void C2ACCD::remove_rigid_body(RigidBodyPtr rb)
@@ -129,42 +147,69 @@ void C2ACCD::remove_articulated_body(ArticulatedBodyPtr abody)
  */
 bool C2ACCD::is_contact(Real dt, const vector<pair<DynamicBodyPtr, VectorN> >& q0, const vector<pair<DynamicBodyPtr, VectorN> >& q1,vector<Event>& contacts)
 {
-  typedef pair<CollisionGeometryPtr, BVPtr> CG_BV;
-
   // clear the vector of contacts 
   contacts.clear();
 
   FILE_LOG(LOG_COLDET) << "C2ACCD::is_contact() entered" << endl;
 
-  // setup the set of collision geometries encountered
-  vector<CollisionGeometryPtr> encountered;
+  // map each body to the index of its states
+  unordered_map<DynamicBodyPtr, unsigned> body_index;
+  for (unsigned i=0; i< q0.size(); i++)
+  {
+    assert(q0[i].first == q1[i].first);
+    body_index[q0[i].first] = i;
+  }
 
-  // check the geometries
-  for (set<CollisionGeometryPtr>::const_iterator i = _geoms.begin(); i != _geoms.end(); i++)
-    for (set<CollisionGeometryPtr>::const_iterator j = i; j != _geoms.end(); j++)
-    {
-      if (i == j)
-        continue;
+  // do broad phase
+  vector<pair<CollisionGeometryPtr, CollisionGeometryPtr> > to_check;
+  broad_phase(q0, q1, to_check);
 
-      // get the two geometries
-      CollisionGeometryPtr a = *i;
-      CollisionGeometryPtr b = *j;
+  // get the indices of the states of the bodies of each pair
+  vector<pair<unsigned, unsigned> > body_pairs(to_check.size());
+  for (unsigned i=0; i< to_check.size(); i++)
+  {
+    // get the two geometries
+    CollisionGeometryPtr a = to_check[i].first;
+    CollisionGeometryPtr b = to_check[i].second;
+
+    // verify that the two bodies are rigid
+    if (!dynamic_pointer_cast<RigidBody>(a->get_single_body()) || !dynamic_pointer_cast<RigidBody>(b->get_single_body()))
+      throw std::runtime_error("One or more bodies is not rigid; C2ACCD only works with rigid bodies");
+
+    // find the states
+    unordered_map<DynamicBodyPtr, unsigned>::const_iterator ia = body_index.find(get_super_body(a));
+    unordered_map<DynamicBodyPtr, unsigned>::const_iterator ib = body_index.find(get_super_body(b));
+    assert(ia != body_index.end() && ib != body_index.end());
+    body_pairs[i] = make_pair(ia->second, ib->second);
+  }
 
-      // verify that the pair should be checked
-      if (!is_checked(a, b))
-        continue;
+  // checking a pair changes the states of its bodies, so only pairs that 
+  // share no bodies may be checked at the same time
+  vector<vector<unsigned> > batches;
+  schedule_pairs(body_pairs, batches);
+  FILE_LOG(LOG_COLDET) << " -- checking " << to_check.size() << " pairs in " << batches.size() << " batches" << endl;
 
-      // get the two rigid bodies
-      RigidBodyPtr rba = dynamic_pointer_cast<RigidBody>(a->get_single_body());
-      RigidBodyPtr rbb = dynamic_pointer_cast<RigidBody>(b->get_single_body());
+  // check the geometries
+  vector<vector<Event> > events(to_check.size());
+  for (unsigned i=0; i< batches.size(); i++)
+  {
+    const vector<unsigned>& batch = batches[i];
 
-      // verify that the two bodies are rigid
-      if (!rba || !rbb)
-        throw std::runtime_error("One or more bodies is not rigid; C2ACCD only works with rigid bodies");
+    #pragma omp parallel for
+    for (int j=0; j< (int) batch.size(); j++)
+    {
+      const unsigned k = batch[j];
+      const unsigned ia = body_pairs[k].first;
+      const unsigned ib = body_pairs[k].second;
 
       // test the geometries for contact
-      check_geoms(dt, a, b, q0, q1, contacts);
-    } 
+      check_geoms(dt, to_check[k].first, to_check[k].second, q0[ia].second, q1[ia].second, q0[ib].second, q1[ib].second, events[k]);
+    }
+  }
+
+  // integrate all contacts into a single structure 
+  for (unsigned i=0; i< events.size(); i++)
+    contacts.insert(contacts.end(), events[i].begin(), events[i].end());
 
   FILE_LOG(LOG_COLDET) << "contacts:" << endl;
   if (contacts.empty())
@@ -182,6 +227,44 @@ bool C2ACCD::is_contact(Real dt, const vector<pair<DynamicBodyPtr, VectorN> >& q
   return !contacts.empty();
 }
 
+/// Determines the pairs of geometries whose swept bounds overlap over the step
+/**
+ * \post body states are at q1 
+ */
+void C2ACCD::broad_phase(const vector<pair<DynamicBodyPtr, VectorN> >& q0, const vector<pair<DynamicBodyPtr, VectorN> >& q1, vector<pair<CollisionGeometryPtr, CollisionGeometryPtr> >& to_check)
+{
+  FILE_LOG(LOG_COLDET) << "C2ACCD::broad_phase() entered" << std::endl;
+
+  // clear the vector of pairs to check
+  to_check.clear();
+
+  // get the enabled geometries and their root SSRs
+  vector<CollisionGeometryPtr> geoms;
+  vector<BVPtr> roots;
+  for (set<CollisionGeometryPtr>::const_iterator i = _geoms.begin(); i != _geoms.end(); i++)
+  {
+    if (!is_enabled(*i))
+      continue;
+    assert(_root_SSRs.find(*i) != _root_SSRs.end());
+    geoms.push_back(*i);
+    roots.push_back(_root_SSRs.find(*i)->second);
+  }
+
+  // compute the bounds swept over the step and find the overlapping pairs
+  vector<pair<Vector3, Vector3> > bounds;
+  vector<pair<CollisionGeometryPtr, CollisionGeometryPtr> > overlaps;
+  calc_swept_AABBs(q0, q1, geoms, roots, bounds);
+  _sweep_and_prune.find_overlaps(geoms, bounds, overlaps);
+
+  // setup pairs to check
+  for (unsigned i=0; i< overlaps.size(); i++)
+    if (is_checked(overlaps[i].first, overlaps[i].second))
+      to_check.push_back(overlaps[i]);
+
+  FILE_LOG(LOG_COLDET) << " -- " << to_check.size() << " of " << overlaps.size() << " overlapping pairs to be checked" << std::endl;
+  FILE_LOG(LOG_COLDET) << "C2ACCD::broad_phase() exited" << std::endl;
+}
+
 /// Gets the "super" body for a collision geometry
 DynamicBodyPtr C2ACCD::get_super_body(CollisionGeometryPtr geom)
 {
@@ -194,24 +277,18 @@ DynamicBodyPtr C2ACCD::get_super_body(CollisionGeometryPtr geom)
     return rb;
 }
 
-/// Finds the index of the body / state pair for the given body
-unsigned C2ACCD::find_body(const vector<pair<DynamicBodyPtr, VectorN> >& q, DynamicBodyPtr body)
-{
-  for (unsigned i=0; i< q.size(); i++)
-    if (q[i].first == body)
-      return i;
-
-  return std::numeric_limits<unsigned>::max();
-}
-
 /// Does a collision check for a pair of geometries 
 /**
  * \param dt the time interval
  * \param a the first geometry
  * \param b the second geometry
+ * \param qa0 the states of a's (super) body at the beginning of the interval
+ * \param qa1 the states of a's (super) body at the end of the interval
+ * \param qb0 the states of b's (super) body at the beginning of the interval
+ * \param qb1 the states of b's (super) body at the end of the interval
  * \param contacts on return
  */
-void C2ACCD::check_geoms(Real dt, CollisionGeometryPtr a, CollisionGeometryPtr b, const vector<pair<DynamicBodyPtr, VectorN> >& q0, const vector<pair<DynamicBodyPtr, VectorN> >& q1, vector<Event>& contacts)
+void C2ACCD::check_geoms(Real dt, CollisionGeometryPtr a, CollisionGeometryPtr b, const VectorN& qa0, const VectorN& qa1, const VectorN& qb0, const VectorN& qb1, vector<Event>& contacts)
 {
   VectorN q, qtmp;
 
@@ -220,25 +297,13 @@ void C2ACCD::check_geoms(Real dt, CollisionGeometryPtr a, CollisionGeometryPtr b
   FILE_LOG(LOG_COLDET) << "  against geometry " << b->id << " for body " << b->get_single_body()->id << std::endl;
 
   // get the SSR's for a and b
-  shared_ptr<SSR> ssr_a = _root_SSRs[a];
-  shared_ptr<SSR> ssr_b = _root_SSRs[b];
+  shared_ptr<SSR> ssr_a = _root_SSRs.find(a)->second;
+  shared_ptr<SSR> ssr_b = _root_SSRs.find(b)->second;
 
   // get bodies for a and b
   DynamicBodyPtr ba = get_super_body(a);
   DynamicBodyPtr bb = get_super_body(b);
 
-  // get the states for bodies a and b
-  const unsigned idx_a = find_body(q0, ba);
-  const unsigned idx_b = find_body(q0, bb);
-  assert(idx_a == find_body(q1, ba));
-  assert(idx_b == find_body(q1, bb));
-  assert(idx_a != std::numeric_limits<unsigned>::max());
-  assert(idx_b != std::numeric_limits<unsigned>::max());
-  const VectorN& qa0 = q0[idx_a].second;
-  const VectorN& qa1 = q1[idx_a].second;
-  const VectorN& qb0 = q0[idx_b].second;
-  const VectorN& qb1 = q1[idx_b].second;
-
   // set bodies to states qa0 and qb0
   ba->set_generalized_coordinates(DynamicBody::eRodrigues, qa0);
   bb->set_generalized_coordinates(DynamicBody::eRodrigues, qb0);
@@ -919,11 +984,56 @@ Real C2ACCD::do_CAStep(Real dist, const Vector3& dab, CollisionGeometryPtr a, Co
 }
 
 /// CA algorithm (no "control")
+/**
+ * The SSR leaf pairs that determine the step (the front of the BV test 
+ * tree) are cached for each pair of geometries along with their closest 
+ * triangles.  The step computed from the cached triangles bounds the step 
+ * from above, so it is used to initialize the step for the next query, 
+ * which prunes most of the traversal when the geometries move coherently.
+ */
 Real C2ACCD::do_CA(Real step_size, CollisionGeometryPtr a, CollisionGeometryPtr b, shared_ptr<SSR> ssr_a, shared_ptr<SSR> ssr_b, const Matrix4& aTb, Real dt)
 {
   const Real TTOL = alpha_tolerance / step_size;
   FILE_LOG(LOG_COLDET) << "C2ACCD::do_CA() entered" << endl;
 
+  // get the front from the last query on this pair
+  const pair<CollisionGeometryPtr, CollisionGeometryPtr> key(a, b);
+  vector<CAFeatures> front;
+  #ifdef _OPENMP
+  pthread_mutex_lock(&_ca_fronts_mutex);
+  #endif
+  map<pair<CollisionGeometryPtr, CollisionGeometryPtr>, vector<CAFeatures> >::const_iterator fiter = _ca_fronts.find(key);
+  if (fiter != _ca_fronts.end())
+    front = fiter->second;
+  #ifdef _OPENMP
+  pthread_mutex_unlock(&_ca_fronts_mutex);
+  #endif
+
+  // use the cached closest triangles to bound the step
+  for (unsigned i=0; i< front.size(); i++)
+  {
+    const CAFeatures& f = front[i];
+    if (_meshes.find(f.ssr_a) == _meshes.end() || _meshes.find(f.ssr_b) == _meshes.end())
+      continue;
+    Triangle ta = _meshes.find(f.ssr_a)->second.first->get_triangle(f.tri_a);
+    Triangle tb = Triangle::transform(_meshes.find(f.ssr_b)->second.first->get_triangle(f.tri_b), aTb);
+    Vector3 cpa, cpb;
+    Real dist = std::sqrt(Triangle::calc_sq_dist(ta, tb, cpa, cpb));
+    cpa = a->get_transform().mult_point(cpa);
+    cpb = a->get_transform().mult_point(cpb);
+    FILE_LOG(LOG_COLDET) << " -- cached triangle pair distance: " << dist << endl;
+
+    // triangles in contact: the step is zero 
+    if ((cpa - cpb).norm() <= NEAR_ZERO)
+      return 0.0;
+
+    dt = std::min(dt, do_CAStep(dist, cpb - cpa, a, b, f.ssr_a, f.ssr_b));
+  }
+  FILE_LOG(LOG_COLDET) << " -- initial bound from " << front.size() << " cached leaf pairs: " << dt << endl;
+
+  // setup the new front
+  vector<pair<Real, CAFeatures> > leafs;
+
   // place the two SSR's onto a priority queue
   priority_queue<SSRPair> Q;
   Q.push(SSRPair(ssr_a, ssr_b));
@@ -940,7 +1050,10 @@ Real C2ACCD::do_CA(Real step_size, CollisionGeometryPtr a, CollisionGeometryPtr
       // compute the distance between the triangles in the SSRs and get closest
       // points in global frame
       Vector3 cpa, cpb;
-      Real dist = calc_dist(ssrs.first, ssrs.second, aTb, cpa, cpb);
+      CAFeatures f;
+      f.ssr_a = ssrs.first;
+      f.ssr_b = ssrs.second;
+      Real dist = calc_dist(ssrs.first, ssrs.second, aTb, cpa, cpb, f.tri_a, f.tri_b);
       cpa = a->get_transform().mult_point(cpa);
       cpb = a->get_transform().mult_point(cpb);
       FILE_LOG(LOG_COLDET) << " -- SSR leafs detected, distance: " << dist << " closest points: " << cpa << " and " << cpb << endl;
@@ -951,9 +1064,15 @@ Real C2ACCD::do_CA(Real step_size, CollisionGeometryPtr a, CollisionGeometryPtr
         Real dtstar = do_CAStep(dist, cpb - cpa, a, b, ssrs.first, ssrs.second);
         if (dtstar < dt)
           dt = dtstar;
+        leafs.push_back(make_pair(dtstar, f));
       }
       else
-        return 0.0; 
+      {
+        leafs.clear();
+        leafs.push_back(make_pair((Real) 0.0, f));
+        dt = (Real) 0.0;
+        break;
+      }
 
       continue;
     }
@@ -1071,6 +1190,23 @@ Real C2ACCD::do_CA(Real step_size, CollisionGeometryPtr a, CollisionGeometryPtr
     }
   } 
 
+  // cache the leaf pairs that determine the step; if no leaf pair was 
+  // reached, the bound came from the old front, which is kept
+  if (!leafs.empty())
+  {
+    front.clear();
+    for (unsigned i=0; i< leafs.size(); i++)
+      if (leafs[i].first <= dt + TTOL)
+        front.push_back(leafs[i].second);
+    #ifdef _OPENMP
+    pthread_mutex_lock(&_ca_fronts_mutex);
+    #endif
+    _ca_fronts[key] = front;
+    #ifdef _OPENMP
+    pthread_mutex_unlock(&_ca_fronts_mutex);
+    #endif
+  }
+
   FILE_LOG(LOG_COLDET) << "C2ACCD::do_CA() exiting" << endl;
   return dt;
 }
@@ -1101,8 +1237,8 @@ Real C2ACCD::do_C2A(CollisionGeometryPtr a, CollisionGeometryPtr b, shared_ptr<S
     // get triangles in ssr_a and ssr_b
     assert(_meshes.find(ssr_a) != _meshes.end());
     assert(_meshes.find(ssr_b) != _meshes.end());
-    pair<shared_ptr<const IndexedTriArray>, list<unsigned> >& mesh_a = _meshes[ssr_a];
-    pair<shared_ptr<const IndexedTriArray>, list<unsigned> >& mesh_b = _meshes[ssr_b];
+    const pair<shared_ptr<const IndexedTriArray>, list<unsigned> >& mesh_a = _meshes.find(ssr_a)->second;
+    const pair<shared_ptr<const IndexedTriArray>, list<unsigned> >& mesh_b = _meshes.find(ssr_b)->second;
     assert(!mesh_a.second.empty());
     assert(!mesh_b.second.empty());
 
@@ -1308,7 +1444,11 @@ Real C2ACCD::do_C2A(CollisionGeometryPtr a, CollisionGeometryPtr b, shared_ptr<S
 */
 
 /// Calculates the smallest distance between triangles in two SSR leaf nodes
-Real C2ACCD::calc_dist(shared_ptr<SSR> a, shared_ptr<SSR> b, const Matrix4& aTb, Vector3& cpa, Vector3& cpb) const
+/**
+ * \param tri_a the index of the closest triangle in a, on return
+ * \param tri_b the index of the closest triangle in b, on return
+ */
+Real C2ACCD::calc_dist(shared_ptr<SSR> a, shared_ptr<SSR> b, const Matrix4& aTb, Vector3& cpa, Vector3& cpb, unsigned& tri_a, unsigned& tri_b) const
 {
   FILE_LOG(LOG_COLDET) << "C2ACCD::calc_dist() entered" << endl;
   FILE_LOG(LOG_COLDET) << "  aTb: " << endl << aTb;
@@ -1337,6 +1477,8 @@ Real C2ACCD::calc_dist(shared_ptr<SSR> a, shared_ptr<SSR> b, const Matrix4& aTb,
         min_dist = dist;
         cpa = cpa_cand;
         cpb = cpb_cand;
+        tri_a = ta_idx;
+        tri_b = tb_idx;
       }
     }
   }
@@ -1404,55 +1546,32 @@ void C2ACCD::save_to_xml(XMLTreePtr node, list<BaseConstPtr>& shared_objects) co
  */
 bool C2ACCD::is_collision(Real epsilon)
 {
-  // clear the set of colliding pairs and list of colliding triangles
-  colliding_pairs.clear();
-  colliding_tris.clear();
-
-  // iterate over geometries 
-  for (std::set<CollisionGeometryPtr>::const_iterator i = _geoms.begin(); i != _geoms.end(); i++)
-  {
-    // get the first geometry and its primitive 
-    CollisionGeometryPtr g1 = *i;
-
-    // get the transform and the inverse transform for this geometry
-    const Matrix4& wTg1 = g1->get_transform();
-    Matrix4 g1Tw = Matrix4::inverse_transform(wTg1);
-
-    // loop through all other geometries
-    std::set<CollisionGeometryPtr>::const_iterator j = i;
-    j++;
-    for (; j != _geoms.end(); j++)
-    {
-      // get the second geometry and its primitive 
-      CollisionGeometryPtr g2 = *j;
-
-      // see whether to check
-      if (!is_checked(g1, g2))
-        continue; 
+  return check_pairs(&C2ACCD::check_pair, this);
+}
 
-      // get the two BV trees
-      BVPtr bv1 = _root_SSRs[g1];
-      BVPtr bv2 = _root_SSRs[g2];
+/// Checks a single pair of geometries for intersection (called by CollisionDetection::check_pairs())
+bool C2ACCD::check_pair(void* data, CollisionGeometryPtr g1, CollisionGeometryPtr g2, const Matrix4& g1Tg2, list<CollidingTriPair>& tris)
+{
+  C2ACCD* ccd = (C2ACCD*) data;
 
-      // get the transform for g2 and its inverse
-      const Matrix4& wTg2 = g2->get_transform(); 
+  // get the two BV trees
+  BVPtr bv1 = ccd->_root_SSRs.find(g1)->second;
+  BVPtr bv2 = ccd->_root_SSRs.find(g2)->second;
 
-      // if intersects, add to colliding pairs
-      if (intersect_BV_trees(bv1, bv2, g1Tw * wTg2, g1, g2))
-        colliding_pairs.insert(make_sorted_pair(g1, g2));
-    } 
-  }
-
-  return !colliding_pairs.empty();
+  // check for intersection
+  return ccd->intersect_BV_trees(bv1, bv2, g1Tg2, g1, g2, tris);
 }
 
 /// Intersects two BV trees; returns <b>true</b> if one (or more) pair of the underlying triangles intersects
-bool C2ACCD::intersect_BV_trees(BVPtr a, BVPtr b, const Matrix4& aTb, CollisionGeometryPtr geom_a, CollisionGeometryPtr geom_b) 
+/**
+ * Intersecting pairs of triangles are appended to tris.
+ */
+bool C2ACCD::intersect_BV_trees(BVPtr a, BVPtr b, const Matrix4& aTb, CollisionGeometryPtr geom_a, CollisionGeometryPtr geom_b, list<CollidingTriPair>& tris) 
 {
   std::queue<tuple<BVPtr, BVPtr, bool> > q;
 
   // get address of the last colliding triangle pair on the queue
-  CollidingTriPair* last = (colliding_tris.empty()) ? NULL : &colliding_tris.back();
+  CollidingTriPair* last = (tris.empty()) ? NULL : &tris.back();
 
   FILE_LOG(LOG_COLDET) << "C2ACCD::intersect_BV_trees() entered" << endl;
 
@@ -1483,12 +1602,12 @@ bool C2ACCD::intersect_BV_trees(BVPtr a, BVPtr b, const Matrix4& aTb, CollisionG
     if (bv1->is_leaf() && bv2->is_leaf())
     {
       if (!rev)
-        intersect_BV_leafs(bv1, bv2, aTb, geom_a, geom_b, std::back_inserter(colliding_tris));
+        intersect_BV_leafs(bv1, bv2, aTb, geom_a, geom_b, std::back_inserter(tris));
       else
-        intersect_BV_leafs(bv2, bv1, aTb, geom_a, geom_b, std::back_inserter(colliding_tris));
+        intersect_BV_leafs(bv2, bv1, aTb, geom_a, geom_b, std::back_inserter(tris));
 
       // see whether we want to exit early
-      if (mode == eFirstContact && !colliding_tris.empty() && last != &colliding_tris.back())
+      if (mode == eFirstContact && !tris.empty() && last != &tris.back())
         return true;
     }
 
@@ -1509,7 +1628,7 @@ bool C2ACCD::intersect_BV_trees(BVPtr a, BVPtr b, const Matrix4& aTb, CollisionG
   }
 
   // see whether we have an intersection
-  if (!colliding_tris.empty() && last != &colliding_tris.back())
+  if (!tris.empty() && last != &tris.back())
     return true;
 
   FILE_LOG(LOG_COLDET) << "  -- all intersection checks passed; no intersection" << endl;
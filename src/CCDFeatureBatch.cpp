@@ -0,0 +1,452 @@
+/****************************************************************************
+ * Copyright 2011 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#if defined(__AVX2__) && defined(BUILD_DOUBLE)
+#include <immintrin.h>
+#endif
+#include <Moby/Constants.h>
+#include <Moby/CCDFeatureBatch.h>
+
+using namespace Moby;
+using std::vector;
+
+/// Removes all features from the batch
+void CCDFeatureBatch::clear()
+{
+  _type.clear();
+  _ee.clear();
+  for (unsigned k=0; k< 4; k++)
+    for (unsigned j=0; j< 3; j++)
+    {
+      _x[k][j].clear();
+      _xdot[k][j].clear();
+    }
+}
+
+/// Reserves space for n features
+void CCDFeatureBatch::reserve(unsigned n)
+{
+  _type.reserve(n);
+  _ee.reserve(n);
+  for (unsigned k=0; k< 4; k++)
+    for (unsigned j=0; j< 3; j++)
+    {
+      _x[k][j].reserve(n);
+      _xdot[k][j].reserve(n);
+    }
+}
+
+/// Adds a vertex moving against a triangle with independently moving vertices
+/**
+ * \param p the position of the vertex at the start of the interval
+ * \param pdot the velocity of the vertex
+ * \param t the triangle at the start of the interval
+ * \param adot the velocity of vertex a of the triangle
+ * \param bdot the velocity of vertex b of the triangle
+ * \param cdot the velocity of vertex c of the triangle
+ */
+void CCDFeatureBatch::add_vertex_face(const Vector3& p, const Vector3& pdot, const Triangle& t, const Vector3& adot, const Vector3& bdot, const Vector3& cdot)
+{
+  const Vector3 x[4] = { p, t.a, t.b, t.c };
+  const Vector3 xdot[4] = { pdot, adot, bdot, cdot };
+  add(eVertexFace, x, xdot);
+}
+
+/// Adds an edge (p0, p1) moving against an edge (q0, q1)
+/**
+ * Endpoints are given at the start of the interval along with their
+ * velocities.
+ */
+void CCDFeatureBatch::add_edge_edge(const Vector3& p0, const Vector3& p0dot, const Vector3& p1, const Vector3& p1dot, const Vector3& q0, const Vector3& q0dot, const Vector3& q1, const Vector3& q1dot)
+{
+  const Vector3 x[4] = { p0, p1, q0, q1 };
+  const Vector3 xdot[4] = { p0dot, p1dot, q0dot, q1dot };
+  add(eEdgeEdge, x, xdot);
+}
+
+/// Adds a feature of four points to the batch
+void CCDFeatureBatch::add(FeatureType type, const Vector3* x, const Vector3* xdot)
+{
+  _type.push_back(type);
+  _ee.push_back((type == eEdgeEdge) ? (Real) 1.0 : (Real) 0.0);
+  for (unsigned k=0; k< 4; k++)
+    for (unsigned j=0; j< 3; j++)
+    {
+      _x[k][j].push_back(x[k][j]);
+      _xdot[k][j].push_back(xdot[k][j]);
+    }
+}
+
+/// Gets point k of feature i at time t
+Vector3 CCDFeatureBatch::get_point(unsigned k, unsigned i, Real t) const
+{
+  return Vector3(_x[k][0][i] + _xdot[k][0][i]*t, _x[k][1][i] + _xdot[k][1][i]*t, _x[k][2][i] + _xdot[k][2][i]*t);
+}
+
+/// Computes the first time of contact of every feature in the batch
+/**
+ * \param dt the length of the interval
+ * \param toi the time of contact of each feature in [0, dt] on return, or
+ *        std::numeric_limits<Real>::max() if the feature does not touch
+ *        over the interval
+ */
+void CCDFeatureBatch::calc_first_isects(Real dt, vector<Real>& toi) const
+{
+  const unsigned N = size();
+  toi.resize(N);
+  if (N == 0)
+    return;
+
+  #if defined(__AVX2__) && defined(BUILD_DOUBLE)
+  // do groups of four features with AVX2 and the remainder with scalars
+  const unsigned NVEC = N - N % 4;
+  calc_first_isects_AVX2(0, NVEC, dt, &toi.front());
+  calc_first_isects_scalar(NVEC, N, dt, &toi.front());
+  #else
+  calc_first_isects_scalar(0, N, dt, &toi.front());
+  #endif
+}
+
+/// Computes the point and normal of contact of feature i at time t
+/**
+ * \param i the index of the feature
+ * \param t the time of contact (from calc_first_isects())
+ * \param point the point of contact on return
+ * \param normal the unit normal on return, directed against the motion of
+ *        the vertex (or first edge) relative to the triangle (or second edge)
+ */
+void CCDFeatureBatch::calc_contact(unsigned i, Real t, Vector3& point, Vector3& normal) const
+{
+  Vector3 x[4], xdot[4];
+  for (unsigned k=0; k< 4; k++)
+  {
+    x[k] = get_point(k, i, t);
+    xdot[k] = Vector3(_xdot[k][0][i], _xdot[k][1][i], _xdot[k][2][i]);
+  }
+
+  // get the point of contact and the relative velocity there
+  Vector3 rvel;
+  if (_type[i] == eVertexFace)
+  {
+    // compute barycentric coordinates of the vertex in the triangle
+    Vector3 v0 = x[2] - x[1], v1 = x[3] - x[1], v2 = x[0] - x[1];
+    Real d00 = v0.dot(v0), d01 = v0.dot(v1), d11 = v1.dot(v1);
+    Real d20 = v2.dot(v0), d21 = v2.dot(v1);
+    Real denom = d00*d11 - d01*d01;
+    Real s = (denom > (Real) 0.0) ? (d11*d20 - d01*d21)/denom : (Real) 0.0;
+    Real u = (denom > (Real) 0.0) ? (d00*d21 - d01*d20)/denom : (Real) 0.0;
+
+    point = x[0];
+    normal = Vector3::cross(v0, v1);
+    rvel = xdot[0] - (xdot[1]*((Real) 1.0 - s - u) + xdot[2]*s + xdot[3]*u);
+  }
+  else
+  {
+    // compute the crossing parameters of the two edges
+    Vector3 d1 = x[1] - x[0], d2 = x[3] - x[2], r = x[2] - x[0];
+    normal = Vector3::cross(d1, d2);
+    Real nn = normal.norm_sq();
+    Real s = (nn > (Real) 0.0) ? Vector3::cross(r, d2).dot(normal)/nn : (Real) 0.0;
+    Real u = (nn > (Real) 0.0) ? Vector3::cross(r, d1).dot(normal)/nn : (Real) 0.0;
+
+    point = x[0] + d1*s;
+    rvel = (xdot[0] + (xdot[1] - xdot[0])*s) - (xdot[2] + (xdot[3] - xdot[2])*u);
+  }
+
+  // normalize the normal and direct it against the relative motion
+  Real nrm = normal.norm();
+  if (nrm > (Real) 0.0)
+    normal /= nrm;
+  if (rvel.dot(normal) > (Real) 0.0)
+    normal = -normal;
+}
+
+/// Computes the first times of contact of features [begin, end) one at a time
+void CCDFeatureBatch::calc_first_isects_scalar(unsigned begin, unsigned end, Real dt, Real* toi) const
+{
+  const Real INF = std::numeric_limits<Real>::max();
+  const Real TOL = NEAR_ZERO;
+
+  for (unsigned i=begin; i< end; i++)
+  {
+    // get the points relative to the first point
+    Vector3 e[3], ed[3];
+    for (unsigned k=0; k< 3; k++)
+      for (unsigned j=0; j< 3; j++)
+      {
+        e[k][j] = _x[k+1][j][i] - _x[0][j][i];
+        ed[k][j] = _xdot[k+1][j][i] - _xdot[0][j][i];
+      }
+
+    // compute the coefficients of the coplanarity cubic,
+    // det(e1 + t*ed1, e2 + t*ed2, e3 + t*ed3)
+    Vector3 e23 = Vector3::cross(e[1], e[2]);
+    Vector3 ed23 = Vector3::cross(ed[1], ed[2]);
+    Vector3 ed2e3 = Vector3::cross(ed[1], e[2]);
+    Vector3 e2ed3 = Vector3::cross(e[1], ed[2]);
+    const Real c0 = e[0].dot(e23);
+    const Real c1 = ed[0].dot(e23) + e[0].dot(ed2e3) + e[0].dot(e2ed3);
+    const Real c2 = ed[0].dot(ed2e3) + ed[0].dot(e2ed3) + e[0].dot(ed23);
+    const Real c3 = ed[0].dot(ed23);
+
+    // find the critical points of the cubic within (0, dt); the cubic is
+    // monotone between consecutive critical points
+    Real s1 = dt, s2 = dt;
+    const Real disc = c2*c2 - (Real) 3.0*c1*c3;
+    if (disc >= (Real) 0.0)
+    {
+      Real sq = std::sqrt(disc);
+      Real q = -(c2 + ((c2 < (Real) 0.0) ? -sq : sq));
+      Real r1 = q/((Real) 3.0*c3);
+      Real r2 = c1/q;
+      s1 = (r1 > (Real) 0.0 && r1 < dt) ? r1 : dt;
+      s2 = (r2 > (Real) 0.0 && r2 < dt) ? r2 : dt;
+      if (s2 < s1)
+        std::swap(s1, s2);
+    }
+    const Real lo_bounds[3] = { (Real) 0.0, s1, s2 };
+    const Real hi_bounds[3] = { s1, s2, dt };
+
+    // look for a root in each interval, from earliest to latest
+    toi[i] = INF;
+    for (unsigned m=0; m< 3 && toi[i] == INF; m++)
+    {
+      Real lo = lo_bounds[m], hi = hi_bounds[m];
+      Real flo = c0 + lo*(c1 + lo*(c2 + lo*c3));
+      Real fhi = c0 + hi*(c1 + hi*(c2 + hi*c3));
+      if (flo*fhi > (Real) 0.0)
+        continue;
+
+      // bisect to the root
+      for (unsigned b=0; b< NBISECTIONS; b++)
+      {
+        Real mid = (lo + hi)*(Real) 0.5;
+        Real fmid = c0 + mid*(c1 + mid*(c2 + mid*c3));
+        if (fmid*flo > (Real) 0.0)
+        {
+          lo = mid;
+          flo = fmid;
+        }
+        else
+          hi = mid;
+      }
+      const Real t = (lo + hi)*(Real) 0.5;
+
+      // get the points at the root
+      Vector3 x0 = get_point(0, i, t), x1 = get_point(1, i, t);
+      Vector3 x2 = get_point(2, i, t), x3 = get_point(3, i, t);
+
+      // see whether the vertex is inside the triangle, or the edges cross,
+      // using unnormalized barycentric coordinates / edge parameters
+      Real s, u, denom;
+      if (_type[i] == eVertexFace)
+      {
+        Vector3 v0 = x2 - x1, v1 = x3 - x1, v2 = x0 - x1;
+        Real d00 = v0.dot(v0), d01 = v0.dot(v1), d11 = v1.dot(v1);
+        Real d20 = v2.dot(v0), d21 = v2.dot(v1);
+        denom = d00*d11 - d01*d01;
+        s = d11*d20 - d01*d21;
+        u = d00*d21 - d01*d20;
+        if (denom > (Real) 0.0 && s >= -TOL*denom && u >= -TOL*denom && s + u <= ((Real) 1.0 + TOL)*denom)
+          toi[i] = t;
+      }
+      else
+      {
+        Vector3 d1 = x1 - x0, d2 = x3 - x2, r = x2 - x0;
+        Vector3 n = Vector3::cross(d1, d2);
+        denom = n.norm_sq();
+        s = Vector3::cross(r, d2).dot(n);
+        u = Vector3::cross(r, d1).dot(n);
+        if (denom > TOL*d1.norm_sq()*d2.norm_sq() && s >= -TOL*denom && s <= ((Real) 1.0 + TOL)*denom && u >= -TOL*denom && u <= ((Real) 1.0 + TOL)*denom)
+          toi[i] = t;
+      }
+    }
+  }
+}
+
+#if defined(__AVX2__) && defined(BUILD_DOUBLE)
+namespace {
+
+// cross product of vectors in structure-of-arrays form
+inline void cross(const __m256d a[3], const __m256d b[3], __m256d c[3])
+{
+  c[0] = _mm256_sub_pd(_mm256_mul_pd(a[1], b[2]), _mm256_mul_pd(a[2], b[1]));
+  c[1] = _mm256_sub_pd(_mm256_mul_pd(a[2], b[0]), _mm256_mul_pd(a[0], b[2]));
+  c[2] = _mm256_sub_pd(_mm256_mul_pd(a[0], b[1]), _mm256_mul_pd(a[1], b[0]));
+}
+
+// dot product of vectors in structure-of-arrays form
+inline __m256d dot(const __m256d a[3], const __m256d b[3])
+{
+  return _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(a[0], b[0]), _mm256_mul_pd(a[1], b[1])), _mm256_mul_pd(a[2], b[2]));
+}
+
+// evaluates c0 + t*(c1 + t*(c2 + t*c3))
+inline __m256d eval_cubic(__m256d c0, __m256d c1, __m256d c2, __m256d c3, __m256d t)
+{
+  __m256d f = _mm256_add_pd(c2, _mm256_mul_pd(t, c3));
+  f = _mm256_add_pd(c1, _mm256_mul_pd(t, f));
+  return _mm256_add_pd(c0, _mm256_mul_pd(t, f));
+}
+
+// clamps values outside of (0, dt) (and NaNs) to dt
+inline __m256d clip_critical(__m256d r, __m256d dt)
+{
+  __m256d in = _mm256_and_pd(_mm256_cmp_pd(r, _mm256_setzero_pd(), _CMP_GT_OQ), _mm256_cmp_pd(r, dt, _CMP_LT_OQ));
+  return _mm256_blendv_pd(dt, r, in);
+}
+
+} // end namespace
+
+/// Computes the first times of contact of features [begin, end) four at a time
+/**
+ * Mirrors calc_first_isects_scalar(); branches are replaced with masks.
+ */
+void CCDFeatureBatch::calc_first_isects_AVX2(unsigned begin, unsigned end, Real dt, Real* toi) const
+{
+  assert((end - begin) % 4 == 0);
+  const __m256d ZERO = _mm256_setzero_pd();
+  const __m256d HALF = _mm256_set1_pd(0.5);
+  const __m256d THREE = _mm256_set1_pd(3.0);
+  const __m256d TOL = _mm256_set1_pd(NEAR_ZERO);
+  const __m256d ONE_TOL = _mm256_set1_pd(1.0 + NEAR_ZERO);
+  const __m256d INF = _mm256_set1_pd(std::numeric_limits<Real>::max());
+  const __m256d SIGN = _mm256_set1_pd(-0.0);
+  const __m256d DT = _mm256_set1_pd(dt);
+
+  for (unsigned i=begin; i< end; i+= 4)
+  {
+    // load the points and velocities
+    __m256d x[4][3], xdot[4][3];
+    for (unsigned k=0; k< 4; k++)
+      for (unsigned j=0; j< 3; j++)
+      {
+        x[k][j] = _mm256_loadu_pd(&_x[k][j][i]);
+        xdot[k][j] = _mm256_loadu_pd(&_xdot[k][j][i]);
+      }
+    const __m256d ee = _mm256_cmp_pd(_mm256_loadu_pd(&_ee[i]), ZERO, _CMP_NEQ_OQ);
+
+    // get the points relative to the first point
+    __m256d e[3][3], ed[3][3];
+    for (unsigned k=0; k< 3; k++)
+      for (unsigned j=0; j< 3; j++)
+      {
+        e[k][j] = _mm256_sub_pd(x[k+1][j], x[0][j]);
+        ed[k][j] = _mm256_sub_pd(xdot[k+1][j], xdot[0][j]);
+      }
+
+    // compute the coefficients of the coplanarity cubic
+    __m256d e23[3], ed23[3], ed2e3[3], e2ed3[3];
+    cross(e[1], e[2], e23);
+    cross(ed[1], ed[2], ed23);
+    cross(ed[1], e[2], ed2e3);
+    cross(e[1], ed[2], e2ed3);
+    const __m256d c0 = dot(e[0], e23);
+    const __m256d c1 = _mm256_add_pd(_mm256_add_pd(dot(ed[0], e23), dot(e[0], ed2e3)), dot(e[0], e2ed3));
+    const __m256d c2 = _mm256_add_pd(_mm256_add_pd(dot(ed[0], ed2e3), dot(ed[0], e2ed3)), dot(e[0], ed23));
+    const __m256d c3 = dot(ed[0], ed23);
+
+    // find the critical points of the cubic within (0, dt)
+    __m256d disc = _mm256_sub_pd(_mm256_mul_pd(c2, c2), _mm256_mul_pd(THREE, _mm256_mul_pd(c1, c3)));
+    __m256d has_crit = _mm256_cmp_pd(disc, ZERO, _CMP_GE_OQ);
+    __m256d sq = _mm256_sqrt_pd(_mm256_max_pd(disc, ZERO));
+    sq = _mm256_or_pd(sq, _mm256_and_pd(c2, SIGN));
+    __m256d q = _mm256_xor_pd(_mm256_add_pd(c2, sq), SIGN);
+    __m256d r1 = clip_critical(_mm256_div_pd(q, _mm256_mul_pd(THREE, c3)), DT);
+    __m256d r2 = clip_critical(_mm256_div_pd(c1, q), DT);
+    r1 = _mm256_blendv_pd(DT, r1, has_crit);
+    r2 = _mm256_blendv_pd(DT, r2, has_crit);
+    const __m256d s1 = _mm256_min_pd(r1, r2);
+    const __m256d s2 = _mm256_max_pd(r1, r2);
+    const __m256d lo_bounds[3] = { ZERO, s1, s2 };
+    const __m256d hi_bounds[3] = { s1, s2, DT };
+
+    // look for a root in each interval, from earliest to latest
+    __m256d result = INF;
+    for (unsigned m=0; m< 3; m++)
+    {
+      // lanes that have already found a contact are done
+      __m256d active = _mm256_cmp_pd(result, INF, _CMP_EQ_OQ);
+      __m256d lo = lo_bounds[m], hi = hi_bounds[m];
+      __m256d flo = eval_cubic(c0, c1, c2, c3, lo);
+      __m256d fhi = eval_cubic(c0, c1, c2, c3, hi);
+      active = _mm256_and_pd(active, _mm256_cmp_pd(_mm256_mul_pd(flo, fhi), ZERO, _CMP_LE_OQ));
+      if (_mm256_movemask_pd(active) == 0)
+        continue;
+
+      // bisect to the root
+      for (unsigned b=0; b< NBISECTIONS; b++)
+      {
+        __m256d mid = _mm256_mul_pd(_mm256_add_pd(lo, hi), HALF);
+        __m256d fmid = eval_cubic(c0, c1, c2, c3, mid);
+        __m256d right = _mm256_cmp_pd(_mm256_mul_pd(fmid, flo), ZERO, _CMP_GT_OQ);
+        lo = _mm256_blendv_pd(lo, mid, right);
+        flo = _mm256_blendv_pd(flo, fmid, right);
+        hi = _mm256_blendv_pd(mid, hi, right);
+      }
+      const __m256d t = _mm256_mul_pd(_mm256_add_pd(lo, hi), HALF);
+
+      // get the points at the root
+      __m256d p[4][3];
+      for (unsigned k=0; k< 4; k++)
+        for (unsigned j=0; j< 3; j++)
+          p[k][j] = _mm256_add_pd(x[k][j], _mm256_mul_pd(xdot[k][j], t));
+
+      // vertex / face: unnormalized barycentric coordinates
+      __m256d v0[3], v1[3], v2[3];
+      for (unsigned j=0; j< 3; j++)
+      {
+        v0[j] = _mm256_sub_pd(p[2][j], p[1][j]);
+        v1[j] = _mm256_sub_pd(p[3][j], p[1][j]);
+        v2[j] = _mm256_sub_pd(p[0][j], p[1][j]);
+      }
+      __m256d d00 = dot(v0, v0), d01 = dot(v0, v1), d11 = dot(v1, v1);
+      __m256d d20 = dot(v2, v0), d21 = dot(v2, v1);
+      __m256d vf_denom = _mm256_sub_pd(_mm256_mul_pd(d00, d11), _mm256_mul_pd(d01, d01));
+      __m256d vf_s = _mm256_sub_pd(_mm256_mul_pd(d11, d20), _mm256_mul_pd(d01, d21));
+      __m256d vf_u = _mm256_sub_pd(_mm256_mul_pd(d00, d21), _mm256_mul_pd(d01, d20));
+      __m256d neg_tol = _mm256_xor_pd(_mm256_mul_pd(TOL, vf_denom), SIGN);
+      __m256d vf_inside = _mm256_cmp_pd(vf_denom, ZERO, _CMP_GT_OQ);
+      vf_inside = _mm256_and_pd(vf_inside, _mm256_cmp_pd(vf_s, neg_tol, _CMP_GE_OQ));
+      vf_inside = _mm256_and_pd(vf_inside, _mm256_cmp_pd(vf_u, neg_tol, _CMP_GE_OQ));
+      vf_inside = _mm256_and_pd(vf_inside, _mm256_cmp_pd(_mm256_add_pd(vf_s, vf_u), _mm256_mul_pd(ONE_TOL, vf_denom), _CMP_LE_OQ));
+
+      // edge / edge: unnormalized crossing parameters
+      __m256d d1[3], d2[3], r[3], n[3], rd1[3], rd2[3];
+      for (unsigned j=0; j< 3; j++)
+      {
+        d1[j] = _mm256_sub_pd(p[1][j], p[0][j]);
+        d2[j] = _mm256_sub_pd(p[3][j], p[2][j]);
+        r[j] = _mm256_sub_pd(p[2][j], p[0][j]);
+      }
+      cross(d1, d2, n);
+      cross(r, d2, rd2);
+      cross(r, d1, rd1);
+      __m256d ee_denom = dot(n, n);
+      __m256d ee_s = dot(rd2, n);
+      __m256d ee_u = dot(rd1, n);
+      __m256d ee_lo = _mm256_xor_pd(_mm256_mul_pd(TOL, ee_denom), SIGN);
+      __m256d ee_hi = _mm256_mul_pd(ONE_TOL, ee_denom);
+      __m256d ee_inside = _mm256_cmp_pd(ee_denom, _mm256_mul_pd(TOL, _mm256_mul_pd(dot(d1, d1), dot(d2, d2))), _CMP_GT_OQ);
+      ee_inside = _mm256_and_pd(ee_inside, _mm256_cmp_pd(ee_s, ee_lo, _CMP_GE_OQ));
+      ee_inside = _mm256_and_pd(ee_inside, _mm256_cmp_pd(ee_s, ee_hi, _CMP_LE_OQ));
+      ee_inside = _mm256_and_pd(ee_inside, _mm256_cmp_pd(ee_u, ee_lo, _CMP_GE_OQ));
+      ee_inside = _mm256_and_pd(ee_inside, _mm256_cmp_pd(ee_u, ee_hi, _CMP_LE_OQ));
+
+      // record the root for active lanes where the features touch
+      __m256d inside = _mm256_blendv_pd(vf_inside, ee_inside, ee);
+      result = _mm256_blendv_pd(result, t, _mm256_and_pd(active, inside));
+    }
+
+    _mm256_storeu_pd(toi + i, result);
+  }
+}
+#endif
+
@@ -719,8 +719,8 @@ void CRBAlgorithm::precalc(RCArticulatedBodyPtr body, ReferenceFrameType rftype)
     // attempt to do a Cholesky factorization of M
     MatrixN& fM = this->_fM;
     MatrixN& M = this->_M;
-    fM.copy_from(M);
-    if (_rank_deficient = !LinAlg::factor_chol(fM))
+    _rank_deficient = !_M_solver.factor(M, MixedSolver::ePositiveDefinite);
+    if (_rank_deficient)
     {
       fM.copy_from(M);
 //    if (_rank_deficient = !factorize_cholesky(fM))
@@ -788,7 +788,7 @@ MatrixN& CRBAlgorithm::M_solve(const MatrixN& m, MatrixN& result)
 /// Solves for acceleration using the body inertia matrix
 VectorN& CRBAlgorithm::M_solve_noprecalc(const VectorN& v, VectorN& result) const
 {
-  // get the factorized inertia matrix
+  // get the pseudo-inverse of the inertia matrix
   const MatrixN& fJ = this->_fM; 
 
   // determine whether the matrix is rank-deficient
@@ -801,7 +801,7 @@ VectorN& CRBAlgorithm::M_solve_noprecalc(const VectorN& v, VectorN& result) cons
   {
     // matrix is not rank deficient, use Cholesky factorization
     result.copy_from(v);
-    LinAlg::solve_chol_fast(fJ, result);
+    _M_solver.solve(result);
   }
 
   return result;
@@ -810,7 +810,7 @@ VectorN& CRBAlgorithm::M_solve_noprecalc(const VectorN& v, VectorN& result) cons
 /// Solves for acceleration using the body inertia matrix
 MatrixN& CRBAlgorithm::M_solve_noprecalc(const MatrixN& m, MatrixN& result) const
 {
-  // get the factorized inertia matrix
+  // get the pseudo-inverse of the inertia matrix
   const MatrixN& fJ = this->_fM; 
 
   // determine whether the matrix is rank-deficient
@@ -823,7 +823,7 @@ MatrixN& CRBAlgorithm::M_solve_noprecalc(const MatrixN& m, MatrixN& result) cons
   {
     // matrix is not rank deficient, use Cholesky factorization
     result.copy_from(m);
-    LinAlg::solve_chol_fast(fJ, result);
+    _M_solver.solve(result);
   }
 
   return result;
@@ -797,23 +797,17 @@ void CSG::load_from_xml(XMLTreeConstPtr node, std::map<std::string, BasePtr>& id
   const XMLAttrib* fname_attrib = node->get_attrib("triangle-mesh-filename");
   if (fname_attrib)
   {
-    // setup the file extensions
-    const char* OBJ_EXT = ".obj";
-
     // get the filename
     string fname(fname_attrib->get_string_value());
 
-    // get the lowercase version of the filename
-    string fname_lower = fname;
-    std::transform(fname_lower.begin(), fname_lower.end(), fname_lower.begin(), (int(*)(int)) std::tolower);
-
     // get the type of file and construct the triangle mesh appropriately
-    if (fname_lower.find(string(OBJ_EXT)) == fname_lower.size() - strlen(OBJ_EXT))
-      set_mesh(shared_ptr<IndexedTriArray>(new IndexedTriArray(IndexedTriArray::read_from_obj(fname))));
+    if (IndexedTriArray::is_mesh_file(fname))
+      set_mesh(shared_ptr<IndexedTriArray>(new IndexedTriArray(IndexedTriArray::read_from_file(fname))));
     else
     {
       cerr << "CSG::load_from_xml() - unrecognized filename extension" << endl;
-      cerr << "  for attribute 'filename'.  Valid extensions are '.obj' (Wavefront OBJ)" << endl;
+      cerr << "  for attribute 'filename'.  Valid extensions are '.obj' (Wavefront OBJ)," << endl;
+      cerr << "  '.stl' (STL), and '.ply' (PLY)" << endl;
     }
   
     // see whether to center the mesh
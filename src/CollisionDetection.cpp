@@ -20,6 +20,7 @@
 #include <Moby/XMLTree.h>
 #include <Moby/XMLTree.h>
 #include <Moby/EventDrivenSimulator.h>
+#include <Moby/BV.h>
 #include <Moby/CollisionDetection.h>
 
 using namespace Moby;
@@ -446,19 +447,68 @@ void CollisionDetection::remove_collision_geometry(CollisionGeometryPtr geom)
 
 /// Calculates distances between all pairs of geometries
 /**
+ * Pairs are distributed across threads; the distances and closest points of
+ * each pair are computed into per-pair buffers and then stored in pair order.
  * \note does not calculate inter-geometry distances (i.e., in case a geometry
  *       is deformable)
  */  
 Real CollisionDetection::calc_distances()
 {
-  Vector3 cp1, cp2;
-
   // clear the mapping of distances first
   distances.clear();
   closest_points.clear();
 
+  // get the pairs to check
+  vector<pair<CollisionGeometryPtr, CollisionGeometryPtr> > pairs;
+  get_checked_pairs(pairs);
+
   // determine distance between each pair of bodies
+  const int NPAIRS = (int) pairs.size();
+  vector<Real> dist(NPAIRS);
+  vector<pair<Vector3, Vector3> > cp(NPAIRS);
+  #pragma omp parallel for
+  for (int k=0; k< NPAIRS; k++)
+  {
+    // get the two geometries
+    CollisionGeometryPtr g1 = pairs[k].first;
+    CollisionGeometryPtr g2 = pairs[k].second;
+
+    // get the inverse transform for g1
+    Matrix4 g1Tw = Matrix4::inverse_transform(g1->get_transform());
+
+    // get the transform for g2
+    const Matrix4& wTg2 = g2->get_transform(); 
+
+    // compute the distance
+    dist[k] = calc_distance(g1, g2, g1Tw * wTg2, cp[k].first, cp[k].second);
+  }
+
+  // save the distances and closest points
   Real min_dist = std::numeric_limits<Real>::max();
+  for (int k=0; k< NPAIRS; k++)
+  {
+    min_dist = std::min(dist[k], min_dist);    
+    distances[make_sorted_pair(pairs[k].first, pairs[k].second)] = dist[k];
+    closest_points[pairs[k]] = cp[k];
+  }
+
+  return min_dist;
+}
+
+/// Gets the pairs of geometries that are checked for collision
+/**
+ * Pairs are returned in the order of the geometries in _geoms.  The bounding
+ * volume hierarchy and mesh of each geometry in a pair are built here, so 
+ * that the pairs may subsequently be checked concurrently (primitives 
+ * construct both lazily).
+ * \param pairs the checked pairs, on return
+ */
+void CollisionDetection::get_checked_pairs(vector<pair<CollisionGeometryPtr, CollisionGeometryPtr> >& pairs)
+{
+  pairs.clear();
+
+  // find the pairs, noting the geometries that are checked
+  std::set<CollisionGeometryPtr> checked;
   for (std::set<CollisionGeometryPtr>::const_iterator i = _geoms.begin(); i != _geoms.end(); i++)
   {
     std::set<CollisionGeometryPtr>::const_iterator j = i; 
@@ -468,29 +518,87 @@ Real CollisionDetection::calc_distances()
       if (!is_checked(*i, *j))
         continue;
 
-      // get the two geometries
-      CollisionGeometryPtr g1 = *i;
-      CollisionGeometryPtr g2 = *j;
+      pairs.push_back(make_pair(*i, *j));
+      checked.insert(*i);
+      checked.insert(*j);
+    }
+  }
 
-      // get the inverse transform for g1
-      Matrix4 g1Tw = Matrix4::inverse_transform(g1->get_transform());
+  // build the hierarchies and meshes
+  BOOST_FOREACH(CollisionGeometryPtr geom, checked)
+  {
+    PrimitivePtr primitive = geom->get_geometry();
+    primitive->get_BVH_root();
+    primitive->get_mesh();
+  }
+}
 
-      // get the transform for g2
-      const Matrix4& wTg2 = g2->get_transform(); 
+/// Checks all pairs of geometries for intersection
+/**
+ * The pairs from get_checked_pairs() are distributed across threads, and the
+ * colliding triangles of each pair are stored in a separate list; the lists
+ * are merged in pair order, so that colliding_tris does not depend on the
+ * number of threads.  Unless all contacts are to be reported, pairs not yet
+ * checked are skipped once a collision has been found.  Implementations of
+ * is_collision() supply the check for a single pair.
+ * \param check the function that checks a single pair
+ * \param data data passed to check (typically the collision detector)
+ * \return <b>true</b> if any pair intersects
+ */
+bool CollisionDetection::check_pairs(PairCheck check, void* data)
+{
+  // clear the set of colliding pairs and list of colliding triangles
+  colliding_pairs.clear();
+  colliding_tris.clear();
+
+  // get the pairs to check
+  vector<pair<CollisionGeometryPtr, CollisionGeometryPtr> > pairs;
+  get_checked_pairs(pairs);
+
+  // check the pairs concurrently
+  const int NPAIRS = (int) pairs.size();
+  vector<list<CollidingTriPair> > tris(NPAIRS);
+  vector<unsigned char> colliding(NPAIRS, 0);
+  bool found = false;
+  #pragma omp parallel for schedule(dynamic)
+  for (int k=0; k< NPAIRS; k++)
+  {
+    // see whether the check can be skipped
+    if (!return_all_contacts)
+    {
+      bool done;
+      #pragma omp atomic read
+      done = found;
+      if (done)
+        continue;
+    }
 
-      // otherwise, compute the distance
-      Real dist = calc_distance(g1, g2, g1Tw * wTg2, cp1, cp2);
-      min_dist = std::min(dist, min_dist);    
+    // get the two geometries
+    CollisionGeometryPtr g1 = pairs[k].first;
+    CollisionGeometryPtr g2 = pairs[k].second;
 
-      // save the distance
-      distances[make_sorted_pair(g1, g2)] = dist;
+    // get the transforms
+    Matrix4 g1Tw = Matrix4::inverse_transform(g1->get_transform());
+    const Matrix4& wTg2 = g2->get_transform(); 
 
-      // set the closest points
-      closest_points[make_pair(g1, g2)] = make_pair(cp1, cp2);
+    // check for intersection
+    if ((*check)(data, g1, g2, g1Tw * wTg2, tris[k]))
+    {
+      colliding[k] = 1;
+      #pragma omp atomic write
+      found = true;
     }
   }
 
-  return min_dist;
+  // gather the colliding pairs and triangles in pair order
+  for (int k=0; k< NPAIRS; k++)
+  {
+    if (colliding[k])
+      colliding_pairs.insert(make_sorted_pair(pairs[k].first, pairs[k].second));
+    colliding_tris.splice(colliding_tris.end(), tris[k]);
+  }
+
+  return !colliding_pairs.empty();
 }
 
 /// Calculates the closest points (and squared distance) between geometries a and b
@@ -550,6 +658,432 @@ Real CollisionDetection::calc_distance(CollisionGeometryPtr a, CollisionGeometry
   return min_dist;
 }
 
+/// Computes the axis-aligned bounds of a geometry at the current state of its body
+/**
+ * \param geom the geometry
+ * \param root the root bounding volume of the geometry; if null, the bounds
+ *        are computed from the vertices of the geometry instead
+ * \param lo the lower corner of the bounds (global frame), on return
+ * \param hi the upper corner of the bounds (global frame), on return
+ */
+void CollisionDetection::calc_AABB(CollisionGeometryPtr geom, BVPtr root, Vector3& lo, Vector3& hi)
+{
+  const Matrix4& T = geom->get_transform();
+
+  // use the bounding volume, if possible
+  if (root)
+  {
+    lo = root->get_lower_bounds(T);
+    hi = root->get_upper_bounds(T);
+    return;
+  }
+
+  // otherwise, bound the vertices of the mesh
+  const vector<Vector3>& verts = geom->get_geometry()->get_mesh()->get_vertices();
+  lo = Vector3(1,1,1) * std::numeric_limits<Real>::max();
+  hi = -lo;
+  for (unsigned i=0; i< verts.size(); i++)
+  {
+    Vector3 v = T.mult_point(verts[i]);
+    for (unsigned k=0; k< 3; k++)
+    {
+      lo[k] = std::min(lo[k], v[k]);
+      hi[k] = std::max(hi[k], v[k]);
+    }
+  }
+}
+
+/// Computes axis-aligned bounds on the space swept by geometries between two sets of body states
+/**
+ * Generalized coordinates are interpolated linearly between q0 and q1, so 
+ * the vertices of deformable bodies move along line segments, while rigid 
+ * bodies translate linearly and rotate along a great circle arc.  The bounds 
+ * of a rigid body at the two endpoints (relative to its center-of-mass) are
+ * therefore expanded by the greatest deviation of that arc from its chord.
+ * \param q0 the states of the bodies at the beginning of the interval
+ * \param q1 the states of the bodies at the end of the interval
+ * \param geoms the geometries to bound
+ * \param roots the root bounding volume of each geometry (see calc_AABB())
+ * \param bounds the lower and upper corners of the swept bounds, on return
+ * \note links of articulated bodies are treated like rigid bodies moving
+ *       between their endpoint states
+ * \post body states are set to q1
+ */
+void CollisionDetection::calc_swept_AABBs(const vector<pair<DynamicBodyPtr, VectorN> >& q0, const vector<pair<DynamicBodyPtr, VectorN> >& q1, const vector<CollisionGeometryPtr>& geoms, const vector<BVPtr>& roots, vector<pair<Vector3, Vector3> >& bounds)
+{
+  const unsigned N = geoms.size();
+  assert(roots.size() == N);
+
+  // compute the bounds and the rigid body poses at both sets of states
+  vector<pair<Vector3, Vector3> > b0(N);
+  vector<Vector3> x0(N), x1(N);
+  vector<Quat> quat0(N), quat1(N);
+  bounds.resize(N);
+  for (unsigned j=0; j< 2; j++)
+  {
+    // set the body states
+    const vector<pair<DynamicBodyPtr, VectorN> >& q = (j == 0) ? q0 : q1;
+    for (unsigned i=0; i< q.size(); i++)
+      q[i].first->set_generalized_coordinates(DynamicBody::eRodrigues, q[i].second);
+
+    // compute the bounds
+    vector<pair<Vector3, Vector3> >& b = (j == 0) ? b0 : bounds;
+    vector<Vector3>& x = (j == 0) ? x0 : x1;
+    vector<Quat>& quat = (j == 0) ? quat0 : quat1;
+    for (unsigned i=0; i< N; i++)
+    {
+      calc_AABB(geoms[i], roots[i], b[i].first, b[i].second);
+      RigidBodyPtr rb = dynamic_pointer_cast<RigidBody>(geoms[i]->get_single_body());
+      if (rb)
+      {
+        x[i] = rb->get_position();
+        quat[i] = rb->get_orientation();
+      }
+    }
+  }
+
+  // combine the bounds
+  for (unsigned i=0; i< N; i++)
+  {
+    Vector3& lo = bounds[i].first;
+    Vector3& hi = bounds[i].second;
+
+    // deformable bodies: bounds at the endpoints contain the swept vertices
+    if (!dynamic_pointer_cast<RigidBody>(geoms[i]->get_single_body()))
+    {
+      for (unsigned k=0; k< 3; k++)
+      {
+        lo[k] = std::min(lo[k], b0[i].first[k]);
+        hi[k] = std::max(hi[k], b0[i].second[k]);
+      }
+      continue;
+    }
+
+    // get the bounds relative to the center-of-mass at both endpoints 
+    Vector3 lo0 = b0[i].first - x0[i], hi0 = b0[i].second - x0[i];
+    Vector3 lo1 = lo - x1[i], hi1 = hi - x1[i];
+
+    // determine the greatest distance of the geometry from the center-of-mass
+    Real r0 = ((lo0 + hi0)*(Real) 0.5).norm() + ((hi0 - lo0)*(Real) 0.5).norm();
+    Real r1 = ((lo1 + hi1)*(Real) 0.5).norm() + ((hi1 - lo1)*(Real) 0.5).norm();
+
+    // the rotation angle (theta) of the interpolated orientation satisfies 
+    // cos(theta/2) = <q0, q1>; points deviate by at most r*(1 - cos(theta/2))
+    // from the chord of their arcs
+    const Quat& qa = quat0[i];
+    const Quat& qb = quat1[i];
+    Real c = qa.x*qb.x + qa.y*qb.y + qa.z*qb.z + qa.w*qb.w;
+    Real dev = std::max(r0, r1) * ((Real) 1.0 - std::max(std::min(c, (Real) 1.0), (Real) -1.0));
+
+    for (unsigned k=0; k< 3; k++)
+    {
+      lo[k] = std::min(x0[i][k], x1[i][k]) + std::min(lo0[k], lo1[k]) - dev;
+      hi[k] = std::max(x0[i][k], x1[i][k]) + std::max(hi0[k], hi1[k]) + dev;
+    }
+  }
+}
+
+/// Groups pairs of bodies into batches in which no body appears twice
+/**
+ * Checking a pair of geometries for contact changes the states of their 
+ * bodies, so only pairs in the same batch may be checked concurrently. 
+ * \param body_pairs the indices of the (super) bodies of each pair
+ * \param batches the indices of the pairs in each batch on return; pairs 
+ *        appear within each batch in the order given
+ */
+void CollisionDetection::schedule_pairs(const vector<pair<unsigned, unsigned> >& body_pairs, vector<vector<unsigned> >& batches)
+{
+  batches.clear();
+
+  // determine the number of bodies
+  unsigned nbodies = 0;
+  for (unsigned i=0; i< body_pairs.size(); i++)
+    nbodies = std::max(nbodies, std::max(body_pairs[i].first, body_pairs[i].second) + 1);
+
+  // put each pair in the first batch following the last batch that uses 
+  // either of its bodies
+  vector<unsigned> next(nbodies, 0);
+  for (unsigned i=0; i< body_pairs.size(); i++)
+  {
+    const unsigned a = body_pairs[i].first, b = body_pairs[i].second;
+    const unsigned k = std::max(next[a], next[b]);
+    if (k == batches.size())
+      batches.push_back(vector<unsigned>());
+    batches[k].push_back(i);
+    next[a] = next[b] = k+1;
+  }
+}
+
+/// Determines whether there is a collision at the current state, re-testing only pairs that may have changed
+/**
+ * Only pairs of geometries whose bounds overlap are tested.  A pair 
+ * found not to be intersecting is not re-tested until the transform between 
+ * its two geometries changes; pairs that include a deformable geometry are
+ * always re-tested.  Geometries are tested using their bounding volume 
+ * hierarchies and triangle / triangle intersection (self-intersection of 
+ * deformable geometries is not tested), so this method is intended for 
+ * validating simulation state rather than for replacing is_collision().
+ * \note the colliding pairs are stored in colliding_pairs
+ * \return <b>true</b> if any pair of geometries intersects
+ */
+bool CollisionDetection::is_collision_incremental()
+{
+  FILE_LOG(LOG_COLDET) << "CollisionDetection::is_collision_incremental() entered" << std::endl;
+
+  // clear the set of colliding pairs
+  colliding_pairs.clear();
+
+  // get the enabled geometries and their bounds; deformable geometries are 
+  // bounded using their vertices
+  vector<CollisionGeometryPtr> geoms;
+  vector<pair<Vector3, Vector3> > bounds;
+  for (std::set<CollisionGeometryPtr>::const_iterator i = _geoms.begin(); i != _geoms.end(); i++)
+  {
+    if (!is_enabled(*i))
+      continue;
+    BVPtr root;
+    if (dynamic_pointer_cast<RigidBody>((*i)->get_single_body()))
+      root = (*i)->get_geometry()->get_BVH_root();
+    geoms.push_back(*i);
+    bounds.push_back(pair<Vector3, Vector3>());
+    calc_AABB(*i, root, bounds.back().first, bounds.back().second);
+  }
+
+  // find the pairs with overlapping bounds
+  vector<pair<CollisionGeometryPtr, CollisionGeometryPtr> > overlaps;
+  _validation_broad_phase.find_overlaps(geoms, bounds, overlaps);
+
+  // test the pairs; the validated pairs are rebuilt so that pairs that no 
+  // longer overlap are dropped
+  std::map<sorted_pair<CollisionGeometryPtr>, Matrix4> validated;
+  unsigned ntested = 0;
+  for (unsigned i=0; i< overlaps.size(); i++)
+  {
+    if (!is_checked(overlaps[i].first, overlaps[i].second))
+      continue;
+
+    // compute the relative transform for the pair
+    sorted_pair<CollisionGeometryPtr> cg_pair = make_sorted_pair(overlaps[i].first, overlaps[i].second);
+    CollisionGeometryPtr a = cg_pair.first, b = cg_pair.second;
+    Matrix4 aTb = Matrix4::inverse_transform(a->get_transform()) * b->get_transform();
+
+    // if the relative transform has not changed since the pair was last
+    // validated, there is no need to test it again
+    bool deformable = !dynamic_pointer_cast<RigidBody>(a->get_single_body()) ||
+                      !dynamic_pointer_cast<RigidBody>(b->get_single_body());
+    if (!deformable)
+    {
+      std::map<sorted_pair<CollisionGeometryPtr>, Matrix4>::const_iterator v = _validated.find(cg_pair);
+      if (v != _validated.end() && v->second.epsilon_equals(aTb, NEAR_ZERO))
+      {
+        validated.insert(*v);
+        continue;
+      }
+    }
+
+    // test the pair
+    ntested++;
+    if (query_intersect(a, b, aTb))
+      colliding_pairs.insert(cg_pair);
+    else if (!deformable)
+      validated[cg_pair] = aTb;
+  }
+  _validated.swap(validated);
+
+  FILE_LOG(LOG_COLDET) << "  " << overlaps.size() << " overlapping pairs, " << ntested << " tested" << std::endl;
+  FILE_LOG(LOG_COLDET) << "CollisionDetection::is_collision_incremental() exited" << std::endl;
+
+  return !colliding_pairs.empty();
+}
+
+/// Determines whether the triangles of two geometries intersect
+/**
+ * \param a the first geometry
+ * \param b the second geometry
+ * \param aTb the transform from b's frame to a's frame
+ */
+bool CollisionDetection::query_intersect(CollisionGeometryPtr a, CollisionGeometryPtr b, const Matrix4& aTb)
+{
+  // get the primitives
+  PrimitivePtr a_primitive = a->get_geometry();
+  PrimitivePtr b_primitive = b->get_geometry();
+
+  // descend the two bounding volume hierarchies 
+  std::stack<pair<BVPtr, BVPtr> > S;
+  S.push(make_pair(a_primitive->get_BVH_root(), b_primitive->get_BVH_root()));
+  while (!S.empty())
+  {
+    BVPtr bva = S.top().first;
+    BVPtr bvb = S.top().second;
+    S.pop();
+
+    // if the BVs do not intersect, there is nothing more to do
+    if (!BV::intersects(bva, bvb, aTb))
+      continue;
+
+    // if both BVs are leafs, intersect their triangles
+    if (bva->is_leaf() && bvb->is_leaf())
+    {
+      const pair<shared_ptr<const IndexedTriArray>, list<unsigned> >& mdata_a = a_primitive->get_sub_mesh(bva);
+      const pair<shared_ptr<const IndexedTriArray>, list<unsigned> >& mdata_b = b_primitive->get_sub_mesh(bvb);
+      BOOST_FOREACH(unsigned a_idx, mdata_a.second)
+      {
+        Triangle ta = mdata_a.first->get_triangle(a_idx);
+        BOOST_FOREACH(unsigned b_idx, mdata_b.second)
+        {
+          Triangle tb = Triangle::transform(mdata_b.first->get_triangle(b_idx), aTb);
+          if (CompGeom::query_intersect_tri_tri(ta, tb))
+            return true;
+        }
+      }
+    }
+    else if (!bva->is_leaf())
+    {
+      BOOST_FOREACH(BVPtr child, bva->children)
+        S.push(make_pair(child, bvb));
+    }
+    else
+    {
+      BOOST_FOREACH(BVPtr child, bvb->children)
+        S.push(make_pair(bva, child));
+    }
+  }
+
+  return false;
+}
+
+/// Casts a batch of rays against all enabled collision geometries
+/**
+ * Rays are processed in packets of consecutive rays: geometries whose 
+ * bounds do not intersect the bounds of a packet are culled for all rays in
+ * the packet at once, and the remaining geometries are tested against the 
+ * rays of the packet together.  Packets are processed in parallel, so 
+ * rays that are coherent (e.g., the beams of a range sensor) should be 
+ * adjacent.
+ * \param rays the origin and the (unit) direction of each ray (global frame)
+ * \param max_dist the length of each ray
+ * \param hits the first hit along each ray, on return; the geometry of a
+ *        hit is null if the ray hits nothing within max_dist
+ * \note bodies must not be modified while rays are being cast
+ */
+void CollisionDetection::ray_cast_batch(const vector<pair<Vector3, Vector3> >& rays, Real max_dist, vector<RayCastHit>& hits)
+{
+  const unsigned PACKET_SIZE = 4;
+  const Real INF = std::numeric_limits<Real>::max();
+
+  FILE_LOG(LOG_COLDET) << "CollisionDetection::ray_cast_batch() entered" << std::endl;
+
+  // get the enabled geometries along with their bounding volume hierarchies
+  // and bounds; the hierarchies are built here, before going parallel
+  vector<CollisionGeometryPtr> geoms;
+  vector<BVPtr> roots;
+  vector<Matrix4> iT;
+  vector<Vector3> lo, hi;
+  for (std::set<CollisionGeometryPtr>::const_iterator i = _geoms.begin(); i != _geoms.end(); i++)
+  {
+    if (!is_enabled(*i) || !(*i)->get_geometry())
+      continue;
+    geoms.push_back(*i);
+    roots.push_back((*i)->get_geometry()->get_BVH_root());
+    iT.push_back(Matrix4::inverse_transform((*i)->get_transform()));
+    lo.push_back(Vector3());
+    hi.push_back(Vector3());
+    calc_AABB(*i, roots.back(), lo.back(), hi.back());
+  }
+
+  // setup the hits
+  hits.resize(rays.size());
+  for (unsigned i=0; i< rays.size(); i++)
+  {
+    hits[i].geom.reset();
+    hits[i].dist = INF;
+  }
+
+  // process packets in parallel
+  const int NPACKETS = (int) ((rays.size() + PACKET_SIZE - 1)/PACKET_SIZE);
+  #pragma omp parallel for
+  for (int p=0; p< NPACKETS; p++)
+  {
+    const unsigned BEGIN = (unsigned) p*PACKET_SIZE;
+    const unsigned N = std::min(PACKET_SIZE, (unsigned) rays.size() - BEGIN);
+
+    // setup the packet in structure-of-arrays form, with the reciprocals of
+    // the direction components for slab tests; unused slots repeat the 
+    // first ray of the packet
+    Real org[3][PACKET_SIZE], inv_dir[3][PACKET_SIZE], tmax[PACKET_SIZE];
+    Vector3 plo = Vector3(1,1,1)*INF, phi = -plo;
+    for (unsigned j=0; j< PACKET_SIZE; j++)
+    {
+      const pair<Vector3, Vector3>& ray = rays[BEGIN + ((j < N) ? j : 0)];
+      tmax[j] = max_dist;
+      for (unsigned k=0; k< 3; k++)
+      {
+        org[k][j] = ray.first[k];
+        inv_dir[k][j] = (Real) 1.0/ray.second[k];
+        Real end = ray.first[k] + ray.second[k]*max_dist;
+        plo[k] = std::min(plo[k], std::min(ray.first[k], end));
+        phi[k] = std::max(phi[k], std::max(ray.first[k], end));
+      }
+    }
+
+    for (unsigned g=0; g< geoms.size(); g++)
+    {
+      // cull the geometry for the entire packet using the packet bounds
+      if (plo[0] > hi[g][0] || plo[1] > hi[g][1] || plo[2] > hi[g][2] ||
+          lo[g][0] > phi[0] || lo[g][1] > phi[1] || lo[g][2] > phi[2])
+        continue;
+
+      // do slab tests for all rays in the packet against the geometry bounds 
+      bool hit[PACKET_SIZE];
+      for (unsigned j=0; j< PACKET_SIZE; j++)
+      {
+        Real tnear = (Real) 0.0, tfar = tmax[j];
+        for (unsigned k=0; k< 3; k++)
+        {
+          Real t1 = (lo[g][k] - org[k][j])*inv_dir[k][j];
+          Real t2 = (hi[g][k] - org[k][j])*inv_dir[k][j];
+          tnear = std::max(tnear, std::min(t1, t2));
+          tfar = std::min(tfar, std::max(t1, t2));
+        }
+        hit[j] = (tnear <= tfar);
+      }
+
+      // intersect rays that pass the slab tests with the geometry 
+      for (unsigned j=0; j< N; j++)
+      {
+        if (!hit[j])
+          continue;
+
+        // transform the segment to the geometry frame 
+        const pair<Vector3, Vector3>& ray = rays[BEGIN+j];
+        LineSeg3 seg(iT[g].mult_point(ray.first), iT[g].mult_point(ray.first + ray.second*tmax[j]));
+
+        Real t;
+        Vector3 isect, normal;
+        if (!geoms[g]->get_geometry()->intersect_seg(roots[g], seg, t, isect, normal))
+          continue;
+
+        // transform the point and normal to the global frame
+        const Matrix4& T = geoms[g]->get_transform();
+        isect = T.mult_point(isect);
+        Real dist = (isect - ray.first).norm();
+        if (dist >= hits[BEGIN+j].dist)
+          continue;
+
+        // record the hit and shorten the ray 
+        RayCastHit& h = hits[BEGIN+j];
+        h.geom = geoms[g];
+        h.dist = dist;
+        h.point = isect;
+        h.normal = T.mult_vector(normal);
+        tmax[j] = dist;
+      }
+    }
+  }
+
+  FILE_LOG(LOG_COLDET) << "CollisionDetection::ray_cast_batch() exited" << std::endl;
+}
+
 /// Implements Base::load_from_xml()
 void CollisionDetection::load_from_xml(XMLTreeConstPtr node, std::map<std::string, BasePtr>& id_map)
 {
@@ -0,0 +1,410 @@
+/****************************************************************************
+ * Copyright 2011 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#include <cmath>
+#include <limits>
+#include <list>
+#include <set>
+#include <stack>
+#include <algorithm>
+#include <stdexcept>
+#include <boost/foreach.hpp>
+#include <Moby/BV.h>
+#include <Moby/CompGeom.h>
+#include <Moby/IndexedTriArray.h>
+#include <Moby/Primitive.h>
+#include <Moby/RigidBody.h>
+#include <Moby/CollisionGeometry.h>
+#include <Moby/CollisionDetection.h>
+#include <Moby/CollisionQuery.h>
+
+using namespace Moby;
+using boost::shared_ptr;
+using boost::dynamic_pointer_cast;
+using std::vector;
+using std::list;
+using std::pair;
+using std::make_pair;
+
+const unsigned CollisionQuery::NO_BODY = std::numeric_limits<unsigned>::max();
+
+/// Constructs the object to check the same pairs of geometries as a collision detector
+/**
+ * Pairs that are disabled in the collision detector (at the time of
+ * construction) are not checked.
+ */
+CollisionQuery::CollisionQuery(const CollisionDetection& cd)
+{
+  const std::set<CollisionGeometryPtr>& geoms = cd.get_collision_geometries();
+  for (std::set<CollisionGeometryPtr>::const_iterator i = geoms.begin(); i != geoms.end(); i++)
+    add_geometry(*i);
+
+  // setup the pairs to check
+  for (unsigned i=0; i< _geoms.size(); i++)
+    for (unsigned j=i+1; j< _geoms.size(); j++)
+      if (cd.is_checked(_geoms[i], _geoms[j]))
+        _pairs.push_back(make_pair(i, j));
+}
+
+/// Constructs the object to check all pairs of the given geometries that do not belong to the same rigid body
+CollisionQuery::CollisionQuery(const vector<CollisionGeometryPtr>& geoms)
+{
+  BOOST_FOREACH(CollisionGeometryPtr geom, geoms)
+    add_geometry(geom);
+
+  // setup the pairs to check
+  for (unsigned i=0; i< _geoms.size(); i++)
+    for (unsigned j=i+1; j< _geoms.size(); j++)
+      if (_body_index[i] == NO_BODY || _body_index[i] != _body_index[j])
+        _pairs.push_back(make_pair(i, j));
+}
+
+/// Sets whether a pair of geometries is checked
+void CollisionQuery::set_enabled(CollisionGeometryPtr g1, CollisionGeometryPtr g2, bool enabled)
+{
+  // get the indices of the two geometries
+  vector<CollisionGeometryPtr>::const_iterator i1 = std::find(_geoms.begin(), _geoms.end(), g1);
+  vector<CollisionGeometryPtr>::const_iterator i2 = std::find(_geoms.begin(), _geoms.end(), g2);
+  if (i1 == _geoms.end() || i2 == _geoms.end())
+    throw std::runtime_error("CollisionQuery::set_enabled() - geometry not found!");
+  unsigned a = i1 - _geoms.begin();
+  unsigned b = i2 - _geoms.begin();
+  if (a == b)
+    return;
+  pair<unsigned, unsigned> p = (a < b) ? make_pair(a, b) : make_pair(b, a);
+
+  // add or remove the pair, keeping the pairs sorted
+  vector<pair<unsigned, unsigned> >::iterator i = std::lower_bound(_pairs.begin(), _pairs.end(), p);
+  bool found = (i != _pairs.end() && *i == p);
+  if (enabled && !found)
+    _pairs.insert(i, p);
+  else if (!enabled && found)
+    _pairs.erase(i);
+}
+
+/// Gets the configuration given by the current poses of the bodies
+void CollisionQuery::get_current_configuration(vector<Matrix4>& config) const
+{
+  config.resize(_bodies.size());
+  for (unsigned i=0; i< _bodies.size(); i++)
+    config[i] = _bodies[i]->get_transform();
+}
+
+/// Determines whether any pair of geometries intersects at a configuration
+/**
+ * \param config the pose of each body returned by get_bodies()
+ */
+bool CollisionQuery::is_collision(const vector<Matrix4>& config) const
+{
+  // compute the transforms of the geometries
+  vector<Matrix4> wTg;
+  calc_transforms(config, wTg);
+
+  // check the pairs
+  for (unsigned i=0; i< _pairs.size(); i++)
+  {
+    const unsigned a = _pairs[i].first;
+    const unsigned b = _pairs[i].second;
+    Matrix4 aTb = Matrix4::inverse_transform(wTg[a]) * wTg[b];
+    if (is_collision(a, b, aTb))
+      return true;
+  }
+
+  return false;
+}
+
+/// Calculates the minimum distance between any pair of geometries at a configuration
+/**
+ * \param config the pose of each body returned by get_bodies()
+ * \return the minimum distance (zero if geometries intersect)
+ */
+Real CollisionQuery::calc_distance(const vector<Matrix4>& config) const
+{
+  // compute the transforms of the geometries
+  vector<Matrix4> wTg;
+  calc_transforms(config, wTg);
+
+  // check the pairs; the minimum distance found so far bounds the search
+  // over subsequent pairs
+  Real min_dist = std::numeric_limits<Real>::max();
+  for (unsigned i=0; i< _pairs.size() && min_dist > (Real) 0.0; i++)
+  {
+    const unsigned a = _pairs[i].first;
+    const unsigned b = _pairs[i].second;
+    Matrix4 aTb = Matrix4::inverse_transform(wTg[a]) * wTg[b];
+    min_dist = std::min(min_dist, calc_distance(a, b, aTb, min_dist));
+  }
+
+  return min_dist;
+}
+
+/// Determines whether there is a collision at each of a set of configurations (in parallel)
+/**
+ * \param configs the configurations
+ * \param colliding whether there is a collision at each configuration, on
+ *        return
+ */
+void CollisionQuery::check_collisions(const vector<vector<Matrix4> >& configs, vector<bool>& colliding) const
+{
+  // check the configurations before going parallel
+  for (unsigned i=0; i< configs.size(); i++)
+    if (configs[i].size() != _bodies.size())
+      throw std::runtime_error("CollisionQuery::check_collisions() - configuration size does not match number of bodies!");
+
+  // check the configurations
+  const int N = (int) configs.size();
+  vector<unsigned char> result(N);
+  #pragma omp parallel for schedule(dynamic)
+  for (int i=0; i< N; i++)
+    result[i] = (is_collision(configs[i])) ? 1 : 0;
+
+  // copy the results
+  colliding.resize(N);
+  for (int i=0; i< N; i++)
+    colliding[i] = (result[i] != 0);
+}
+
+/// Calculates the minimum distance between geometries at each of a set of configurations (in parallel)
+/**
+ * \param configs the configurations
+ * \param distances the minimum distance at each configuration, on return
+ */
+void CollisionQuery::calc_distances(const vector<vector<Matrix4> >& configs, vector<Real>& distances) const
+{
+  // check the configurations before going parallel
+  for (unsigned i=0; i< configs.size(); i++)
+    if (configs[i].size() != _bodies.size())
+      throw std::runtime_error("CollisionQuery::calc_distances() - configuration size does not match number of bodies!");
+
+  // compute the distances
+  const int N = (int) configs.size();
+  distances.resize(N);
+  #pragma omp parallel for schedule(dynamic)
+  for (int i=0; i< N; i++)
+    distances[i] = calc_distance(configs[i]);
+}
+
+/// Adds a geometry, copying its bounding volume hierarchy and triangles
+void CollisionQuery::add_geometry(CollisionGeometryPtr geom)
+{
+  // skip geometries without a primitive
+  PrimitivePtr primitive = geom->get_geometry();
+  if (!primitive)
+    return;
+
+  // get the index of the rigid body (if any), adding the body if necessary
+  RigidBodyPtr rb = dynamic_pointer_cast<RigidBody>(geom->get_single_body());
+  unsigned idx = NO_BODY;
+  if (rb)
+  {
+    idx = std::find(_bodies.begin(), _bodies.end(), rb) - _bodies.begin();
+    if (idx == _bodies.size())
+      _bodies.push_back(rb);
+  }
+
+  // store the geometry and its transform relative to the body
+  _geoms.push_back(geom);
+  _body_index.push_back(idx);
+  if (rb)
+    _bTg.push_back(Matrix4::inverse_transform(rb->get_transform()) * geom->get_transform());
+  else
+    _bTg.push_back(geom->get_transform());
+
+  // copy the bounding volume hierarchy
+  vector<Vector3> verts;
+  _nodes.push_back(vector<Node>());
+  build_nodes(primitive, primitive->get_BVH_root(), _nodes.back(), verts);
+}
+
+/// Builds the nodes of the hierarchy rooted at a bounding volume
+/**
+ * \param primitive the primitive that the hierarchy belongs to
+ * \param bv the bounding volume
+ * \param nodes the nodes of the hierarchy; nodes are appended
+ * \param verts the vertices of the triangles covered by bv, on return
+ * \return the index of the node for bv
+ */
+unsigned CollisionQuery::build_nodes(PrimitivePtr primitive, BVPtr bv, vector<Node>& nodes, vector<Vector3>& verts)
+{
+  const unsigned idx = nodes.size();
+  nodes.push_back(Node());
+  nodes[idx].bv = bv;
+  verts.clear();
+
+  if (bv->is_leaf())
+  {
+    // copy the triangles of the leaf
+    const pair<shared_ptr<const IndexedTriArray>, list<unsigned> >& mdata = primitive->get_sub_mesh(bv);
+    BOOST_FOREACH(unsigned i, mdata.second)
+    {
+      Triangle tri = mdata.first->get_triangle(i);
+      nodes[idx].tris.push_back(tri);
+      verts.push_back(tri.a);
+      verts.push_back(tri.b);
+      verts.push_back(tri.c);
+    }
+  }
+  else
+  {
+    // build the children (note that nodes may be reallocated)
+    vector<Vector3> child_verts;
+    BOOST_FOREACH(BVPtr child, bv->children)
+    {
+      unsigned child_idx = build_nodes(primitive, child, nodes, child_verts);
+      nodes[idx].children.push_back(child_idx);
+      verts.insert(verts.end(), child_verts.begin(), child_verts.end());
+    }
+  }
+
+  // compute a sphere around the vertices, centered at the center of their
+  // bounding box
+  Vector3 lo = (verts.empty()) ? ZEROS_3 : verts.front();
+  Vector3 hi = lo;
+  for (unsigned i=1; i< verts.size(); i++)
+    for (unsigned k=0; k< 3; k++)
+    {
+      lo[k] = std::min(lo[k], verts[i][k]);
+      hi[k] = std::max(hi[k], verts[i][k]);
+    }
+  nodes[idx].center = (lo + hi) * (Real) 0.5;
+  nodes[idx].radius = (Real) 0.0;
+  for (unsigned i=0; i< verts.size(); i++)
+    nodes[idx].radius = std::max(nodes[idx].radius, (verts[i] - nodes[idx].center).norm());
+
+  return idx;
+}
+
+/// Computes the global transform of each geometry at a configuration
+void CollisionQuery::calc_transforms(const vector<Matrix4>& config, vector<Matrix4>& transforms) const
+{
+  if (config.size() != _bodies.size())
+    throw std::runtime_error("CollisionQuery::calc_transforms() - configuration size does not match number of bodies!");
+
+  transforms.resize(_geoms.size());
+  for (unsigned i=0; i< _geoms.size(); i++)
+    transforms[i] = (_body_index[i] == NO_BODY) ? _bTg[i] : config[_body_index[i]] * _bTg[i];
+}
+
+/// Determines whether two geometries intersect
+/**
+ * \param a the index of the first geometry
+ * \param b the index of the second geometry
+ * \param aTb the transform from b's frame to a's frame
+ */
+bool CollisionQuery::is_collision(unsigned a, unsigned b, const Matrix4& aTb) const
+{
+  const vector<Node>& nodes_a = _nodes[a];
+  const vector<Node>& nodes_b = _nodes[b];
+
+  // descend both hierarchies
+  std::stack<pair<unsigned, unsigned> > S;
+  S.push(make_pair((unsigned) 0, (unsigned) 0));
+  while (!S.empty())
+  {
+    const Node& na = nodes_a[S.top().first];
+    const Node& nb = nodes_b[S.top().second];
+    const unsigned ia = S.top().first;
+    const unsigned ib = S.top().second;
+    S.pop();
+
+    // if the BVs do not intersect, there is nothing more to do
+    if (!BV::intersects(na.bv, nb.bv, aTb))
+      continue;
+
+    // if both BVs are leafs, intersect their triangles
+    if (na.children.empty() && nb.children.empty())
+    {
+      for (unsigned j=0; j< nb.tris.size(); j++)
+      {
+        Triangle tb = Triangle::transform(nb.tris[j], aTb);
+        for (unsigned i=0; i< na.tris.size(); i++)
+          if (CompGeom::query_intersect_tri_tri(na.tris[i], tb))
+            return true;
+      }
+    }
+    else if (!na.children.empty())
+    {
+      for (unsigned i=0; i< na.children.size(); i++)
+        S.push(make_pair(na.children[i], ib));
+    }
+    else
+    {
+      for (unsigned i=0; i< nb.children.size(); i++)
+        S.push(make_pair(ia, nb.children[i]));
+    }
+  }
+
+  return false;
+}
+
+/// Calculates the distance between two geometries
+/**
+ * Pairs of nodes are pruned using the distance between their bounding
+ * spheres.
+ * \param a the index of the first geometry
+ * \param b the index of the second geometry
+ * \param aTb the transform from b's frame to a's frame
+ * \param max_dist distances of max_dist or greater need not be computed
+ * \return the distance between the geometries, or max_dist if the distance
+ *         is at least max_dist
+ */
+Real CollisionQuery::calc_distance(unsigned a, unsigned b, const Matrix4& aTb, Real max_dist) const
+{
+  const vector<Node>& nodes_a = _nodes[a];
+  const vector<Node>& nodes_b = _nodes[b];
+  Real min_dist = max_dist;
+
+  // descend both hierarchies
+  std::stack<pair<unsigned, unsigned> > S;
+  S.push(make_pair((unsigned) 0, (unsigned) 0));
+  while (!S.empty())
+  {
+    const Node& na = nodes_a[S.top().first];
+    const Node& nb = nodes_b[S.top().second];
+    const unsigned ia = S.top().first;
+    const unsigned ib = S.top().second;
+    S.pop();
+
+    // prune the pair if its spheres are no closer than the closest triangles
+    Real lower = (na.center - aTb.mult_point(nb.center)).norm() - na.radius - nb.radius;
+    if (lower >= min_dist)
+      continue;
+
+    // if both nodes are leafs, compute distances between their triangles
+    if (na.children.empty() && nb.children.empty())
+    {
+      for (unsigned j=0; j< nb.tris.size(); j++)
+      {
+        Triangle tb = Triangle::transform(nb.tris[j], aTb);
+        for (unsigned i=0; i< na.tris.size(); i++)
+        {
+          Vector3 cpa, cpb;
+          Real dist = std::sqrt(Triangle::calc_sq_dist(na.tris[i], tb, cpa, cpb));
+          if (dist < min_dist)
+            min_dist = dist;
+        }
+      }
+
+      // see whether the geometries intersect
+      if (min_dist <= (Real) 0.0)
+        return (Real) 0.0;
+    }
+    // otherwise, descend through the larger node
+    else if (!na.children.empty() && (nb.children.empty() || na.radius >= nb.radius))
+    {
+      for (unsigned i=0; i< na.children.size(); i++)
+        S.push(make_pair(na.children[i], ib));
+    }
+    else
+    {
+      for (unsigned i=0; i< nb.children.size(); i++)
+        S.push(make_pair(ia, nb.children[i]));
+    }
+  }
+
+  return min_dist;
+}
+
@@ -8,6 +8,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <iterator>
+#include <algorithm>
 #include <cmath>
 #include <set>
 #include <stack>
@@ -1901,16 +1902,563 @@ bool CompGeom::collinear(const Vector2& a, const Vector2& b, const Vector2& c, R
 }
 
 /// Determines whether three points are collinear
+/**
+ * \param tol the relative tolerance; if tol is zero, the test is exact
+ */
 bool CompGeom::collinear(const Vector3& a, const Vector3& b, const Vector3& c, Real tol)
 {  
   const unsigned X = 0, Y = 1, Z = 2;
   assert(tol >= 0.0);
 
+  // three points are exactly collinear iff their projections onto all three
+  // coordinate planes are collinear
+  if (tol == 0.0)
+    return orient_2D(Vector2(a[X], a[Y]), Vector2(b[X], b[Y]), Vector2(c[X], c[Y])) == 0.0 &&
+           orient_2D(Vector2(a[Y], a[Z]), Vector2(b[Y], b[Z]), Vector2(c[Y], c[Z])) == 0.0 &&
+           orient_2D(Vector2(a[Z], a[X]), Vector2(b[Z], b[X]), Vector2(c[Z], c[X])) == 0.0;
+
    return (rel_equal((c[Z]-a[Z])*(b[Y]-a[Y]), (b[Z]-a[Z])*(c[Y]-a[Y]), tol) &&
           rel_equal((b[Z]-a[Z])*(c[X]-a[X]), (b[X]-a[X])*(c[Z]-a[Z]), tol) && 
           rel_equal((b[X]-a[X])*(c[Y]-a[Y]), (b[Y]-a[Y])*(c[X]-a[X]), tol));
 }
 
+/*****************************************************************************
+ Robust geometric predicates BEGIN
+
+ The predicates below are adapted from [Shewchuk, 1997]: each is first
+ evaluated in ordinary floating point; if the magnitude of the result exceeds
+ a bound on its rounding error, its sign is correct and it is returned 
+ immediately.  Otherwise, the determinant is evaluated exactly using 
+ floating-point expansions (sums of non-overlapping doubles).  The predicates
+ assume IEEE 754 double precision arithmetic with round-to-even (i.e., they 
+ must not be compiled with -ffast-math or evaluated using x87 extended 
+ precision) and that no overflow or underflow occurs.
+ ****************************************************************************/
+
+/// Machine epsilon for the predicates (half of an ulp of 1.0)
+static const double PRED_EPS = std::numeric_limits<double>::epsilon() * 0.5;
+
+/// Splitter for the predicates (used to split a double into two halves)
+static const double PRED_SPLITTER = 134217729.0;    // 2^27 + 1
+
+/// Error bounds for the floating point filters [Shewchuk, 1997]
+static const double CCW_ERRBOUND_A = (3.0 + 16.0*PRED_EPS)*PRED_EPS;
+static const double O3D_ERRBOUND_A = (7.0 + 56.0*PRED_EPS)*PRED_EPS;
+static const double ICC_ERRBOUND_A = (10.0 + 96.0*PRED_EPS)*PRED_EPS;
+static const double ISP_ERRBOUND_A = (16.0 + 224.0*PRED_EPS)*PRED_EPS;
+
+/// Computes x + y = a + b exactly, where x = fl(a + b) (requires |a| >= |b|)
+static inline void fast_two_sum(double a, double b, double& x, double& y)
+{
+  x = a + b;
+  double bvirt = x - a;
+  y = b - bvirt;
+}
+
+/// Computes x + y = a + b exactly, where x = fl(a + b)
+static inline void two_sum(double a, double b, double& x, double& y)
+{
+  x = a + b;
+  double bvirt = x - a;
+  double avirt = x - bvirt;
+  double bround = b - bvirt;
+  double around = a - avirt;
+  y = around + bround;
+}
+
+/// Splits a into two halves (of 26 bits each), a = hi + lo
+static inline void split(double a, double& hi, double& lo)
+{
+  double c = PRED_SPLITTER * a;
+  double abig = c - a;
+  hi = c - abig;
+  lo = a - hi;
+}
+
+/// Computes x + y = a * b exactly, where x = fl(a * b)
+static inline void two_product(double a, double b, double& x, double& y)
+{
+  double ahi, alo, bhi, blo;
+  x = a * b;
+  split(a, ahi, alo);
+  split(b, bhi, blo);
+  double err1 = x - (ahi * bhi);
+  double err2 = err1 - (alo * bhi);
+  double err3 = err2 - (ahi * blo);
+  y = (alo * blo) - err3;
+}
+
+/// Sums two expansions (with zero elimination)
+/**
+ * \param elen the number of components of e
+ * \param e an expansion (components in increasing order of magnitude)
+ * \param flen the number of components of f
+ * \param f an expansion (components in increasing order of magnitude)
+ * \param h on return, the expansion e + f (h must have room for elen + flen
+ *        components; h may not alias e or f)
+ * \return the number of components of h (at least one)
+ */
+static int expansion_sum(int elen, const double* e, int flen, const double* f, double* h)
+{
+  double Q, Qnew, hh;
+  int eindex = 0, findex = 0, hindex = 0;
+  double enow = e[0];
+  double fnow = f[0];
+
+  // take the smallest component as the initial sum
+  if ((fnow > enow) == (fnow > -enow))
+  {
+    Q = enow;
+    enow = (++eindex < elen) ? e[eindex] : 0.0;
+  }
+  else
+  {
+    Q = fnow;
+    fnow = (++findex < flen) ? f[findex] : 0.0;
+  }
+
+  // merge the components in order of magnitude
+  if (eindex < elen && findex < flen)
+  {
+    if ((fnow > enow) == (fnow > -enow))
+    {
+      fast_two_sum(enow, Q, Qnew, hh);
+      enow = (++eindex < elen) ? e[eindex] : 0.0;
+    }
+    else
+    {
+      fast_two_sum(fnow, Q, Qnew, hh);
+      fnow = (++findex < flen) ? f[findex] : 0.0;
+    }
+    Q = Qnew;
+    if (hh != 0.0)
+      h[hindex++] = hh;
+    while (eindex < elen && findex < flen)
+    {
+      if ((fnow > enow) == (fnow > -enow))
+      {
+        two_sum(Q, enow, Qnew, hh);
+        enow = (++eindex < elen) ? e[eindex] : 0.0;
+      }
+      else
+      {
+        two_sum(Q, fnow, Qnew, hh);
+        fnow = (++findex < flen) ? f[findex] : 0.0;
+      }
+      Q = Qnew;
+      if (hh != 0.0)
+        h[hindex++] = hh;
+    }
+  }
+
+  // process the remaining components
+  while (eindex < elen)
+  {
+    two_sum(Q, enow, Qnew, hh);
+    enow = (++eindex < elen) ? e[eindex] : 0.0;
+    Q = Qnew;
+    if (hh != 0.0)
+      h[hindex++] = hh;
+  }
+  while (findex < flen)
+  {
+    two_sum(Q, fnow, Qnew, hh);
+    fnow = (++findex < flen) ? f[findex] : 0.0;
+    Q = Qnew;
+    if (hh != 0.0)
+      h[hindex++] = hh;
+  }
+  if (Q != 0.0 || hindex == 0)
+    h[hindex++] = Q;
+
+  return hindex;
+}
+
+/// Multiplies an expansion by a scalar (with zero elimination)
+/**
+ * \param elen the number of components of e
+ * \param e an expansion (components in increasing order of magnitude)
+ * \param b the scalar
+ * \param h on return, the expansion b*e (h must have room for 2*elen 
+ *        components; h may not alias e)
+ * \return the number of components of h (at least one)
+ */
+static int scale_expansion(int elen, const double* e, double b, double* h)
+{
+  double Q, sum, hh, product1, product0;
+  int hindex = 0;
+
+  two_product(e[0], b, Q, hh);
+  if (hh != 0.0)
+    h[hindex++] = hh;
+  for (int i=1; i< elen; i++)
+  {
+    two_product(e[i], b, product1, product0);
+    two_sum(Q, product0, sum, hh);
+    if (hh != 0.0)
+      h[hindex++] = hh;
+    fast_two_sum(product1, sum, Q, hh);
+    if (hh != 0.0)
+      h[hindex++] = hh;
+  }
+  if (Q != 0.0 || hindex == 0)
+    h[hindex++] = Q;
+
+  return hindex;
+}
+
+/// Multiplies two expansions
+static void expansion_product(int elen, const double* e, int flen, const double* f, std::vector<double>& h)
+{
+  std::vector<double> term(2*elen), sum;
+  h.assign(1, 0.0);
+  for (int i=0; i< flen; i++)
+  {
+    int tlen = scale_expansion(elen, e, f[i], &term[0]);
+    sum.resize(h.size() + tlen);
+    sum.resize(expansion_sum(h.size(), &h[0], tlen, &term[0], &sum[0]));
+    h.swap(sum);
+  }
+}
+
+/// Negates an expansion in place
+static inline void negate_expansion(int elen, double* e)
+{
+  for (int i=0; i< elen; i++)
+    e[i] = -e[i];
+}
+
+/// Approximates the value of an expansion (the sign of the approximation is exact)
+static inline double estimate(int elen, const double* e)
+{
+  double Q = e[0];
+  for (int i=1; i< elen; i++)
+    Q += e[i];
+  return Q;
+}
+
+/// Computes a[0]*b[1] - b[0]*a[1] exactly (as an expansion of at most four components)
+static int cross_2D_exact(const double* a, const double* b, double* h)
+{
+  double p[2], q[2];
+  two_product(a[0], b[1], p[1], p[0]);
+  two_product(b[0], a[1], q[1], q[0]);
+  negate_expansion(2, q);
+  return expansion_sum(2, p, 2, q, h);
+}
+
+/// Computes the 2D orientation determinant of a, b, c exactly (as an expansion of at most twelve components)
+/**
+ * Only the first two coordinates of each point are used.
+ */
+static int orient_2D_exact(const double* a, const double* b, const double* c, double* h)
+{
+  double ab[4], bc[4], ca[4], abbc[8];
+  int ablen = cross_2D_exact(a, b, ab);
+  int bclen = cross_2D_exact(b, c, bc);
+  int calen = cross_2D_exact(c, a, ca);
+  int abbclen = expansion_sum(ablen, ab, bclen, bc, abbc);
+  return expansion_sum(abbclen, abbc, calen, ca, h);
+}
+
+/// Computes the 3D orientation determinant of a, b, c, d exactly (as an expansion of at most 96 components)
+static int orient_3D_exact(const double* a, const double* b, const double* c, const double* d, double* h)
+{
+  const unsigned Z = 2;
+
+  // expand the 4x4 determinant [x y z 1] along the z column
+  double bcd[12], acd[12], abd[12], abc[12];
+  int bcdlen = orient_2D_exact(b, c, d, bcd);
+  int acdlen = orient_2D_exact(a, c, d, acd);
+  int abdlen = orient_2D_exact(a, b, d, abd);
+  int abclen = orient_2D_exact(a, b, c, abc);
+  double t1[24], t2[24], t3[24], t4[24], s1[48], s2[48];
+  int t1len = scale_expansion(bcdlen, bcd, a[Z], t1);
+  int t2len = scale_expansion(acdlen, acd, -b[Z], t2);
+  int t3len = scale_expansion(abdlen, abd, c[Z], t3);
+  int t4len = scale_expansion(abclen, abc, -d[Z], t4);
+  int s1len = expansion_sum(t1len, t1, t2len, t2, s1);
+  int s2len = expansion_sum(t3len, t3, t4len, t4, s2);
+  return expansion_sum(s1len, s1, s2len, s2, h);
+}
+
+/// Computes the squared norm of a 2D or 3D point exactly
+static int lift_exact(const double* a, unsigned dim, double* h)
+{
+  double sq[2], tmp[6];
+  two_product(a[0], a[0], sq[1], sq[0]);
+  int hlen = 2;
+  h[0] = sq[0];
+  h[1] = sq[1];
+  for (unsigned i=1; i< dim; i++)
+  {
+    two_product(a[i], a[i], sq[1], sq[0]);
+    int tlen = expansion_sum(hlen, h, 2, sq, tmp);
+    std::copy(tmp, tmp+tlen, h);
+    hlen = tlen;
+  }
+  return hlen;
+}
+
+/// Adds (sign)*lift*minor to an expansion (used by the exact in-circle and in-sphere tests)
+static void add_lifted_term(const double* lift, int liftlen, const double* minor, int minorlen, bool negate, std::vector<double>& det)
+{
+  std::vector<double> term, sum;
+  expansion_product(minorlen, minor, liftlen, lift, term);
+  if (negate)
+    negate_expansion(term.size(), &term[0]);
+  sum.resize(det.size() + term.size());
+  sum.resize(expansion_sum(det.size(), &det[0], term.size(), &term[0], &sum[0]));
+  det.swap(sum);
+}
+
+/// Determines the orientation of three points in 2D
+/**
+ * \return a positive value if a, b, and c occur in counterclockwise order, a 
+ *         negative value if they occur in clockwise order, and zero if they 
+ *         are collinear; the sign of the result is exact, and the magnitude
+ *         approximates twice the signed area of the triangle abc
+ */
+Real CompGeom::orient_2D(const Vector2& a, const Vector2& b, const Vector2& c)
+{
+  const unsigned X = 0, Y = 1;
+
+  // use the floating point filter first
+  double detleft = ((double) a[X] - c[X]) * ((double) b[Y] - c[Y]);
+  double detright = ((double) a[Y] - c[Y]) * ((double) b[X] - c[X]);
+  double det = detleft - detright;
+  double detsum;
+  if (detleft > 0.0)
+  {
+    if (detright <= 0.0)
+      return det;
+    detsum = detleft + detright;
+  }
+  else if (detleft < 0.0)
+  {
+    if (detright >= 0.0)
+      return det;
+    detsum = -detleft - detright;
+  }
+  else
+    return det;
+  if (std::fabs(det) >= CCW_ERRBOUND_A * detsum)
+    return det;
+
+  // evaluate the determinant exactly
+  double pa[2] = { a[X], a[Y] }, pb[2] = { b[X], b[Y] }, pc[2] = { c[X], c[Y] };
+  double h[12];
+  int hlen = orient_2D_exact(pa, pb, pc, h);
+  return estimate(hlen, h);
+}
+
+/// Determines the orientation of four points in 3D
+/**
+ * \return a positive value if d lies below the plane passing through a, b, 
+ *         and c (where "below" is defined such that a, b, and c appear in 
+ *         counterclockwise order when viewed from above the plane), a negative
+ *         value if d lies above the plane, and zero if the points are 
+ *         coplanar; the sign of the result is exact, and the magnitude 
+ *         approximates six times the signed volume of the tetrahedron abcd
+ *         (i.e., the result is equal to volume(a, b, c, d))
+ */
+Real CompGeom::orient_3D(const Vector3& a, const Vector3& b, const Vector3& c, const Vector3& d)
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+
+  // use the floating point filter first
+  double adx = (double) a[X] - d[X], bdx = (double) b[X] - d[X], cdx = (double) c[X] - d[X];
+  double ady = (double) a[Y] - d[Y], bdy = (double) b[Y] - d[Y], cdy = (double) c[Y] - d[Y];
+  double adz = (double) a[Z] - d[Z], bdz = (double) b[Z] - d[Z], cdz = (double) c[Z] - d[Z];
+  double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+  double cdxady = cdx * ady, adxcdy = adx * cdy;
+  double adxbdy = adx * bdy, bdxady = bdx * ady;
+  double det = adz * (bdxcdy - cdxbdy) + bdz * (cdxady - adxcdy) + cdz * (adxbdy - bdxady);
+  double permanent = (std::fabs(bdxcdy) + std::fabs(cdxbdy)) * std::fabs(adz) + 
+                     (std::fabs(cdxady) + std::fabs(adxcdy)) * std::fabs(bdz) + 
+                     (std::fabs(adxbdy) + std::fabs(bdxady)) * std::fabs(cdz);
+  if (std::fabs(det) > O3D_ERRBOUND_A * permanent)
+    return det;
+
+  // evaluate the determinant exactly
+  double pa[3] = { a[X], a[Y], a[Z] }, pb[3] = { b[X], b[Y], b[Z] };
+  double pc[3] = { c[X], c[Y], c[Z] }, pd[3] = { d[X], d[Y], d[Z] };
+  double h[96];
+  int hlen = orient_3D_exact(pa, pb, pc, pd, h);
+  return estimate(hlen, h);
+}
+
+/// Determines whether a point lies inside the circle passing through three points in 2D
+/**
+ * \return a positive value if d lies inside the circle passing through a, b,
+ *         and c, a negative value if it lies outside, and zero if the four
+ *         points are cocircular; a, b, and c must be in counterclockwise 
+ *         order, or the sign of the result is reversed; the sign of the result
+ *         is exact
+ */
+Real CompGeom::in_circle(const Vector2& a, const Vector2& b, const Vector2& c, const Vector2& d)
+{
+  const unsigned X = 0, Y = 1;
+
+  // use the floating point filter first
+  double adx = (double) a[X] - d[X], bdx = (double) b[X] - d[X], cdx = (double) c[X] - d[X];
+  double ady = (double) a[Y] - d[Y], bdy = (double) b[Y] - d[Y], cdy = (double) c[Y] - d[Y];
+  double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+  double cdxady = cdx * ady, adxcdy = adx * cdy;
+  double adxbdy = adx * bdy, bdxady = bdx * ady;
+  double alift = adx * adx + ady * ady;
+  double blift = bdx * bdx + bdy * bdy;
+  double clift = cdx * cdx + cdy * cdy;
+  double det = alift * (bdxcdy - cdxbdy) + blift * (cdxady - adxcdy) + clift * (adxbdy - bdxady);
+  double permanent = (std::fabs(bdxcdy) + std::fabs(cdxbdy)) * alift + 
+                     (std::fabs(cdxady) + std::fabs(adxcdy)) * blift + 
+                     (std::fabs(adxbdy) + std::fabs(bdxady)) * clift;
+  if (std::fabs(det) > ICC_ERRBOUND_A * permanent)
+    return det;
+
+  // evaluate the (lifted) 4x4 determinant [x y x^2+y^2 1] exactly by 
+  // expanding along the lifted column
+  double pa[2] = { a[X], a[Y] }, pb[2] = { b[X], b[Y] }; 
+  double pc[2] = { c[X], c[Y] }, pd[2] = { d[X], d[Y] };
+  double lift[4][4], minor[4][12];
+  int liftlen[4], minorlen[4];
+  liftlen[0] = lift_exact(pa, 2, lift[0]);
+  liftlen[1] = lift_exact(pb, 2, lift[1]);
+  liftlen[2] = lift_exact(pc, 2, lift[2]);
+  liftlen[3] = lift_exact(pd, 2, lift[3]);
+  minorlen[0] = orient_2D_exact(pb, pc, pd, minor[0]);
+  minorlen[1] = orient_2D_exact(pa, pc, pd, minor[1]);
+  minorlen[2] = orient_2D_exact(pa, pb, pd, minor[2]);
+  minorlen[3] = orient_2D_exact(pa, pb, pc, minor[3]);
+  std::vector<double> h(1, 0.0);
+  for (unsigned i=0; i< 4; i++)
+    add_lifted_term(lift[i], liftlen[i], minor[i], minorlen[i], (i % 2) == 1, h);
+  return estimate(h.size(), &h[0]);
+}
+
+/// Determines whether a point lies inside the sphere passing through four points in 3D
+/**
+ * \return a positive value if e lies inside the sphere passing through a, b,
+ *         c, and d, a negative value if it lies outside, and zero if the five
+ *         points are cospherical; a, b, c, and d must be ordered such that 
+ *         orient_3D(a, b, c, d) is positive, or the sign of the result is 
+ *         reversed; the sign of the result is exact
+ */
+Real CompGeom::in_sphere(const Vector3& a, const Vector3& b, const Vector3& c, const Vector3& d, const Vector3& e)
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+
+  // use the floating point filter first
+  double aex = (double) a[X] - e[X], bex = (double) b[X] - e[X], cex = (double) c[X] - e[X], dex = (double) d[X] - e[X];
+  double aey = (double) a[Y] - e[Y], bey = (double) b[Y] - e[Y], cey = (double) c[Y] - e[Y], dey = (double) d[Y] - e[Y];
+  double aez = (double) a[Z] - e[Z], bez = (double) b[Z] - e[Z], cez = (double) c[Z] - e[Z], dez = (double) d[Z] - e[Z];
+  double aexbey = aex * bey, bexaey = bex * aey;
+  double bexcey = bex * cey, cexbey = cex * bey;
+  double cexdey = cex * dey, dexcey = dex * cey;
+  double dexaey = dex * aey, aexdey = aex * dey;
+  double aexcey = aex * cey, cexaey = cex * aey;
+  double bexdey = bex * dey, dexbey = dex * bey;
+  double ab = aexbey - bexaey, bc = bexcey - cexbey, cd = cexdey - dexcey;
+  double da = dexaey - aexdey, ac = aexcey - cexaey, bd = bexdey - dexbey;
+  double abc = aez * bc - bez * ac + cez * ab;
+  double bcd = bez * cd - cez * bd + dez * bc;
+  double cda = cez * da + dez * ac + aez * cd;
+  double dab = dez * ab + aez * bd + bez * da;
+  double alift = aex * aex + aey * aey + aez * aez;
+  double blift = bex * bex + bey * bey + bez * bez;
+  double clift = cex * cex + cey * cey + cez * cez;
+  double dlift = dex * dex + dey * dey + dez * dez;
+  double det = (dlift * abc - clift * dab) + (blift * cda - alift * bcd);
+  double aezplus = std::fabs(aez), bezplus = std::fabs(bez);
+  double cezplus = std::fabs(cez), dezplus = std::fabs(dez);
+  double abp = std::fabs(aexbey) + std::fabs(bexaey);
+  double bcp = std::fabs(bexcey) + std::fabs(cexbey);
+  double cdp = std::fabs(cexdey) + std::fabs(dexcey);
+  double dap = std::fabs(dexaey) + std::fabs(aexdey);
+  double acp = std::fabs(aexcey) + std::fabs(cexaey);
+  double bdp = std::fabs(bexdey) + std::fabs(dexbey);
+  double permanent = (cdp * bezplus + bdp * cezplus + bcp * dezplus) * alift + 
+                     (dap * cezplus + acp * dezplus + cdp * aezplus) * blift + 
+                     (abp * dezplus + bdp * aezplus + dap * bezplus) * clift + 
+                     (bcp * aezplus + acp * bezplus + abp * cezplus) * dlift;
+  if (std::fabs(det) > ISP_ERRBOUND_A * permanent)
+    return det;
+
+  // evaluate the (lifted) 5x5 determinant [x y z x^2+y^2+z^2 1] exactly by
+  // expanding along the lifted column
+  double p[5][3] = { { a[X], a[Y], a[Z] }, { b[X], b[Y], b[Z] }, 
+                     { c[X], c[Y], c[Z] }, { d[X], d[Y], d[Z] }, 
+                     { e[X], e[Y], e[Z] } };
+  std::vector<double> h(1, 0.0);
+  for (unsigned i=0; i< 5; i++)
+  {
+    // get the four remaining points
+    const double* q[4];
+    for (unsigned j=0, k=0; j< 5; j++)
+      if (j != i)
+        q[k++] = p[j];
+
+    double lift[6], minor[96];
+    int liftlen = lift_exact(p[i], 3, lift);
+    int minorlen = orient_3D_exact(q[0], q[1], q[2], q[3], minor);
+    add_lifted_term(lift, liftlen, minor, minorlen, (i % 2) == 0, h);
+  }
+  return estimate(h.size(), &h[0]);
+}
+
+/*****************************************************************************
+ Robust geometric predicates END
+ ****************************************************************************/
+
+/// Compares two points lexicographically (used by calc_convex_hull_2D())
+static bool lex_less(const Vector2* a, const Vector2* b)
+{
+  const unsigned X = 0, Y = 1;
+  return ((*a)[X] < (*b)[X]) || ((*a)[X] == (*b)[X] && (*a)[Y] < (*b)[Y]);
+}
+
+/// Computes the convex hull of a set of points in 2D
+/**
+ * Uses Andrew's monotone chain algorithm with the exact orientation test 
+ * (orient_2D()), so the hull is computed without tolerances and without 
+ * qhull; runs in O(N lg N) time.
+ * \param points the points (sorted on return)
+ * \param hull on return, the vertices of the hull in ccw order, excluding 
+ *        points that lie in the relative interior of hull edges; empty if the
+ *        points are collinear (or if there are fewer than three)
+ */
+void CompGeom::calc_convex_hull_2D(std::vector<Vector2*>& points, std::vector<Vector2*>& hull)
+{
+  hull.clear();
+  const unsigned N = points.size();
+  if (N < 3)
+    return;
+
+  // sort the points lexicographically
+  std::sort(points.begin(), points.end(), lex_less);
+
+  // compute the lower hull, then the upper hull
+  hull.resize(2*N);
+  unsigned k = 0;
+  for (unsigned i=0; i< N; i++)
+  {
+    while (k >= 2 && orient_2D(*hull[k-2], *hull[k-1], *points[i]) <= 0.0)
+      k--;
+    hull[k++] = points[i];
+  }
+  for (unsigned i=N-1, lower = k+1; i > 0; i--)
+  {
+    while (k >= lower && orient_2D(*hull[k-2], *hull[k-1], *points[i-1]) <= 0.0)
+      k--;
+    hull[k++] = points[i-1];
+  }
+
+  // the last point is the same as the first 
+  hull.resize(k-1);
+  if (hull.size() < 3)
+    hull.clear();
+}
+
 /// Gets the volume of a tetrahedron composed of vertices a, b, c, d
 LongReal CompGeom::volume(const Vector3& a, const Vector3& b, const Vector3& c, const Vector3& d)
 {
@@ -1930,6 +2478,8 @@ LongReal CompGeom::volume(const Vector3& a, const Vector3& b, const Vector3& c,
 
 /// Gets the sign of the volume of a tetrahedron composed of vertices a, b, c, d
 /**
+ * \param tol volumes whose magnitude is no greater than tol are considered to
+ *        be zero; if tol is zero, the test is exact (see orient_3D())
  * \returns -1 if d is "visible" from the plane of (a,b,c); 0 if the a,b,c, and
  *          d are coplanar, and +1 otherwise
  */
@@ -1937,7 +2487,8 @@ CompGeom::VisibilityType CompGeom::volume_sign(const Vector3& a, const Vector3&
 {
   assert(tol >= 0.0);
 
-  LongReal v = volume(a, b, c, d);
+  // the sign of the volume is exact (so a zero tolerance yields an exact test)
+  Real v = orient_3D(a, b, c, d);
   if (v < -tol)
     return eVisible;
   else if (v > tol)
@@ -1956,23 +2507,18 @@ LongReal CompGeom::area(const Vector2& a, const Vector2& b, const Vector2& c)
 }
 
 /// Gets the sign of the area of two vectors with respect to an arbitrary center
+/**
+ * \param tol areas whose magnitude is no greater than tol are considered to 
+ *        be zero; if tol is zero, the test is exact (see orient_2D())
+ */
 CompGeom::OrientationType CompGeom::area_sign(const Vector2& a, const Vector2& b, const Vector2& c, Real tol)
 {
   assert(tol >= 0.0);  
 
-  const unsigned X = 0, Y = 1;
-  LongReal a1 = (b[X] - a[X]) * (c[Y] - a[Y]);
-  LongReal a2 = (c[X] - a[X]) * (b[Y] - a[Y]);
-
-  // see whether a1 and a2 are relatively equal
-//  if (rel_equal(a1, a2, tol))
-//    return eOn;
-
-  // get the area
-  Real x = a1 - a2;
-
-if (x < tol && x > -tol)
-  return eOn;
+  // get the area; its sign is exact (so a zero tolerance yields an exact test)
+  Real x = orient_2D(a, b, c);
+  if (x <= tol && x >= -tol)
+    return eOn;
 
   // return the proper sign
   return (x > 0.0) ? eLeft : eRight;
@@ -2618,12 +3164,252 @@ void CompGeom::project_onto_axis(const Triangle& rkTri, const Vector3& rkAxis, R
     rfMax = fdot2;
 }
 
+/// Computes the orientation of each vertex of s with respect to the plane of t (i.e., orient_3D(t.a, t.b, v, t.c) for each vertex v of s)
 /**
- * Determines whether two triangles intersect.
+ * The cross product of the edges of t is shared among the three tests; the
+ * floating point filter of orient_3D() is applied to each result, and 
+ * orient_3D() is called only when the filter fails.
+ */
+static void calc_plane_orientations(const Triangle& t, const Triangle& s, Real o[3])
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+
+  // compute the (cross product) minors of the edges of t
+  double ax = (double) t.a[X] - t.c[X], ay = (double) t.a[Y] - t.c[Y], az = (double) t.a[Z] - t.c[Z];
+  double bx = (double) t.b[X] - t.c[X], by = (double) t.b[Y] - t.c[Y], bz = (double) t.b[Z] - t.c[Z];
+  double aybz = ay * bz, azby = az * by;
+  double azbx = az * bx, axbz = ax * bz;
+  double axby = ax * by, aybx = ay * bx;
+  double nx = aybz - azby, ny = azbx - axbz, nz = axby - aybx;
+  double px = std::fabs(aybz) + std::fabs(azby);
+  double py = std::fabs(azbx) + std::fabs(axbz);
+  double pz = std::fabs(axby) + std::fabs(aybx);
+
+  // compute the orientations
+  const Vector3* v[3] = { &s.a, &s.b, &s.c };
+  for (unsigned i=0; i< 3; i++)
+  {
+    double cx = (double) (*v[i])[X] - t.c[X];
+    double cy = (double) (*v[i])[Y] - t.c[Y];
+    double cz = (double) (*v[i])[Z] - t.c[Z];
+    double det = cx * nx + cy * ny + cz * nz;
+    double permanent = std::fabs(cx) * px + std::fabs(cy) * py + std::fabs(cz) * pz;
+    o[i] = (std::fabs(det) > O3D_ERRBOUND_A * permanent) ? det : CompGeom::orient_3D(t.a, t.b, *v[i], t.c);
+  }
+}
+
+/// Utility method for query_intersect_tri_tri()
+/**
+ * Given that p1 (of the first triangle) and p2 (of the second triangle) are
+ * the vertices that lie alone on one side of the plane of the other triangle
+ * (and that both triangles are oriented appropriately), determines whether 
+ * the intervals of intersection of the triangles with the line of intersection
+ * of their planes overlap.
+ */
+bool CompGeom::check_min_max(const Vector3& p1, const Vector3& q1, const Vector3& r1, const Vector3& p2, const Vector3& q2, const Vector3& r2)
+{
+  if (orient_3D(p2, p1, q2, q1) > 0.0)
+    return false;
+  if (orient_3D(p2, r1, r2, p1) > 0.0)
+    return false;
+  return true;
+}
+
+/// Utility method for query_intersect_tri_tri()
+/**
+ * Permutes the vertices of the second triangle such that p2 lies alone on
+ * one side of the plane of the first triangle (p1 lies alone on one side of 
+ * the plane of the second triangle) and calls check_min_max().
+ */
+bool CompGeom::query_intersect_tri_tri(const Vector3& p1, const Vector3& q1, const Vector3& r1, const Vector3& p2, const Vector3& q2, const Vector3& r2, Real dp2, Real dq2, Real dr2, const Triangle& t1, const Triangle& t2)
+{
+  if (dp2 > 0.0)
+  {
+    if (dq2 > 0.0)
+      return check_min_max(p1, r1, q1, r2, p2, q2);
+    else if (dr2 > 0.0)
+      return check_min_max(p1, r1, q1, q2, r2, p2);
+    else
+      return check_min_max(p1, q1, r1, p2, q2, r2);
+  }
+  else if (dp2 < 0.0)
+  {
+    if (dq2 < 0.0)
+      return check_min_max(p1, q1, r1, r2, p2, q2);
+    else if (dr2 < 0.0)
+      return check_min_max(p1, q1, r1, q2, r2, p2);
+    else
+      return check_min_max(p1, r1, q1, p2, q2, r2);
+  }
+  else
+  {
+    if (dq2 < 0.0)
+    {
+      if (dr2 >= 0.0)
+        return check_min_max(p1, r1, q1, q2, r2, p2);
+      else
+        return check_min_max(p1, q1, r1, p2, q2, r2);
+    }
+    else if (dq2 > 0.0)
+    {
+      if (dr2 > 0.0)
+        return check_min_max(p1, r1, q1, p2, q2, r2);
+      else
+        return check_min_max(p1, q1, r1, q2, r2, p2);
+    }
+    else
+    {
+      if (dr2 > 0.0)
+        return check_min_max(p1, q1, r1, r2, p2, q2);
+      else if (dr2 < 0.0)
+        return check_min_max(p1, r1, q1, r2, p2, q2);
+      else
+        return query_intersect_coplanar_tri_tri(t1, t2);
+    }
+  }
+}
+
+/// Utility method for query_intersect_tri_tri(): determines whether two coplanar triangles intersect
+/**
+ * The triangles are projected onto the coordinate plane in which the first
+ * triangle has greatest area (projection is exact) and tested for separation
+ * along the edge normals of both triangles, using exact orientation tests.
+ * Degenerate triangles are handled by the separating axis test.
+ */
+bool CompGeom::query_intersect_coplanar_tri_tri(const Triangle& t1, const Triangle& t2)
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+
+  // determine the projection plane using the normal of the first triangle
+  Vector3 N = Vector3::cross(t1.b - t1.a, t1.c - t1.a);
+  unsigned i0 = Y, i1 = Z;
+  if (std::fabs(N[Y]) > std::fabs(N[X]) && std::fabs(N[Y]) >= std::fabs(N[Z]))
+  {
+    i0 = Z;
+    i1 = X;
+  }
+  else if (std::fabs(N[Z]) > std::fabs(N[X]) && std::fabs(N[Z]) > std::fabs(N[Y]))
+  {
+    i0 = X;
+    i1 = Y;
+  }
+
+  // project the triangles
+  Vector2 u[3] = { Vector2(t1.a[i0], t1.a[i1]), Vector2(t1.b[i0], t1.b[i1]), Vector2(t1.c[i0], t1.c[i1]) };
+  Vector2 v[3] = { Vector2(t2.a[i0], t2.a[i1]), Vector2(t2.b[i0], t2.b[i1]), Vector2(t2.c[i0], t2.c[i1]) };
+
+  // orient the projected triangles counterclockwise; degenerate triangles
+  // (those whose projections have zero area) are handled by the separating
+  // axis test
+  Real o1 = orient_2D(u[0], u[1], u[2]);
+  Real o2 = orient_2D(v[0], v[1], v[2]);
+  if (o1 == 0.0 || o2 == 0.0)
+    return query_intersect_tri_tri_sep_axes(t1, t2);
+  if (o1 < 0.0)
+    std::swap(u[1], u[2]);
+  if (o2 < 0.0)
+    std::swap(v[1], v[2]);
+
+  // look for an edge of either triangle that separates the triangles
+  for (unsigned i=0; i< 3; i++)
+  {
+    const unsigned j = (i < 2) ? i+1 : 0;
+    if (orient_2D(u[i], u[j], v[0]) < 0.0 && orient_2D(u[i], u[j], v[1]) < 0.0 && orient_2D(u[i], u[j], v[2]) < 0.0)
+      return false;
+    if (orient_2D(v[i], v[j], u[0]) < 0.0 && orient_2D(v[i], v[j], u[1]) < 0.0 && orient_2D(v[i], v[j], u[2]) < 0.0)
+      return false;
+  }
+
+  return true;
+}
+
+/**
+ * Determines whether two (closed) triangles intersect.
+ * \return <b>true</b> if the triangles intersect
+ * \note adapted from [Guigue and Devillers, 2003]; the test uses only the
+ *       exact orientation predicates (orient_3D() and orient_2D()), so its
+ *       result is exact for the given (floating point) vertices
+ */
+bool CompGeom::query_intersect_tri_tri(const Triangle& t1, const Triangle& t2)
+{
+  const Vector3& p1 = t1.a;
+  const Vector3& q1 = t1.b;
+  const Vector3& r1 = t1.c;
+  const Vector3& p2 = t2.a;
+  const Vector3& q2 = t2.b;
+  const Vector3& r2 = t2.c;
+
+  // compute the orientations of the first triangle's vertices with respect 
+  // to the plane of the second triangle
+  Real d1[3];
+  calc_plane_orientations(t2, t1, d1);
+  Real dp1 = d1[0], dq1 = d1[1], dr1 = d1[2];
+  if ((dp1 > 0.0 && dq1 > 0.0 && dr1 > 0.0) || (dp1 < 0.0 && dq1 < 0.0 && dr1 < 0.0))
+    return false;
+
+  // compute the orientations of the second triangle's vertices with respect 
+  // to the plane of the first triangle
+  Real d2[3];
+  calc_plane_orientations(t1, t2, d2);
+  Real dp2 = d2[0], dq2 = d2[1], dr2 = d2[2];
+  if ((dp2 > 0.0 && dq2 > 0.0 && dr2 > 0.0) || (dp2 < 0.0 && dq2 < 0.0 && dr2 < 0.0))
+    return false;
+
+  // permute the vertices of the first triangle such that p1 lies alone on 
+  // one side of the plane of the second triangle
+  if (dp1 > 0.0)
+  {
+    if (dq1 > 0.0)
+      return query_intersect_tri_tri(r1, p1, q1, p2, r2, q2, dp2, dr2, dq2, t1, t2);
+    else if (dr1 > 0.0)
+      return query_intersect_tri_tri(q1, r1, p1, p2, r2, q2, dp2, dr2, dq2, t1, t2);
+    else
+      return query_intersect_tri_tri(p1, q1, r1, p2, q2, r2, dp2, dq2, dr2, t1, t2);
+  }
+  else if (dp1 < 0.0)
+  {
+    if (dq1 < 0.0)
+      return query_intersect_tri_tri(r1, p1, q1, p2, q2, r2, dp2, dq2, dr2, t1, t2);
+    else if (dr1 < 0.0)
+      return query_intersect_tri_tri(q1, r1, p1, p2, q2, r2, dp2, dq2, dr2, t1, t2);
+    else
+      return query_intersect_tri_tri(p1, q1, r1, p2, r2, q2, dp2, dr2, dq2, t1, t2);
+  }
+  else
+  {
+    if (dq1 < 0.0)
+    {
+      if (dr1 >= 0.0)
+        return query_intersect_tri_tri(q1, r1, p1, p2, r2, q2, dp2, dr2, dq2, t1, t2);
+      else
+        return query_intersect_tri_tri(p1, q1, r1, p2, q2, r2, dp2, dq2, dr2, t1, t2);
+    }
+    else if (dq1 > 0.0)
+    {
+      if (dr1 > 0.0)
+        return query_intersect_tri_tri(p1, q1, r1, p2, r2, q2, dp2, dr2, dq2, t1, t2);
+      else
+        return query_intersect_tri_tri(q1, r1, p1, p2, q2, r2, dp2, dq2, dr2, t1, t2);
+    }
+    else
+    {
+      if (dr1 > 0.0)
+        return query_intersect_tri_tri(r1, p1, q1, p2, q2, r2, dp2, dq2, dr2, t1, t2);
+      else if (dr1 < 0.0)
+        return query_intersect_tri_tri(r1, p1, q1, p2, r2, q2, dp2, dr2, dq2, t1, t2);
+      else
+        return query_intersect_coplanar_tri_tri(t1, t2);
+    }
+  }
+}
+
+/**
+ * Determines whether two triangles intersect using separating axes.
  * \return <b>true</b> if the triangles intersect
- * \note adapted from www.geometrictools.com 
+ * \note adapted from www.geometrictools.com; used by query_intersect_tri_tri()
+ *       for degenerate triangles
  */
-bool CompGeom::query_intersect_tri_tri(const Triangle& t0, const Triangle& t1)
+bool CompGeom::query_intersect_tri_tri_sep_axes(const Triangle& t0, const Triangle& t1)
 {
   // get edge vectors for triangle0
   Vector3 akE0[3] =
@@ -29,6 +29,10 @@ DeformableBody::DeformableBody()
 {
   // ensure that config updates are enabled
   _config_updates_enabled = true;
+
+  // rebuild the bounding volume hierarchy once it has doubled in volume
+  _bv_rebuild_threshold = (Real) 2.0;
+  _hroot_volume = (Real) 0.0;
 }
 
 /// Disables configuration updates
@@ -663,8 +667,19 @@ void DeformableBody::update_geometries()
   // update the collision geometry
   _cgeom_primitive->set_mesh(shared_ptr<IndexedTriArray>(new IndexedTriArray(vertices.begin(), vertices.end(), facets.begin(), facets.end())));
 
-  // rebuild the AABB hierarchy
-  _hroot = build_AABB_tree(_aabb_tetra_map);
+  // refit the AABB hierarchy to the moved nodes; rebuild it only if the
+  // boxes have grown too much (the tetrahedra are no longer well separated)
+  if (!_hroot)
+    _hroot = build_AABB_tree(_aabb_tetra_map);
+  else
+  {
+    Real volume = refit_AABB_tree();
+    if (volume > _hroot_volume * _bv_rebuild_threshold)
+    {
+      FILE_LOG(LOG_BV) << "DeformableBody::update_geometries() - AABB hierarchy volume grew from " << _hroot_volume << " to " << volume << "; rebuilding" << endl;
+      _hroot = build_AABB_tree(_aabb_tetra_map);
+    }
+  }
 }
 
 /// Calculates the velocity of a point on the deformable body
@@ -741,6 +756,11 @@ void DeformableBody::load_from_xml(XMLTreeConstPtr node, map<string, BasePtr>& i
   // don't verify the node name -- this class has derived classes
   // ***********************************************************************
 
+  // read the bounding volume hierarchy rebuild threshold, if specified
+  const XMLAttrib* bv_rebuild_attr = node->get_attrib("bv-rebuild-threshold");
+  if (bv_rebuild_attr)
+    _bv_rebuild_threshold = bv_rebuild_attr->get_real_value();
+
   // read nodes- note that this must be done before loading the meshes
   list<XMLTreeConstPtr> nodes_nodes = node->find_child_nodes("Node");
   if (!nodes_nodes.empty())
@@ -1004,6 +1024,9 @@ void DeformableBody::save_to_xml(XMLTreePtr node, list<BaseConstPtr>& shared_obj
   // rename the node
   node->name = "DeformableBody";
 
+  // save the bounding volume hierarchy rebuild threshold
+  node->attribs.insert(XMLAttrib("bv-rebuild-threshold", _bv_rebuild_threshold));
+
   // save the meshes
   if (_tri_mesh)
   {
@@ -1200,8 +1223,10 @@ AABBPtr DeformableBody::build_AABB_tree(map<BVPtr, list<unsigned> >& aabb_tetra_
     aabb->minp -= eps;
     aabb->maxp += eps;
     if (!aabb->is_leaf())
+    {
       BOOST_FOREACH(BVPtr child, aabb->children)
         Q.push(dynamic_pointer_cast<AABB>(child));
+    }
   }
 
   // wipe out userdata 
@@ -1214,8 +1239,10 @@ AABBPtr DeformableBody::build_AABB_tree(map<BVPtr, list<unsigned> >& aabb_tetra_
 
     // add all children to the queue
     if (!aabb->is_leaf())
+    {
       BOOST_FOREACH(BVPtr child, aabb->children)
         Q.push(dynamic_pointer_cast<AABB>(child));
+    }
 
     // wipe out userdata
     aabb->userdata = shared_ptr<void>();
@@ -1231,11 +1258,130 @@ AABBPtr DeformableBody::build_AABB_tree(map<BVPtr, list<unsigned> >& aabb_tetra_
       FILE_LOG(LOG_BV) << oss.str() << endl;
     } 
 
+  // compute the total volume of the hierarchy (for determining when to
+  // rebuild)
+  _hroot_volume = (Real) 0.0;
+  Q.push(root);
+  while (!Q.empty())
+  {
+    AABBPtr aabb = Q.front();
+    Q.pop();
+    _hroot_volume += aabb->calc_volume();
+    if (!aabb->is_leaf())
+    {
+      BOOST_FOREACH(BVPtr child, aabb->children)
+        Q.push(dynamic_pointer_cast<AABB>(child));
+    }
+  }
+
   FILE_LOG(LOG_BV) << "DeformableBody::build_AABB_tree() exited" << endl;
 
   return root;
 }
 
+/// Refits the AABB hierarchy to the current positions of the nodes
+/**
+ * Leaf boxes are recomputed from the tetrahedra they contain and internal
+ * boxes from their children, level by level from the bottom of the tree; the
+ * boxes of each level are refit in parallel.  The hierarchy itself (and the
+ * mapping from leafs to tetrahedra) is unchanged.
+ * \return the total volume of the boxes in the refit hierarchy
+ */
+Real DeformableBody::refit_AABB_tree()
+{
+  const unsigned THREE_D = 3;
+  const Real EXP = 0.1;          // box expansion constant (as in build_AABB_tree())
+  Vector3 eps(EXP, EXP, EXP);
+
+  FILE_LOG(LOG_BV) << "DeformableBody::refit_AABB_tree() entered" << endl;
+
+  // get the levels of the tree
+  vector<vector<BVPtr> > levels(1, vector<BVPtr>(1, _hroot));
+  while (true)
+  {
+    vector<BVPtr> next;
+    BOOST_FOREACH(BVPtr bv, levels.back())
+      next.insert(next.end(), bv->children.begin(), bv->children.end());
+    if (next.empty())
+      break;
+    levels.push_back(next);
+  }
+
+  // refit from the bottom level up; children are always refit before parents
+  for (unsigned level = levels.size(); level-- > 0; )
+  {
+    const vector<BVPtr>& bvs = levels[level];
+
+    #pragma omp parallel for
+    for (int i=0; i< (int) bvs.size(); i++)
+    {
+      AABB* aabb = (AABB*) bvs[i].get();
+      if (aabb->is_leaf())
+      {
+        // get the tetrahedra in the leaf
+        map<BVPtr, list<unsigned> >::const_iterator map_iter = _aabb_tetra_map.find(bvs[i]);
+        assert(map_iter != _aabb_tetra_map.end());
+        const list<unsigned>& tetra = map_iter->second;
+        if (tetra.empty())
+          continue;
+
+        // compute the box around the nodes of the tetrahedra
+        aabb->minp = aabb->maxp = _nodes[_tetrahedra[tetra.front()].a]->x;
+        BOOST_FOREACH(unsigned idx, tetra)
+        {
+          const IndexedTetra& t = _tetrahedra[idx];
+          const unsigned v[4] = { t.a, t.b, t.c, t.d };
+          for (unsigned j=0; j< 4; j++)
+          {
+            const Vector3& x = _nodes[v[j]]->x;
+            for (unsigned k=0; k< THREE_D; k++)
+            {
+              if (x[k] < aabb->minp[k])
+                aabb->minp[k] = x[k];
+              else if (x[k] > aabb->maxp[k])
+                aabb->maxp[k] = x[k];
+            }
+          }
+        }
+
+        // expand the box
+        aabb->minp -= eps;
+        aabb->maxp += eps;
+      }
+      else
+      {
+        // compute the box around the children
+        list<BVPtr>::const_iterator j = aabb->children.begin();
+        const AABB* child = (const AABB*) j->get();
+        aabb->minp = child->minp;
+        aabb->maxp = child->maxp;
+        for (j++; j != aabb->children.end(); j++)
+        {
+          child = (const AABB*) j->get();
+          for (unsigned k=0; k< THREE_D; k++)
+          {
+            if (child->minp[k] < aabb->minp[k])
+              aabb->minp[k] = child->minp[k];
+            if (child->maxp[k] > aabb->maxp[k])
+              aabb->maxp[k] = child->maxp[k];
+          }
+        }
+      }
+    }
+  }
+
+  // compute the total volume of the hierarchy
+  Real volume = (Real) 0.0;
+  for (unsigned i=0; i< levels.size(); i++)
+    BOOST_FOREACH(BVPtr bv, levels[i])
+      volume += bv->calc_volume();
+
+  FILE_LOG(LOG_BV) << "  total volume of refit hierarchy: " << volume << " (" << _hroot_volume << " when built)" << endl;
+  FILE_LOG(LOG_BV) << "DeformableBody::refit_AABB_tree() exited" << endl;
+
+  return volume;
+}
+
 /// Splits a collection of tetrahedra along a splitting plane into 2 new meshes 
 void DeformableBody::split_tetra(const Vector3& point, unsigned axis, const list<unsigned>& otetra, list<unsigned>& ptetra, list<unsigned>& ntetra) 
 {
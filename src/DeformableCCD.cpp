@@ -4,6 +4,7 @@
  * License (found in COPYING).
  ****************************************************************************/
 
+#include <stdint.h>
 #include <fstream>
 #include <set>
 #include <cmath>
@@ -56,6 +57,7 @@ DeformableCCD::DeformableCCD()
   pthread_mutex_init(&_ve_BVs_mutex, NULL);
   _rebuild_bounds_vecs = true;
   return_all_contacts = true;
+  self_collisions = false;
 }
 
 void DeformableCCD::add_collision_geometry(CollisionGeometryPtr cg)
@@ -217,6 +219,26 @@ bool DeformableCCD::is_contact(Real dt, const vector<pair<DynamicBodyPtr, Vector
     check_geoms(dt, a, b, aTb, bTa, a_vel, b_vel, contacts);
   } 
 
+  // check geometries of deformable bodies for self-collision
+  if (self_collisions)
+  {
+    BOOST_FOREACH(CollisionGeometryPtr cg, _geoms)
+    {
+      // only deformable bodies can self-collide
+      SingleBodyPtr sb = cg->get_single_body();
+      if (!dynamic_pointer_cast<DeformableBody>(sb))
+        continue;
+
+      // get the velocity for the body
+      map<SingleBodyPtr, pair<Vector3, Vector3> >::const_iterator vel_iter = vels.find(sb);
+      if (vel_iter == vels.end())
+        continue;
+
+      // test the geometry against itself
+      check_geoms(dt, cg, cg, IDENTITY_4x4, IDENTITY_4x4, vel_iter->second, vel_iter->second, contacts);
+    }
+  }
+
   FILE_LOG(LOG_COLDET) << "contacts:" << endl;
   if (contacts.empty())
     FILE_LOG(LOG_COLDET) << " -- no contacts in narrow phase" << endl;
@@ -254,6 +276,7 @@ void DeformableCCD::check_geoms(Real dt, CollisionGeometryPtr a, CollisionGeomet
   // init statistics for geometry pair
   unsigned n_bv_tests = 0;
   unsigned n_verts_tested = 0;
+  unsigned n_self_culled = 0;
 
   // set the earliest TOC
   Real earliest = (Real) 1.0; 
@@ -275,6 +298,23 @@ void DeformableCCD::check_geoms(Real dt, CollisionGeometryPtr a, CollisionGeomet
   BVPtr bv_a = aprimitive->get_BVH_root();
   BVPtr bv_b = bprimitive->get_BVH_root(); 
 
+  // if a deformable body is being checked against itself, compute normal 
+  // cones for culling the parts of the body that cannot self-intersect 
+  // NOTE: geometries of different bodies may share BVs, so BVs are only
+  // compared to determine self-checks when a == b 
+  const bool SELF_CHECK = (a == b);
+  map<BVPtr, NormalCone> cones;
+  Real max_mvmt = (Real) 0.0;
+  if (SELF_CHECK)
+  {
+    DeformableBodyPtr db = dynamic_pointer_cast<DeformableBody>(a->get_single_body());
+    if (db)
+    {
+      max_mvmt = get_max_speed(db, dt) * dt;
+      calc_normal_cones(a, bv_a, max_mvmt, cones);
+    }
+  }
+
   // add the two top-level BVs to the queue for processing
   queue<BVProcess> q;
   q.push(BVProcess());
@@ -302,13 +342,27 @@ void DeformableCCD::check_geoms(Real dt, CollisionGeometryPtr a, CollisionGeomet
     // if the velocity-expanded BVs do not intersect, continue looping
     // NOTE: we test whether the two BVs are equal first to preclude checking
     // the same BVs for intersection
-    if (ax != bx && !BV::intersects(bva, bvb, aTb))
+    if (!(SELF_CHECK && ax == bx) && !BV::intersects(bva, bvb, aTb))
     {
       FILE_LOG(LOG_COLDET) << " -- bounding volumes do not intersect" << endl;
       q.pop();
       continue;
     }
 
+    // if a BV is being checked against itself, see whether the surface 
+    // within the BV can self-intersect at all; if not, skip the entire subtree
+    if (SELF_CHECK && ax == bx)
+    {
+      map<BVPtr, NormalCone>::const_iterator cone_iter = cones.find(ax);
+      if (cone_iter != cones.end() && is_self_collision_free(a, ax, cone_iter->second, max_mvmt))
+      {
+        FILE_LOG(LOG_COLDET) << " -- surface in bounding volume cannot self-intersect" << endl;
+        n_self_culled++;
+        q.pop();
+        continue;
+      }
+    }
+
     // calculate the volume for the OBBs
     Real ax_vol = ax->calc_volume();
     Real bx_vol = bx->calc_volume();
@@ -317,7 +371,7 @@ void DeformableCCD::check_geoms(Real dt, CollisionGeometryPtr a, CollisionGeomet
     // depth has been reached, intersect
     // the vertices of triangles in one BV against the triangles of the other
     // (and vice versa)
-    if (ax == bx && ax->is_leaf())
+    if (SELF_CHECK && ax == bx && ax->is_leaf())
     {
       // we've encountered a leaf bounding volume for a deformable body being
       // checked for self-collision
@@ -451,6 +505,10 @@ void DeformableCCD::check_geoms(Real dt, CollisionGeometryPtr a, CollisionGeomet
 
     // output number of vertices tested 
     FILE_LOG(LOG_COLDET) << "  number of vertices tested: " << n_verts_tested << std::endl;
+
+    // output number of subtrees culled from self-collision checking
+    if (SELF_CHECK)
+      FILE_LOG(LOG_COLDET) << "  number of BV subtrees culled for self-collision: " << n_self_culled << std::endl;
   }
   FILE_LOG(LOG_COLDET) << "DeformableCCD::check_geoms() exited" << endl;
 }
@@ -543,6 +601,242 @@ void DeformableCCD::check_vertices(Real dt, CollisionGeometryPtr a, CollisionGeo
   }
 } 
 
+/// Merges two normal cones into the smallest cone containing both
+DeformableCCD::NormalCone DeformableCCD::merge_cones(const NormalCone& c1, const NormalCone& c2)
+{
+  const Real HALF_PI = M_PI * (Real) 0.5;
+
+  // if either cone is unbounded, so is the merged cone
+  if (c1.angle >= HALF_PI)
+    return c1;
+  if (c2.angle >= HALF_PI)
+    return c2;
+
+  // get the angle between the two axes
+  Real theta = std::acos(std::max((Real) -1.0, std::min((Real) 1.0, c1.axis.dot(c2.axis))));
+
+  // see whether one cone contains the other
+  if (theta + c2.angle <= c1.angle)
+    return c1;
+  if (theta + c1.angle <= c2.angle)
+    return c2;
+
+  // determine the angle of the merged cone
+  NormalCone c;
+  c.axis = c1.axis;
+  c.angle = (theta + c1.angle + c2.angle) * (Real) 0.5;
+  if (c.angle >= HALF_PI)
+  {
+    c.angle = M_PI;
+    return c;
+  }
+
+  // rotate the axis of the first cone toward that of the second
+  Vector3 u = c2.axis - c1.axis*std::cos(theta);
+  Real ulen = u.norm();
+  if (ulen < NEAR_ZERO)
+  {
+    c.angle = std::max(c1.angle, c2.angle) + theta;
+    return c;
+  }
+  Real phi = c.angle - c1.angle;
+  c.axis = c1.axis*std::cos(phi) + u*(std::sin(phi)/ulen);
+  c.axis.normalize();
+
+  return c;
+}
+
+/// Computes the normal cones for all BVs of a deformable geometry
+/**
+ * Each cone bounds the normals of the triangles covered by the BV over the
+ * entire time step, given that no vertex moves more than max_mvmt.
+ */
+void DeformableCCD::calc_normal_cones(CollisionGeometryPtr cg, BVPtr root, Real max_mvmt, map<BVPtr, NormalCone>& cones)
+{
+  // get the mesh for the geometry
+  PrimitivePtr primitive = cg->get_geometry();
+  const IndexedTriArray& mesh = *primitive->get_mesh();
+  const vector<IndexedTri>& facets = mesh.get_facets();
+  const vector<Vector3>& verts = mesh.get_vertices();
+
+  // get all BVs; reverse breadth-first order processes children before parents
+  vector<BVPtr> bvs;
+  root->get_all_BVs(std::back_inserter(bvs));
+  for (vector<BVPtr>::const_reverse_iterator i = bvs.rbegin(); i != bvs.rend(); i++)
+  {
+    BVPtr bv = *i;
+    NormalCone& cone = cones[bv];
+    cone.axis = Vector3(0,0,1);
+    cone.angle = M_PI;
+
+    // internal nodes merge the cones of their children
+    if (!bv->is_leaf())
+    {
+      list<BVPtr>::const_iterator j = bv->children.begin();
+      cone = cones[*j];
+      for (j++; j != bv->children.end(); j++)
+        cone = merge_cones(cone, cones[*j]);
+      continue;
+    }
+
+    // leafs bound the normals of their triangles 
+    list<unsigned> tris = primitive->get_sub_mesh(bv).second;
+    bool first = true;
+    BOOST_FOREACH(unsigned idx, tris)
+    {
+      // get the (unnormalized) normal of the triangle
+      const IndexedTri& f = facets[idx];
+      Vector3 e1 = verts[f.b] - verts[f.a];
+      Vector3 e2 = verts[f.c] - verts[f.a];
+      Vector3 n = Vector3::cross(e1, e2);
+      Real nlen = n.norm();
+
+      // bound the change in the normal when each vertex moves by max_mvmt
+      // (each edge then changes by at most 2*max_mvmt)
+      Real dev = (Real) 2.0*max_mvmt*(e1.norm() + e2.norm()) + (Real) 4.0*max_mvmt*max_mvmt;
+      NormalCone tcone;
+      tcone.axis = Vector3(0,0,1);
+      tcone.angle = M_PI;
+      if (nlen > NEAR_ZERO && dev < nlen)
+      {
+        tcone.axis = n/nlen;
+        tcone.angle = std::asin(dev/nlen);
+      }
+
+      // merge the cone
+      cone = (first) ? tcone : merge_cones(cone, tcone);
+      first = false;
+    }
+  }
+}
+
+/// Computes the distance between two 2D line segments
+Real DeformableCCD::calc_dist_2D(const LineSeg2& s1, const LineSeg2& s2)
+{
+  Vector2 isect, isect2;
+
+  // if the segments intersect, the distance is zero
+  if (CompGeom::intersect_segs(s1, s2, isect, isect2) != CompGeom::eSegSegNoIntersect)
+    return (Real) 0.0;
+
+  // otherwise, the closest points include an endpoint of one segment
+  const Vector2* p[4] = { &s1.first, &s1.second, &s2.first, &s2.second };
+  const LineSeg2* s[4] = { &s2, &s2, &s1, &s1 };
+  Real min_dist = std::numeric_limits<Real>::max();
+  for (unsigned i=0; i< 4; i++)
+  {
+    Vector2 d = s[i]->second - s[i]->first;
+    Real dlen_sq = d.norm_sq();
+    Real t = (dlen_sq > (Real) 0.0) ? (*p[i] - s[i]->first).dot(d)/dlen_sq : (Real) 0.0;
+    t = std::max((Real) 0.0, std::min((Real) 1.0, t));
+    min_dist = std::min(min_dist, (s[i]->first + d*t - *p[i]).norm());
+  }
+
+  return min_dist;
+}
+
+/// Determines whether the surface covered by a BV cannot self-intersect over the time step
+/**
+ * Uses the criterion of Volino and Magnenat-Thalmann: a connected surface 
+ * patch cannot self-intersect if there is a direction along which all of its
+ * normals are positive (i.e., its normal cone has a half-angle less than 
+ * pi/2) and the projection of its contour onto the plane orthogonal to that 
+ * direction does not self-intersect.  The contour test is made conservative
+ * by requiring non-adjacent contour segments to remain further apart than 
+ * the vertices can move.
+ * \param cg the geometry
+ * \param bv a BV in the geometry's hierarchy
+ * \param cone the normal cone for the BV, computed by calc_normal_cones()
+ * \param max_mvmt the maximum distance any vertex moves over the step
+ */
+bool DeformableCCD::is_self_collision_free(CollisionGeometryPtr cg, BVPtr bv, const NormalCone& cone, Real max_mvmt)
+{
+  const Real HALF_PI = M_PI * (Real) 0.5;
+
+  // the normal cone must be bounded
+  if (cone.angle >= HALF_PI)
+    return false;
+
+  // get the triangles covered by the BV
+  PrimitivePtr primitive = cg->get_geometry();
+  const pair<shared_ptr<const IndexedTriArray>, list<unsigned> >& mdata = primitive->get_sub_mesh(bv);
+  const vector<IndexedTri>& facets = mdata.first->get_facets();
+  const vector<Vector3>& verts = mdata.first->get_vertices();
+
+  // get the directed edges of the triangles, keyed by undirected edge 
+  vector<pair<uint64_t, pair<unsigned, unsigned> > > edges;
+  BOOST_FOREACH(unsigned idx, mdata.second)
+  {
+    const unsigned v[4] = { facets[idx].a, facets[idx].b, facets[idx].c, facets[idx].a };
+    for (unsigned j=0; j< 3; j++)
+    {
+      uint64_t hi = std::max(v[j], v[j+1]), lo = std::min(v[j], v[j+1]);
+      edges.push_back(make_pair((hi << 32) | lo, make_pair(v[j], v[j+1])));
+    }
+  }
+  std::sort(edges.begin(), edges.end());
+
+  // the contour consists of the edges used by only one triangle
+  vector<pair<unsigned, unsigned> > contour;
+  for (unsigned i=0, j=0; i< edges.size(); i = j)
+  {
+    for (j=i+1; j< edges.size() && edges[j].first == edges[i].first; j++) ;
+    if (j - i == 1)
+      contour.push_back(edges[i].second);
+    else if (j - i > 2)
+      return false;   // non-manifold
+  }
+
+  // a closed surface does not have a contour (and cannot have a bounded
+  // normal cone)
+  if (contour.empty())
+    return false;
+
+  // the contour must be a single loop; sort the edges by the first vertex
+  std::sort(contour.begin(), contour.end());
+  for (unsigned i=1; i< contour.size(); i++)
+    if (contour[i].first == contour[i-1].first)
+      return false;
+  unsigned nvisited = 0;
+  unsigned v = contour.front().first;
+  do
+  {
+    vector<pair<unsigned, unsigned> >::const_iterator next = std::lower_bound(contour.begin(), contour.end(), make_pair(v, 0U));
+    if (next == contour.end() || next->first != v)
+      return false;
+    v = next->second;
+    nvisited++;
+  }
+  while (v != contour.front().first && nvisited <= contour.size());
+  if (nvisited != contour.size())
+    return false;
+
+  // project the contour onto the plane orthogonal to the cone axis
+  Matrix3 R = CompGeom::calc_3D_to_2D_matrix(cone.axis);
+  vector<LineSeg2> segs(contour.size());
+  for (unsigned i=0; i< contour.size(); i++)
+  {
+    segs[i].first = CompGeom::to_2D(verts[contour[i].first], R);
+    segs[i].second = CompGeom::to_2D(verts[contour[i].second], R);
+  }
+
+  // non-adjacent segments of the projected contour must not intersect (or 
+  // come close enough to intersect during the time step)
+  const Real MIN_DIST = max_mvmt * (Real) 2.0 + NEAR_ZERO;
+  for (unsigned i=0; i< contour.size(); i++)
+    for (unsigned j=i+1; j< contour.size(); j++)
+    {
+      // skip adjacent segments
+      if (contour[i].first == contour[j].second || contour[i].second == contour[j].first)
+        continue;
+
+      if (calc_dist_2D(segs[i], segs[j]) < MIN_DIST)
+        return false;
+    }
+
+  return true;
+}
+
 /// Gets the velocity-expanded BV for a BV
 BVPtr DeformableCCD::get_vel_exp_BV(CollisionGeometryPtr cg, BVPtr bv, const Vector3& lv, const Vector3& av)
 {
@@ -620,6 +914,11 @@ void DeformableCCD::load_from_xml(XMLTreeConstPtr node, map<std::string, BasePtr
   const XMLAttrib* eps_attr = node->get_attrib("eps-tolerance");
   if (eps_attr)
     this->eps_tolerance = eps_attr->get_real_value();
+
+  // determine whether to check for self-collisions, if specified
+  const XMLAttrib* self_attr = node->get_attrib("self-collisions");
+  if (self_attr)
+    this->self_collisions = self_attr->get_bool_value();
 }
 
 /// Implements Base::save_to_xml()
@@ -637,6 +936,9 @@ void DeformableCCD::save_to_xml(XMLTreePtr node, list<BaseConstPtr>& shared_obje
 
   // save the eps tolerance
   node->attribs.insert(XMLAttrib("eps-tolerance", eps_tolerance));
+
+  // save whether to check for self-collisions
+  node->attribs.insert(XMLAttrib("self-collisions", self_collisions));
 }
 
 /****************************************************************************
@@ -1540,57 +1842,32 @@ void DeformableCCD::build_bv_vector(const map<SingleBodyPtr, pair<Vector3, Vecto
  */
 bool DeformableCCD::is_collision(Real epsilon)
 {
-  // clear the set of colliding pairs and list of colliding triangles
-  colliding_pairs.clear();
-  colliding_tris.clear();
-
-  // iterate over geometries 
-  for (std::set<CollisionGeometryPtr>::const_iterator i = _geoms.begin(); i != _geoms.end(); i++)
-  {
-    // get the first geometry and its primitive 
-    CollisionGeometryPtr g1 = *i;
-    PrimitivePtr g1_primitive = g1->get_geometry();
-
-    // get the transform and the inverse transform for this geometry
-    const Matrix4& wTg1 = g1->get_transform();
-    Matrix4 g1Tw = Matrix4::inverse_transform(wTg1);
-
-    // loop through all other geometries
-    std::set<CollisionGeometryPtr>::const_iterator j = i;
-    j++;
-    for (; j != _geoms.end(); j++)
-    {
-      // get the second geometry and its primitive 
-      CollisionGeometryPtr g2 = *j;
-      PrimitivePtr g2_primitive = g2->get_geometry();
-
-      // see whether to check
-      if (!is_checked(g1, g2))
-        continue; 
-
-      // get the two BV trees
-      BVPtr bv1 = g1_primitive->get_BVH_root();
-      BVPtr bv2 = g2_primitive->get_BVH_root();
+  return check_pairs(&DeformableCCD::check_pair, this);
+}
 
-      // get the transform for g2 and its inverse
-      const Matrix4& wTg2 = g2->get_transform(); 
+/// Checks a single pair of geometries for intersection (called by CollisionDetection::check_pairs())
+bool DeformableCCD::check_pair(void* data, CollisionGeometryPtr g1, CollisionGeometryPtr g2, const Matrix4& g1Tg2, list<CollidingTriPair>& tris)
+{
+  DeformableCCD* ccd = (DeformableCCD*) data;
 
-      // if intersects, add to colliding pairs
-      if (intersect_BV_trees(bv1, bv2, g1Tw * wTg2, g1, g2))
-        colliding_pairs.insert(make_sorted_pair(g1, g2));
-    } 
-  }
+  // get the two BV trees
+  BVPtr bv1 = g1->get_geometry()->get_BVH_root();
+  BVPtr bv2 = g2->get_geometry()->get_BVH_root();
 
-  return !colliding_pairs.empty();
+  // check for intersection
+  return ccd->intersect_BV_trees(bv1, bv2, g1Tg2, g1, g2, tris);
 }
 
 /// Intersects two BV trees; returns <b>true</b> if one (or more) pair of the underlying triangles intersects
-bool DeformableCCD::intersect_BV_trees(BVPtr a, BVPtr b, const Matrix4& aTb, CollisionGeometryPtr geom_a, CollisionGeometryPtr geom_b) 
+/**
+ * Intersecting pairs of triangles are appended to tris.
+ */
+bool DeformableCCD::intersect_BV_trees(BVPtr a, BVPtr b, const Matrix4& aTb, CollisionGeometryPtr geom_a, CollisionGeometryPtr geom_b, list<CollidingTriPair>& tris) 
 {
   std::queue<tuple<BVPtr, BVPtr, bool> > q;
 
   // get address of the last colliding triangle pair on the queue
-  CollidingTriPair* last = (colliding_tris.empty()) ? NULL : &colliding_tris.back();
+  CollidingTriPair* last = (tris.empty()) ? NULL : &tris.back();
 
   FILE_LOG(LOG_COLDET) << "DeformableCCD::intersect_BV_trees() entered" << endl;
 
@@ -1621,12 +1898,12 @@ bool DeformableCCD::intersect_BV_trees(BVPtr a, BVPtr b, const Matrix4& aTb, Col
     if (bv1->is_leaf() && bv2->is_leaf())
     {
       if (!rev)
-        intersect_BV_leafs(bv1, bv2, aTb, geom_a, geom_b, std::back_inserter(colliding_tris));
+        intersect_BV_leafs(bv1, bv2, aTb, geom_a, geom_b, std::back_inserter(tris));
       else
-        intersect_BV_leafs(bv2, bv1, aTb, geom_a, geom_b, std::back_inserter(colliding_tris));
+        intersect_BV_leafs(bv2, bv1, aTb, geom_a, geom_b, std::back_inserter(tris));
 
       // see whether we want to exit early
-      if (mode == eFirstContact && !colliding_tris.empty() && last != &colliding_tris.back())
+      if (mode == eFirstContact && !tris.empty() && last != &tris.back())
         return true;
     }
 
@@ -1647,7 +1924,7 @@ bool DeformableCCD::intersect_BV_trees(BVPtr a, BVPtr b, const Matrix4& aTb, Col
   }
 
   // see whether we have an intersection
-  if (!colliding_tris.empty() && last != &colliding_tris.back())
+  if (!tris.empty() && last != &tris.back())
     return true;
 
   FILE_LOG(LOG_COLDET) << "  -- all intersection checks passed; no intersection" << endl;
@@ -42,6 +42,9 @@ EventDrivenSimulator::EventDrivenSimulator()
   post_mini_step_callback_fn = NULL;
   _simulation_violated = false;
   render_contact_points = false;
+  validation_interval = 1;
+  incremental_validation = true;
+  _validation_counter = 0;
 }
 
 /// Gets the contact data between a pair of geometries (if any)
@@ -463,9 +466,7 @@ Real EventDrivenSimulator::step(Real step_size)
     // update the coordinates using the new velocities
     for (unsigned i=0; i< _q0.size(); i++)
     {
-      _qf[i].copy_from(_qdf[i]);
-      _qf[i] *= dt;
-      _qf[i] += _q0[i];
+      _qf[i] = _q0[i] + _qdf[i]*dt;
     }
   }
 
@@ -498,10 +499,14 @@ Real EventDrivenSimulator::find_and_handle_si_events(Real dt)
   // make sure that dt is non-negative
   assert(dt >= (Real) 0.0);
 
-  // only for debugging purposes: verify that bodies aren't already interpenetrating
+  // only for debugging purposes: verify that bodies aren't already 
+  // interpenetrating (every validation_interval checks)
   #ifndef NDEBUG
-  if (!_simulation_violated)
+  if (!_simulation_violated && validation_interval > 0 && ++_validation_counter >= validation_interval)
+  {
+    _validation_counter = 0;
     check_violation();
+  }
   #endif
 
   // clear events 
@@ -653,9 +658,7 @@ Real EventDrivenSimulator::find_TOI(Real dt)
       // set the coordinates
       for (unsigned i=0; i< _bodies.size(); i++)
       {
-        _qf[i].copy_from(_qdf[i]);
-        _qf[i] *= dt;
-        _qf[i] += _q0[i];
+        _qf[i] = _q0[i] + _qdf[i]*dt;
         _bodies[i]->set_generalized_coordinates(DynamicBody::eRodrigues, _qf[i]);
       }
 
@@ -669,9 +672,7 @@ Real EventDrivenSimulator::find_TOI(Real dt)
     h += tmin;
     for (unsigned i=0; i< _q0.size(); i++)
     {
-      _qf[i].copy_from(_qdf[i]);
-      _qf[i] *= h;
-      _qf[i] += _q0[i];
+      _qf[i] = _q0[i] + _qdf[i]*h;
       _bodies[i]->set_generalized_coordinates(DynamicBody::eRodrigues, _qf[i]);
     }
     FILE_LOG(LOG_SIMULATOR) << "    current time is " << current_time << endl;
@@ -703,8 +704,7 @@ Real EventDrivenSimulator::find_TOI(Real dt)
       // step positions to h
       for (unsigned i=0; i< _q0.size(); i++)
       {
-        _qf[i].copy_from(_qdf[i]);
-        _qf[i] *= h;
+        _qf[i] = _qdf[i]*h;
         _q0[i] += _qf[i];
         _bodies[i]->set_generalized_coordinates(DynamicBody::eRodrigues, _q0[i]);
       }
@@ -727,9 +727,7 @@ Real EventDrivenSimulator::find_TOI(Real dt)
   // set the coordinates and velocities
   for (unsigned i=0; i< _bodies.size(); i++)
   {
-    _qf[i].copy_from(_qdf[i]);
-    _qf[i] *= dt;
-    _qf[i] += _q0[i];
+    _qf[i] = _q0[i] + _qdf[i]*dt;
     _bodies[i]->set_generalized_coordinates(DynamicBody::eRodrigues, _qf[i]);
   }
 
@@ -745,7 +743,8 @@ void EventDrivenSimulator::check_violation()
   BOOST_FOREACH(shared_ptr<CollisionDetection> cd, collision_detectors)
   {
     // do the collision detection routine
-    if (cd->is_collision((Real) 0.0))
+    bool collision = (incremental_validation) ? cd->is_collision_incremental() : cd->is_collision((Real) 0.0);
+    if (collision)
     {
       if (!_simulation_violated)
       {
@@ -798,6 +797,16 @@ void EventDrivenSimulator::load_from_xml(XMLTreeConstPtr node, map<std::string,
   // first, load all data specified to the Simulator object
   Simulator::load_from_xml(node, id_map);
 
+  // get the interpenetration check interval, if specified
+  const XMLAttrib* vint_attrib = node->get_attrib("validation-interval");
+  if (vint_attrib)
+    validation_interval = vint_attrib->get_unsigned_value();
+
+  // see whether interpenetration checks are incremental
+  const XMLAttrib* ival_attrib = node->get_attrib("incremental-validation");
+  if (ival_attrib)
+    incremental_validation = ival_attrib->get_bool_value();
+
   // clear list of collision detectors
   collision_detectors.clear();
 
@@ -880,6 +889,10 @@ void EventDrivenSimulator::save_to_xml(XMLTreePtr node, list<BaseConstPtr>& shar
   // reset the node's name
   node->name = "EventDrivenSimulator";
 
+  // save the interpenetration check settings
+  node->attribs.insert(XMLAttrib("validation-interval", validation_interval));
+  node->attribs.insert(XMLAttrib("incremental-validation", incremental_validation));
+
   // save the IDs of the collision detectors, if any 
   BOOST_FOREACH(shared_ptr<CollisionDetection> c, collision_detectors)
   {
@@ -60,50 +60,49 @@ GeneralizedCCD::GeneralizedCCD()
   _max_dexp = std::numeric_limits<unsigned>::max();
   pthread_mutex_init(&_contact_mutex, NULL);
   pthread_mutex_init(&_ve_BVs_mutex, NULL);
-  _rebuild_bounds_vecs = true;
   return_all_contacts = true;
 }
 
 void GeneralizedCCD::add_collision_geometry(CollisionGeometryPtr cg)
 {
   CollisionDetection::add_collision_geometry(cg);
-  _rebuild_bounds_vecs = true;
+  _sweep_and_prune.reset();
 }
 
 void GeneralizedCCD::add_rigid_body(RigidBodyPtr rb)
 {
   CollisionDetection::add_rigid_body(rb);
-  _rebuild_bounds_vecs = true;
+  _sweep_and_prune.reset();
 }
 
 void GeneralizedCCD::add_articulated_body(ArticulatedBodyPtr abody, bool disable_adjacent)
 {
   CollisionDetection::add_articulated_body(abody, disable_adjacent);
-  _rebuild_bounds_vecs = true;
+  _sweep_and_prune.reset();
 }
 
 void GeneralizedCCD::remove_collision_geometry(CollisionGeometryPtr cg)
 {
   CollisionDetection::remove_collision_geometry(cg);
-  _rebuild_bounds_vecs = true;
+  _sweep_and_prune.reset();
 }
 
 void GeneralizedCCD::remove_all_collision_geometries()
 {
   CollisionDetection::remove_all_collision_geometries();
-  _rebuild_bounds_vecs = true;
+  _sweep_and_prune.reset();
 }
 
 void GeneralizedCCD::remove_rigid_body(RigidBodyPtr rb)
 {
   CollisionDetection::remove_rigid_body(rb);
-  _rebuild_bounds_vecs = true;
+  _sweep_and_prune.reset();
 }
 
 void GeneralizedCCD::remove_articulated_body(ArticulatedBodyPtr abody)
 {
   CollisionDetection::remove_articulated_body(abody);
-  _rebuild_bounds_vecs = true;
+  _sweep_and_prune.reset();
 }
 
 /// Computes the velocities from states
@@ -1243,91 +1242,50 @@ void GeneralizedCCD::broad_phase(const map<SingleBodyPtr, pair<Vector3, Vector3>
   // clear the vector of pairs to check
   to_check.clear();
 
-  // sort the AABBs
-  sort_AABBs(vel_map);
-
-  // store how many overlaps we have for pairs
-  map<sorted_pair<CollisionGeometryPtr>, unsigned> overlaps;
-
-  // set of active bounds
-  set<CollisionGeometryPtr> active_bounds;
-
-  // scan through the x-bounds
-  for (unsigned i=0; i< _x_bounds.size(); i++)
+  // compute the bounds of the velocity-expanded BVs of all enabled geometries
+  vector<CollisionGeometryPtr> geoms;
+  vector<pair<Vector3, Vector3> > bounds;
+  for (set<CollisionGeometryPtr>::const_iterator i = _geoms.begin(); i != _geoms.end(); i++)
   {
-    // eliminate from the active bounds if at the end of a bound
-    if (_x_bounds[i].second.end)
-    {
-      assert(active_bounds.find(_x_bounds[i].second.geom) != active_bounds.end());
-      active_bounds.erase(_x_bounds[i].second.geom);
-    }
-    else
-    {
-      // at the start of a bound
-      BOOST_FOREACH(CollisionGeometryPtr cg, active_bounds)
-        overlaps[make_sorted_pair(cg, _x_bounds[i].second.geom)]++;
+    // if the geometry is disabled, skip the geometry
+    if (this->disabled.find(*i) != this->disabled.end())
+      continue;
 
-      // add the geometry to the active set
-      active_bounds.insert(_x_bounds[i].second.geom);
-    }
-  }
+    // get the rigid body and the top-level BV for the geometry
+    RigidBodyPtr rb = dynamic_pointer_cast<RigidBody>((*i)->get_single_body());
+    BVPtr bv = (*i)->get_geometry()->get_BVH_root();
 
-  // scan through the y-bounds
-  for (unsigned i=0; i< _y_bounds.size(); i++)
-  {
-    // eliminate from the active bounds if at the end of a bound
-    if (_y_bounds[i].second.end)
-    {
-      assert(active_bounds.find(_y_bounds[i].second.geom) != active_bounds.end());
-      active_bounds.erase(_y_bounds[i].second.geom);
-    }
-    else
-    {
-      // at the start of a bound
-      BOOST_FOREACH(CollisionGeometryPtr cg, active_bounds)
-        overlaps[make_sorted_pair(cg, _y_bounds[i].second.geom)]++;
+    // get the velocities for the rigid body
+    assert(vel_map.find(rb) != vel_map.end());
+    const Vector3& xd = vel_map.find(rb)->second.first;
+    const Vector3& omega = vel_map.find(rb)->second.second;
 
-      // add the geometry to the active set
-      active_bounds.insert(_y_bounds[i].second.geom);
-    }
+    // get the expanded bounding volume and its bounds
+    BVPtr bv_exp = get_vel_exp_BV(*i, bv, xd, omega);
+    const Matrix4& T = (*i)->get_transform();
+    geoms.push_back(*i);
+    bounds.push_back(make_pair(bv_exp->get_lower_bounds(T), bv_exp->get_upper_bounds(T)));
+    FILE_LOG(LOG_COLDET) << "  bounds for collision geometry " << *i << " (" << rb->id << "): " << bounds.back().first << " / " << bounds.back().second << std::endl;
   }
 
-  // scan through the z-bounds
-  for (unsigned i=0; i< _z_bounds.size(); i++)
-  {
-    // eliminate from the active bounds if at the end of a bound
-    if (_z_bounds[i].second.end)
-    {
-      assert(active_bounds.find(_z_bounds[i].second.geom) != active_bounds.end());
-      active_bounds.erase(_z_bounds[i].second.geom);
-    }
-    else
-    {
-      // at the start of a bound
-      BOOST_FOREACH(CollisionGeometryPtr cg, active_bounds)
-        overlaps[make_sorted_pair(cg, _z_bounds[i].second.geom)]++;
-
-      // add the geometry to the active set
-      active_bounds.insert(_z_bounds[i].second.geom);
-    }
-  }
+  // find the geometries whose bounds overlap
+  vector<pair<CollisionGeometryPtr, CollisionGeometryPtr> > overlaps;
+  _sweep_and_prune.find_overlaps(geoms, bounds, overlaps);
 
   // now setup pairs to check
-  for (map<sorted_pair<CollisionGeometryPtr>, unsigned>::const_iterator i = overlaps.begin(); i != overlaps.end(); i++)
+  for (unsigned i=0; i< overlaps.size(); i++)
   {
-    FILE_LOG(LOG_COLDET) << i->second << " overlaps between " << i->first.first << " (" << i->first.first->get_single_body()->id << ") and " << i->first.second << " (" << i->first.second->get_single_body()->id << ")" << std::endl;
-
-    // only consider the pair if they overlap in all three dimensions
-    if (i->second < 3)
-      continue;
+    CollisionGeometryPtr g1 = overlaps[i].first;
+    CollisionGeometryPtr g2 = overlaps[i].second;
+    FILE_LOG(LOG_COLDET) << "overlap between " << g1 << " (" << g1->get_single_body()->id << ") and " << g2 << " (" << g2->get_single_body()->id << ")" << std::endl;
 
     // if the pair is disabled, continue looping
-    if (this->disabled_pairs.find(i->first) != this->disabled_pairs.end())
+    if (this->disabled_pairs.find(make_sorted_pair(g1, g2)) != this->disabled_pairs.end())
       continue;
 
     // get the rigid bodies corresponding to the geometries
-    RigidBodyPtr rb1 = dynamic_pointer_cast<RigidBody>(i->first.first->get_single_body());
-    RigidBodyPtr rb2 = dynamic_pointer_cast<RigidBody>(i->first.second->get_single_body());
+    RigidBodyPtr rb1 = dynamic_pointer_cast<RigidBody>(g1->get_single_body());
+    RigidBodyPtr rb2 = dynamic_pointer_cast<RigidBody>(g2->get_single_body());
 
     // don't check pairs from the same rigid body
     if (rb1 == rb2)
@@ -1338,149 +1296,13 @@ void GeneralizedCCD::broad_phase(const map<SingleBodyPtr, pair<Vector3, Vector3>
       continue;
 
     // if we're here, we have a candidate for the narrow phase
-    to_check.push_back(make_pair(i->first.first, i->first.second));
+    to_check.push_back(make_pair(g1, g2));
     FILE_LOG(LOG_COLDET) << "  ... checking pair" << std::endl;
   }
   
   FILE_LOG(LOG_COLDET) << "GeneralizedCCD::broad_phase() exited" << std::endl;
 }
 
-void GeneralizedCCD::sort_AABBs(const map<SingleBodyPtr, pair<Vector3, Vector3> >& vel_map)
-{
-  // if a geometry was added or removed, rebuild the vector of bounds
-  // and copy it to x, y, z dimensions
-  if (_rebuild_bounds_vecs)
-  {
-    build_bv_vector(vel_map, _x_bounds);
-    _y_bounds = _x_bounds;
-    _z_bounds = _x_bounds;
-  }
-
-  // update bounds vectors
-  update_bounds_vector(_x_bounds, vel_map, eXAxis);
-  update_bounds_vector(_y_bounds, vel_map, eYAxis);
-  update_bounds_vector(_z_bounds, vel_map, eZAxis);
-  
-  // if geometry was added or removed, do standard sorts of vectors
-  if (_rebuild_bounds_vecs)
-  {
-    std::sort(_x_bounds.begin(), _x_bounds.end());
-    std::sort(_y_bounds.begin(), _y_bounds.end());
-    std::sort(_z_bounds.begin(), _z_bounds.end());
-
-    // now indicate that bounds vectors have been (re)built
-    _rebuild_bounds_vecs = false;
-  }
-  else
-  {
-    // bounds are nearly sorted; do insertion sort
-    insertion_sort(_x_bounds.begin(), _x_bounds.end());
-    insertion_sort(_y_bounds.begin(), _y_bounds.end());
-    insertion_sort(_z_bounds.begin(), _z_bounds.end());
-  }
-}
-
-void GeneralizedCCD::update_bounds_vector(vector<pair<Real, BoundsStruct> >& bounds, const map<SingleBodyPtr, pair<Vector3, Vector3> >& vel_map, AxisType axis)
-{
-  const unsigned X = 0, Y = 1, Z = 2;
-
-  FILE_LOG(LOG_COLDET) << " -- update_bounds_vector() entered (axis=" << axis << ")" << std::endl;
-
-  // iterate over bounds vector
-  for (unsigned i=0; i< bounds.size(); i++)
-  {
-    // get the bounding volume, collision geometry, and rigid body
-    BVPtr bv = bounds[i].second.bv;
-    CollisionGeometryPtr geom = bounds[i].second.geom;
-    RigidBodyPtr rb = dynamic_pointer_cast<RigidBody>(geom->get_single_body());
-
-    // update the velocities
-    const Vector3& xd = vel_map.find(rb)->second.first;
-    const Vector3& omega = vel_map.find(rb)->second.second;
-    bounds[i].second.xd = xd; 
-    bounds[i].second.omega = omega;
-
-    // get the expanded bounding volume
-    BVPtr bv_exp = get_vel_exp_BV(geom, bv, xd, omega);
-
-    // get the transform for the collision geometry
-    const Matrix4& T = geom->get_transform();
-
-    // get the bound for the bounding volume
-    Vector3 bound = (bounds[i].second.end) ? bv_exp->get_upper_bounds(T) : bv_exp->get_lower_bounds(T);
-    FILE_LOG(LOG_COLDET) << "  updating collision geometry: " << geom << "  rigid body: " << geom->get_single_body()->id << std::endl;
-
-    // update the bounds for the given axis
-    switch (axis)
-    {
-      case eXAxis:
-        bounds[i].first = bound[X];
-        break;
- 
-      case eYAxis:
-        bounds[i].first = bound[Y];
-        break;
-
-      case eZAxis:
-        bounds[i].first = bound[Z];
-        break;
-
-      default:
-        assert(false);
-    }
-
-    if (bounds[i].second.end)
-      FILE_LOG(LOG_COLDET) << "    upper bound: " << bounds[i].first << std::endl; 
-    if (!bounds[i].second.end)  
-      FILE_LOG(LOG_COLDET) << "    lower bound: " << bounds[i].first << std::endl;
-  }
-
-  FILE_LOG(LOG_COLDET) << " -- update_bounds_vector() exited" << std::endl;
-}
-
-void GeneralizedCCD::build_bv_vector(const map<SingleBodyPtr, pair<Vector3, Vector3> >& vel_map, vector<pair<Real, BoundsStruct> >& bounds)
-{
-  const Real INF = std::numeric_limits<Real>::max();
-
-  // clear the vector
-  bounds.clear();
-
-  // iterate over all collision geometries
-  for (set<CollisionGeometryPtr>::const_iterator i = _geoms.begin(); i != _geoms.end(); i++)
-  {
-    // if the geometry is disabled, skip the geometry
-    if (this->disabled.find(*i) != this->disabled.end())
-      continue;
-
-    // get the rigid body and primitive for the geometry
-    RigidBodyPtr rb = dynamic_pointer_cast<RigidBody>((*i)->get_single_body());
-    PrimitivePtr p = (*i)->get_geometry();
-
-    // get the top-level BV for the geometry
-    BVPtr bv = p->get_BVH_root();
-
-    // get the velocities for the rigid body
-    assert(vel_map.find(rb) != vel_map.end());
-    const Vector3& xd = vel_map.find(rb)->second.first;
-    const Vector3& omega = vel_map.find(rb)->second.second;
-
-    // setup the bounds structure
-    BoundsStruct bs;
-    bs.end = false;
-    bs.geom = *i;
-    bs.xd = xd;
-    bs.omega = omega;
-    bs.bv = bv;
-
-    // add the lower bound
-    bounds.push_back(make_pair(-INF, bs));
-
-    // modify the bounds structure to indicate the end bound
-    bs.end = true;
-    bounds.push_back(make_pair(INF, bs));
-  }
-}
-
 /****************************************************************************
  Methods for broad phase end 
 ****************************************************************************/
@@ -1495,57 +1317,32 @@ void GeneralizedCCD::build_bv_vector(const map<SingleBodyPtr, pair<Vector3, Vect
  */
 bool GeneralizedCCD::is_collision(Real epsilon)
 {
-  // clear the set of colliding pairs and list of colliding triangles
-  colliding_pairs.clear();
-  colliding_tris.clear();
-
-  // iterate over geometries 
-  for (std::set<CollisionGeometryPtr>::const_iterator i = _geoms.begin(); i != _geoms.end(); i++)
-  {
-    // get the first geometry and its primitive 
-    CollisionGeometryPtr g1 = *i;
-    PrimitivePtr g1_primitive = g1->get_geometry();
-
-    // get the transform and the inverse transform for this geometry
-    const Matrix4& wTg1 = g1->get_transform();
-    Matrix4 g1Tw = Matrix4::inverse_transform(wTg1);
-
-    // loop through all other geometries
-    std::set<CollisionGeometryPtr>::const_iterator j = i;
-    j++;
-    for (; j != _geoms.end(); j++)
-    {
-      // get the second geometry and its primitive 
-      CollisionGeometryPtr g2 = *j;
-      PrimitivePtr g2_primitive = g2->get_geometry();
-
-      // see whether to check
-      if (!is_checked(g1, g2))
-        continue; 
-
-      // get the two BV trees
-      BVPtr bv1 = g1_primitive->get_BVH_root();
-      BVPtr bv2 = g2_primitive->get_BVH_root();
+  return check_pairs(&GeneralizedCCD::check_pair, this);
+}
 
-      // get the transform for g2 and its inverse
-      const Matrix4& wTg2 = g2->get_transform(); 
+/// Checks a single pair of geometries for intersection (called by CollisionDetection::check_pairs())
+bool GeneralizedCCD::check_pair(void* data, CollisionGeometryPtr g1, CollisionGeometryPtr g2, const Matrix4& g1Tg2, list<CollidingTriPair>& tris)
+{
+  GeneralizedCCD* ccd = (GeneralizedCCD*) data;
 
-      // if intersects, add to colliding pairs
-      if (intersect_BV_trees(bv1, bv2, g1Tw * wTg2, g1, g2))
-        colliding_pairs.insert(make_sorted_pair(g1, g2));
-    } 
-  }
+  // get the two BV trees
+  BVPtr bv1 = g1->get_geometry()->get_BVH_root();
+  BVPtr bv2 = g2->get_geometry()->get_BVH_root();
 
-  return !colliding_pairs.empty();
+  // check for intersection
+  return ccd->intersect_BV_trees(bv1, bv2, g1Tg2, g1, g2, tris);
 }
 
 /// Intersects two BV trees; returns <b>true</b> if one (or more) pair of the underlying triangles intersects
-bool GeneralizedCCD::intersect_BV_trees(BVPtr a, BVPtr b, const Matrix4& aTb, CollisionGeometryPtr geom_a, CollisionGeometryPtr geom_b) 
+/**
+ * Intersecting pairs of triangles are appended to tris.
+ */
+bool GeneralizedCCD::intersect_BV_trees(BVPtr a, BVPtr b, const Matrix4& aTb, CollisionGeometryPtr geom_a, CollisionGeometryPtr geom_b, list<CollidingTriPair>& tris) 
 {
   std::queue<tuple<BVPtr, BVPtr, bool> > q;
 
   // get address of the last colliding triangle pair on the queue
-  CollidingTriPair* last = (colliding_tris.empty()) ? NULL : &colliding_tris.back();
+  CollidingTriPair* last = (tris.empty()) ? NULL : &tris.back();
 
   FILE_LOG(LOG_COLDET) << "GeneralizedCCD::intersect_BV_trees() entered" << endl;
 
@@ -1576,12 +1373,12 @@ bool GeneralizedCCD::intersect_BV_trees(BVPtr a, BVPtr b, const Matrix4& aTb, Co
     if (bv1->is_leaf() && bv2->is_leaf())
     {
       if (!rev)
-        intersect_BV_leafs(bv1, bv2, aTb, geom_a, geom_b, std::back_inserter(colliding_tris));
+        intersect_BV_leafs(bv1, bv2, aTb, geom_a, geom_b, std::back_inserter(tris));
       else
-        intersect_BV_leafs(bv2, bv1, aTb, geom_a, geom_b, std::back_inserter(colliding_tris));
+        intersect_BV_leafs(bv2, bv1, aTb, geom_a, geom_b, std::back_inserter(tris));
 
       // see whether we want to exit early
-      if (mode == eFirstContact && !colliding_tris.empty() && last != &colliding_tris.back())
+      if (mode == eFirstContact && !tris.empty() && last != &tris.back())
         return true;
     }
 
@@ -1602,7 +1399,7 @@ bool GeneralizedCCD::intersect_BV_trees(BVPtr a, BVPtr b, const Matrix4& aTb, Co
   }
 
   // see whether we have an intersection
-  if (!colliding_tris.empty() && last != &colliding_tris.back())
+  if (!tris.empty() && last != &tris.back())
     return true;
 
   FILE_LOG(LOG_COLDET) << "  -- all intersection checks passed; no intersection" << endl;
@@ -18,6 +18,7 @@
 #include <Moby/SingleBody.h>
 #include <Moby/RigidBody.h>
 #include <Moby/LinAlg.h>
+#include <Moby/SparseCholesky.h>
 #include <Moby/Log.h>
 #include <Moby/XMLTree.h>
 #include <Moby/Optimization.h>
@@ -148,6 +149,11 @@ void ImpactEventHandler::apply_model_to_connected_events(const list<Event*>& eve
   // compute all event cross-terms
   compute_problem_data(epd);
 
+  // setup the QP solver
+  epd.use_ip_solver = use_ip_solver;
+  epd.ip_max_iterations = ip_max_iterations;
+  epd.ip_eps = ip_eps;
+
   // compute energy
   if (LOGGING(LOG_EVENT))
   {
@@ -426,35 +432,66 @@ void ImpactEventHandler::compute_problem_data(EventProblemData& q)
     q.super_bodies[i]->update_event_data(q);
 }
 
+/// Computes X = B*inv(Jx*iM*Jx'), using either its sparse factorization or its regularized inverse
+static MatrixN& mult_inv_Jx_iM_JxT(const MatrixN& B, bool chol, const SparseCholesky& L, const MatrixN& iJx_iM_JxT, MatrixN& X)
+{
+  if (!chol)
+    return B.mult(iJx_iM_JxT, X);
+
+  // Jx*iM*Jx' is symmetric, so X' = inv(Jx*iM*Jx')*B'
+  X.copy_from(B).transpose();
+  L.solve(X);
+  return X.transpose();
+}
+
+/// Computes x = inv(Jx*iM*Jx')*b, using either its sparse factorization or its regularized inverse
+static VectorN& solve_Jx_iM_JxT(const VectorN& b, bool chol, const SparseCholesky& L, const MatrixN& iJx_iM_JxT, VectorN& x)
+{
+  if (!chol)
+    return iJx_iM_JxT.mult(b, x);
+
+  x.copy_from(b);
+  return L.solve(x);
+}
+
 /// Solves the (frictionless) LCP
 void ImpactEventHandler::solve_lcp(EventProblemData& q, VectorN& z)
 {
   SAFESTATIC MatrixN UL, LR, MM;
   SAFESTATIC MatrixN UR, t2, iJx_iM_JxT;
   SAFESTATIC VectorN alpha_c, alpha_l, alpha_x, v1, v2, qq;
+  SAFESTATIC SparseCholesky Jx_iM_JxT_chol;
 
   // setup sizes
   UL.resize(q.N_CONTACTS, q.N_CONTACTS);
   UR.resize(q.N_CONTACTS, q.N_LIMITS);
   LR.resize(q.N_LIMITS, q.N_LIMITS);
 
-  // setup primary terms -- first upper left hand block of matrix
-  iJx_iM_JxT.copy_from(q.Jx_iM_JxT);
-  try
-  {
-    LinAlg::pseudo_inverse(iJx_iM_JxT, LinAlg::svd1);
-  }
-  catch (NumericalException e)
+  // Jx*iM*Jx' is sparse for maximal coordinate articulated bodies, so it is
+  // factored using a sparse Cholesky factorization; the regularized inverse
+  // is only computed if it is rank deficient
+  const bool CHOL = Jx_iM_JxT_chol.factor(SparseMatrixN(q.Jx_iM_JxT, (Real) 0.0));
+  if (!CHOL)
   {
     iJx_iM_JxT.copy_from(q.Jx_iM_JxT);
-    LinAlg::pseudo_inverse(iJx_iM_JxT, LinAlg::svd2);
+    try
+    {
+      LinAlg::pseudo_inverse(iJx_iM_JxT, LinAlg::svd1);
+    }
+    catch (NumericalException e)
+    {
+      iJx_iM_JxT.copy_from(q.Jx_iM_JxT);
+      LinAlg::pseudo_inverse(iJx_iM_JxT, LinAlg::svd2);
+    }
   }
-  q.Jc_iM_JxT.mult(iJx_iM_JxT, t2);
+
+  // setup primary terms -- first upper left hand block of matrix
+  mult_inv_Jx_iM_JxT(q.Jc_iM_JxT, CHOL, Jx_iM_JxT_chol, iJx_iM_JxT, t2);
   t2.mult_transpose(q.Jc_iM_JxT, UL);
   // now do upper right hand block of matrix
   t2.mult_transpose(q.Jl_iM_JxT, UR);
   // now lower right hand block of matrix
-  q.Jl_iM_JxT.mult(iJx_iM_JxT, t2);
+  mult_inv_Jx_iM_JxT(q.Jl_iM_JxT, CHOL, Jx_iM_JxT_chol, iJx_iM_JxT, t2);
   t2.mult_transpose(q.Jl_iM_JxT, LR);
 
   // subtract secondary terms
@@ -476,7 +513,7 @@ void ImpactEventHandler::solve_lcp(EventProblemData& q, VectorN& z)
 
   // setup the LCP vector
   qq.resize(MM.rows());
-  iJx_iM_JxT.mult(q.Jx_v, v2); 
+  solve_Jx_iM_JxT(q.Jx_v, CHOL, Jx_iM_JxT_chol, iJx_iM_JxT, v2);
   q.Jc_iM_JxT.mult(v2, v1);
   v1 -= q.Jc_v;
   qq.set_sub_vec(0, v1);
@@ -520,7 +557,7 @@ void ImpactEventHandler::solve_lcp(EventProblemData& q, VectorN& z)
   v1 += v2;
   v1 += q.Jx_v;
   v1.negate();
-  iJx_iM_JxT.mult(v1, alpha_x);
+  solve_Jx_iM_JxT(v1, CHOL, Jx_iM_JxT_chol, iJx_iM_JxT, alpha_x);
 
   // setup the homogeneous solution
   z.set_zero();
@@ -21,6 +21,7 @@
 #include <Moby/Log.h>
 #include <Moby/XMLTree.h>
 #include <Moby/Optimization.h>
+#include <Moby/StructuredQP.h>
 #include <Moby/ImpactToleranceException.h>
 #include <Moby/NumericalException.h>
 #include <Moby/ImpactEventHandler.h>
@@ -624,6 +625,7 @@ void ImpactEventHandler::solve_qp_work_ijoints(EventProblemData& q, VectorN& z)
   SAFESTATIC MatrixN sub, t1, t2, t3, neg1, A; 
   SAFESTATIC MatrixN H, MM;
   SAFESTATIC VectorN negv, c, qq, nb, tmpv, y;
+  SAFESTATIC vector<unsigned> P;
 
   // init the QP matrix and vector
   const unsigned KAPPA = (q.use_kappa) ? 1 : 0;
@@ -632,8 +634,6 @@ void ImpactEventHandler::solve_qp_work_ijoints(EventProblemData& q, VectorN& z)
   c.resize(H.rows());
   A.set_zero(N_INEQUAL, q.N_VARS);
   nb.set_zero(N_INEQUAL);
-  MM.set_zero(q.N_VARS + N_INEQUAL, q.N_VARS + N_INEQUAL);
-  qq.resize(MM.rows());
 
   // setup [Q M'; -M 0]
   unsigned col = 0, row = 0;
@@ -724,15 +724,6 @@ void ImpactEventHandler::solve_qp_work_ijoints(EventProblemData& q, VectorN& z)
     nb[row] = q.kappa;
   }
 
-  // setup the LCP matrix
-  MM.set_sub_mat(0, 0, H);
-  MM.set_sub_mat(q.N_VARS, 0, A);
-  MM.set_sub_mat(0, q.N_VARS, A.negate(), true);
-
-  // setup the LCP vector
-  qq.set_sub_vec(0, c);
-  qq.set_sub_vec(q.N_VARS, nb);
-
   FILE_LOG(LOG_EVENT) << "ImpactEventHandler::solve_qp() entered" << std::endl;
   FILE_LOG(LOG_EVENT) << "  Jc * inv(M) * Jc': " << std::endl << q.Jc_iM_JcT;
   FILE_LOG(LOG_EVENT) << "  Jc * inv(M) * Dc': " << std::endl << q.Jc_iM_DcT;
@@ -752,6 +743,36 @@ void ImpactEventHandler::solve_qp_work_ijoints(EventProblemData& q, VectorN& z)
   FILE_LOG(LOG_EVENT) << "c vector: " << c << std::endl;
   FILE_LOG(LOG_EVENT) << "A matrix: " << std::endl << A;
   FILE_LOG(LOG_EVENT) << "b vector: " << (-nb) << std::endl;
+
+  // solve the QP using the structured interior-point solver, if desired
+  if (q.use_ip_solver)
+  {
+    // the contact and limit constraints are gradient constraints of the QP
+    P.clear();
+    for (unsigned i=0; i< q.N_CONTACTS; i++)
+      P.push_back(q.ALPHA_C_IDX+i);
+    for (unsigned i=0; i< q.N_LIMITS; i++)
+      P.push_back(q.ALPHA_L_IDX+i);
+
+    if (solve_qp_work_ip(q, H, c, A, nb, P, z))
+    {
+      FILE_LOG(LOG_EVENT) << "QP solution: " << z << std::endl; 
+      FILE_LOG(LOG_EVENT) << "ImpactEventHandler::solve_qp_work_ijoints() exited" << std::endl;
+      return;
+    }
+  }
+
+  // setup the LCP matrix
+  MM.set_zero(q.N_VARS + N_INEQUAL, q.N_VARS + N_INEQUAL);
+  MM.set_sub_mat(0, 0, H);
+  MM.set_sub_mat(q.N_VARS, 0, A);
+  MM.set_sub_mat(0, q.N_VARS, A.negate(), true);
+
+  // setup the LCP vector
+  qq.resize(MM.rows());
+  qq.set_sub_vec(0, c);
+  qq.set_sub_vec(q.N_VARS, nb);
+
   FILE_LOG(LOG_EVENT) << "LCP matrix: " << std::endl << MM; 
   FILE_LOG(LOG_EVENT) << "LCP vector: " << qq << std::endl; 
 
@@ -763,6 +784,50 @@ void ImpactEventHandler::solve_qp_work_ijoints(EventProblemData& q, VectorN& z)
   FILE_LOG(LOG_EVENT) << "ImpactEventHandler::solve_qp_work_ijoints() exited" << std::endl;
 }
 
+/// Solves a quadratic program setup by solve_qp_work_ijoints() or solve_qp_work_general() using the structured interior-point solver
+/**
+ * The QP minimizes 1/2 x'*H*x + c'*x subject to x >= 0 and A*x + nb >= 0.
+ * The first P.size() rows of A are the rows of H indexed by P (and the
+ * corresponding components of nb those of c); the remaining rows (e.g., the
+ * friction cone constraints of the individual contacts and the kappa
+ * constraint) are passed to the solver as general constraints.
+ * \param P the indices of the variables whose gradient constraints form the
+ *        first rows of A
+ * \param z the primal variables followed by the multipliers of the
+ *        constraints on return (the solution of the equivalent LCP)
+ * \return <b>false</b> if the solver failed to converge
+ */
+bool ImpactEventHandler::solve_qp_work_ip(const EventProblemData& q, const MatrixN& H, const VectorN& c, const MatrixN& A, const VectorN& nb, const vector<unsigned>& P, VectorN& z)
+{
+  SAFESTATIC StructuredQP qp;
+  SAFESTATIC SparseMatrixN Af;
+  SAFESTATIC MatrixN sub;
+  SAFESTATIC VectorN b, x, lambda;
+
+  // the constraints not given by gradients are sparse
+  const unsigned N_GRAD = P.size();
+  A.get_sub_mat(N_GRAD, A.rows(), 0, A.columns(), sub);
+  Af = SparseMatrixN(sub, (Real) 0.0);
+  nb.get_sub_vec(N_GRAD, nb.size(), b);
+  b.negate();
+
+  // solve the QP
+  qp.max_iterations = q.ip_max_iterations;
+  qp.eps = q.ip_eps;
+  if (!qp.solve(H, c, P, Af, b, x, lambda))
+  {
+    FILE_LOG(LOG_EVENT) << "ImpactEventHandler::solve_qp_work_ip() - interior-point solver failed; using Lemke's algorithm" << std::endl;
+    return false;
+  }
+  FILE_LOG(LOG_EVENT) << "ImpactEventHandler::solve_qp_work_ip() - interior-point solver converged in " << qp.get_iterations() << " iterations" << std::endl;
+
+  // setup the solution
+  z.resize(x.size() + lambda.size());
+  z.set_sub_vec(0, x);
+  z.set_sub_vec(x.size(), lambda);
+  return true;
+}
+
 /// Solves the quadratic program (does all of the work)
 /**
  * \note this is the version without joint friction forces
@@ -817,8 +882,6 @@ void ImpactEventHandler::solve_qp_work_general(EventProblemData& q, VectorN& z)
   c.resize(H.rows());
   A.set_zero(N_INEQUAL, q.N_VARS);
   nb.set_zero(N_INEQUAL);
-  MM.set_zero(N_VARS + N_INEQUAL, N_VARS + N_INEQUAL);
-  qq.resize(MM.rows());
 
   // setup [Q M'; -M 0]
   unsigned col = 0, row = 0;
@@ -923,15 +986,6 @@ void ImpactEventHandler::solve_qp_work_general(EventProblemData& q, VectorN& z)
   nb += tmpv;
   A.mult(R, AR);
 
-  // setup the LCP matrix
-  MM.set_sub_mat(0, 0, H);
-  MM.set_sub_mat(N_VARS, 0, AR);
-  MM.set_sub_mat(0, N_VARS, AR.negate(), true);
-
-  // setup the LCP vector
-  qq.set_sub_vec(0, c);
-  qq.set_sub_vec(N_VARS, nb);
-
   FILE_LOG(LOG_EVENT) << "ImpactEventHandler::solve_qp_work_general() entered" << std::endl;
   FILE_LOG(LOG_EVENT) << "  Jc * inv(M) * Jc': " << std::endl << q.Jc_iM_JcT;
   FILE_LOG(LOG_EVENT) << "  Jc * inv(M) * Dc': " << std::endl << q.Jc_iM_DcT;
@@ -951,12 +1005,30 @@ void ImpactEventHandler::solve_qp_work_general(EventProblemData& q, VectorN& z)
   FILE_LOG(LOG_EVENT) << "c vector: " << c << std::endl;
   FILE_LOG(LOG_EVENT) << "A matrix: " << std::endl << A;
   FILE_LOG(LOG_EVENT) << "b vector: " << (-nb) << std::endl;
-  FILE_LOG(LOG_EVENT) << "LCP matrix: " << std::endl << MM; 
-  FILE_LOG(LOG_EVENT) << "LCP vector: " << qq << std::endl; 
 
-  // solve the LCP using Lemke's algorithm
-  if (!Optimization::lcp_lemke_regularized(MM, qq, tmpv))
-    throw std::runtime_error("Unable to solve event QP!");
+  // solve the QP using the structured interior-point solver, if desired (the
+  // rows of A*R are not rows of the projected H, so none are passed as
+  // gradient constraints), or the equivalent LCP using Lemke's algorithm
+  if (!q.use_ip_solver || !solve_qp_work_ip(q, H, c, AR, nb, vector<unsigned>(), tmpv))
+  {
+    // setup the LCP matrix
+    MM.set_zero(N_VARS + N_INEQUAL, N_VARS + N_INEQUAL);
+    MM.set_sub_mat(0, 0, H);
+    MM.set_sub_mat(N_VARS, 0, AR);
+    MM.set_sub_mat(0, N_VARS, AR.negate(), true);
+
+    // setup the LCP vector
+    qq.resize(MM.rows());
+    qq.set_sub_vec(0, c);
+    qq.set_sub_vec(N_VARS, nb);
+
+    FILE_LOG(LOG_EVENT) << "LCP matrix: " << std::endl << MM; 
+    FILE_LOG(LOG_EVENT) << "LCP vector: " << qq << std::endl; 
+
+    // solve the LCP using Lemke's algorithm
+    if (!Optimization::lcp_lemke_regularized(MM, qq, tmpv))
+      throw std::runtime_error("Unable to solve event QP!");
+  }
 
   // get the nullspace solution out
   FILE_LOG(LOG_EVENT) << "LCP solution: " << tmpv << std::endl; 
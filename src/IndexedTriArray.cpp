@@ -4,7 +4,10 @@
  * License (found in COPYING).
  ****************************************************************************/
 
+#include <stdint.h>
 #include <queue>
+#include <limits>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <Moby/Constants.h>
@@ -155,7 +158,139 @@ IndexedTriArray& IndexedTriArray::operator=(const IndexedTriArray& mesh)
   return *this;
 }
 
+/// Determines the facets incident to each vertex in compressed sparse row form
+/**
+ * The facets incident to each vertex are stored in ascending order.
+ */
+CSRAdjacency IndexedTriArray::calc_vertex_facet_adjacency() const
+{
+  const vector<IndexedTri>& facets = *_facets;
+  const unsigned NV = _vertices->size();
+  CSRAdjacency adj;
+
+  // count the number of facets incident to each vertex
+  adj.offsets.resize(NV+1, 0);
+  for (unsigned i=0; i< facets.size(); i++)
+  {
+    adj.offsets[facets[i].a+1]++;
+    adj.offsets[facets[i].b+1]++;
+    adj.offsets[facets[i].c+1]++;
+  }
+
+  // compute the row offsets
+  for (unsigned i=0; i< NV; i++)
+    adj.offsets[i+1] += adj.offsets[i];
+
+  // fill the rows; facets are visited in order, so rows come out sorted
+  vector<unsigned> fill(adj.offsets.begin(), adj.offsets.end()-1);
+  adj.indices.resize(adj.offsets.back());
+  for (unsigned i=0; i< facets.size(); i++)
+  {
+    adj.indices[fill[facets[i].a]++] = i;
+    adj.indices[fill[facets[i].b]++] = i;
+    adj.indices[fill[facets[i].c]++] = i;
+  }
+
+  return adj;
+}
+
+/// Determines the (unique) edges of the mesh and the facets incident to each
+/**
+ * The edge table is built by sorting, so it contains no duplicates and is
+ * ordered (use find_edge() to locate an edge).
+ * \param edges the sorted edges of the mesh on return
+ * \param edge_facets row i gives the (ascending) indices of the facets 
+ *        incident to edges[i] on return
+ */
+void IndexedTriArray::calc_edge_facet_adjacency(vector<sorted_pair<unsigned> >& edges, CSRAdjacency& edge_facets) const
+{
+  const unsigned EDGES_PER_TRI = 3;
+  const vector<IndexedTri>& facets = *_facets;
+
+  // create (edge, facet) keys; edges are keyed by (larger, smaller) vertex
+  // index so that the order is that of sorted_pair
+  vector<std::pair<uint64_t, unsigned> > keys(facets.size()*EDGES_PER_TRI);
+  for (unsigned i=0, k=0; i< facets.size(); i++)
+  {
+    const unsigned v[EDGES_PER_TRI+1] = { facets[i].a, facets[i].b, facets[i].c, facets[i].a };
+    for (unsigned j=0; j< EDGES_PER_TRI; j++)
+    {
+      uint64_t hi = std::max(v[j], v[j+1]), lo = std::min(v[j], v[j+1]);
+      keys[k++] = std::make_pair((hi << 32) | lo, i);
+    }
+  }
+  std::sort(keys.begin(), keys.end());
+
+  // build the edge table and the edge / facet rows
+  edges.clear();
+  edge_facets.offsets.clear();
+  edge_facets.indices.resize(keys.size());
+  for (unsigned i=0; i< keys.size(); i++)
+  {
+    if (i == 0 || keys[i].first != keys[i-1].first)
+    {
+      edges.push_back(make_sorted_pair((unsigned) (keys[i].first >> 32), (unsigned) (keys[i].first & 0xffffffff)));
+      edge_facets.offsets.push_back(i);
+    }
+    edge_facets.indices[i] = keys[i].second;
+  }
+  edge_facets.offsets.push_back(keys.size());
+}
+
+/// Finds the index of edge (v1, v2) in an edge table from calc_edge_facet_adjacency()
+/**
+ * \return the index of the edge, or std::numeric_limits<unsigned>::max() if
+ *         the edge is not in the table
+ */
+unsigned IndexedTriArray::find_edge(const vector<sorted_pair<unsigned> >& edges, unsigned v1, unsigned v2)
+{
+  sorted_pair<unsigned> e = make_sorted_pair(v1, v2);
+  vector<sorted_pair<unsigned> >::const_iterator i = std::lower_bound(edges.begin(), edges.end(), e);
+  return (i != edges.end() && *i == e) ? (unsigned) (i - edges.begin()) : std::numeric_limits<unsigned>::max();
+}
+
+/// Determines the (unique) vertices adjacent to each vertex in compressed sparse row form
+CSRAdjacency IndexedTriArray::calc_vertex_edge_adjacency() const
+{
+  const unsigned NV = _vertices->size();
+  CSRAdjacency adj;
+
+  // get the edges
+  vector<sorted_pair<unsigned> > edges;
+  CSRAdjacency edge_facets;
+  calc_edge_facet_adjacency(edges, edge_facets);
+
+  // count the degree of each vertex
+  adj.offsets.resize(NV+1, 0);
+  for (unsigned i=0; i< edges.size(); i++)
+  {
+    adj.offsets[edges[i].first+1]++;
+    adj.offsets[edges[i].second+1]++;
+  }
+  for (unsigned i=0; i< NV; i++)
+    adj.offsets[i+1] += adj.offsets[i];
+
+  // fill the rows
+  vector<unsigned> fill(adj.offsets.begin(), adj.offsets.end()-1);
+  adj.indices.resize(adj.offsets.back());
+  for (unsigned i=0; i< edges.size(); i++)
+  {
+    adj.indices[fill[edges[i].first]++] = edges[i].second;
+    adj.indices[fill[edges[i].second]++] = edges[i].first;
+  }
+
+  // sort the rows
+  for (unsigned i=0; i< NV; i++)
+    std::sort(adj.indices.begin() + adj.offsets[i], adj.indices.begin() + adj.offsets[i+1]);
+
+  return adj;
+}
+
 /// Determines a map from vertices to facet indices
+/**
+ * \note calc_vertex_facet_adjacency() computes the same relation in a 
+ *       compact form
+ */
 vector<list<unsigned> > IndexedTriArray::determine_vertex_facet_map() const
 {
   vector<list<unsigned> > m(_vertices->size());
@@ -175,6 +310,8 @@ vector<list<unsigned> > IndexedTriArray::determine_vertex_facet_map() const
 /**
  * \return a map from vertices to edges; each element in the map repesents
  *         the second vertex of the edge (the key is the first)
+ * \note calc_vertex_edge_adjacency() computes the same relation (without
+ *       duplicates) in a compact form
  */
 vector<list<unsigned> > IndexedTriArray::determine_vertex_edge_map() const
 {
@@ -194,6 +331,10 @@ vector<list<unsigned> > IndexedTriArray::determine_vertex_edge_map() const
 }
 
 /// Determines a map from edges to facet indices
+/**
+ * \note calc_edge_facet_adjacency() computes the same relation in a compact
+ *       form
+ */
 map<sorted_pair<unsigned>, list<unsigned> > IndexedTriArray::determine_edge_facet_map() const
 {
   map<sorted_pair<unsigned>, list<unsigned> > m;
@@ -357,21 +498,7 @@ IndexedTriArray IndexedTriArray::translate(const Vector3& x) const
 /// Calculates facets incident to a vertex
 void IndexedTriArray::calc_incident_facets()
 {
-  // create the array
-  shared_ptr<vector<list<unsigned> > > new_incident_facets(new vector<list<unsigned> >(_vertices->size()));
-  _incident_facets = new_incident_facets;
-  vector<list<unsigned> >& incident_facets = *new_incident_facets;
-
-  // get facets and vertices
-  const vector<IndexedTri>& facets = get_facets();
-
-  // set it up
-  for (unsigned i=0; i< facets.size(); i++)
-  {
-    incident_facets[facets[i].a].push_back(i);
-    incident_facets[facets[i].b].push_back(i);
-    incident_facets[facets[i].c].push_back(i);
-  }
+  _incident_facets = shared_ptr<const CSRAdjacency>(new CSRAdjacency(calc_vertex_facet_adjacency()));
 }
 
 /// Compresses the vertices used in an IndexedTriArray to create a new mesh 
@@ -446,134 +573,6 @@ void IndexedTriArray::write_to_obj(const IndexedTriArray& mesh, const string& fi
   out.close();
 }
 
-/// Reads triangle mesh from a Wavefront OBJ file
-IndexedTriArray IndexedTriArray::read_from_obj(const string& filename)
-{
-  const unsigned BUF_SIZE = 2048;
-  char buffer[BUF_SIZE];
-  Real v1, v2, v3;
-  int i1, i2, i3;
-
-  // create arrays for vertices and facets
-  vector<Vector3> vertices;
-  vector<IndexedTri> facets;
-
-  // open the file
-  std::ifstream in(filename.c_str());
-  if (in.fail())
-  {
-    cerr << "IndexedTriArray::read_obj_file() - unable to open ";
-    cerr << filename << endl;
-    return IndexedTriArray();
-  }
-
-  // read in the file
-  while (true)
-  {
-    // read in the line identifier
-    string id;
-    in >> id;
-    if (in.eof())
-      break;
-    
-    // determine whether the line describes a vertex
-    if (id == std::string("v") || id == std::string("V"))
-    {
-      // read in the vertex and the rest of the line
-      in >> v1;
-      in >> v2;
-      in >> v3;
-      if (in.eof())
-      {
-        std::string errstr = std::string("Unexpected EOF reached reading vertices from OBJ file ") + filename + std::string(" in IndexedTriArray::read_from_obj()"); 
-        throw std::runtime_error(errstr.c_str());
-      }
-
-      // create and add the vertex
-      vertices.push_back(Vector3(v1, v2, v3));
-      continue;
-    }
-  
-    // determine whether the read line describes a face
-    if (id[0] == 'f' || id[0] == 'F')
-    {
-      string f1, f2, f3;
-      size_t idx;
-      
-      // read in the indices 
-      in >> f1;
-      in >> f2;
-      in >> f3;
-      if (in.eof())
-      {
-        std::string errstr = std::string("Unexpected EOF reached reading faces from OBJ file ") + filename + std::string(" in IndexedTriArray::read_from_obj()"); 
-        throw std::runtime_error(errstr.c_str());
-      }
-
-      // strip out associated texture and normal vertices for f1
-      idx = f1.find_first_of('/');
-      if (idx != string::npos)
-        f1.erase(idx, string::npos);
-      
-      // strip out associated texture and normal vertices for f2
-      idx = f2.find_first_of('/');
-      if (idx != string::npos)
-        f2.erase(idx, string::npos);
-      
-      // strip out associated texture and normal vertices for f3
-      idx = f3.find_first_of('/');
-      if (idx != string::npos)
-        f3.erase(idx, string::npos);
-    
-      // get the indices  
-      i1 = std::atoi(f1.c_str());
-      i2 = std::atoi(f2.c_str());
-      i3 = std::atoi(f3.c_str());
-
-      // if the indices are negative, translate them to positive; otherwise, decrement them
-      if (i1 < 0)
-        i1 = vertices.size() + i1;
-      else
-        i1--;
-      if (i2 < 0)
-        i2 = vertices.size() + i2;
-      else
-        i2--;
-      if (i3 < 0)
-        i3 = vertices.size() + i3;
-      else
-        i3--;
-
-      // if triangle is degenerate, do not store it
-      Triangle tri(vertices[i1], vertices[i2], vertices[i3]);
-      if (tri.calc_area() < NEAR_ZERO)
-        continue;
-
-      // create the indexed triangle and store the face
-      facets.push_back(IndexedTri((unsigned) i1, (unsigned) i2, (unsigned) i3));
-      continue;
-    }
-
-    // unhandled tag, read the rest of the line -- it will be ignored
-    in.getline(buffer, BUF_SIZE);
-  }
-
-  // close the file
-  in.close();
-  
-  // vertex and face lists should have been read..
-  if (vertices.empty() || facets.empty())
-  {
-    cerr << "IndexedTriArray::read_obj_file() - no vertices and/or facets ";
-    cerr << "read from " << filename << endl;
-    vertices.clear();
-    facets.clear();
-  }
-
-  // create the indexed triangle array
-  return IndexedTriArray(vertices.begin(), vertices.end(), facets.begin(), facets.end());
-}
-
 /// Method exists b/c CompGeom cannot be included from IndexedTriArray.h
 bool IndexedTriArray::query_intersect_tri_tri(const Triangle& t1, const Triangle& t2)
 {
@@ -583,85 +582,57 @@ bool IndexedTriArray::query_intersect_tri_tri(const Triangle& t1, const Triangle
 /// Determines coplanar vertices and edges of the mesh
 void IndexedTriArray::determine_coplanar_features()
 {
-  // compute maps of vertices to facets and edges to facets in the mesh
-  vector<list<unsigned> > v_f_map = determine_vertex_facet_map();
-  map<sorted_pair<unsigned>, list<unsigned> > e_f_map = determine_edge_facet_map();
+  // compute the edge table and the facets incident to each edge; the facets
+  // incident to each vertex have already been computed
+  const CSRAdjacency& v_f_map = *_incident_facets;
+  vector<sorted_pair<unsigned> > edges;
+  CSRAdjacency e_f_map;
+  calc_edge_facet_adjacency(edges, e_f_map);
 
   // get the vertices and facets
   const vector<IndexedTri>& f = get_facets();
   const vector<Vector3>& v = get_vertices();
 
-  // init lists which will hold the temporary result
-  list<sorted_pair<unsigned> > cp_edges;
-  list<unsigned> cp_verts;
-
-  // construct the list of coplanar vertices
+  // construct the (sorted) vector of coplanar vertices
+  _coplanar_verts.clear();
   for (unsigned i=0; i< _vertices->size(); i++)
-  {
-    list<unsigned>::const_iterator liter = v_f_map[i].begin();
-    if (liter == v_f_map[i].end())
-      continue;
-
-    // get the normal to the first face
-    const IndexedTri& fi = f[*liter++];
-    Vector3 fn = Triangle(v[fi.a], v[fi.b], v[fi.c]).calc_normal();
-
-    // iterate
-    while (liter != v_f_map[i].end()) 
-    {
-      // get the normal to the second face
-      const IndexedTri& fli = f[*liter++];      
-      Vector3 fn2 = Triangle(v[fli.a], v[fli.b], v[fli.c]).calc_normal();
-
-      // check angle between the two normals -- note: we allow the normals to
-      // be completely opposed
-      if (std::fabs(std::fabs(fn.dot(fn2)) - 1.0) > NEAR_ZERO)
-        goto skip1;
-    }
+    if (v_f_map.degree(i) > 0 && coplanar_facets(v_f_map.row(i), f, v))
+      _coplanar_verts.push_back(i);
 
-    // if here, all faces are coplanar
-    cp_verts.push_back(i);
-
-    // this jump point skips the insertion into the list
-    skip1:;
-  }
-
-  // construct the list of coplanar edges
-  for (map<sorted_pair<unsigned>, list<unsigned> >::const_iterator i = e_f_map.begin(); i != e_f_map.end(); i++)
+  // construct the (sorted) vector of coplanar edges
+  _coplanar_edges.clear();
+  for (unsigned i=0; i< edges.size(); i++)
   {
-    assert(!i->second.empty());
-    list<unsigned>::const_iterator liter = i->second.begin();
-
-    // get the normal to the first face
-    const IndexedTri& fi = f[*liter++];
-    Vector3 fn = Triangle(v[fi.a], v[fi.b], v[fi.c]).calc_normal();
+    assert(e_f_map.degree(i) > 0);
+    if (coplanar_facets(e_f_map.row(i), f, v))
+      _coplanar_edges.push_back(edges[i]);
+  }
+}
 
-    // iterate
-    while (liter != i->second.end()) 
-    {
-      // get the normal to the second face
-      const IndexedTri& fli = f[*liter++];      
-      Vector3 fn2 = Triangle(v[fli.a], v[fli.b], v[fli.c]).calc_normal();
-
-      // check angle between the two normals -- note: we allow the normals to
-      // be completely opposed
-      if (std::fabs(std::fabs(fn.dot(fn2)) - 1.0) > NEAR_ZERO)
-        goto skip2;
-    }
+/// Determines whether all facets in a set are coplanar
+/**
+ * \note we allow the normals to be completely opposed
+ */
+bool IndexedTriArray::coplanar_facets(CSRAdjacency::Row facets, const vector<IndexedTri>& f, const vector<Vector3>& v)
+{
+  const unsigned* fiter = facets.first;
 
-    // if here, all faces are coplanar
-    cp_edges.push_back(i->first);
+  // get the normal to the first face
+  const IndexedTri& fi = f[*fiter++];
+  Vector3 fn = Triangle(v[fi.a], v[fi.b], v[fi.c]).calc_normal();
 
-    // this jump point skips the insertion into the list
-    skip2:;
-  }  
+  // iterate
+  while (fiter != facets.second)
+  {
+    // get the normal to the second face
+    const IndexedTri& fli = f[*fiter++];
+    Vector3 fn2 = Triangle(v[fli.a], v[fli.b], v[fli.c]).calc_normal();
 
-  // sort the lists
-  cp_verts.sort();
-  cp_edges.sort();
+    // check angle between the two normals
+    if (std::fabs(std::fabs(fn.dot(fn2)) - 1.0) > NEAR_ZERO)
+      return false;
+  }
 
-  // setup the vectors
-  _coplanar_verts = vector<unsigned>(cp_verts.begin(), cp_verts.end());
-  _coplanar_edges = vector<sorted_pair<unsigned> >(cp_edges.begin(), cp_edges.end());
+  return true;
 }
 
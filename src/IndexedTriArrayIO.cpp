@@ -0,0 +1,735 @@
+/****************************************************************************
+ * Copyright 2011 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#include <stdint.h>
+#include <cstring>
+#include <cctype>
+#include <limits>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <Moby/Constants.h>
+#include <Moby/MappedFile.h>
+#include <Moby/IndexedTriArray.h>
+
+using namespace Moby;
+using std::cerr;
+using std::endl;
+using std::vector;
+using std::string;
+using boost::shared_ptr;
+
+// NOTE: the parsing routines below operate directly on memory-mapped files;
+// none of them allocate per line or per token
+
+/// Determines whether a character is a space or a tab
+static inline bool is_blank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+/// Skips spaces and tabs (but not newlines)
+static inline const char* skip_blanks(const char* p, const char* end)
+{
+  while (p < end && is_blank(*p))
+    p++;
+  return p;
+}
+
+/// Skips to the first character of the next line
+static inline const char* skip_line(const char* p, const char* end)
+{
+  const char* nl = (const char*) memchr(p, '\n', end - p);
+  return (nl) ? nl + 1 : end;
+}
+
+/// Skips to the next whitespace character (or newline)
+static inline const char* skip_token(const char* p, const char* end)
+{
+  while (p < end && !is_blank(*p) && *p != '\n')
+    p++;
+  return p;
+}
+
+/// Powers of ten that are exactly representable as doubles
+static const double EXACT_POW10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+/// Parses a floating point number in decimal notation
+/**
+ * Numbers with up to 19 significant digits and small exponents (the
+ * overwhelmingly common case for mesh files) are converted with a single
+ * multiplication or division by an exact power of ten; anything else (e.g.,
+ * "nan", "inf", or very long mantissas) falls back to strtod().
+ * \param p the position to start parsing at; advanced past the number on
+ *        return
+ * \return <b>true</b> if a number was parsed
+ */
+static bool parse_double(const char*& p, const char* end, double& x)
+{
+  const unsigned MAX_DIGITS = 19, MAX_EXACT_POW = 22;
+  const char* s = skip_blanks(p, end);
+  const char* start = s;
+
+  // get the sign
+  bool neg = false;
+  if (s < end && (*s == '-' || *s == '+'))
+    neg = (*s++ == '-');
+
+  // read the integer and fractional digits
+  uint64_t mant = 0;
+  int exp10 = 0;
+  unsigned ndigits = 0;
+  bool any = false, exact = true;
+  for (; s < end && (unsigned) (*s - '0') < 10; s++, any = true)
+  {
+    if (ndigits < MAX_DIGITS)
+    {
+      mant = mant*10 + (unsigned) (*s - '0');
+      if (mant > 0)
+        ndigits++;
+    }
+    else
+    {
+      exp10++;
+      exact = false;
+    }
+  }
+  if (s < end && *s == '.')
+  {
+    for (s++; s < end && (unsigned) (*s - '0') < 10; s++, any = true)
+    {
+      if (ndigits < MAX_DIGITS)
+      {
+        mant = mant*10 + (unsigned) (*s - '0');
+        if (mant > 0)
+          ndigits++;
+        exp10--;
+      }
+      else
+        exact = false;
+    }
+  }
+
+  // read the exponent
+  if (any && s < end && (*s == 'e' || *s == 'E'))
+  {
+    const char* e = s+1;
+    bool eneg = false;
+    if (e < end && (*e == '-' || *e == '+'))
+      eneg = (*e++ == '-');
+    if (e < end && (unsigned) (*e - '0') < 10)
+    {
+      int ex = 0;
+      for (; e < end && (unsigned) (*e - '0') < 10; e++)
+        if (ex < 100000)
+          ex = ex*10 + (*e - '0');
+      exp10 += (eneg) ? -ex : ex;
+      s = e;
+    }
+  }
+
+  // fast path
+  if (any && exact && mant < ((uint64_t) 1 << 53) && std::abs(exp10) <= (int) MAX_EXACT_POW)
+  {
+    x = (double) mant;
+    x = (exp10 < 0) ? x / EXACT_POW10[-exp10] : x * EXACT_POW10[exp10];
+    if (neg)
+      x = -x;
+    p = s;
+    return true;
+  }
+
+  // slow path: copy the token and use strtod()
+  const unsigned BUF_SIZE = 128;
+  char buffer[BUF_SIZE];
+  const char* tend = skip_token(start, end);
+  if (tend == start || tend - start >= (std::ptrdiff_t) BUF_SIZE)
+    return false;
+  std::copy(start, tend, buffer);
+  buffer[tend - start] = '\0';
+  char* bend;
+  x = std::strtod(buffer, &bend);
+  if (bend == buffer)
+    return false;
+  p = start + (bend - buffer);
+  return true;
+}
+
+/// Parses a (possibly signed) decimal integer
+static bool parse_long(const char*& p, const char* end, long& x)
+{
+  const char* s = skip_blanks(p, end);
+  bool neg = false;
+  if (s < end && (*s == '-' || *s == '+'))
+    neg = (*s++ == '-');
+  if (s == end || (unsigned) (*s - '0') >= 10)
+    return false;
+  long v = 0;
+  for (; s < end && (unsigned) (*s - '0') < 10; s++)
+    v = v*10 + (*s - '0');
+  x = (neg) ? -v : v;
+  p = s;
+  return true;
+}
+
+/// Determines whether this machine is little endian
+static bool host_little_endian()
+{
+  const uint32_t one = 1;
+  return *((const unsigned char*) &one) == 1;
+}
+
+/// Copies a binary value from the file, swapping bytes if necessary
+template <class T>
+static T read_binary(const char* p, bool swap)
+{
+  T value;
+  char* dest = (char*) &value;
+  std::memcpy(dest, p, sizeof(T));
+  if (swap)
+    std::reverse(dest, dest + sizeof(T));
+  return value;
+}
+
+/// Creates a mesh from parsed vertices and facets, discarding degenerate triangles
+IndexedTriArray IndexedTriArray::create_from_parsed(shared_ptr<vector<Vector3> > vertices, shared_ptr<vector<IndexedTri> > facets, const string& filename)
+{
+  // remove degenerate triangles (in place)
+  vector<IndexedTri>& f = *facets;
+  const vector<Vector3>& v = *vertices;
+  unsigned nvalid = 0;
+  for (unsigned i=0; i< f.size(); i++)
+  {
+    if (f[i].a >= v.size() || f[i].b >= v.size() || f[i].c >= v.size())
+      throw std::runtime_error(string("Invalid vertex index reading mesh file ") + filename);
+    Triangle tri(v[f[i].a], v[f[i].b], v[f[i].c]);
+    if (tri.calc_area() < NEAR_ZERO)
+      continue;
+    f[nvalid++] = f[i];
+  }
+  f.resize(nvalid);
+
+  // vertex and face lists should have been read..
+  if (vertices->empty() || facets->empty())
+  {
+    cerr << "IndexedTriArray::read_from_file() - no vertices and/or facets ";
+    cerr << "read from " << filename << endl;
+    vertices->clear();
+    facets->clear();
+  }
+
+  // create the indexed triangle array without copying the data
+  return IndexedTriArray(shared_ptr<const vector<Vector3> >(vertices), shared_ptr<const vector<IndexedTri> >(facets));
+}
+
+/// Welds coincident vertices using a hash grid
+/**
+ * \param xyz packed vertex coordinates (three per vertex)
+ * \param tol vertices closer than this distance are merged; if zero, only
+ *        vertices with identical coordinates are merged
+ * \param vertices the unique vertices on return
+ * \param vmap the mapping from input vertices to unique vertices on return
+ */
+void IndexedTriArray::weld_vertices(const vector<double>& xyz, Real tol, vector<Vector3>& vertices, vector<unsigned>& vmap)
+{
+  const unsigned NONE = std::numeric_limits<unsigned>::max();
+  const uint64_t P1 = 73856093, P2 = 19349663, P3 = 83492791;
+  const unsigned n = xyz.size()/3;
+  const double dtol = (double) tol;
+
+  // size the table to a power of two at least twice the number of vertices
+  unsigned nbuckets = 1;
+  while (nbuckets < 2*n)
+    nbuckets <<= 1;
+  vector<unsigned> head(nbuckets, NONE);
+  vector<unsigned> next;
+  vector<double> uxyz;
+  next.reserve(n);
+  uxyz.reserve(xyz.size());
+  vmap.resize(n);
+
+  for (unsigned i=0; i< n; i++)
+  {
+    const double* x = &xyz[i*3];
+    unsigned found = NONE;
+    uint64_t h;
+
+    if (dtol > 0.0)
+    {
+      // search the 27 cells around the vertex
+      const int64_t cx = (int64_t) std::floor(x[0]/dtol);
+      const int64_t cy = (int64_t) std::floor(x[1]/dtol);
+      const int64_t cz = (int64_t) std::floor(x[2]/dtol);
+      for (int dx = -1; dx <= 1 && found == NONE; dx++)
+        for (int dy = -1; dy <= 1 && found == NONE; dy++)
+          for (int dz = -1; dz <= 1 && found == NONE; dz++)
+          {
+            uint64_t hc = ((uint64_t) (cx+dx)*P1) ^ ((uint64_t) (cy+dy)*P2) ^ ((uint64_t) (cz+dz)*P3);
+            for (unsigned j = head[hc & (nbuckets-1)]; j != NONE; j = next[j])
+            {
+              const double* y = &uxyz[j*3];
+              double d0 = x[0]-y[0], d1 = x[1]-y[1], d2 = x[2]-y[2];
+              if (d0*d0 + d1*d1 + d2*d2 <= dtol*dtol)
+              {
+                found = j;
+                break;
+              }
+            }
+          }
+      h = ((uint64_t) cx*P1) ^ ((uint64_t) cy*P2) ^ ((uint64_t) cz*P3);
+    }
+    else
+    {
+      // hash the bit patterns of the coordinates (normalizing -0 to 0)
+      uint64_t b[3];
+      for (unsigned k=0; k< 3; k++)
+      {
+        double c = (x[k] == 0.0) ? 0.0 : x[k];
+        std::memcpy(&b[k], &c, sizeof(double));
+      }
+      h = (b[0]*P1) ^ (b[1]*P2) ^ (b[2]*P3);
+      h ^= (h >> 29);
+      for (unsigned j = head[h & (nbuckets-1)]; j != NONE; j = next[j])
+      {
+        const double* y = &uxyz[j*3];
+        if (x[0] == y[0] && x[1] == y[1] && x[2] == y[2])
+        {
+          found = j;
+          break;
+        }
+      }
+    }
+
+    // add a new vertex, if necessary
+    if (found == NONE)
+    {
+      found = next.size();
+      uxyz.insert(uxyz.end(), x, x+3);
+      next.push_back(head[h & (nbuckets-1)]);
+      head[h & (nbuckets-1)] = found;
+    }
+    vmap[i] = found;
+  }
+
+  // create the unique vertices
+  vertices.resize(next.size());
+  for (unsigned i=0; i< vertices.size(); i++)
+    vertices[i] = Vector3((Real) uxyz[i*3], (Real) uxyz[i*3+1], (Real) uxyz[i*3+2]);
+}
+
+/// Reads a triangle mesh from a file, determining the format from the file extension
+/**
+ * Wavefront OBJ (.obj), STL (.stl; binary or ASCII), and PLY (.ply; ASCII
+ * or binary) files are supported.
+ * \param filename the name of the file
+ * \param weld_tol the tolerance used to merge vertices of STL files (which
+ *        store no connectivity)
+ */
+IndexedTriArray IndexedTriArray::read_from_file(const string& filename, Real weld_tol)
+{
+  // get the lowercase extension
+  string ext;
+  string::size_type idx = filename.find_last_of('.');
+  if (idx != string::npos)
+    ext = filename.substr(idx);
+  std::transform(ext.begin(), ext.end(), ext.begin(), (int(*)(int)) std::tolower);
+
+  if (ext == ".obj")
+    return read_from_obj(filename);
+  else if (ext == ".stl")
+    return read_from_stl(filename, weld_tol);
+  else if (ext == ".ply")
+    return read_from_ply(filename);
+  else
+    throw std::runtime_error(string("IndexedTriArray::read_from_file() - unknown mesh file type: ") + filename);
+}
+
+/// Determines whether a filename has an extension readable by read_from_file()
+bool IndexedTriArray::is_mesh_file(const string& filename)
+{
+  string::size_type idx = filename.find_last_of('.');
+  if (idx == string::npos)
+    return false;
+  string ext = filename.substr(idx);
+  std::transform(ext.begin(), ext.end(), ext.begin(), (int(*)(int)) std::tolower);
+  return ext == ".obj" || ext == ".stl" || ext == ".ply";
+}
+
+/// Reads triangle mesh from a Wavefront OBJ file
+/**
+ * Polygonal faces are triangulated as fans; texture and normal indices are
+ * ignored.
+ * \note throws std::runtime_error if the file cannot be read, as for the
+ *       other formats
+ */
+IndexedTriArray IndexedTriArray::read_from_obj(const string& filename)
+{
+  // map the file
+  MappedFile file(filename);
+
+  // create arrays for vertices and facets
+  shared_ptr<vector<Vector3> > vertices(new vector<Vector3>);
+  shared_ptr<vector<IndexedTri> > facets(new vector<IndexedTri>);
+  vector<long> poly;
+
+  // read in the file
+  const char* end = file.end();
+  for (const char* p = file.begin(); p < end; p = skip_line(p, end))
+  {
+    // read in the line identifier
+    p = skip_blanks(p, end);
+    if (p + 1 >= end || !is_blank(p[1]))
+      continue;
+
+    // determine whether the line describes a vertex
+    if (*p == 'v' || *p == 'V')
+    {
+      double x, y, z;
+      p++;
+      if (!parse_double(p, end, x) || !parse_double(p, end, y) || !parse_double(p, end, z))
+      {
+        std::string errstr = std::string("Unexpected EOF reached reading vertices from OBJ file ") + filename + std::string(" in IndexedTriArray::read_from_obj()");
+        throw std::runtime_error(errstr.c_str());
+      }
+
+      // create and add the vertex
+      vertices->push_back(Vector3((Real) x, (Real) y, (Real) z));
+    }
+    // determine whether the read line describes a face
+    else if (*p == 'f' || *p == 'F')
+    {
+      // read in the indices, stripping texture and normal indices
+      poly.clear();
+      long idx;
+      for (p++; parse_long(p, end, idx); p = skip_token(p, end))
+      {
+        // if the index is negative, translate it to positive; otherwise,
+        // decrement it
+        poly.push_back((idx < 0) ? (long) vertices->size() + idx : idx - 1);
+      }
+      if (poly.size() < 3)
+      {
+        std::string errstr = std::string("Unexpected EOF reached reading faces from OBJ file ") + filename + std::string(" in IndexedTriArray::read_from_obj()");
+        throw std::runtime_error(errstr.c_str());
+      }
+
+      // create the indexed triangles (as a fan)
+      for (unsigned i=2; i< poly.size(); i++)
+        facets->push_back(IndexedTri((unsigned) poly[0], (unsigned) poly[i-1], (unsigned) poly[i]));
+    }
+  }
+
+  return create_from_parsed(vertices, facets, filename);
+}
+
+/// Reads a triangle mesh from a (binary or ASCII) STL file
+/**
+ * STL files store every triangle with its own copy of its vertices, so
+ * vertices are welded to recover the connectivity.
+ * \param filename the name of the file
+ * \param weld_tol vertices closer than this distance are merged; if zero,
+ *        only vertices with identical coordinates are merged
+ */
+IndexedTriArray IndexedTriArray::read_from_stl(const string& filename, Real weld_tol)
+{
+  const unsigned HEADER_SIZE = 80, TRI_SIZE = 50, FLOATS_PER_TRI = 12;
+  const unsigned NORMAL_FLOATS = 3;
+
+  // map the file
+  MappedFile file(filename);
+  const char* p = file.begin();
+  const char* end = file.end();
+
+  // read the triangle soup
+  vector<double> xyz;
+  const bool swap = !host_little_endian();
+  if (file.size() >= HEADER_SIZE + sizeof(uint32_t) &&
+      file.size() == HEADER_SIZE + sizeof(uint32_t) + (std::size_t) TRI_SIZE*read_binary<uint32_t>(p + HEADER_SIZE, swap))
+  {
+    // binary file: normal and three vertices (little endian floats) per tri
+    const unsigned ntris = read_binary<uint32_t>(p + HEADER_SIZE, swap);
+    xyz.resize(ntris*9);
+    const char* tri = p + HEADER_SIZE + sizeof(uint32_t);
+    for (unsigned i=0, j=0; i< ntris; i++, tri += TRI_SIZE)
+      for (unsigned k=NORMAL_FLOATS; k< FLOATS_PER_TRI; k++)
+        xyz[j++] = (double) read_binary<float>(tri + k*sizeof(float), swap);
+  }
+  else
+  {
+    // ASCII file: read the coordinates following each "vertex" keyword
+    const char* KEYWORD = "vertex";
+    const unsigned KEYWORD_LEN = strlen(KEYWORD);
+    if (file.size() < 5 || strncmp(p, "solid", 5) != 0)
+      throw std::runtime_error(string("IndexedTriArray::read_from_stl() - unrecognized STL file ") + filename);
+    for (; p < end; p = skip_line(p, end))
+    {
+      p = skip_blanks(p, end);
+      if (end - p <= (std::ptrdiff_t) KEYWORD_LEN || strncmp(p, KEYWORD, KEYWORD_LEN) != 0)
+        continue;
+      p += KEYWORD_LEN;
+      double v[3];
+      if (!parse_double(p, end, v[0]) || !parse_double(p, end, v[1]) || !parse_double(p, end, v[2]))
+        throw std::runtime_error(string("IndexedTriArray::read_from_stl() - malformed vertex in ") + filename);
+      xyz.insert(xyz.end(), v, v+3);
+    }
+    if (xyz.size() % 9 != 0)
+      throw std::runtime_error(string("IndexedTriArray::read_from_stl() - incomplete facet in ") + filename);
+  }
+
+  // weld the vertices
+  shared_ptr<vector<Vector3> > vertices(new vector<Vector3>);
+  vector<unsigned> vmap;
+  weld_vertices(xyz, weld_tol, *vertices, vmap);
+
+  // create the facets
+  shared_ptr<vector<IndexedTri> > facets(new vector<IndexedTri>(vmap.size()/3));
+  for (unsigned i=0; i< facets->size(); i++)
+    (*facets)[i] = IndexedTri(vmap[i*3], vmap[i*3+1], vmap[i*3+2]);
+
+  return create_from_parsed(vertices, facets, filename);
+}
+
+/// Property of a PLY element
+struct PLYProperty
+{
+  string name;          // the name of the property
+  unsigned type;        // the size (in bytes) of the (element) type
+  bool floating;        // whether the (element) type is floating point
+  bool is_signed;       // whether the (element) type is signed
+  bool list;            // whether the property is a list
+  unsigned count_type;  // the size (in bytes) of the count type of a list
+};
+
+/// Element of a PLY file
+struct PLYElement
+{
+  string name;                     // the name of the element
+  unsigned count;                  // the number of instances of the element
+  vector<PLYProperty> properties;  // the properties of the element
+};
+
+/// Gets the size (in bytes) and kind of a PLY type
+static bool get_ply_type(const string& name, unsigned& size, bool& floating, bool& is_signed)
+{
+  floating = false;
+  is_signed = true;
+  if (name == "char" || name == "int8")
+    size = 1;
+  else if (name == "uchar" || name == "uint8")
+  {
+    size = 1;
+    is_signed = false;
+  }
+  else if (name == "short" || name == "int16")
+    size = 2;
+  else if (name == "ushort" || name == "uint16")
+  {
+    size = 2;
+    is_signed = false;
+  }
+  else if (name == "int" || name == "int32")
+    size = 4;
+  else if (name == "uint" || name == "uint32")
+  {
+    size = 4;
+    is_signed = false;
+  }
+  else if (name == "float" || name == "float32")
+  {
+    size = 4;
+    floating = true;
+  }
+  else if (name == "double" || name == "float64")
+  {
+    size = 8;
+    floating = true;
+  }
+  else
+    return false;
+
+  return true;
+}
+
+/// Reads a scalar from a binary PLY file and advances the pointer
+static double read_ply_binary(const char*& p, const char* end, unsigned size, bool floating, bool is_signed, bool swap)
+{
+  if (end - p < (std::ptrdiff_t) size)
+    throw std::runtime_error("IndexedTriArray::read_from_ply() - unexpected end of file");
+
+  double x;
+  if (floating)
+    x = (size == 4) ? (double) read_binary<float>(p, swap) : read_binary<double>(p, swap);
+  else if (size == 1)
+    x = (is_signed) ? (double) *((const signed char*) p) : (double) *((const unsigned char*) p);
+  else if (size == 2)
+    x = (is_signed) ? (double) read_binary<int16_t>(p, swap) : (double) read_binary<uint16_t>(p, swap);
+  else
+    x = (is_signed) ? (double) read_binary<int32_t>(p, swap) : (double) read_binary<uint32_t>(p, swap);
+  p += size;
+  return x;
+}
+
+/// Reads a scalar from an ASCII or binary PLY file and advances the pointer
+static double read_ply_value(const char*& p, const char* end, bool ascii, unsigned size, bool floating, bool is_signed, bool swap)
+{
+  if (!ascii)
+    return read_ply_binary(p, end, size, floating, is_signed, swap);
+
+  // skip newlines as well as blanks (elements may span lines)
+  while (p < end && (is_blank(*p) || *p == '\n'))
+    p++;
+  double x;
+  if (!parse_double(p, end, x))
+    throw std::runtime_error("IndexedTriArray::read_from_ply() - malformed value");
+  return x;
+}
+
+/// Reads a triangle mesh from a (ASCII or binary) PLY file
+/**
+ * Vertex positions are taken from the 'x', 'y', and 'z' properties of the
+ * 'vertex' element and polygons from the 'vertex_indices' (or
+ * 'vertex_index') list of the 'face' element; polygons are triangulated as
+ * fans.  All other elements and properties are skipped.
+ */
+IndexedTriArray IndexedTriArray::read_from_ply(const string& filename)
+{
+  const unsigned X = 0, Y = 1, Z = 2;
+
+  // map the file
+  MappedFile file(filename);
+  const char* p = file.begin();
+  const char* end = file.end();
+
+  // verify the magic number
+  if (file.size() < 3 || strncmp(p, "ply", 3) != 0)
+    throw std::runtime_error(string("IndexedTriArray::read_from_ply() - not a PLY file: ") + filename);
+
+  // read the header
+  bool ascii = true, swap = false;
+  vector<PLYElement> elements;
+  for (p = skip_line(p, end); ; p = skip_line(p, end))
+  {
+    if (p >= end)
+      throw std::runtime_error(string("IndexedTriArray::read_from_ply() - header not terminated in ") + filename);
+
+    // tokenize the line
+    const char* eol = skip_line(p, end);
+    vector<string> tokens;
+    for (const char* t = skip_blanks(p, eol); t < eol && *t != '\n'; t = skip_blanks(t, eol))
+    {
+      const char* tend = skip_token(t, eol);
+      tokens.push_back(string(t, tend));
+      t = tend;
+    }
+    if (tokens.empty())
+      continue;
+
+    if (tokens[0] == "end_header")
+    {
+      p = eol;
+      break;
+    }
+    else if (tokens[0] == "format" && tokens.size() > 1)
+    {
+      ascii = (tokens[1] == "ascii");
+      if (tokens[1] == "binary_little_endian")
+        swap = !host_little_endian();
+      else if (tokens[1] == "binary_big_endian")
+        swap = host_little_endian();
+      else if (!ascii)
+        throw std::runtime_error(string("IndexedTriArray::read_from_ply() - unknown format in ") + filename);
+    }
+    else if (tokens[0] == "element" && tokens.size() > 2)
+    {
+      elements.push_back(PLYElement());
+      elements.back().name = tokens[1];
+      elements.back().count = (unsigned) std::atol(tokens[2].c_str());
+    }
+    else if (tokens[0] == "property" && !elements.empty())
+    {
+      PLYProperty prop;
+      bool valid, floating, is_signed;
+      prop.list = (tokens.size() > 4 && tokens[1] == "list");
+      if (prop.list)
+      {
+        valid = get_ply_type(tokens[2], prop.count_type, floating, is_signed) &&
+                get_ply_type(tokens[3], prop.type, prop.floating, prop.is_signed);
+        prop.name = tokens[4];
+      }
+      else
+      {
+        valid = tokens.size() > 2 && get_ply_type(tokens[1], prop.type, prop.floating, prop.is_signed);
+        prop.count_type = 0;
+        prop.name = (tokens.size() > 2) ? tokens[2] : string();
+      }
+      if (!valid)
+        throw std::runtime_error(string("IndexedTriArray::read_from_ply() - bad property in ") + filename);
+      elements.back().properties.push_back(prop);
+    }
+  }
+
+  // create arrays for vertices and facets
+  shared_ptr<vector<Vector3> > vertices(new vector<Vector3>);
+  shared_ptr<vector<IndexedTri> > facets(new vector<IndexedTri>);
+  vector<long> poly;
+
+  // read the elements in order
+  for (unsigned i=0; i< elements.size(); i++)
+  {
+    const PLYElement& e = elements[i];
+    const bool is_vertex = (e.name == "vertex");
+    const bool is_face = (e.name == "face");
+    if (is_vertex)
+      vertices->reserve(e.count);
+    else if (is_face)
+      facets->reserve(e.count);
+
+    for (unsigned j=0; j< e.count; j++)
+    {
+      double v[3] = { 0.0, 0.0, 0.0 };
+      for (unsigned k=0; k< e.properties.size(); k++)
+      {
+        const PLYProperty& prop = e.properties[k];
+        if (prop.list)
+        {
+          // get the number of entries in the list
+          unsigned n = (unsigned) read_ply_value(p, end, ascii, prop.count_type, false, false, swap);
+          const bool is_indices = is_face && (prop.name == "vertex_indices" || prop.name == "vertex_index");
+          if (is_indices)
+            poly.clear();
+          for (unsigned m=0; m< n; m++)
+          {
+            double x = read_ply_value(p, end, ascii, prop.type, prop.floating, prop.is_signed, swap);
+            if (is_indices)
+              poly.push_back((long) x);
+          }
+
+          // create the indexed triangles (as a fan)
+          if (is_indices)
+            for (unsigned m=2; m< poly.size(); m++)
+              facets->push_back(IndexedTri((unsigned) poly[0], (unsigned) poly[m-1], (unsigned) poly[m]));
+        }
+        else
+        {
+          double x = read_ply_value(p, end, ascii, prop.type, prop.floating, prop.is_signed, swap);
+          if (is_vertex)
+          {
+            if (prop.name == "x")
+              v[X] = x;
+            else if (prop.name == "y")
+              v[Y] = x;
+            else if (prop.name == "z")
+              v[Z] = x;
+          }
+        }
+      }
+
+      // store the vertex
+      if (is_vertex)
+        vertices->push_back(Vector3((Real) v[X], (Real) v[Y], (Real) v[Z]));
+    }
+  }
+
+  return create_from_parsed(vertices, facets, filename);
+}
+
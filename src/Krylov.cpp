@@ -0,0 +1,591 @@
+/****************************************************************************
+ * Copyright 2011 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#include <cmath>
+#include <algorithm>
+#include <Moby/Log.h>
+#include <Moby/MissizeException.h>
+#include <Moby/NonsquareMatrixException.h>
+#include <Moby/Krylov.h>
+
+using std::vector;
+using boost::shared_array;
+using namespace Moby;
+
+KrylovParams::KrylovParams()
+{
+  n = 0;
+  mult = transpose_mult = precond = NULL;
+  data = precond_data = NULL;
+  tol = NEAR_ZERO;
+  damp = (Real) 0.0;
+  max_iterations = std::numeric_limits<unsigned>::max();
+  iterations = 0;
+  residual = (Real) 0.0;
+}
+
+KrylovParams::KrylovParams(unsigned n, void (*mult)(const VectorN&, VectorN&, void*), void* data)
+{
+  this->n = n;
+  this->mult = mult;
+  this->data = data;
+  transpose_mult = precond = NULL;
+  precond_data = NULL;
+  tol = NEAR_ZERO;
+  damp = (Real) 0.0;
+  max_iterations = std::numeric_limits<unsigned>::max();
+  iterations = 0;
+  residual = (Real) 0.0;
+}
+
+/// Applies the preconditioner of the parameters (or the identity if there is none)
+static void apply_precond(const KrylovParams& params, const VectorN& r, VectorN& z)
+{
+  if (params.precond)
+    params.precond(r, z, params.precond_data);
+  else
+    z.copy_from(r);
+}
+
+/// Sets x to the initial iterate and r to the initial residual b - A*x
+static void init_residual(const KrylovParams& params, const VectorN& b, VectorN& x, VectorN& r)
+{
+  if (b.size() != params.n)
+    throw MissizeException();
+
+  if (x.size() == params.n)
+  {
+    params.mult(x, r, params.data);
+    r.negate() += b;
+  }
+  else
+  {
+    x.set_zero(params.n);
+    r.copy_from(b);
+  }
+}
+
+/// Solves A*x = b for symmetric positive definite A using the preconditioned conjugate gradient method
+/**
+ * \return <b>true</b> if the tolerance was met; <b>false</b> if the
+ *         iteration budget was exhausted or A was found to not be positive
+ *         definite
+ */
+bool Krylov::pcg(KrylovParams& params, const VectorN& b, VectorN& x)
+{
+  VectorN r, z, p, q;
+
+  // setup the initial residual
+  params.iterations = 0;
+  init_residual(params, b, x, r);
+  const Real bnorm = b.norm();
+  if (bnorm == (Real) 0.0)
+  {
+    x.set_zero(params.n);
+    params.residual = (Real) 0.0;
+    return true;
+  }
+  params.residual = r.norm()/bnorm;
+  if (params.residual <= params.tol)
+    return true;
+
+  // setup the first search direction
+  apply_precond(params, r, z);
+  p.copy_from(z);
+  Real rz = r.dot(z);
+
+  while (params.iterations < params.max_iterations)
+  {
+    params.iterations++;
+
+    // compute the step along the search direction
+    params.mult(p, q, params.data);
+    const Real pq = p.dot(q);
+    if (!(pq > (Real) 0.0))
+    {
+      FILE_LOG(LOG_LINALG) << "Krylov::pcg() - matrix is not positive definite" << std::endl;
+      return false;
+    }
+    const Real alpha = rz/pq;
+    x += p*alpha;
+    r -= q*alpha;
+
+    // check for convergence
+    params.residual = r.norm()/bnorm;
+    if (params.residual <= params.tol)
+      return true;
+
+    // update the search direction
+    apply_precond(params, r, z);
+    const Real rz_new = r.dot(z);
+    const Real beta = rz_new/rz;
+    rz = rz_new;
+    p = z + p*beta;
+  }
+
+  FILE_LOG(LOG_LINALG) << "Krylov::pcg() - iteration limit reached; relative residual: " << params.residual << std::endl;
+  return false;
+}
+
+/// Solves A*x = b for symmetric A using the (preconditioned) minimum residual method
+/**
+ * A may be indefinite; if it is singular, the iterates approach a least
+ * squares solution.  The residual and the right hand side are both measured
+ * in the norm defined by the inverse of the preconditioner (the Euclidean
+ * norm if there is no preconditioner).
+ * \return <b>true</b> if the tolerance was met; <b>false</b> if the
+ *         iteration budget was exhausted or the preconditioner was found to
+ *         not be positive definite
+ */
+bool Krylov::minres(KrylovParams& params, const VectorN& b, VectorN& x)
+{
+  const Real EPS = std::numeric_limits<Real>::epsilon();
+  VectorN r1, r2, y, v, w, w1, w2;
+
+  // setup the initial residual and the first Lanczos vector
+  params.iterations = 0;
+  const bool X0 = (x.size() == params.n);
+  init_residual(params, b, x, r1);
+  apply_precond(params, r1, y);
+  Real beta1 = r1.dot(y);
+  if (beta1 < (Real) 0.0)
+  {
+    FILE_LOG(LOG_LINALG) << "Krylov::minres() - preconditioner is not positive definite" << std::endl;
+    return false;
+  }
+  beta1 = std::sqrt(beta1);
+
+  // determine the norm of b (r1 = b if the initial iterate is zero)
+  Real bnorm = beta1;
+  if (X0)
+  {
+    apply_precond(params, b, v);
+    bnorm = std::sqrt(std::max(b.dot(v), (Real) 0.0));
+  }
+  if (bnorm == (Real) 0.0)
+  {
+    x.set_zero(params.n);
+    params.residual = (Real) 0.0;
+    return true;
+  }
+  params.residual = beta1/bnorm;
+  if (params.residual <= params.tol)
+    return true;
+
+  // initialize the recurrences
+  r2.copy_from(r1);
+  w.set_zero(params.n);
+  w2.set_zero(params.n);
+  Real oldb = (Real) 0.0, beta = beta1, dbar = (Real) 0.0, epsln = (Real) 0.0;
+  Real phibar = beta1, cs = (Real) -1.0, sn = (Real) 0.0;
+
+  while (params.iterations < params.max_iterations)
+  {
+    params.iterations++;
+
+    // perform the next step of the Lanczos process
+    v.copy_from(y) /= beta;
+    params.mult(v, y, params.data);
+    if (params.iterations > 1)
+      y -= r1*(beta/oldb);
+    const Real alpha = v.dot(y);
+    y -= r2*(alpha/beta);
+    r1.copy_from(r2);
+    r2.copy_from(y);
+    apply_precond(params, r2, y);
+    oldb = beta;
+    beta = r2.dot(y);
+    if (beta < (Real) 0.0)
+    {
+      FILE_LOG(LOG_LINALG) << "Krylov::minres() - preconditioner is not positive definite" << std::endl;
+      return false;
+    }
+    beta = std::sqrt(beta);
+
+    // apply the previous rotation and compute the next one
+    const Real oldeps = epsln;
+    const Real delta = cs*dbar + sn*alpha;
+    const Real gbar = sn*dbar - cs*alpha;
+    epsln = sn*beta;
+    dbar = -cs*beta;
+    const Real gamma = std::max(std::sqrt(gbar*gbar + beta*beta), EPS);
+    cs = gbar/gamma;
+    sn = beta/gamma;
+    const Real phi = cs*phibar;
+    phibar *= sn;
+
+    // update the solution
+    w1.copy_from(w2);
+    w2.copy_from(w);
+    w = (v - w1*oldeps - w2*delta)/gamma;
+    x += w*phi;
+
+    // check for convergence
+    params.residual = phibar/bnorm;
+    if (params.residual <= params.tol || beta == (Real) 0.0)
+      return true;
+  }
+
+  FILE_LOG(LOG_LINALG) << "Krylov::minres() - iteration limit reached; relative residual: " << params.residual << std::endl;
+  return false;
+}
+
+/// Solves the (damped) least squares problem min ||A*x - b||^2 + damp^2*||x||^2 using LSQR
+/**
+ * A need not be square; for rank deficient or underdetermined systems
+ * (starting from x = 0), the minimum norm solution is computed.  An initial
+ * iterate is only used if params.damp is zero.  params.transpose_mult must
+ * be set and params.precond is ignored.
+ * \return <b>true</b> if either the residual or the normal equations
+ *         residual met the tolerance
+ */
+bool Krylov::lsqr(KrylovParams& params, const VectorN& b, VectorN& x)
+{
+  const Real damp = params.damp;
+  const Real tol = params.tol;
+  VectorN u, v, w, dx, tmp;
+
+  // solve for a correction to any initial iterate
+  params.iterations = 0;
+  params.residual = (Real) 0.0;
+  if (damp == (Real) 0.0)
+  {
+    if (x.size() == params.n)
+    {
+      params.mult(x, u, params.data);
+      u.negate() += b;
+    }
+    else
+    {
+      x.set_zero(params.n);
+      u.copy_from(b);
+    }
+  }
+  else
+  {
+    x.set_zero(params.n);
+    u.copy_from(b);
+  }
+  dx.set_zero(params.n);
+
+  // setup first vectors u and v for bidiagonalization.  These satisfy
+  // beta*u = b, alpha*v = A'u
+  Real alpha = (Real) 0.0;
+  Real beta = u.norm();
+  if (beta > (Real) 0.0)
+  {
+    u /= beta;
+    params.transpose_mult(u, v, params.data);
+    alpha = v.norm();
+  }
+  else
+    v.set_zero(params.n);
+  if (alpha > (Real) 0.0)
+    v /= alpha;
+  w.copy_from(v);
+
+  // look for solution x = 0
+  if (alpha * beta == (Real) 0.0)
+    return true;
+
+  Real rhobar = alpha;
+  Real phibar = beta;
+  const Real bnorm = beta;
+  Real anorm = (Real) 0.0, xnorm = (Real) 0.0, xxnorm = (Real) 0.0;
+  Real res2 = (Real) 0.0, z = (Real) 0.0, cs2 = (Real) -1.0, sn2 = (Real) 0.0;
+
+  // main iteration loop
+  bool converged = false;
+  while (params.iterations < params.max_iterations && !converged)
+  {
+    params.iterations++;
+
+    // perform the next step of the bidiagonalization to obtain the next beta,
+    // u, alpha, v.  These satisfy the relations
+    // beta*u = A*v - alpha*u
+    // alpha*v = A'*u - beta*v
+    u *= -alpha;
+    params.mult(v, tmp, params.data);
+    u += tmp;
+    beta = u.norm();
+    anorm = std::sqrt(anorm*anorm + alpha*alpha + beta*beta + damp*damp);
+    if (beta > (Real) 0.0)
+    {
+      u /= beta;
+      v *= -beta;
+      params.transpose_mult(u, tmp, params.data);
+      v += tmp;
+      alpha = v.norm();
+      if (alpha > (Real) 0.0)
+        v /= alpha;
+    }
+
+    // use a plane rotation to eliminate the damping parameter.  This alters
+    // the diagonal (rhobar) of the lower bidiagonal matrix
+    const Real rhobar1 = std::sqrt(rhobar*rhobar + damp*damp);
+    const Real cs1 = rhobar / rhobar1;
+    const Real sn1 = damp / rhobar1;
+    const Real psi = sn1 * phibar;
+    phibar = cs1 * phibar;
+
+    // use a plane rotation to eliminate the subdiagonal element (beta) of the
+    // lower bidiagonal matrix, giving an upper bidiagonal matrix
+    const Real rho = std::sqrt(rhobar1*rhobar1 + beta*beta);
+    const Real cs = rhobar1/rho;
+    const Real sn = beta/rho;
+    const Real theta = sn*alpha;
+    rhobar = -cs*alpha;
+    const Real phi = cs*phibar;
+    phibar = sn*phibar;
+    const Real tau = sn*phi;
+
+    // update x and w
+    dx += w*(phi/rho);
+    w = v - w*(theta/rho);
+
+    // use a plane rotation on the right to eliminate the super-diagonal
+    // element (theta) of the upper bidiagonal matrix.  Then use the result
+    // to estimate norm(x)
+    const Real delta = sn2 * rho;
+    const Real gambar = -cs2 * rho;
+    const Real rhs = phi - delta * z;
+    const Real zbar = rhs / gambar;
+    xnorm = std::sqrt(xxnorm + zbar*zbar);
+    const Real gamma = std::sqrt(gambar*gambar + theta*theta);
+    cs2 = gambar / gamma;
+    sn2 = theta / gamma;
+    z = rhs / gamma;
+    xxnorm += z*z;
+
+    // test for convergence.  first, estimate the norms of rbar and Abar'rbar
+    res2 += psi*psi;
+    const Real rnorm = std::sqrt(phibar*phibar + res2);
+    const Real arnorm = alpha*std::fabs(tau);
+    const Real test1 = rnorm / bnorm;
+    const Real test2 = (rnorm > (Real) 0.0) ? arnorm/(anorm*rnorm) : (Real) 0.0;
+    const Real rtol = tol + tol*anorm*xnorm / bnorm;
+    params.residual = test1;
+
+    // allow for tolerances set by the user (which may be zero, in which case
+    // the iteration stops when the tests reach machine precision)
+    if (test2 <= tol || test1 <= rtol)
+      converged = true;
+    else if ((Real) 1.0 + test2 <= (Real) 1.0)
+      converged = true;
+    else if ((Real) 1.0 + test1/((Real) 1.0 + anorm*xnorm/bnorm) <= (Real) 1.0)
+      converged = true;
+  }
+
+  x += dx;
+  if (!converged)
+    FILE_LOG(LOG_LINALG) << "Krylov::lsqr() - iteration limit reached; relative residual: " << params.residual << std::endl;
+  return converged;
+}
+
+/// Operator that computes y = A*x for a dense matrix A (passed as a const MatrixN*)
+void Krylov::mult_dense(const VectorN& x, VectorN& y, void* A)
+{
+  ((const MatrixN*) A)->mult(x, y);
+}
+
+/// Operator that computes y = A'*x for a dense matrix A (passed as a const MatrixN*)
+void Krylov::transpose_mult_dense(const VectorN& x, VectorN& y, void* A)
+{
+  ((const MatrixN*) A)->transpose_mult(x, y);
+}
+
+/// Operator that computes y = A*x for a sparse matrix A (passed as a const SparseMatrixN*)
+void Krylov::mult_sparse(const VectorN& x, VectorN& y, void* A)
+{
+  ((const SparseMatrixN*) A)->mult(x, y);
+}
+
+/// Operator that computes y = A'*x for a sparse matrix A (passed as a const SparseMatrixN*)
+void Krylov::transpose_mult_sparse(const VectorN& x, VectorN& y, void* A)
+{
+  ((const SparseMatrixN*) A)->transpose_mult(x, y);
+}
+
+/// Sets up the preconditioner from the diagonal of the coefficient matrix
+/**
+ * Nonpositive diagonal elements are treated as ones.
+ */
+void JacobiPreconditioner::set(const VectorN& diag)
+{
+  _inv_diag.resize(diag.size());
+  for (unsigned i=0; i< diag.size(); i++)
+    _inv_diag[i] = (diag[i] > (Real) 0.0) ? (Real) 1.0/diag[i] : (Real) 1.0;
+}
+
+/// Sets up the preconditioner from the diagonal of a sparse matrix
+void JacobiPreconditioner::set(const SparseMatrixN& A)
+{
+  if (A.rows() != A.columns())
+    throw NonsquareMatrixException();
+
+  shared_array<unsigned> ptr = A.get_ptr();
+  shared_array<unsigned> indices = A.get_indices();
+  shared_array<Real> data = A.get_data();
+  VectorN diag;
+  diag.set_zero(A.rows());
+  for (unsigned i=0; i< A.rows(); i++)
+    for (unsigned k=ptr[i]; k< ptr[i+1]; k++)
+      if (indices[k] == i)
+        diag[i] += data[k];
+
+  set(diag);
+}
+
+/// Preconditioner callback that computes z = inv(D)*r (precond is a JacobiPreconditioner*)
+void JacobiPreconditioner::apply(const VectorN& r, VectorN& z, void* precond)
+{
+  const VectorN& inv_diag = ((const JacobiPreconditioner*) precond)->_inv_diag;
+  if (r.size() != inv_diag.size())
+    throw MissizeException();
+
+  z.resize(r.size());
+  for (unsigned i=0; i< r.size(); i++)
+    z[i] = r[i]*inv_diag[i];
+}
+
+/// Computes the incomplete Cholesky factorization of a symmetric matrix
+/**
+ * \return <b>true</b> if the factorization succeeded without a diagonal
+ *         shift, <b>false</b> if a shift was necessary
+ */
+bool IncompleteCholesky::factor(const SparseMatrixN& A)
+{
+  const unsigned MAX_ATTEMPTS = 20;
+
+  if (A.rows() != A.columns())
+    throw NonsquareMatrixException();
+
+  if (factor(A, (Real) 0.0))
+    return true;
+
+  // increase the shift until the factorization succeeds
+  Real shift = (Real) 1e-3;
+  for (unsigned i=0; i< MAX_ATTEMPTS; i++, shift *= (Real) 4.0)
+    if (factor(A, shift))
+    {
+      FILE_LOG(LOG_LINALG) << "IncompleteCholesky::factor() - used diagonal shift of " << shift << std::endl;
+      return false;
+    }
+
+  // as a last resort, use the diagonal
+  FILE_LOG(LOG_LINALG) << "IncompleteCholesky::factor() - factorization failed; using diagonal" << std::endl;
+  shared_array<unsigned> ptr = A.get_ptr();
+  shared_array<unsigned> indices = A.get_indices();
+  shared_array<Real> data = A.get_data();
+  _ptr.resize(_n+1);
+  _indices.resize(_n);
+  _data.resize(_n);
+  for (unsigned i=0; i< _n; i++)
+  {
+    _ptr[i] = i;
+    _indices[i] = i;
+    _data[i] = (Real) 1.0;
+    for (unsigned k=ptr[i]; k< ptr[i+1]; k++)
+      if (indices[k] == i && data[k] > (Real) 0.0)
+        _data[i] = std::sqrt(data[k]);
+  }
+  _ptr[_n] = _n;
+  return false;
+}
+
+/// Computes the zero fill incomplete Cholesky factorization of A + shift*diag(A)
+bool IncompleteCholesky::factor(const SparseMatrixN& A, Real shift)
+{
+  _n = A.rows();
+  _shift = shift;
+  shared_array<unsigned> ptr = A.get_ptr();
+  shared_array<unsigned> indices = A.get_indices();
+  shared_array<Real> data = A.get_data();
+
+  // copy the lower triangle of A (column indices are sorted, so the diagonal
+  // is the last element in each row)
+  _ptr.resize(_n+1);
+  _indices.clear();
+  _data.clear();
+  _ptr[0] = 0;
+  for (unsigned i=0; i< _n; i++)
+  {
+    Real diag = (Real) 0.0;
+    for (unsigned k=ptr[i]; k< ptr[i+1] && indices[k] < i; k++)
+    {
+      _indices.push_back(indices[k]);
+      _data.push_back(data[k]);
+    }
+    for (unsigned k=ptr[i]; k< ptr[i+1]; k++)
+      if (indices[k] == i)
+        diag += data[k];
+    _indices.push_back(i);
+    _data.push_back(diag*((Real) 1.0 + shift));
+    _ptr[i+1] = _indices.size();
+  }
+
+  // compute L row by row: L(i,k) = (A(i,k) - L(i,1:k-1)*L(k,1:k-1)')/L(k,k)
+  for (unsigned i=0; i< _n; i++)
+  {
+    const unsigned iend = _ptr[i+1]-1;
+    for (unsigned p=_ptr[i]; p< iend; p++)
+    {
+      // compute the dot product of the sparse rows i and k (columns < k)
+      const unsigned k = _indices[p];
+      const unsigned kend = _ptr[k+1]-1;
+      Real dot = (Real) 0.0;
+      for (unsigned q=_ptr[i], r=_ptr[k]; q< p && r< kend; )
+      {
+        if (_indices[q] < _indices[r])
+          q++;
+        else if (_indices[q] > _indices[r])
+          r++;
+        else
+          dot += _data[q++]*_data[r++];
+      }
+      _data[p] = (_data[p] - dot)/_data[kend];
+    }
+
+    // compute the diagonal element
+    Real d = _data[iend];
+    for (unsigned p=_ptr[i]; p< iend; p++)
+      d -= _data[p]*_data[p];
+    if (!(d > (Real) 0.0))
+      return false;
+    _data[iend] = std::sqrt(d);
+  }
+
+  return true;
+}
+
+/// Preconditioner callback that computes z = inv(L*L')*r (precond is an IncompleteCholesky*)
+void IncompleteCholesky::apply(const VectorN& r, VectorN& z, void* precond)
+{
+  const IncompleteCholesky& ic = *((const IncompleteCholesky*) precond);
+  if (r.size() != ic._n)
+    throw MissizeException();
+
+  // solve L*y = r
+  z.copy_from(r);
+  for (unsigned i=0; i< ic._n; i++)
+  {
+    const unsigned iend = ic._ptr[i+1]-1;
+    Real s = z[i];
+    for (unsigned p=ic._ptr[i]; p< iend; p++)
+      s -= ic._data[p]*z[ic._indices[p]];
+    z[i] = s/ic._data[iend];
+  }
+
+  // solve L'*z = y
+  for (unsigned i=ic._n; i-- > 0; )
+  {
+    const unsigned iend = ic._ptr[i+1]-1;
+    z[i] /= ic._data[iend];
+    for (unsigned p=ic._ptr[i]; p< iend; p++)
+      z[ic._indices[p]] -= ic._data[p]*z[i];
+  }
+}
+
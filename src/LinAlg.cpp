@@ -11,6 +11,7 @@
 #include <cmath>
 #include <limits>
 #include <cstdlib>
+#include <algorithm>
 #include <boost/algorithm/minmax.hpp>
 #include <Moby/FastThreadable.h>
 #include <Moby/cblas.h>
@@ -20,6 +21,9 @@
 #include <Moby/NumericalException.h>
 #include <Moby/SingularException.h>
 #include <Moby/Log.h>
+#include <Moby/BLASBackend.h>
+#include <Moby/SmallLinAlg.h>
+#include <Moby/Krylov.h>
 #include <Moby/LinAlg.h>
 
 using namespace Moby;
@@ -156,7 +160,7 @@ static void gesdd_(char* JOBZ, INTEGER* M, INTEGER* N, SINGLE* A, INTEGER* LDA,
   IWORK().resize(8*minmn);
 
   // call LAPACK to determine the optimal workspace size
-  sgesdd_(JOBZ, M, N, A, LDA, S, U, LDU, V, LDVT, &WORK_QUERY, &LWORK, IWORK(), INFO);
+  BLASBackend::routines().sgesdd(JOBZ, M, N, A, LDA, S, U, LDU, V, LDVT, &WORK_QUERY, &LWORK, IWORK(), INFO);
 
   // setup workspace
   LWORK = (INTEGER) WORK_QUERY;
@@ -164,7 +168,7 @@ static void gesdd_(char* JOBZ, INTEGER* M, INTEGER* N, SINGLE* A, INTEGER* LDA,
   WORK().resize(LWORK); 
 
   // call LAPACK once again
-  sgesdd_(JOBZ, M, N, A, LDA, S, U, LDU, V, LDVT, &WORK.front(), &LWORK, &IWORK().front(), INFO);
+  BLASBackend::routines().sgesdd(JOBZ, M, N, A, LDA, S, U, LDU, V, LDVT, &WORK.front(), &LWORK, &IWORK().front(), INFO);
 }
 
 /// Calls LAPACK function for svd 
@@ -175,7 +179,7 @@ static void gesvd_(char* JOBU, char* JOBV, INTEGER* M, INTEGER* N, SINGLE* A, IN
   INTEGER LWORK = -1;
 
   // call LAPACK to determine the optimal workspace size
-  sgesvd_(JOBU, JOBV, M, N, A, LDA, S, U, LDU, V, LDVT, &WORK_QUERY, &LWORK, INFO);
+  BLASBackend::routines().sgesvd(JOBU, JOBV, M, N, A, LDA, S, U, LDU, V, LDVT, &WORK_QUERY, &LWORK, INFO);
 
   // setup workspace
   LWORK = (INTEGER) WORK_QUERY;
@@ -183,7 +187,7 @@ static void gesvd_(char* JOBU, char* JOBV, INTEGER* M, INTEGER* N, SINGLE* A, IN
   WORK().resize(LWORK); 
 
   // call LAPACK once again
-  sgesvd_(JOBU, JOBV, M, N, A, LDA, S, U, LDU, V, LDVT, &WORK.front(), &LWORK, INFO);
+  BLASBackend::routines().sgesvd(JOBU, JOBV, M, N, A, LDA, S, U, LDU, V, LDVT, &WORK.front(), &LWORK, INFO);
 }
 
 /// Calls LAPACK function for computing eigenvalues and eigenvectors
@@ -194,7 +198,7 @@ static void syevd_(char* JOBZ, char* UPLO, INTEGER* N, SINGLE* A, INTEGER* LDA,
   INTEGER LWORK = -1;
   INTEGER IWORK_QUERY;
   INTEGER LIWORK = -1;
-  ssyevd_(JOBZ, UPLO, N, A, LDA, EVALS, &WORK_QUERY, &LWORK, &IWORK_QUERY, &LIWORK, INFO);
+  BLASBackend::routines().ssyevd(JOBZ, UPLO, N, A, LDA, EVALS, &WORK_QUERY, &LWORK, &IWORK_QUERY, &LIWORK, INFO);
 
   // set array sizes
   LWORK = (INTEGER) WORK_QUERY;
@@ -203,7 +207,7 @@ static void syevd_(char* JOBZ, char* UPLO, INTEGER* N, SINGLE* A, INTEGER* LDA,
   SAFESTATIC FastThreadable<vector<INTEGER> > IWORK;
   WORK().resize(LWORK);
   IWORK().resize(LIWORK);
-  ssyevd_(JOBZ, UPLO, N, A, LDA, EVALS, &WORK().front(), &LWORK, &IWORK().front(), &LIWORK, INFO);
+  BLASBackend::routines().ssyevd(JOBZ, UPLO, N, A, LDA, EVALS, &WORK().front(), &LWORK, &IWORK().front(), &LIWORK, INFO);
 }
 
 /// Calls LAPACK function for solving system of linear equations using LU factorization
@@ -215,7 +219,7 @@ static void gesv_(INTEGER* N, INTEGER* NRHS, SINGLE* A, INTEGER* LDA, INTEGER* I
 /// Calls LAPACK function for solving a system of linear equations from a Cholesky factorization
 static void potrs_(char* UPLO, INTEGER* N, INTEGER* NRHS, SINGLE* A, INTEGER* LDA, SINGLE* B, INTEGER* LDB, INTEGER* INFO)
 {
-  spotrs_(UPLO, N, NRHS, A, LDA, B, LDB, INFO);
+  BLASBackend::routines().spotrs(UPLO, N, NRHS, A, LDA, B, LDB, INFO);
 }
 
 /// Calls LAPACK function for computing matrix inverse using Cholesky factorization
@@ -227,7 +231,7 @@ static void potri_(char* UPLO, INTEGER* N, SINGLE* A, INTEGER* LDA, INTEGER* INF
 /// Calls LAPACK function for Cholesky factorization
 static void potrf_(char* UPLO, INTEGER* N, SINGLE* A, INTEGER* LDA, INTEGER* INFO)
 {
-  spotrf_(UPLO, N, A, LDA, INFO);
+  BLASBackend::routines().spotrf(UPLO, N, A, LDA, INFO);
 }
 
 /// Calls LAPACK function for solving system of equations Ax=b, where A is PSD
@@ -302,7 +306,7 @@ static void geqrf_(INTEGER* M, INTEGER* N, SINGLE* A, INTEGER* LDA, SINGLE* TAU,
 /// Calls LAPACK function for LU factorization 
 static void getrf_(INTEGER* M, INTEGER* N, SINGLE* A, INTEGER* LDA, INTEGER* IPIV, INTEGER* INFO)
 {
-  sgetrf_(M, N, A, LDA, IPIV, INFO);
+  BLASBackend::routines().sgetrf(M, N, A, LDA, IPIV, INFO);
 }
 
 /// Calls LAPACK function for matrix inversion using LU factorization
@@ -328,7 +332,7 @@ static void getri_(INTEGER* N, SINGLE* A, INTEGER* LDA, INTEGER* IPIV, INTEGER*
 /// Calls LAPACK function for solving system of linear equations with a given LU factorization
 static void getrs_(char* TRANS, INTEGER* N, INTEGER* NRHS, SINGLE* A, INTEGER* LDA, INTEGER* IPIV, SINGLE* B, INTEGER* LDB, INTEGER* INFO)
 {
-  sgetrs_(TRANS, N, NRHS, A, LDA, IPIV, B, LDB, INFO);
+  BLASBackend::routines().sgetrs(TRANS, N, NRHS, A, LDA, IPIV, B, LDB, INFO);
 }
 
 /// Calls LAPACK function for forming Q from a QR factorization
@@ -478,7 +482,7 @@ static void gesdd_(char* JOBZ, INTEGER* M, INTEGER* N, DOUBLE* A, INTEGER* LDA,
   IWORK().resize(8*minmn);
 
   // call LAPACK to determine the optimal workspace size
-  dgesdd_(JOBZ, M, N, A, LDA, S, U, LDU, V, LDVT, &WORK_QUERY, &LWORK, &IWORK().front(), INFO);
+  BLASBackend::routines().dgesdd(JOBZ, M, N, A, LDA, S, U, LDU, V, LDVT, &WORK_QUERY, &LWORK, &IWORK().front(), INFO);
 
   // setup workspace
   LWORK = (INTEGER) WORK_QUERY;
@@ -486,7 +490,7 @@ static void gesdd_(char* JOBZ, INTEGER* M, INTEGER* N, DOUBLE* A, INTEGER* LDA,
   WORK().resize(LWORK); 
 
   // call LAPACK once again
-  dgesdd_(JOBZ, M, N, A, LDA, S, U, LDU, V, LDVT, &WORK().front(), &LWORK, &IWORK().front(), INFO);
+  BLASBackend::routines().dgesdd(JOBZ, M, N, A, LDA, S, U, LDU, V, LDVT, &WORK().front(), &LWORK, &IWORK().front(), INFO);
 }
 
 /// Calls LAPACK function for svd
@@ -497,7 +501,7 @@ static void gesvd_(char* JOBU, char* JOBV, INTEGER* M, INTEGER* N, DOUBLE* A, IN
   INTEGER LWORK = -1;
 
   // call LAPACK to determine the optimal workspace size
-  dgesvd_(JOBU, JOBV, M, N, A, LDA, S, U, LDU, V, LDVT, &WORK_QUERY, &LWORK, INFO);
+  BLASBackend::routines().dgesvd(JOBU, JOBV, M, N, A, LDA, S, U, LDU, V, LDVT, &WORK_QUERY, &LWORK, INFO);
 
   // setup workspace
   LWORK = (INTEGER) WORK_QUERY;
@@ -505,7 +509,7 @@ static void gesvd_(char* JOBU, char* JOBV, INTEGER* M, INTEGER* N, DOUBLE* A, IN
   WORK().resize(LWORK); 
 
   // call LAPACK once again
-  dgesvd_(JOBU, JOBV, M, N, A, LDA, S, U, LDU, V, LDVT, &WORK().front(), &LWORK, INFO);
+  BLASBackend::routines().dgesvd(JOBU, JOBV, M, N, A, LDA, S, U, LDU, V, LDVT, &WORK().front(), &LWORK, INFO);
 }
 
 /// Calls LAPACK function for computing eigenvalues and eigenvectors
@@ -516,7 +520,7 @@ static void syevd_(char* JOBZ, char* UPLO, INTEGER* N, DOUBLE* A, INTEGER* LDA,
   INTEGER LWORK = -1;
   INTEGER IWORK_QUERY;
   INTEGER LIWORK = -1;
-  dsyevd_(JOBZ, UPLO, N, A, LDA, EVALS, &WORK_QUERY, &LWORK, &IWORK_QUERY, &LIWORK, INFO);
+  BLASBackend::routines().dsyevd(JOBZ, UPLO, N, A, LDA, EVALS, &WORK_QUERY, &LWORK, &IWORK_QUERY, &LIWORK, INFO);
 
   // set array sizes
   LWORK = (INTEGER) WORK_QUERY;
@@ -526,7 +530,7 @@ static void syevd_(char* JOBZ, char* UPLO, INTEGER* N, DOUBLE* A, INTEGER* LDA,
   WORK().resize(LWORK);
   IWORK().resize(LIWORK);
 
-  dsyevd_(JOBZ, UPLO, N, A, LDA, EVALS, &WORK().front(), &LWORK, &IWORK().front(), &LIWORK, INFO);
+  BLASBackend::routines().dsyevd(JOBZ, UPLO, N, A, LDA, EVALS, &WORK().front(), &LWORK, &IWORK().front(), &LIWORK, INFO);
 }
 
 /// Calls LAPACK function for solving system of linear equations using LU factorization
@@ -538,7 +542,7 @@ static void gesv_(INTEGER* N, INTEGER* NRHS, DOUBLE* A, INTEGER* LDA, INTEGER* I
 /// Calls LAPACK function for solving a system of linear equation from a Cholesky factorization
 static void potrs_(char* UPLO, INTEGER* N, INTEGER* NRHS, DOUBLE* A, INTEGER* LDA, DOUBLE* B, INTEGER* LDB, INTEGER* INFO)
 {
-  dpotrs_(UPLO, N, NRHS, A, LDA, B, LDB, INFO);
+  BLASBackend::routines().dpotrs(UPLO, N, NRHS, A, LDA, B, LDB, INFO);
 }
 
 /// Calls LAPACK function for computing matrix inverse using Cholesky factorization
@@ -550,7 +554,7 @@ static void potri_(char* UPLO, INTEGER* N, DOUBLE* A, INTEGER* LDA, INTEGER* INF
 /// Calls LAPACK function for Cholesky factorization
 static void potrf_(char* UPLO, INTEGER* N, DOUBLE* A, INTEGER* LDA, INTEGER* INFO)
 {
-  dpotrf_(UPLO, N, A, LDA, INFO);
+  BLASBackend::routines().dpotrf(UPLO, N, A, LDA, INFO);
 }
 
 /// Calls LAPACK function for solving system of equations Ax=b, where A is PSD
@@ -625,7 +629,7 @@ static void geqrf_(INTEGER* M, INTEGER* N, DOUBLE* A, INTEGER* LDA, DOUBLE* TAU,
 /// Calls LAPACK function for LU factorization 
 static void getrf_(INTEGER* M, INTEGER* N, DOUBLE* A, INTEGER* LDA, INTEGER* IPIV, INTEGER* INFO)
 {
-  dgetrf_(M, N, A, LDA, IPIV, INFO);
+  BLASBackend::routines().dgetrf(M, N, A, LDA, IPIV, INFO);
 }
 
 /// Calls LAPACK function for matrix inversion using LU factorization
@@ -651,7 +655,7 @@ static void getri_(INTEGER* N, DOUBLE* A, INTEGER* LDA, INTEGER* IPIV, INTEGER*
 /// Calls LAPACK function for solving system of linear equations with a given LU factorization
 static void getrs_(char* TRANS, INTEGER* N, INTEGER* NRHS, DOUBLE* A, INTEGER* LDA, INTEGER* IPIV, DOUBLE* B, INTEGER* LDB, INTEGER* INFO)
 {
-  dgetrs_(TRANS, N, NRHS, A, LDA, IPIV, B, LDB, INFO);
+  BLASBackend::routines().dgetrs(TRANS, N, NRHS, A, LDA, IPIV, B, LDB, INFO);
 }
 
 /// Calls LAPACK function for forming Q from a QR factorization
@@ -975,6 +979,82 @@ static void orgqr_(INTEGER* M, INTEGER* N, INTEGER* K, mpfr::mpreal* A, INTEGER*
 #endif
 #endif
 
+/// The largest matrices factored and solved by the SmallLinAlg kernels
+static const unsigned SMALL_N = 6;
+
+/// Dispatches a Cholesky factorization of an n x n matrix, n <= SMALL_N
+static bool factor_chol_small(unsigned n, Real* A)
+{
+  switch (n)
+  {
+    case 1: return SmallLinAlg<1>::factor_chol(A);
+    case 2: return SmallLinAlg<2>::factor_chol(A);
+    case 3: return SmallLinAlg<3>::factor_chol(A);
+    case 4: return SmallLinAlg<4>::factor_chol(A);
+    case 5: return SmallLinAlg<5>::factor_chol(A);
+    case 6: return SmallLinAlg<6>::factor_chol(A);
+  }
+
+  assert(false);
+  return false;
+}
+
+/// Dispatches a solve using a Cholesky factor of an n x n matrix, n <= SMALL_N
+static void solve_chol_small(unsigned n, const Real* U, Real* xb)
+{
+  switch (n)
+  {
+    case 1: SmallLinAlg<1>::solve_chol(U, xb); break;
+    case 2: SmallLinAlg<2>::solve_chol(U, xb); break;
+    case 3: SmallLinAlg<3>::solve_chol(U, xb); break;
+    case 4: SmallLinAlg<4>::solve_chol(U, xb); break;
+    case 5: SmallLinAlg<5>::solve_chol(U, xb); break;
+    case 6: SmallLinAlg<6>::solve_chol(U, xb); break;
+    default: assert(false);
+  }
+}
+
+/// Dispatches an unpivoted LDL' factorization of an n x n matrix, n <= SMALL_N
+static bool factor_LDL_small(unsigned n, const Real* A, Real* LD)
+{
+  switch (n)
+  {
+    case 1: return SmallLinAlg<1>::factor_LDL(A, LD);
+    case 2: return SmallLinAlg<2>::factor_LDL(A, LD);
+    case 3: return SmallLinAlg<3>::factor_LDL(A, LD);
+    case 4: return SmallLinAlg<4>::factor_LDL(A, LD);
+    case 5: return SmallLinAlg<5>::factor_LDL(A, LD);
+    case 6: return SmallLinAlg<6>::factor_LDL(A, LD);
+  }
+
+  assert(false);
+  return false;
+}
+
+/// Dispatches a solve using an LDL' factorization of an n x n matrix, n <= SMALL_N
+static void solve_LDL_small(unsigned n, const Real* LD, Real* xb)
+{
+  switch (n)
+  {
+    case 1: SmallLinAlg<1>::solve_LDL(LD, xb); break;
+    case 2: SmallLinAlg<2>::solve_LDL(LD, xb); break;
+    case 3: SmallLinAlg<3>::solve_LDL(LD, xb); break;
+    case 4: SmallLinAlg<4>::solve_LDL(LD, xb); break;
+    case 5: SmallLinAlg<5>::solve_LDL(LD, xb); break;
+    case 6: SmallLinAlg<6>::solve_LDL(LD, xb); break;
+    default: assert(false);
+  }
+}
+
+/// Determines whether an LDL' factorization was computed without interchanges
+static bool is_unpivoted(const vector<int>& IPIV)
+{
+  for (unsigned i=0; i< IPIV.size(); i++)
+    if (IPIV[i] != (int) i+1)
+      return false;
+  return true;
+}
+
 /// Solves a tridiagonal system
 /**
  * \param dl the (n-1) elements on the subdiagonal (destroyed on return)
@@ -1065,6 +1145,19 @@ void LinAlg::factor_LDL(MatrixN& A, vector<int>& IPIV)
   // get A's data -- we're going to modify it directly
   Real* data = A.begin();
 
+  // positive definite matrices are factored without pivoting if small
+  if (A.rows() <= SMALL_N)
+  {
+    Real LD[SMALL_N*(SMALL_N+1)/2];
+    if (factor_LDL_small(A.rows(), data, LD))
+    {
+      std::copy(LD, LD+A.rows()*(A.rows()+1)/2, data);
+      for (unsigned i=0; i< A.rows(); i++)
+        IPIV[i] = (int) i+1;
+      return;
+    }
+  }
+
   // alter matrix to put into packed format
   for (unsigned j=0, k=0, r=0; j< A.rows(); j++, r++)
     for (unsigned i=0, s=0; i< A.columns(); i++, s+= A.rows())
@@ -1096,10 +1189,18 @@ bool LinAlg::factor_chol(MatrixN& A)
   INTEGER INFO;
 
   // perform the Cholesky factorization
-  potrf_(&UPLO, &N, A.data(), &N, &INFO);
-  assert(INFO >= 0);
-  if (INFO > 0)
-    return false;
+  if (A.rows() <= SMALL_N)
+  {
+    if (!factor_chol_small(A.rows(), A.data()))
+      return false;
+  }
+  else
+  {
+    potrf_(&UPLO, &N, A.data(), &N, &INFO);
+    assert(INFO >= 0);
+    if (INFO > 0)
+      return false;
+  }
 
   // make the matrix upper triangular
   A.zero_lower_triangle();
@@ -1259,7 +1360,7 @@ VectorN& LinAlg::solve_tri_fast(const MatrixN& A, bool utri, bool transpose_A, V
   if (A.rows() != xb.size())
     throw MissizeException();
 
-  if (A.rows() == A.columns())
+  if (A.rows() != A.columns())
     throw NonsquareMatrixException();
 
   if (A.rows() == 0)
@@ -1291,7 +1392,7 @@ MatrixN& LinAlg::solve_tri_fast(const MatrixN& A, bool utri, bool transpose_A, M
   if (A.rows() != XB.rows())
     throw MissizeException();
 
-  if (A.rows() == A.columns())
+  if (A.rows() != A.columns())
     throw NonsquareMatrixException();
 
   if (A.rows() == 0)
@@ -1326,6 +1427,13 @@ VectorN& LinAlg::solve_LDL_fast(const MatrixN& M, const vector<int>& IPIV, Vecto
   if (M.rows() == 0)
     return xb.set_zero();
 
+  // use the unrolled solver for small, unpivoted factorizations
+  if (M.rows() <= SMALL_N && is_unpivoted(IPIV))
+  {
+    solve_LDL_small(M.rows(), M.data(), xb.data());
+    return xb;
+  }
+
   // setup parameters for LAPACK
   char UPLO = 'L';
   INTEGER N = M.rows();
@@ -1357,8 +1465,16 @@ MatrixN& LinAlg::solve_LDL_fast(const MatrixN& M, const vector<int>& IPIV, Matri
   if (M.rows() == 0)
     return XB.set_zero();
 
-  // setup parameters for LAPACK
-  char UPLO = 'U';
+  // use the unrolled solver for small, unpivoted factorizations
+  if (M.rows() <= SMALL_N && is_unpivoted(IPIV))
+  {
+    for (unsigned j=0; j< XB.columns(); j++)
+      solve_LDL_small(M.rows(), M.data(), XB.data()+j*XB.rows());
+    return XB;
+  }
+
+  // setup parameters for LAPACK (factor_LDL() stores the lower triangle)
+  char UPLO = 'L';
   INTEGER N = M.rows();
   INTEGER NRHS = XB.columns();
   INTEGER LDB = XB.rows();
@@ -1401,6 +1517,13 @@ VectorN& LinAlg::solve_chol_fast(const MatrixN& M, VectorN& xb)
   if (M.rows() == 0)
     return xb.set_zero();
 
+  // use the unrolled solver for small matrices
+  if (M.rows() <= SMALL_N)
+  {
+    solve_chol_small(M.rows(), M.data(), xb.data());
+    return xb;
+  }
+
   // setup parameters for LAPACK
   char UPLO = 'U';
   INTEGER N = M.rows();
@@ -1447,6 +1570,14 @@ MatrixN& LinAlg::solve_chol_fast(const MatrixN& M, MatrixN& XB)
   if (M.rows() == 0 || XB.columns() == 0)
     return XB.set_zero();
 
+  // use the unrolled solver for small matrices
+  if (M.rows() <= SMALL_N)
+  {
+    for (unsigned j=0; j< XB.columns(); j++)
+      solve_chol_small(M.rows(), M.data(), XB.data()+j*XB.rows());
+    return XB;
+  }
+
   // setup parameters for LAPACK
   char UPLO = 'U';
   INTEGER N = M.rows();
@@ -2440,150 +2571,22 @@ VectorN& LinAlg::solve_LS_fast2(MatrixN& A, VectorN& xb)
  * \param b the r.h.s.
  * \param x on output, the least-squares solution to the system
  * \return a reference to x
+ * \note uses Krylov::lsqr()
  */
 VectorN& LinAlg::solve_LS(const SparseMatrixN& A, const VectorN& b, VectorN& x, Real damp, unsigned max_iter, Real tol)
 {
-  // init variables for LSQR
-  const unsigned m = A.rows();
-  const unsigned n = A.columns();
-  Real dampsq = damp*damp;
-  Real ddnorm = (Real) 0.0;
-  Real res2 = (Real) 0.0;
-  Real anorm = (Real) 0.0;
-  Real xnorm = (Real) 0.0;
-  Real xxnorm = (Real) 0.0;
-  Real z = (Real) 0.0;
-  Real cs2 = (Real) -1.0;
-  Real sn2 = (Real) 0.0;
-
-  // setup necessary vectors
-  VectorN u, v, w, tmp, dk;
-
-  // setup first vectors u and v for bidiagonalization.  These satisfy 
-  // beta*u = b, alpha*v = A'u
-  b.get_sub_vec(0, m, u);
-  x.set_zero(n);
-  Real alpha = (Real) 0.0;
-  Real beta = u.norm();
-  if (beta > (Real) 0.0)
-  {
-    u /= beta;
-    A.transpose_mult(u, v);
-    alpha = v.norm();
-  }
-  if (alpha > (Real) 0.0)
-  {
-    v/= alpha;
-    w.copy_from(v);
-  }
-
-  // look for solutio x = 0
-  Real arnorm = alpha * beta;
-  if (arnorm == (Real) 0.0)
-    return x;
-
-  Real rhobar = alpha;
-  Real phibar = beta;
-  Real bnorm = beta;
-  Real rnorm = beta;
-  Real r1norm = rnorm;
-  Real r2norm = rnorm;
-
-  // main iteration loop
-  for (unsigned iter = 0; iter < max_iter; iter++)
-  {
-    // perform the next step of the bidiagonalization to obtain the next beta,
-    // u, alpha, v.  These satisfy the relations
-    // beta*u = a*v - alpha*u
-    // alpha*v = A'*u - beta*v
-    tmp.copy_from(u);
-    u *= alpha;
-    A.mult(v, u) -= tmp;
-    beta = u.norm();
-    if (beta > (Real) 0.0)
-    {
-      u /= beta;
-      anorm = std::sqrt(anorm*anorm + alpha*alpha + beta*beta + damp*damp);
-      tmp.copy_from(v);
-      tmp *= beta;
-      A.transpose_mult(u, v) -= tmp;
-      alpha = v.norm();
-      if (alpha > (Real) 0.0)
-        v /= alpha;
-    }
-
-    // use a plane rotation to eliminate the damping parameter.  This alters
-    // the diagonal (rhobar) of the lower bidiagonal matrix
-    Real rhobar1 = std::sqrt(rhobar*rhobar + damp*damp);
-    Real cs1 = rhobar / rhobar1;
-    Real sn1 = damp / rhobar1;
-    Real psi = sn1 * phibar;
-    phibar = cs1 * phibar;
-
-    // use a plane rotation to eliminate the subdiagonal element (beta) of the
-    // lower bidiagonal matrix, giving an upper bidiagonal matrix
-    Real rho = std::sqrt(rhobar1*rhobar1 + beta*beta);
-    Real cs = rhobar1/rho;
-    Real sn = beta/rho;
-    Real theta = sn*alpha;
-    rhobar = -cs*alpha;
-    Real phi = cs*phibar;
-    phibar = sn*phibar;
-    Real tau = sn*phi;
-
-    // update x and w
-    Real t1 = phi / rho;
-    Real t2 = -theta / rho;
-    dk.copy_from(w);
-    dk /= rho;
-    tmp.copy_from(w) *= t1;
-    x += tmp;
-    tmp.copy_from(w) *= t2;
-    w.copy_from(v) += tmp;
-    ddnorm += dk.norm_sq();
-
-    // use a plane rotation on the right to eliminate the super-diagonal
-    // element (theta) of the upper bidiagonal matrix.  Then use the result
-    // to estimate norm(x)
-    Real delta = sn2 * rho;
-    Real gambar = -cs2 * rho;
-    Real rhs = phi - delta * z;
-    Real zbar = rhs / gambar;
-    xnorm = std::sqrt(xxnorm + zbar*zbar);
-    Real gamma = std::sqrt(gambar*gambar + theta*theta);
-    cs2 = gambar / gamma;
-    sn2 = theta / gamma;
-    Real z = rhs / gamma;
-    xxnorm = xxnorm + z*z;
-
-    // test for convergence.  first, estimate the norms of rbar and Abar'rbar
-    Real res1 = phibar*phibar;
-    res2 = res2 + psi*psi;
-    rnorm = std::sqrt(res1+res2);
-    arnorm = alpha*std::fabs(tau);
-    Real r1sq = rnorm*rnorm - dampsq*xxnorm;
-    r1norm = std::sqrt(std::fabs(r1sq));
-    if (r1sq < 0)
-      r1norm = -r1norm;
-    r2norm = rnorm;
-
-    // now use these norms to estimate certain other quantities, some of which
-    // will be small near a solution
-    Real test1 = rnorm / bnorm;
-    Real test2 = arnorm/(anorm*rnorm);
-    t1 = test1 / ((Real) 1.0 + anorm*xnorm/bnorm);
-    Real rtol = tol + tol*anorm*xnorm / bnorm;
-
-    // following tests guard against extremely small values of tol
-    if ((Real) 1.0 + test2 <= (Real) 1.0)
-      break;
-    if ((Real) 1.0 + t1 <= (Real) 1.0)
-      break;
-
-    // allow for tolerances set by the user
-    if (test2 <= tol || test1 <= rtol)
-      break;
-  }
+  // setup the LSQR operators
+  KrylovParams params(A.columns(), Krylov::mult_sparse, (void*) &A);
+  params.transpose_mult = Krylov::transpose_mult_sparse;
+  params.damp = damp;
+  params.max_iterations = max_iter;
+  params.tol = tol;
+
+  // solve starting from x = 0
+  VectorN bm;
+  b.get_sub_vec(0, A.rows(), bm);
+  x.resize(0);
+  Krylov::lsqr(params, bm, x);
 
   return x;
 }
@@ -1,4 +1,5 @@
 #include <sstream>
+#include <algorithm>
 #include <Moby/RigidBody.h>
 #include <Moby/Joint.h>
 #include <Moby/XMLTree.h>
@@ -8,6 +9,7 @@
 #include <Moby/select>
 #include <Moby/SingularException.h>
 #include <Moby/NumericalException.h>
+#include <Moby/DelassusOperator.h>
 #include <Moby/MCArticulatedBody.h>
 
 using namespace Moby;
@@ -16,7 +18,9 @@ using std::list;
 using std::map;
 using std::string;
 using std::endl;
+using std::pair;
 using boost::shared_ptr;
+using boost::shared_array;
 using boost::static_pointer_cast;
 using boost::dynamic_pointer_cast;
 
@@ -236,22 +240,15 @@ void MCArticulatedBody::precalc()
     // determine the sparse inertias 
     determine_inertias();
 
-    // now form Jx_iM_Jx' and its inverse
+    // now form Jx_iM_Jx' and factor it; if it is rank deficient, it is
+    // applied through the inverse inertia instead (see solve_Jx_iM_JxT())
     _rank_def = false;
-    calc_Jx_iM_JyT(_Jx, _Jx, _Jx_iM_JxT);
-    _inv_Jx_iM_JxT.copy_from(_Jx_iM_JxT);
-    if (!LinAlg::factor_chol(_inv_Jx_iM_JxT))
+    SparseMatrixN sJx_iM_JxT;
+    calc_Jx_iM_JyT(_Jx, _Jx, sJx_iM_JxT).to_dense(_Jx_iM_JxT);
+    if (!_Jx_iM_JxT_chol.factor(sJx_iM_JxT))
     {  
-      _inv_Jx_iM_JxT.copy_from(_Jx_iM_JxT);
-      try
-      {
-        LinAlg::pseudo_inverse(_inv_Jx_iM_JxT, LinAlg::svd1);
-      }
-      catch (NumericalException e)
-      {
-        _inv_Jx_iM_JxT.copy_from(_Jx_iM_JxT);
-        LinAlg::pseudo_inverse(_inv_Jx_iM_JxT, LinAlg::svd2);
-      }
+      to_sparse(_Jx, false, _sJx);
+      _Jx_iM_JxT_precond.set(sJx_iM_JxT);
       _rank_def = true;
     }
 
@@ -281,15 +278,33 @@ void MCArticulatedBody::precalc()
 }
 
 /// Solves J*iM*J'*x = rhs for x
-VectorN& MCArticulatedBody::solve_Jx_iM_JxT(const VectorN& rhs, VectorN& x) const
+/**
+ * If J*iM*J' is rank deficient (e.g., due to redundant constraints), the
+ * minimum residual solution is found using MINRES, which applies J*iM*J'
+ * through solve_generalized_inertia() without forming it.
+ */
+VectorN& MCArticulatedBody::solve_Jx_iM_JxT(const VectorN& rhs, VectorN& x)
 {
   if (!_rank_def)
   {
     x.copy_from(rhs);
-    LinAlg::solve_chol_fast(_inv_Jx_iM_JxT, x);
+    _Jx_iM_JxT_chol.solve(x);
+    return x;
   }
-  else
-    _inv_Jx_iM_JxT.mult(rhs, x);
+
+  // setup the operator; MINRES terminates within rank(J*iM*J') iterations
+  // in exact arithmetic, so the iteration budget allows for round-off
+  DelassusOperator op(_sJx, get_this());
+  KrylovParams params(rhs.size(), &DelassusOperator::mult, &op);
+  params.precond = &JacobiPreconditioner::apply;
+  params.precond_data = &_Jx_iM_JxT_precond;
+  params.max_iterations = rhs.size()*2;
+
+  // solve starting from x = 0 (rhs may be inconsistent, in which case the
+  // tolerance is not met)
+  x.resize(0);
+  if (!Krylov::minres(params, rhs, x))
+    FILE_LOG(LOG_DYNAMICS) << "MCArticulatedBody::solve_Jx_iM_JxT() - MINRES relative residual " << params.residual << " after " << params.iterations << " iterations" << std::endl;
 
   return x;
 }
@@ -2273,66 +2288,94 @@ Real MCArticulatedBody::sgn(Real x)
 /// Sets up a sparse Jacobian multiplied by the inverse inertia matrix multiplied by the transpose of a sparse Jacobian
 MatrixN& MCArticulatedBody::calc_Jx_iM_JyT(const SparseJacobian& Jx, const SparseJacobian& Jy, MatrixN& Jx_iM_JyT) const
 {
-  const unsigned SPATIAL_DIM = 6;
-
-  // setup the matrix Jx_iM_Jx'
-  Jx_iM_JyT.set_zero(Jx.rows(), Jy.rows());
+  SparseMatrixN sJx_iM_JyT;
+  calc_Jx_iM_JyT(Jx, Jy, sJx_iM_JyT).to_dense(Jx_iM_JyT);
 
-  // loop over all links 
-  for (unsigned k=0; k< _links.size(); k++)
-  {
-    // skip disabled bodies
-    if (!_links[k]->is_enabled())
-      continue;
+  FILE_LOG(LOG_DYNAMICS) << "J*inv(M)*J': " << std::endl << Jx_iM_JyT;
 
-    // get the inverse mass and inverse inertia (global frame)
-    Real inv_mass = _links[k]->get_inv_mass();
-    Matrix3 R(&_links[k]->get_orientation());
-    Matrix3 J_inv = R * _links[k]->get_inv_inertia() * Matrix3::transpose(R);
+  return Jx_iM_JyT;
+}
 
-    // loop over all rows of Jx and Jy 
-    for (unsigned rowJx=0; rowJx < Jx.rows(); rowJx++)
-    {
-      // loop over all blocks in this row of Jx
-      for (unsigned m=0, r=0; m< Jx.indices[rowJx].size(); m++, r+= SPATIAL_DIM)
-      {
-        // get the rigid body responsible for this block of Jx
-        if (Jx.indices[rowJx][m] != k)
-          continue;
+/// Computes Jx*iM*Jy' as a sparse matrix
+/**
+ * The cost of forming the product is proportional to its number of nonzero
+ * elements, which grows linearly (rather than quadratically) with the number
+ * of links for chains and trees.
+ */
+SparseMatrixN& MCArticulatedBody::calc_Jx_iM_JyT(const SparseJacobian& Jx, const SparseJacobian& Jy, SparseMatrixN& Jx_iM_JyT) const
+{
+  SparseMatrixN Jx_iM, sJy;
+  to_sparse(Jx, true, Jx_iM);
+  to_sparse(Jy, false, sJy);
+  return Jx_iM.mult_transpose(sJy, Jx_iM_JyT);
+}
 
-        // get the velocity vectors
-        Vector3 l1(Jx(rowJx, r+0), Jx(rowJx, r+1), Jx(rowJx, r+2));
-        Vector3 a1(Jx(rowJx, r+3), Jx(rowJx, r+4), Jx(rowJx, r+5));
+/// Converts a sparse Jacobian to a sparse matrix over the generalized coordinates
+/**
+ * \param J the sparse Jacobian
+ * \param scale_iM if <b>true</b>, computes J*iM rather than J
+ * \param Js the sparse matrix on return; blocks for disabled links are omitted
+ */
+SparseMatrixN& MCArticulatedBody::to_sparse(const SparseJacobian& J, bool scale_iM, SparseMatrixN& Js) const
+{
+  const unsigned SPATIAL_DIM = 6;
+  const unsigned NGC = _gc_indices.back();
+  assert(J.rows() == J.indices.size());
 
-        // scale the spatial vectors using the inverse inertias
-        l1 *= inv_mass;
-        a1 = J_inv * a1;
+  // order the blocks in each row by generalized coordinate index
+  vector<vector<pair<unsigned, unsigned> > > blocks(J.rows());
+  unsigned nv = 0;
+  for (unsigned i=0; i< J.rows(); i++)
+  {
+    for (unsigned j=0; j< J.indices[i].size(); j++)
+    {
+      const unsigned k = J.indices[i][j];
+      if (_links[k]->is_enabled())
+        blocks[i].push_back(std::make_pair(_gc_indices[k], j));
+    }
+    std::sort(blocks[i].begin(), blocks[i].end());
+    nv += blocks[i].size()*SPATIAL_DIM;
+  }
 
-        // loop over all rows of Jy 
-        for (unsigned rowJy=0; rowJy < Jy.rows(); rowJy++)
-        {
-          // loop over all blocks in this row of Jy
-          for (unsigned n=0, s=0; n< Jy.indices[rowJy].size(); n++, s+= SPATIAL_DIM)
-          {
-            // get the rigid body responsible for this row of Jy'
-            if (Jy.indices[rowJy][n] != k)
-              continue;
+  // setup the arrays
+  shared_array<unsigned> ptr(new unsigned[J.rows()+1]);
+  shared_array<unsigned> indices(new unsigned[nv]);
+  shared_array<Real> data(new Real[nv]);
+  ptr[0] = 0;
+  for (unsigned i=0, r=0; i< J.rows(); i++)
+  {
+    for (unsigned b=0; b< blocks[i].size(); b++)
+    {
+      const unsigned gcidx = blocks[i][b].first;
+      const unsigned Jidx = blocks[i][b].second*SPATIAL_DIM;
+      Vector3 l(J(i, Jidx+0), J(i, Jidx+1), J(i, Jidx+2));
+      Vector3 a(J(i, Jidx+3), J(i, Jidx+4), J(i, Jidx+5));
 
-            // get the velocity vectors
-            Vector3 l2(Jy(rowJy, s+0), Jy(rowJy, s+1), Jy(rowJy, s+2));
-            Vector3 a2(Jy(rowJy, s+3), Jy(rowJy, s+4), Jy(rowJy, s+5));
+      // scale the spatial vectors using the inverse inertias (global frame)
+      if (scale_iM)
+      {
+        RigidBodyPtr link = _links[J.indices[i][blocks[i][b].second]];
+        Matrix3 R(&link->get_orientation());
+        l *= link->get_inv_mass();
+        a = R * link->get_inv_inertia() * Matrix3::transpose(R) * a;
+      }
 
-            // compute the dot product
-            Jx_iM_JyT(rowJx, rowJy) += l1.dot(l2) + a1.dot(a2);
-          }
-        }
+      for (unsigned m=0; m< 3; m++)
+      {
+        indices[r] = gcidx+m;
+        data[r++] = l[m];
+      }
+      for (unsigned m=0; m< 3; m++)
+      {
+        indices[r] = gcidx+3+m;
+        data[r++] = a[m];
       }
     }
+    ptr[i+1] = r;
   }
 
-  FILE_LOG(LOG_DYNAMICS) << "J*inv(M)*J': " << std::endl << Jx_iM_JyT;
-
-  return Jx_iM_JyT;
+  Js = SparseMatrixN(J.rows(), NGC, ptr, indices, data);
+  return Js;
 }
 
 /// Multiplies a sparse jacobian by a vector
@@ -0,0 +1,64 @@
+/****************************************************************************
+ * Copyright 2011 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public 
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdexcept>
+#include <Moby/MappedFile.h>
+
+using namespace Moby;
+using std::string;
+
+/// Maps the given file into memory (read only)
+MappedFile::MappedFile(const string& filename)
+{
+  _data = NULL;
+  _size = 0;
+
+  // open the file
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error(string("MappedFile::MappedFile() - unable to open ") + filename);
+
+  // get the size of the file
+  struct stat st;
+  if (fstat(fd, &st) != 0)
+  {
+    close(fd);
+    throw std::runtime_error(string("MappedFile::MappedFile() - unable to stat ") + filename);
+  }
+
+  // empty files cannot be mapped; leave the mapping empty
+  _size = (std::size_t) st.st_size;
+  if (_size == 0)
+  {
+    close(fd);
+    return;
+  }
+
+  // map the file; the descriptor is not needed once the mapping exists
+  void* addr = mmap(NULL, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED)
+  {
+    _size = 0;
+    throw std::runtime_error(string("MappedFile::MappedFile() - unable to map ") + filename);
+  }
+
+  // we will read the file front to back
+  madvise(addr, _size, MADV_SEQUENTIAL);
+  _data = (const char*) addr;
+}
+
+/// Unmaps the file
+MappedFile::~MappedFile()
+{
+  if (_data)
+    munmap((void*) _data, _size);
+}
+
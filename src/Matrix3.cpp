@@ -13,6 +13,7 @@
 #include <Moby/Quat.h>
 #include <Moby/MissizeException.h>
 #include <Moby/MatrixN.h>
+#include <Moby/SpatialKernels.h>
 #include <Moby/Matrix3.h>
 
 using namespace Moby;
@@ -547,18 +548,16 @@ Matrix3& Matrix3::operator=(const Matrix3& m)
 /// Multiplies this matrix by a vector and returns the result in a new vector
 Vector3 Matrix3::mult(const Vector3& v) const
 {
-  const unsigned ROWS = 3, COLUMNS = 3;
   Vector3 result;
-  CBLAS::gemv(CblasNoTrans, ROWS, COLUMNS, *this, ROWS, v, 1, (Real) 1.0, (Real) 0.0, result, 1);
+  SpatialKernels::mult3(_data, v.data(), result.data());
   return result;
 }
 
 /// Multiplies the transpose of this matrix by a vector and returns the result in a new vector
 Vector3 Matrix3::transpose_mult(const Vector3& v) const
 {
-  const unsigned ROWS = 3, COLUMNS = 3;
   Vector3 result;
-  CBLAS::gemv(CblasTrans, COLUMNS, ROWS, *this, ROWS, v, 1, (Real) 1.0, (Real) 0.0, result, 1);
+  SpatialKernels::transpose_mult3(_data, v.data(), result.data());
   return result;
 }
 
@@ -582,9 +581,8 @@ MatrixN* Matrix3::transpose_mult(const MatrixN* m, MatrixN* result) const
 /// Multiplies the transpose of this matrix by a matrix and returns the result in a new matrix 
 Matrix3 Matrix3::transpose_mult(const Matrix3& m) const
 {
-  const unsigned ROWS = 3, COLUMNS = 3;
   Matrix3 result;
-  CBLAS::gemm(CblasTrans, CblasNoTrans, COLUMNS, ROWS, m.columns(), *this, ROWS, m, m.rows(), (Real) 1.0, (Real) 0.0, result, COLUMNS);
+  SpatialKernels::transpose_mult3x3(_data, m.data(), result.data());
   return result;
 }
 
@@ -634,9 +632,8 @@ MatrixN* Matrix3::mult_transpose(const MatrixN* m, MatrixN* result) const
 /// Multiplies this matrix by the transpose of a matrix and returns the result in a new matrix 
 Matrix3 Matrix3::mult_transpose(const Matrix3& m) const
 {
-  const unsigned ROWS = 3, COLUMNS = 3;
   Matrix3 result;
-  CBLAS::gemm(CblasNoTrans, CblasTrans, ROWS, COLUMNS, m.rows(), *this, ROWS, m, m.rows(), (Real) 1.0, (Real) 0.0, result, ROWS);
+  SpatialKernels::mult_transpose3x3(_data, m.data(), result.data());
   return result;
 }
 
@@ -660,9 +657,8 @@ MatrixN* Matrix3::mult(const MatrixN* m, MatrixN* result) const
 /// Multiplies this matrix by another 3x3 matrix
 Matrix3 Matrix3::mult(const Matrix3& m) const
 {
-  const unsigned ROWS = 3, COLUMNS = 3;
   Matrix3 result;
-  CBLAS::gemm(CblasNoTrans, CblasNoTrans, ROWS, COLUMNS, m.rows(), *this, ROWS, m, m.rows(), (Real) 1.0, (Real) 0.0, result, ROWS);
+  SpatialKernels::mult3x3(_data, m.data(), result.data());
   return result;
 }
 
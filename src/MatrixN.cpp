@@ -29,7 +29,7 @@ MatrixN::MatrixN(unsigned rows, unsigned columns)
   _columns = columns;
   _capacity = rows*columns;
   if (rows > 0 && columns > 0)
-    _data = shared_array<Real>(new Real[rows*columns]);
+    _data = ArrayAllocator::create(rows*columns);
 }
 
 /// Constructs a matrix from a vector
@@ -548,7 +548,7 @@ MatrixN& MatrixN::resize(unsigned rows, unsigned columns, bool preserve)
 
   // create a new array
   if (rows > 0 && columns > 0)
-    newdata = shared_array<Real>(new Real[rows*columns]);
+    newdata = ArrayAllocator::create(rows*columns);
 
   // preserve existing elements, if desired
   if (preserve && _rows > 0 && _columns > 0)
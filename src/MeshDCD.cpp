@@ -4,7 +4,6 @@
  * License (found in COPYING).
  ****************************************************************************/
 
-#include <complex>
 #include <fstream>
 #include <set>
 #include <cmath>
@@ -12,6 +11,7 @@
 #include <stack>
 #include <queue>
 #include <boost/tuple/tuple.hpp>
+#include <boost/unordered_map.hpp>
 #include <Moby/CompGeom.h>
 #include <Moby/CollisionDetection.h>
 #include <Moby/LinAlg.h>
@@ -25,6 +25,7 @@
 #include <Moby/Integrator.h>
 #include <Moby/OBB.h>
 #include <Moby/NumericalException.h>
+#include <Moby/CCDFeatureBatch.h>
 #include <Moby/MeshDCD.h>
 
 // To delete
@@ -47,6 +48,7 @@ using std::vector;
 using std::priority_queue;
 using std::pair;
 using std::make_pair;
+using boost::unordered_map;
 
 /// Constructs a collision detector with default tolerances
 /**
@@ -56,62 +58,61 @@ MeshDCD::MeshDCD()
 {
   eps_tolerance = 1e-4;
   isect_tolerance = 1e-4;
-  _rebuild_bounds_vecs = true;
   return_all_contacts = true;
 }
 
 void MeshDCD::add_collision_geometry(CollisionGeometryPtr cg)
 {
   CollisionDetection::add_collision_geometry(cg);
-  _rebuild_bounds_vecs = true;
+  _sweep_and_prune.reset();
 }
 
 void MeshDCD::add_rigid_body(RigidBodyPtr rb)
 {
   CollisionDetection::add_rigid_body(rb);
-  _rebuild_bounds_vecs = true;
+  _sweep_and_prune.reset();
 }
 
 void MeshDCD::add_deformable_body(DeformableBodyPtr db)
 {
   CollisionDetection::add_deformable_body(db);
-  _rebuild_bounds_vecs = true;
+  _sweep_and_prune.reset();
 }
 
 void MeshDCD::add_articulated_body(ArticulatedBodyPtr abody, bool disable_adjacent)
 {
   CollisionDetection::add_articulated_body(abody, disable_adjacent);
-  _rebuild_bounds_vecs = true;
+  _sweep_and_prune.reset();
 }
 
 void MeshDCD::remove_collision_geometry(CollisionGeometryPtr cg)
 {
   CollisionDetection::remove_collision_geometry(cg);
-  _rebuild_bounds_vecs = true;
+  _sweep_and_prune.reset();
 }
 
 void MeshDCD::remove_all_collision_geometries()
 {
   CollisionDetection::remove_all_collision_geometries();
-  _rebuild_bounds_vecs = true;
+  _sweep_and_prune.reset();
 }
 
 void MeshDCD::remove_rigid_body(RigidBodyPtr rb)
 {
   CollisionDetection::remove_rigid_body(rb);
-  _rebuild_bounds_vecs = true;
+  _sweep_and_prune.reset();
 }
 
 void MeshDCD::remove_deformable_body(DeformableBodyPtr db)
 {
   CollisionDetection::remove_deformable_body(db);
-  _rebuild_bounds_vecs = true;
+  _sweep_and_prune.reset();
 }
 
 void MeshDCD::remove_articulated_body(ArticulatedBodyPtr abody)
 {
   CollisionDetection::remove_articulated_body(abody);
-  _rebuild_bounds_vecs = true;
+  _sweep_and_prune.reset();
 }
 
 /// Determines whether there is a contact in the given time interval
@@ -120,32 +121,68 @@ void MeshDCD::remove_articulated_body(ArticulatedBodyPtr abody)
  */
 bool MeshDCD::is_contact(Real dt, const vector<pair<DynamicBodyPtr, VectorN> >& q0, const vector<pair<DynamicBodyPtr, VectorN> >& q1, vector<Event>& contacts)
 {
-  VectorN qd;
-
   // clear the contact set 
   contacts.clear();
 
   FILE_LOG(LOG_COLDET) << "MeshDCD::is_contact() entered" << endl;
 
-  // do broad phase; NOTE: broad phase yields updated BVs
+  // map each body to the index of its states
+  unordered_map<DynamicBodyPtr, unsigned> body_index;
+  for (unsigned i=0; i< q0.size(); i++)
+  {
+    assert(q0[i].first == q1[i].first);
+    body_index[q0[i].first] = i;
+  }
+
+  // do broad phase
   vector<pair<CollisionGeometryPtr, CollisionGeometryPtr> > to_check;
-  broad_phase(to_check);
+  broad_phase(q0, q1, to_check);
 
-  // check the geometries
+  // get the indices of the states of the bodies of each pair
+  vector<pair<unsigned, unsigned> > body_pairs(to_check.size());
   for (unsigned i=0; i< to_check.size(); i++)
   {
-    // get the two geometries
-    CollisionGeometryPtr a = to_check[i].first;
-    CollisionGeometryPtr b = to_check[i].second;
+    unordered_map<DynamicBodyPtr, unsigned>::const_iterator ia = body_index.find(get_super_body(to_check[i].first));
+    unordered_map<DynamicBodyPtr, unsigned>::const_iterator ib = body_index.find(get_super_body(to_check[i].second));
+    assert(ia != body_index.end() && ib != body_index.end());
+    body_pairs[i] = make_pair(ia->second, ib->second);
+  }
 
-    // test the geometries for contact
-    check_geoms(dt, a, b, q0, q1, contacts);
-  } 
+  // checking a pair changes the states of its bodies, so only pairs that 
+  // share no bodies may be checked at the same time
+  vector<vector<unsigned> > batches;
+  schedule_pairs(body_pairs, batches);
+  FILE_LOG(LOG_COLDET) << " -- checking " << to_check.size() << " pairs in " << batches.size() << " batches" << endl;
+
+  // check the geometries
+  vector<vector<Event> > events(to_check.size());
+  for (unsigned i=0; i< batches.size(); i++)
+  {
+    const vector<unsigned>& batch = batches[i];
+
+    #pragma omp parallel for
+    for (int j=0; j< (int) batch.size(); j++)
+    {
+      const unsigned k = batch[j];
+      const unsigned ia = body_pairs[k].first;
+      const unsigned ib = body_pairs[k].second;
+
+      // test the geometries for contact
+      check_geoms(dt, to_check[k].first, to_check[k].second, q0[ia].second, q1[ia].second, q0[ib].second, q1[ib].second, events[k]);
+    }
+  }
+
+  // integrate all contacts into a single structure 
+  for (unsigned i=0; i< events.size(); i++)
+    contacts.insert(contacts.end(), events[i].begin(), events[i].end());
 
   // check all geometries of deformable bodies for self-intersection
   BOOST_FOREACH(CollisionGeometryPtr cg, _geoms)
     if (dynamic_pointer_cast<DeformableBody>(cg))
-      check_geom(dt, cg, q0, q1, contacts);
+    {
+      const unsigned idx = body_index.find(cg->get_single_body())->second;
+      check_geom(dt, cg, q0[idx].second, q1[idx].second, contacts);
+    }
 
   // remove contacts with degenerate normals
   for (unsigned i=0; i< contacts.size(); )
@@ -174,7 +211,7 @@ bool MeshDCD::is_contact(Real dt, const vector<pair<DynamicBodyPtr, VectorN> >&
 }
 
 /// Does a collision check for a geometry for a deformable body
-void MeshDCD::check_geom(Real dt, CollisionGeometryPtr cg, const vector<pair<DynamicBodyPtr, VectorN> >& q0, const vector<pair<DynamicBodyPtr, VectorN> >& q1, vector<Event>& contacts)
+void MeshDCD::check_geom(Real dt, CollisionGeometryPtr cg, const VectorN& qa, const VectorN& qb, vector<Event>& contacts)
 {
   FILE_LOG(LOG_COLDET) << "MeshDCD::check_geom() entered" << endl;
   SAFESTATIC VectorN q, qtmp, old_qd;
@@ -182,13 +219,6 @@ void MeshDCD::check_geom(Real dt, CollisionGeometryPtr cg, const vector<pair<Dyn
   // get the body
   DynamicBodyPtr db = cg->get_single_body();
 
-  // get the old and new configurations of the body (qa, qb)
-  const unsigned db_idx = find_body(q0, db);
-  assert(db_idx != std::numeric_limits<unsigned>::max());
-  assert(db_idx == find_body(q1, db));
-  const VectorN& qa = q0[db_idx].second;
-  const VectorN& qb = q1[db_idx].second;
-
   // check for contact at qb
   db->set_generalized_coordinates(DynamicBody::eRodrigues, qb);
   bool contact = is_collision(cg);
@@ -272,47 +302,27 @@ DynamicBodyPtr MeshDCD::get_super_body(CollisionGeometryPtr geom)
     return rb;
 }
 
-/// Finds the index of the body / state pair for the given body
-unsigned MeshDCD::find_body(const vector<pair<DynamicBodyPtr, VectorN> >& q, DynamicBodyPtr body)
-{
-  for (unsigned i=0; i< q.size(); i++)
-    if (q[i].first == body)
-      return i;
-
-  return std::numeric_limits<unsigned>::max();
-}
-
 /// Does a collision check for a pair of geometries
 /**
  * \param dt the time interval
  * \param a the first geometry
  * \param b the second geometry
- * \param aTb the transform from b's frame to a's frame
- * \param bTa the transform from a's frame to b's frame
- * \param vels linear and angular velocities of bodies
+ * \param qa0 the states of a's (super) body at the beginning of the interval
+ * \param qa1 the states of a's (super) body at the end of the interval
+ * \param qb0 the states of b's (super) body at the beginning of the interval
+ * \param qb1 the states of b's (super) body at the end of the interval
  * \param contacts on return
+ * \note pairs that share no bodies may be checked concurrently
  */
-void MeshDCD::check_geoms(Real dt, CollisionGeometryPtr a, CollisionGeometryPtr b, const vector<pair<DynamicBodyPtr, VectorN> >& q0, const vector<pair<DynamicBodyPtr, VectorN> >& q1, vector<Event>& contacts)
+void MeshDCD::check_geoms(Real dt, CollisionGeometryPtr a, CollisionGeometryPtr b, const VectorN& qa0, const VectorN& qa1, const VectorN& qb0, const VectorN& qb1, vector<Event>& contacts)
 {
   FILE_LOG(LOG_COLDET) << "MeshDCD::check_geoms() entered" << endl;
-  SAFESTATIC VectorN q, qda, qdb, old_qda, old_qdb;
+  VectorN q, qda, qdb, old_qda, old_qdb;
 
   // get the two super bodies
   DynamicBodyPtr sba = get_super_body(a);
   DynamicBodyPtr sbb = get_super_body(b); 
 
-  // get the states at times t=0 and t=1
-  const unsigned idx_a = find_body(q0, sba);
-  const unsigned idx_b = find_body(q0, sbb);
-  assert(idx_a == find_body(q1, sba));
-  assert(idx_b == find_body(q1, sbb));
-  assert(idx_a != std::numeric_limits<unsigned>::max());
-  assert(idx_b != std::numeric_limits<unsigned>::max());
-  const VectorN& qa0 = q0[idx_a].second;
-  const VectorN& qa1 = q1[idx_a].second;
-  const VectorN& qb0 = q0[idx_b].second;
-  const VectorN& qb1 = q1[idx_b].second;
-
   // compute the velocities
   qda.copy_from(qa1) -= qa0;
   qdb.copy_from(qb1) -= qb0;
@@ -378,19 +388,9 @@ void MeshDCD::check_geoms(Real dt, CollisionGeometryPtr a, CollisionGeometryPtr
     // now determine contacts
     if (rba && rbb)
       determine_contacts_rigid(a, b, t, h, contacts);
-    else if (rba && dbb)
-    {
-      determine_contacts_rigid_deformable(a, b, t, h, contacts);
-      determine_contacts_deformable_rigid(b, a, t, h, contacts);
-    }
-    else if (rbb && dba)
-    {
-      determine_contacts_rigid_deformable(b, a, t, h, contacts);
-      determine_contacts_deformable_rigid(a, b, t, h, contacts);
-    }
     else
     {
-      assert(dba && dbb);
+      assert(dba || dbb);
       determine_contacts_deformable(a, b, t, h, contacts);
     }
 
@@ -418,343 +418,183 @@ void MeshDCD::check_geoms(Real dt, CollisionGeometryPtr a, CollisionGeometryPtr
   FILE_LOG(LOG_COLDET) << "MeshDCD::check_geoms() exited" << endl;
 }
 
-/// Computes the real roots of the cubic polynomial x^3 + ax^2 + bx + c
+/// Computes the vertices of a geometry in the global frame, their velocities, and their swept bounds
 /**
- * \return the number of real roots
+ * \param cg the collision geometry
+ * \param t the length of the interval over which the vertices are swept
+ * \param x the vertices (global frame) on return
+ * \param xdot the velocities of the vertices on return
+ * \param bounds the lower and upper corners of the bounds swept by each
+ *        vertex over [0, t] on return
  */
-unsigned MeshDCD::determine_cubic_roots(Real a, Real b, Real c, Real x[3])
+void MeshDCD::calc_swept_vertices(CollisionGeometryPtr cg, Real t, vector<Vector3>& x, vector<Vector3>& xdot, vector<pair<Vector3, Vector3> >& bounds)
 {
-  // determine p, q
-  Real p = b - a*a/3;
-  Real q = c + (2*a*a*a - 9*a*b)/27;
-
-  // typedef the Real complex type
-  typedef std::complex<Real> rcomplex;
-
-  // determine the six values of u (not all unique)
-  rcomplex croot(q*q/4 + p*p*p/27);
-  croot = std::sqrt(croot);
-  rcomplex u1a = std::pow(rcomplex(-q/2) + croot, 1.0/3.0);
-  rcomplex u2a = std::pow(rcomplex(-q/2) - croot, 1.0/3.0);
-  rcomplex umul1(-.5,sqrt(3)/2); 
-  rcomplex umul2(-.5,-sqrt(3)/2); 
-  rcomplex u1b = u1a * umul1; 
-  rcomplex u1c = u1a * umul2; 
-  rcomplex u2b = u2a * umul1; 
-  rcomplex u2c = u2a * umul2; 
-
-  // determine the six values of x (not all unique)
-  Real xx[6];
-  unsigned xidx = 0;
-  xx[xidx++] = (u1a - p/((Real) 3.0*u1a) - a/3).real();
-  xx[xidx++] = (u1b - p/((Real) 3.0*u1b) - a/3).real();
-  xx[xidx++] = (u1c - p/((Real) 3.0*u1c) - a/3).real();
-  xx[xidx++] = (u2a - p/((Real) 3.0*u2a) - a/3).real();
-  xx[xidx++] = (u2b - p/((Real) 3.0*u2b) - a/3).real();
-  xx[xidx++] = (u2c - p/((Real) 3.0*u2c) - a/3).real();
-
-  // find real roots
-  unsigned nreal = 0;
-  for (unsigned i=0; i< 6; i++)
-    if (std::fabs(xx[i]*xx[i]*xx[i] + a*xx[i]*xx[i] + b*xx[i] + c) < NEAR_ZERO)
+  // get the body and the transform for the geometry (the transform is the
+  // identity for deformable bodies)
+  SingleBodyPtr sb = cg->get_single_body();
+  const Matrix4& wTg = cg->get_transform();
+
+  // get the vertices of the mesh
+  const vector<Vector3>& verts = cg->get_geometry()->get_mesh()->get_vertices();
+
+  x.resize(verts.size());
+  xdot.resize(verts.size());
+  bounds.resize(verts.size());
+  for (unsigned i=0; i< verts.size(); i++)
+  {
+    x[i] = wTg.mult_point(verts[i]);
+    xdot[i] = sb->calc_point_vel(x[i]);
+    Vector3 x1 = x[i] + xdot[i]*t;
+    for (unsigned j=0; j< 3; j++)
     {
-      // it's a root; make sure that the root doesn't already exist
-      bool found = false;
-      for (unsigned j=0; j< nreal && !found; j++)
-        if (std::fabs(xx[i] - x[j]) < NEAR_ZERO)
-          found = true;
-
-      // if not found, add the root
-      if (!found)
-        x[nreal++] = xx[i];
+      bounds[i].first[j] = std::min(x[i][j], x1[j]);
+      bounds[i].second[j] = std::max(x[i][j], x1[j]);
     }
-
-  return nreal;
+  }
 }
 
-/// Intersects a line segment against a triangle with vertices moving at different velocities
-Real MeshDCD::calc_first_isect(const Vector3& p, const Vector3& pdot, const Triangle& T, const Vector3& Tadot, const Vector3& Tbdot, const Vector3& Tcdot, Real dt) 
+/// Determines whether two swept bounds overlap
+static bool overlaps(const pair<Vector3, Vector3>& b1, const pair<Vector3, Vector3>& b2)
 {
-  const unsigned X = 0, Y = 1, Z = 2;
-  const Real INF = std::numeric_limits<Real>::max();
+  for (unsigned j=0; j< 3; j++)
+    if (b1.first[j] > b2.second[j] || b2.first[j] > b1.second[j])
+      return false;
 
-  // setup everything to match Mathematica output
-  Real P0X = p[X];
-  Real P0Y = p[Y];
-  Real P0Z = p[Z];
-  Real PdotX = pdot[X];
-  Real PdotY = pdot[Y];
-  Real PdotZ = pdot[Z];
-  Real A0X = T.a[X];
-  Real A0Y = T.a[Y];
-  Real A0Z = T.a[Z];
-  Real AdotX = Tadot[X];
-  Real AdotY = Tadot[Y];
-  Real AdotZ = Tadot[Z];
-  Real B0X = T.b[X];
-  Real B0Y = T.b[Y];
-  Real B0Z = T.b[Z];
-  Real BdotX = Tbdot[X];
-  Real BdotY = Tbdot[Y];
-  Real BdotZ = Tbdot[Z];
-  Real C0X = T.c[X];
-  Real C0Y = T.c[Y];
-  Real C0Z = T.c[Z];
-  Real CdotX = Tcdot[X];
-  Real CdotY = Tcdot[Y];
-  Real CdotZ = Tcdot[Z];
-
-  // setup terms for cubic polynomial
-  Real d =  -A0Z*B0Y*P0X + A0Y*B0Z*P0X + A0Z*C0Y*P0X - B0Z*C0Y*P0X - 
-            A0Y*C0Z*P0X + B0Y*C0Z*P0X + A0Z*B0X*P0Y - A0X*B0Z*P0Y - A0Z*C0X*P0Y 
-            + B0Z*C0X*P0Y + A0X*C0Z*P0Y - B0X*C0Z*P0Y - A0Y*B0X*P0Z + 
-            A0X*B0Y*P0Z + A0Y*C0X*P0Z - B0Y*C0X*P0Z - A0X*C0Y*P0Z + B0X*C0Y*P0Z;
-  Real c = (-(AdotZ*B0Y*P0X) + AdotY*B0Z*P0X - A0Z*BdotY*P0X + 
-       A0Y*BdotZ*P0X + AdotZ*C0Y*P0X - BdotZ*C0Y*P0X - 
-       AdotY*C0Z*P0X + BdotY*C0Z*P0X + A0Z*CdotY*P0X - 
-       B0Z*CdotY*P0X - A0Y*CdotZ*P0X + B0Y*CdotZ*P0X + 
-       AdotZ*B0X*P0Y - AdotX*B0Z*P0Y + A0Z*BdotX*P0Y - 
-       A0X*BdotZ*P0Y - AdotZ*C0X*P0Y + BdotZ*C0X*P0Y + 
-       AdotX*C0Z*P0Y - BdotX*C0Z*P0Y - A0Z*CdotX*P0Y + 
-       B0Z*CdotX*P0Y + A0X*CdotZ*P0Y - B0X*CdotZ*P0Y - 
-       AdotY*B0X*P0Z + AdotX*B0Y*P0Z - A0Y*BdotX*P0Z + 
-       A0X*BdotY*P0Z + AdotY*C0X*P0Z - BdotY*C0X*P0Z - 
-       AdotX*C0Y*P0Z + BdotX*C0Y*P0Z + A0Y*CdotX*P0Z - 
-       B0Y*CdotX*P0Z - A0X*CdotY*P0Z + B0X*CdotY*P0Z - 
-       A0Z*B0Y*PdotX + A0Y*B0Z*PdotX + A0Z*C0Y*PdotX - 
-       B0Z*C0Y*PdotX - A0Y*C0Z*PdotX + B0Y*C0Z*PdotX + 
-       A0Z*B0X*PdotY - A0X*B0Z*PdotY - A0Z*C0X*PdotY + 
-       B0Z*C0X*PdotY + A0X*C0Z*PdotY - B0X*C0Z*PdotY - 
-       A0Y*B0X*PdotZ + A0X*B0Y*PdotZ + A0Y*C0X*PdotZ - 
-       B0Y*C0X*PdotZ - A0X*C0Y*PdotZ + B0X*C0Y*PdotZ);
-  Real b = (-(AdotZ*BdotY*P0X) + AdotY*BdotZ*P0X + 
-       AdotZ*CdotY*P0X - BdotZ*CdotY*P0X - AdotY*CdotZ*P0X + 
-       BdotY*CdotZ*P0X + AdotZ*BdotX*P0Y - AdotX*BdotZ*P0Y - 
-       AdotZ*CdotX*P0Y + BdotZ*CdotX*P0Y + AdotX*CdotZ*P0Y - 
-       BdotX*CdotZ*P0Y - AdotY*BdotX*P0Z + AdotX*BdotY*P0Z + 
-       AdotY*CdotX*P0Z - BdotY*CdotX*P0Z - AdotX*CdotY*P0Z + 
-       BdotX*CdotY*P0Z - AdotZ*B0Y*PdotX + AdotY*B0Z*PdotX - 
-       A0Z*BdotY*PdotX + A0Y*BdotZ*PdotX + AdotZ*C0Y*PdotX - 
-       BdotZ*C0Y*PdotX - AdotY*C0Z*PdotX + BdotY*C0Z*PdotX + 
-       A0Z*CdotY*PdotX - B0Z*CdotY*PdotX - A0Y*CdotZ*PdotX + 
-       B0Y*CdotZ*PdotX + AdotZ*B0X*PdotY - AdotX*B0Z*PdotY + 
-       A0Z*BdotX*PdotY - A0X*BdotZ*PdotY - AdotZ*C0X*PdotY + 
-       BdotZ*C0X*PdotY + AdotX*C0Z*PdotY - BdotX*C0Z*PdotY - 
-       A0Z*CdotX*PdotY + B0Z*CdotX*PdotY + A0X*CdotZ*PdotY - 
-       B0X*CdotZ*PdotY - AdotY*B0X*PdotZ + AdotX*B0Y*PdotZ - 
-       A0Y*BdotX*PdotZ + A0X*BdotY*PdotZ + AdotY*C0X*PdotZ - 
-       BdotY*C0X*PdotZ - AdotX*C0Y*PdotZ + BdotX*C0Y*PdotZ + 
-       A0Y*CdotX*PdotZ - B0Y*CdotX*PdotZ - A0X*CdotY*PdotZ + 
-       B0X*CdotY*PdotZ);
-  Real a = (-(AdotZ*BdotY*PdotX) + AdotY*BdotZ*PdotX + 
-       AdotZ*CdotY*PdotX - BdotZ*CdotY*PdotX - 
-       AdotY*CdotZ*PdotX + BdotY*CdotZ*PdotX + 
-       AdotZ*BdotX*PdotY - AdotX*BdotZ*PdotY - 
-       AdotZ*CdotX*PdotY + BdotZ*CdotX*PdotY + 
-       AdotX*CdotZ*PdotY - BdotX*CdotZ*PdotY - 
-       AdotY*BdotX*PdotZ + AdotX*BdotY*PdotZ + 
-       AdotY*CdotX*PdotZ - BdotY*CdotX*PdotZ - 
-       AdotX*CdotY*PdotZ + BdotX*CdotY*PdotZ);
-
-  // look for case of quadratic
-  if (std::fabs(a) < NEAR_ZERO)
-  {
-    // find the roots of the quadratic eqn
-    a = b;
-    b = c;
-    c = d;
-    Real r1 = (-b + std::sqrt(b*b - 4*a*c))/(2*a);
-    Real r2 = (-b - std::sqrt(b*b - 4*a*c))/(2*a);
- 
-    // if root is negative or greater than dt, make it inf
-    if (r1 < 0.0 || r1 > dt || std::isnan(r1))
-      r1 = INF;
-    if (r2 < 0.0 || r2 > dt || std::isnan(r2))
-      r2 = INF;
-
-    // verify that point corresponding to r1 is inside triangle
-    if (r1 < INF && T.determine_feature(p + pdot*r1) == Triangle::eNone)
-      r1 = INF;
-
-    // verify that point corresponding to r2 is inside triangle
-    if (r2 < INF && T.determine_feature(p + pdot*r2) == Triangle::eNone)
-      r2 = INF;
-
-    // return the first root
-    return std::min(r1, r2); 
-  }
-  else
-  {
-    // divide through by a
-    b /= a;
-    c /= a;
-    d /= a;
-
-    // find the (up to three) roots
-    Real r[3];
-    unsigned nroots = determine_cubic_roots(b, c, d, r);
-
-    // if a root is negative or greater than dt, make it inf
-    for (unsigned i=0; i< nroots; i++)
-      if (r[i] < 0.0 || r[i] > dt || std::isnan(r[i]))
-        r[i] = INF;
-
-    // verify that points corresponding to roots are inside triangle
-    for (unsigned i=0; i< nroots; i++)
-      if (r[i] < INF && T.determine_feature(p + pdot*r[i]) == Triangle::eNone)
-        r[i] = INF;
-
-    // find and return the minimum 
-    Real minimum = r[0];
-    for (unsigned i=1; i< nroots; i++)
-      if (r[i] < minimum)
-        minimum = r[i];
-
-    return minimum;
-  }
+  return true;
 }
 
-/// Determines the contacts between a deformable body and a rigid body
-/**
- * \param a the collision geometry for a deformable body
- * \param b the collision geometry for a rigid body
- * \param t the time-of-contact
- * \param dt the time step
- */
-void MeshDCD::determine_contacts_deformable_rigid(CollisionGeometryPtr a, CollisionGeometryPtr b, Real t, Real dt, vector<Event>& contacts)
+/// Computes the union of swept bounds of the vertices of a triangle or an edge
+static pair<Vector3, Vector3> merge_bounds(const vector<pair<Vector3, Vector3> >& bounds, const unsigned* v, unsigned n)
 {
-  Vector3 p;
-
-  FILE_LOG(LOG_COLDET) << "MeshDCD::determine_contacts_deformable_rigid() entered" << endl;
-
-  // get the bodies
-  SingleBodyPtr sba = a->get_single_body();
-  SingleBodyPtr sbb = b->get_single_body();
-
-  // get the transform from and into b's frame
-  const Matrix4& wTb = b->get_transform();
-
-  // get the meshes from a and b
-  const IndexedTriArray& mesh_a = *a->get_geometry()->get_mesh();
-  const IndexedTriArray& mesh_b = *b->get_geometry()->get_mesh();
-
-  // get all vertices of mesh a
-  const vector<Vector3>& verts_a = mesh_a.get_vertices();
-
-  // loop over all vertices
-  for (unsigned i=0; i< verts_a.size(); i++)
-  {
-    // get the vertex -- it's a world coordinate (no transforms are used for
-    // deformable bodies/geometries)
-    const Vector3& v = verts_a[i];
-
-    // get the velocity of the vertex relative to the rigid body
-    Vector3 vdot = sba->calc_point_vel(v) - sbb->calc_point_vel(v);
-
-    FILE_LOG(LOG_COLDET) << " -- testing vertex " << v << " with relative velocity: " << vdot << endl;
-
-    // loop over all triangles in mesh b
-    for (unsigned j=0; j< mesh_b.num_tris(); j++)
+  pair<Vector3, Vector3> result = bounds[v[0]];
+  for (unsigned i=1; i< n; i++)
+    for (unsigned j=0; j< 3; j++)
     {
-      // get the triangle transformed into the world frame
-      Triangle tri = Triangle::transform(mesh_b.get_triangle(j), wTb);
-
-      // do line segment triangle intersection in b's frame
-      Real t = calc_first_isect(tri, LineSeg3(v, v+vdot*dt), p);
-
-      FILE_LOG(LOG_COLDET) << "  ++ against tri: " << tri << endl;
-      FILE_LOG(LOG_COLDET) << "     intersection parameter: " << t << endl;
-
-      // see whether to create a contact
-      if (t <= (Real) 1.0)
-        contacts.push_back(create_contact(t, a, b, p, vdot, tri));
+      result.first[j] = std::min(result.first[j], bounds[v[i]].first[j]);
+      result.second[j] = std::max(result.second[j], bounds[v[i]].second[j]);
     }
-  }
-  
-  FILE_LOG(LOG_COLDET) << "MeshDCD::determine_contacts_deformable_rigid() exited" << endl;
-}
 
-/// Determines the contacts between a rigid body and a deformable body
-/**
- * \param a the collision geometry for a rigid body
- * \param b the collision geometry for a deformable body
- * \param t the time-of-contact
- * \param dt the time step
- */
-void MeshDCD::determine_contacts_rigid_deformable(CollisionGeometryPtr a, CollisionGeometryPtr b, Real t, Real dt, vector<Event>& contacts)
-{
-  // we can just use the deformable / deformable method for this
-  determine_contacts_deformable(a, b, t, dt, contacts);
+  return result;
 }
 
-/// Determines the contacts between two geometries for deformable bodies
+/// Determines the contacts between two geometries, at least one of which is for a deformable body
 /**
- * \param a the collision geometry for a rigid body
- * \param b the collision geometry for a deformable body
- * \param t the time-of-contact
- * \param dt the time step
- * \note checks vertices from geometry a against geometry b
+ * Vertices of each geometry are checked against the triangles of the other,
+ * and the edges of the two geometries are checked against one another.  
+ * Vertex / face and edge / edge features whose swept bounds overlap are 
+ * gathered into a batch, and the batch is solved at once.
+ * \param a the first collision geometry
+ * \param b the second collision geometry (if a == b, self-collision is checked)
+ * \param t the time-of-contact (the geometries are already positioned there)
+ * \param dt the time interval swept from t
+ * \note t and dt are fractions of the step, as are the times of the contacts
  */
 void MeshDCD::determine_contacts_deformable(CollisionGeometryPtr a, CollisionGeometryPtr b, Real t, Real dt, vector<Event>& contacts)
 {
-  // get the transform for the second collision geometry
-  const Matrix4& wTb = b->get_transform();
+  const Real INF = std::numeric_limits<Real>::max();
+  vector<sorted_pair<unsigned> > edges_a, edges_b;
+  CSRAdjacency junk;
 
-  // get the deformable bodies
-  SingleBodyPtr sba = a->get_single_body();
-  SingleBodyPtr sbb = b->get_single_body();
+  FILE_LOG(LOG_COLDET) << "MeshDCD::determine_contacts_deformable() entered" << endl;
 
   // get the meshes from a and b
   const IndexedTriArray& mesh_a = *a->get_geometry()->get_mesh();
   const IndexedTriArray& mesh_b = *b->get_geometry()->get_mesh();
-
-  // get all vertices of mesh a
-  const vector<Vector3>& verts_a = mesh_a.get_vertices();
-
-  // loop over all vertices
-  for (unsigned i=0; i< verts_a.size(); i++)
+  const vector<IndexedTri>& tris_a = mesh_a.get_facets();
+  const vector<IndexedTri>& tris_b = mesh_b.get_facets();
+
+  // get the vertices and their velocities and swept bounds
+  vector<Vector3> xa, xadot, xb, xbdot;
+  vector<pair<Vector3, Vector3> > bounds_a, bounds_b;
+  calc_swept_vertices(a, dt, xa, xadot, bounds_a);
+  calc_swept_vertices(b, dt, xb, xbdot, bounds_b);
+
+  // get the swept bounds of the triangles
+  vector<pair<Vector3, Vector3> > tbounds_a(tris_a.size()), tbounds_b(tris_b.size());
+  for (unsigned i=0; i< tris_a.size(); i++)
   {
-    // get the vertex
-    const Vector3& v = verts_a[i];
+    const unsigned v[3] = { tris_a[i].a, tris_a[i].b, tris_a[i].c };
+    tbounds_a[i] = merge_bounds(bounds_a, v, 3);
+  }
+  for (unsigned i=0; i< tris_b.size(); i++)
+  {
+    const unsigned v[3] = { tris_b[i].a, tris_b[i].b, tris_b[i].c };
+    tbounds_b[i] = merge_bounds(bounds_b, v, 3);
+  }
 
-    // get the velocity of the vertex
-    Vector3 vdot = sba->calc_point_vel(v);
+  // gather the features; reversed features have their vertex in b
+  CCDFeatureBatch batch;
+  vector<bool> reversed;
 
-    // loop over all triangles in mesh b
-    for (unsigned j=0; j< mesh_b.num_tris(); j++)
+  // gather vertices of a against triangles of b
+  for (unsigned i=0; i< xa.size(); i++)
+    for (unsigned j=0; j< tris_b.size(); j++)
     {
-      // if a == b (self collision check) and v is a vertex of the j'th
-      // triangle, skip it: we don't want to check a vertex against its own tri
-      if (a == b)
+      // we don't want to check a vertex against its own triangle
+      const IndexedTri& itri = tris_b[j];
+      if (a == b && (itri.a == i || itri.b == i || itri.c == i))
+        continue;
+      if (!overlaps(bounds_a[i], tbounds_b[j]))
+        continue;
+      batch.add_vertex_face(xa[i], xadot[i], Triangle(xb[itri.a], xb[itri.b], xb[itri.c]), xbdot[itri.a], xbdot[itri.b], xbdot[itri.c]);
+      reversed.push_back(false);
+    }
+
+  // gather vertices of b against triangles of a 
+  if (a != b)
+    for (unsigned i=0; i< xb.size(); i++)
+      for (unsigned j=0; j< tris_a.size(); j++)
       {
-        const IndexedTri& itri = mesh_b.get_facets()[j];
-        if (itri.a == i || itri.b == i || itri.c == i)
+        if (!overlaps(bounds_b[i], tbounds_a[j]))
           continue;
+        const IndexedTri& itri = tris_a[j];
+        batch.add_vertex_face(xb[i], xbdot[i], Triangle(xa[itri.a], xa[itri.b], xa[itri.c]), xadot[itri.a], xadot[itri.b], xadot[itri.c]);
+        reversed.push_back(true);
       }
 
-      // get the triangle, transformed into global frame
-      Triangle tri = Triangle::transform(mesh_b.get_triangle(j), wTb);
+  // gather edges of a against edges of b
+  mesh_a.calc_edge_facet_adjacency(edges_a, junk);
+  mesh_b.calc_edge_facet_adjacency(edges_b, junk);
+  for (unsigned i=0; i< edges_a.size(); i++)
+  {
+    const unsigned ea[2] = { edges_a[i].first, edges_a[i].second };
+    pair<Vector3, Vector3> ebounds = merge_bounds(bounds_a, ea, 2);
+    for (unsigned j=(a == b) ? i+1 : 0; j< edges_b.size(); j++)
+    {
+      // do not check edges that share a vertex against one another 
+      const unsigned eb[2] = { edges_b[j].first, edges_b[j].second };
+      if (a == b && (ea[0] == eb[0] || ea[0] == eb[1] || ea[1] == eb[0] || ea[1] == eb[1]))
+        continue;
+      if (!overlaps(ebounds, merge_bounds(bounds_b, eb, 2)))
+        continue;
+      batch.add_edge_edge(xa[ea[0]], xadot[ea[0]], xa[ea[1]], xadot[ea[1]], xb[eb[0]], xbdot[eb[0]], xb[eb[1]], xbdot[eb[1]]);
+      reversed.push_back(false);
+    }
+  }
+
+  FILE_LOG(LOG_COLDET) << " -- solving " << batch.size() << " vertex / face and edge / edge features" << endl;
 
-      // get the velocity of the three vertices of the triangle
-      Vector3 adot = sbb->calc_point_vel(tri.a);
-      Vector3 bdot = sbb->calc_point_vel(tri.b);
-      Vector3 cdot = sbb->calc_point_vel(tri.c);
+  // solve for the first times of contact
+  vector<Real> toi;
+  batch.calc_first_isects(dt, toi);
 
-      // find the first time of intersection, if any
-      Real t0 = calc_first_isect(v, vdot, tri, adot, bdot, cdot, t);
-      if (t0 <= t)
-      {
-        // determine the point of contact at time t0 + t
-        Vector3 p = v + vdot*t0;
+  // create the contacts
+  for (unsigned i=0; i< toi.size(); i++)
+  {
+    if (toi[i] == INF)
+      continue;
 
-        // determine the triangle at time t0 + t
-        Triangle abc(tri.a + adot*t0, tri.b + bdot*t0, tri.c + cdot*t0);
+    // get the point of contact and the normal (directed toward a)
+    Vector3 p, normal;
+    batch.calc_contact(i, toi[i], p, normal);
+    if (reversed[i])
+      normal = -normal;
 
-        // create the contact
-        contacts.push_back(create_contact(t0, a, b, p, vdot, abc));
-      }
-    }
+    FILE_LOG(LOG_COLDET) << "  ++ " << ((batch.get_type(i) == CCDFeatureBatch::eVertexFace) ? "vertex / face" : "edge / edge") << " contact at " << toi[i] << ": " << p << " normal: " << normal << endl;
+    contacts.push_back(create_contact(t + toi[i], a, b, p, normal));
   }
+
+  FILE_LOG(LOG_COLDET) << "MeshDCD::determine_contacts_deformable() exited" << endl;
 }
 
 /// Determines the contacts between two geometries for rigid bodies
@@ -995,6 +835,7 @@ void MeshDCD::determine_contacts_rigid(CollisionGeometryPtr a, CollisionGeometry
 Event MeshDCD::create_contact(Real toi, CollisionGeometryPtr a, CollisionGeometryPtr b, const Vector3& p, const Vector3& pdot, const Triangle& t)
 {
   Event e;
+  e.t = toi;
   e.event_type = Event::eContact;
   e.contact_geom1 = a;
   e.contact_geom2 = b;
@@ -1008,6 +849,20 @@ Event MeshDCD::create_contact(Real toi, CollisionGeometryPtr a, CollisionGeometr
   return e;
 }
 
+/// Creates a contact with the given normal
+Event MeshDCD::create_contact(Real toi, CollisionGeometryPtr a, CollisionGeometryPtr b, const Vector3& p, const Vector3& normal)
+{
+  Event e;
+  e.t = toi;
+  e.event_type = Event::eContact;
+  e.contact_geom1 = a;
+  e.contact_geom2 = b;
+  e.contact_point = p;
+  e.contact_normal = normal;
+
+  return e;
+}
+
 /// Calculates the first point of intersection between two line segments and a triangle
 /**
  * \param t the triangle to test against
@@ -1565,8 +1420,10 @@ bool MeshDCD::is_collision(CollisionGeometryPtr a, CollisionGeometryPtr b)
   // get the transform for b and its inverse
   const Matrix4& wTb = b->get_transform(); 
 
-  // if intersects, add to colliding pairs
-  return intersect_BV_trees(bva, bvb, aTw * wTb, a, b);
+  // check for intersection; the intersecting triangles are not needed and are
+  // not stored in colliding_tris, since pairs may be checked concurrently
+  list<CollidingTriPair> tris;
+  return intersect_BV_trees(bva, bvb, aTw * wTb, a, b, tris);
 }
 
 /// Implements Base::load_from_xml()
@@ -1606,51 +1463,66 @@ void MeshDCD::save_to_xml(XMLTreePtr node, list<BaseConstPtr>& shared_objects) c
 
 /// Does "broad phase" for discrete collision checking
 /**
- * Since MeshDCD is just a debugging tool, broad phase is nonexistent.  This
- * function just adds all pairs of (non disabled) geometries for checking.
+ * Determines the pairs of (non disabled) geometries whose bounds, swept over
+ * the step, overlap.
+ * \post body states are at q1
  */
-void MeshDCD::broad_phase(vector<pair<CollisionGeometryPtr, CollisionGeometryPtr> >& to_check)
+void MeshDCD::broad_phase(const vector<pair<DynamicBodyPtr, VectorN> >& q0, const vector<pair<DynamicBodyPtr, VectorN> >& q1, vector<pair<CollisionGeometryPtr, CollisionGeometryPtr> >& to_check)
 {
   FILE_LOG(LOG_COLDET) << "MeshDCD::broad_phase() entered" << std::endl;
 
   // clear the vector of pairs to check
   to_check.clear();
 
-  // now setup pairs to check
-  for (set<CollisionGeometryPtr>::const_iterator a = _geoms.begin(); a != _geoms.end(); a++)
+  // get the enabled geometries and their root BVs; deformable geometries
+  // are bounded using their vertices, since their BVs change with the states
+  vector<CollisionGeometryPtr> geoms;
+  vector<BVPtr> roots;
+  for (set<CollisionGeometryPtr>::const_iterator i = _geoms.begin(); i != _geoms.end(); i++)
   {
-    // if a is disabled, skip it
-    if (this->disabled.find(*a) != this->disabled.end())
+    if (this->disabled.find(*i) != this->disabled.end())
       continue;
+    geoms.push_back(*i);
+    if (dynamic_pointer_cast<RigidBody>((*i)->get_single_body()))
+      roots.push_back((*i)->get_geometry()->get_BVH_root());
+    else
+      roots.push_back(BVPtr());
+  }
 
-    // loop over all other geometries
-    set<CollisionGeometryPtr>::const_iterator b = a;
-    for (b++; b != _geoms.end(); b++)
-    {
-      // if b is disabled, skip it
-      if (this->disabled.find(*b) != this->disabled.end())
-        continue;
- 
-      // if the pair is disabled, continue looping
-      if (this->disabled_pairs.find(make_sorted_pair(*a, *b)) != this->disabled_pairs.end())
-        continue;
+  // compute the bounds swept over the step and find the overlapping pairs
+  vector<pair<Vector3, Vector3> > bounds;
+  vector<pair<CollisionGeometryPtr, CollisionGeometryPtr> > overlaps;
+  calc_swept_AABBs(q0, q1, geoms, roots, bounds);
+  _sweep_and_prune.find_overlaps(geoms, bounds, overlaps);
 
-      // get the rigid bodies (if any) corresponding to the geometries
-      RigidBodyPtr rb1 = dynamic_pointer_cast<RigidBody>((*a)->get_single_body());
-      RigidBodyPtr rb2 = dynamic_pointer_cast<RigidBody>((*b)->get_single_body());
+  // now setup pairs to check
+  for (unsigned i=0; i< overlaps.size(); i++)
+  {
+    CollisionGeometryPtr a = overlaps[i].first;
+    CollisionGeometryPtr b = overlaps[i].second;
 
-      // don't check pairs from the same rigid body
-      if (rb1 && rb1 == rb2)
-        continue;
+    // if the pair is disabled, continue looping
+    if (this->disabled_pairs.find(make_sorted_pair(a, b)) != this->disabled_pairs.end())
+      continue;
 
-      // if both rigid bodies are disabled, don't check
-      if (rb1 && !rb1->is_enabled() && rb2 && !rb2->is_enabled())
-        continue;
+    // get the rigid bodies (if any) corresponding to the geometries
+    RigidBodyPtr rb1 = dynamic_pointer_cast<RigidBody>(a->get_single_body());
+    RigidBodyPtr rb2 = dynamic_pointer_cast<RigidBody>(b->get_single_body());
 
-      // if we're here, we have a candidate for the narrow phase
-      to_check.push_back(make_pair(*a, *b));
-    }
+    // don't check pairs from the same rigid body
+    if (rb1 && rb1 == rb2)
+      continue;
+
+    // if both rigid bodies are disabled, don't check
+    if (rb1 && !rb1->is_enabled() && rb2 && !rb2->is_enabled())
+      continue;
+
+    // if we're here, we have a candidate for the narrow phase
+    to_check.push_back(overlaps[i]);
   }
+
+  FILE_LOG(LOG_COLDET) << " -- " << to_check.size() << " of " << overlaps.size() << " overlapping pairs to be checked" << std::endl;
+  FILE_LOG(LOG_COLDET) << "MeshDCD::broad_phase() exited" << std::endl;
 }
 
 /****************************************************************************
@@ -1663,57 +1535,32 @@ void MeshDCD::broad_phase(vector<pair<CollisionGeometryPtr, CollisionGeometryPtr
  */
 bool MeshDCD::is_collision(Real epsilon)
 {
-  // clear the set of colliding pairs and list of colliding triangles
-  colliding_pairs.clear();
-  colliding_tris.clear();
-
-  // iterate over geometries 
-  for (std::set<CollisionGeometryPtr>::const_iterator i = _geoms.begin(); i != _geoms.end(); i++)
-  {
-    // get the first geometry and its primitive 
-    CollisionGeometryPtr g1 = *i;
-    PrimitivePtr g1_primitive = g1->get_geometry();
-
-    // get the transform and the inverse transform for this geometry
-    const Matrix4& wTg1 = g1->get_transform();
-    Matrix4 g1Tw = Matrix4::inverse_transform(wTg1);
-
-    // loop through all other geometries
-    std::set<CollisionGeometryPtr>::const_iterator j = i;
-    j++;
-    for (; j != _geoms.end(); j++)
-    {
-      // get the second geometry and its primitive 
-      CollisionGeometryPtr g2 = *j;
-      PrimitivePtr g2_primitive = g2->get_geometry();
-
-      // see whether to check
-      if (!is_checked(g1, g2))
-        continue; 
-
-      // get the two BV trees
-      BVPtr bv1 = g1_primitive->get_BVH_root();
-      BVPtr bv2 = g2_primitive->get_BVH_root();
+  return check_pairs(&MeshDCD::check_pair, this);
+}
 
-      // get the transform for g2 and its inverse
-      const Matrix4& wTg2 = g2->get_transform(); 
+/// Checks a single pair of geometries for intersection (called by CollisionDetection::check_pairs())
+bool MeshDCD::check_pair(void* data, CollisionGeometryPtr g1, CollisionGeometryPtr g2, const Matrix4& g1Tg2, list<CollidingTriPair>& tris)
+{
+  MeshDCD* ccd = (MeshDCD*) data;
 
-      // if intersects, add to colliding pairs
-      if (intersect_BV_trees(bv1, bv2, g1Tw * wTg2, g1, g2))
-        colliding_pairs.insert(make_sorted_pair(g1, g2));
-    } 
-  }
+  // get the two BV trees
+  BVPtr bv1 = g1->get_geometry()->get_BVH_root();
+  BVPtr bv2 = g2->get_geometry()->get_BVH_root();
 
-  return !colliding_pairs.empty();
+  // check for intersection
+  return ccd->intersect_BV_trees(bv1, bv2, g1Tg2, g1, g2, tris);
 }
 
 /// Intersects two BV trees; returns <b>true</b> if one (or more) pair of the underlying triangles intersects
-bool MeshDCD::intersect_BV_trees(BVPtr a, BVPtr b, const Matrix4& aTb, CollisionGeometryPtr geom_a, CollisionGeometryPtr geom_b) 
+/**
+ * Intersecting pairs of triangles are appended to tris.
+ */
+bool MeshDCD::intersect_BV_trees(BVPtr a, BVPtr b, const Matrix4& aTb, CollisionGeometryPtr geom_a, CollisionGeometryPtr geom_b, list<CollidingTriPair>& tris) 
 {
   std::queue<tuple<BVPtr, BVPtr, bool> > q;
 
   // get address of the last colliding triangle pair on the queue
-  CollidingTriPair* last = (colliding_tris.empty()) ? NULL : &colliding_tris.back();
+  CollidingTriPair* last = (tris.empty()) ? NULL : &tris.back();
 
   FILE_LOG(LOG_COLDET) << "MeshDCD::intersect_BV_trees() entered" << endl;
 
@@ -1744,12 +1591,12 @@ bool MeshDCD::intersect_BV_trees(BVPtr a, BVPtr b, const Matrix4& aTb, Collision
     if (bv1->is_leaf() && bv2->is_leaf())
     {
       if (!rev)
-        intersect_BV_leafs(bv1, bv2, aTb, geom_a, geom_b, std::back_inserter(colliding_tris));
+        intersect_BV_leafs(bv1, bv2, aTb, geom_a, geom_b, std::back_inserter(tris));
       else
-        intersect_BV_leafs(bv2, bv1, aTb, geom_a, geom_b, std::back_inserter(colliding_tris));
+        intersect_BV_leafs(bv2, bv1, aTb, geom_a, geom_b, std::back_inserter(tris));
 
       // see whether we want to exit early
-      if (mode == eFirstContact && !colliding_tris.empty() && last != &colliding_tris.back())
+      if (mode == eFirstContact && !tris.empty() && last != &tris.back())
         return true;
     }
 
@@ -1770,7 +1617,7 @@ bool MeshDCD::intersect_BV_trees(BVPtr a, BVPtr b, const Matrix4& aTb, Collision
   }
 
   // see whether we have an intersection
-  if (!colliding_tris.empty() && last != &colliding_tris.back())
+  if (!tris.empty() && last != &tris.back())
     return true;
 
   FILE_LOG(LOG_COLDET) << "  -- all intersection checks passed; no intersection" << endl;
@@ -0,0 +1,316 @@
+/****************************************************************************
+ * Copyright 2011 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <Moby/Constants.h>
+#include <Moby/Log.h>
+#include <Moby/LinAlg.h>
+#include <Moby/BLASBackend.h>
+#include <Moby/FastThreadable.h>
+#include <Moby/MissizeException.h>
+#include <Moby/NonsquareMatrixException.h>
+#include <Moby/MixedSolver.h>
+
+using std::vector;
+using namespace Moby;
+
+#if defined(USE_MIXED_PRECISION) && defined(BUILD_DOUBLE)
+#define MIXED_PRECISION
+#endif
+
+#ifdef MIXED_PRECISION
+/// Matrices smaller than this are always factored in working precision
+static const unsigned MIN_SINGLE_SIZE = 64;
+
+/// Computes the infinity norm (maximum absolute row sum) of a matrix
+/**
+ * \note MatrixN::norm_inf() computes the maximum absolute element instead
+ */
+static Real calc_norm_inf(const MatrixN& A)
+{
+  vector<Real> sums(A.rows(), (Real) 0.0);
+  const Real* data = A.data();
+  for (unsigned j=0; j< A.columns(); j++)
+    for (unsigned i=0; i< A.rows(); i++)
+      sums[i] += std::fabs(*data++);
+  return (sums.empty()) ? (Real) 0.0 : *std::max_element(sums.begin(), sums.end());
+}
+#endif
+
+MixedSolver::MixedSolver()
+{
+  max_refinements = 30;
+  _n = 0;
+  _type = eGeneral;
+  _precision = eWorking;
+  _A_norm_inf = (Real) 0.0;
+}
+
+/// Factors a square matrix
+/**
+ * \param A the matrix to factor
+ * \param type the type of A; if A is positive definite, a Cholesky
+ *        factorization is used
+ * \return <b>false</b> if A is singular (or, if type is ePositiveDefinite,
+ *         not positive definite) in working precision
+ */
+bool MixedSolver::factor(const MatrixN& A, MatrixType type)
+{
+  if (A.rows() != A.columns())
+    throw NonsquareMatrixException();
+
+  _n = A.rows();
+  _type = type;
+
+  #ifdef MIXED_PRECISION
+  // store A for computing residuals
+  _A.copy_from(A);
+  _A_norm_inf = calc_norm_inf(A);
+
+  // small matrices are factored in working precision
+  if (_n < MIN_SINGLE_SIZE)
+    return factor_working();
+
+  // try a single precision factorization first
+  if (factor_single())
+    return true;
+
+  // refactor in working precision
+  if (!factor_working())
+    return false;
+
+  // A is ill-conditioned in single precision; compute residuals in extended
+  // precision if it is ill-conditioned in working precision too
+  MatrixN tmp;
+  tmp.copy_from(_A);
+  const Real cond = LinAlg::cond(tmp);
+  if (!(cond < (Real) 1.0/NEAR_ZERO))
+  {
+    FILE_LOG(LOG_LINALG) << "MixedSolver::factor() - condition number " << cond << "; using extended precision residuals" << std::endl;
+    _precision = eExtended;
+  }
+  return true;
+  #else
+  _fA.copy_from(A);
+  return factor_working();
+  #endif
+}
+
+/// Factors the stored matrix in single precision
+/**
+ * The factorization is rejected if it is singular, not positive definite,
+ * or too inaccurate for iterative refinement to converge on a test system.
+ */
+bool MixedSolver::factor_single()
+{
+  #ifdef MIXED_PRECISION
+  int N = (int) _n;
+  int INFO;
+
+  // convert A to single precision and factor it
+  _sA.resize(_n*_n);
+  const Real* A = _A.data();
+  for (unsigned i=0; i< _n*_n; i++)
+    _sA[i] = (float) A[i];
+  if (_type == ePositiveDefinite)
+  {
+    char UPLO = 'U';
+    BLASBackend::routines().spotrf(&UPLO, &N, &_sA.front(), &N, &INFO);
+  }
+  else
+  {
+    _ipiv.resize(_n);
+    BLASBackend::routines().sgetrf(&N, &N, &_sA.front(), &N, &_ipiv.front(), &INFO);
+  }
+  if (INFO != 0)
+  {
+    FILE_LOG(LOG_LINALG) << "MixedSolver::factor_single() - single precision factorization failed" << std::endl;
+    return false;
+  }
+  _precision = eSingle;
+
+  // verify that refinement converges for A*x = A*1
+  VectorN ones(_n), b, x;
+  std::fill(ones.begin(), ones.end(), (Real) 1.0);
+  _A.mult(ones, b);
+  x.copy_from(b);
+  solve_factored(x);
+  if (refine(b, x))
+    return true;
+
+  FILE_LOG(LOG_LINALG) << "MixedSolver::factor_single() - refinement failed to converge" << std::endl;
+  #endif
+  return false;
+}
+
+/// Factors the matrix in _fA in working precision
+bool MixedSolver::factor_working()
+{
+  _precision = eWorking;
+  #ifdef MIXED_PRECISION
+  _fA.copy_from(_A);
+  #endif
+  if (_type == ePositiveDefinite)
+    return LinAlg::factor_chol(_fA);
+  else
+    return LinAlg::factor_LU(_fA, _ipiv);
+}
+
+/// Solves A*x = b using the factorization only (no refinement)
+void MixedSolver::solve_factored(VectorN& x) const
+{
+  #ifdef MIXED_PRECISION
+  if (_precision == eSingle)
+  {
+    SAFESTATIC FastThreadable<vector<float> > sx_x;
+    vector<float>& sx = sx_x();
+    int N = (int) _n;
+    int NRHS = 1;
+    int INFO;
+
+    sx.resize(_n);
+    for (unsigned i=0; i< _n; i++)
+      sx[i] = (float) x[i];
+    if (_type == ePositiveDefinite)
+    {
+      char UPLO = 'U';
+      BLASBackend::routines().spotrs(&UPLO, &N, &NRHS, (float*) &_sA.front(), &N, &sx.front(), &N, &INFO);
+    }
+    else
+    {
+      char TRANS = 'N';
+      BLASBackend::routines().sgetrs(&TRANS, &N, &NRHS, (float*) &_sA.front(), &N, (int*) &_ipiv.front(), &sx.front(), &N, &INFO);
+    }
+    for (unsigned i=0; i< _n; i++)
+      x[i] = (Real) sx[i];
+    return;
+  }
+  #endif
+
+  if (_type == ePositiveDefinite)
+    LinAlg::solve_chol_fast(_fA, x);
+  else
+    LinAlg::solve_LU_fast(_fA, false, _ipiv, x);
+}
+
+/// Computes the residual r = b - A*x (in extended precision, if necessary)
+void MixedSolver::calc_residual(const VectorN& b, const VectorN& x, VectorN& r) const
+{
+  if (_precision == eExtended)
+  {
+    SAFESTATIC FastThreadable<vector<LongReal> > acc_x;
+    vector<LongReal>& acc = acc_x();
+    acc.resize(_n);
+    for (unsigned i=0; i< _n; i++)
+      acc[i] = (LongReal) b[i];
+    const Real* A = _A.data();
+    for (unsigned j=0; j< _n; j++, A += _n)
+    {
+      const LongReal xj = (LongReal) x[j];
+      for (unsigned i=0; i< _n; i++)
+        acc[i] -= (LongReal) A[i]*xj;
+    }
+    r.resize(_n);
+    for (unsigned i=0; i< _n; i++)
+      r[i] = (Real) acc[i];
+  }
+  else
+  {
+    _A.mult(x, r);
+    r.negate() += b;
+  }
+}
+
+/// Iteratively refines the solution to A*x = b
+/**
+ * Refinement stops when ||b - A*x|| <= ||x||*||A||*eps*sqrt(n) (infinity
+ * norms), as in LAPACK's dsgesv.
+ * \return <b>true</b> if refinement converged
+ */
+bool MixedSolver::refine(const VectorN& b, VectorN& x) const
+{
+  const Real EPS = std::numeric_limits<Real>::epsilon()*std::sqrt((Real) _n);
+  SAFESTATIC FastThreadable<VectorN> r_x;
+  VectorN& r = r_x();
+
+  for (unsigned i=0; i<= max_refinements; i++)
+  {
+    // check for convergence
+    calc_residual(b, x, r);
+    if (r.norm_inf() <= x.norm_inf()*_A_norm_inf*EPS)
+      return true;
+
+    // update the solution
+    if (i < max_refinements)
+    {
+      solve_factored(r);
+      x += r;
+    }
+  }
+
+  return false;
+}
+
+/// Solves A*x = b using the factorization computed by factor()
+/**
+ * \param xb the right hand side on input, the solution x on return
+ */
+VectorN& MixedSolver::solve(VectorN& xb) const
+{
+  if (xb.size() != _n)
+    throw MissizeException();
+
+  // working precision solutions are not refined
+  if (_precision == eWorking)
+  {
+    solve_factored(xb);
+    return xb;
+  }
+
+  // solve and refine
+  SAFESTATIC FastThreadable<VectorN> b_x;
+  VectorN& b = b_x();
+  b.copy_from(xb);
+  solve_factored(xb);
+  if (!refine(b, xb))
+    FILE_LOG(LOG_LINALG) << "MixedSolver::solve() - refinement failed to converge" << std::endl;
+
+  return xb;
+}
+
+/// Solves A*X = B using the factorization computed by factor()
+/**
+ * \param XB the right hand sides on input, the solutions X on return
+ */
+MatrixN& MixedSolver::solve(MatrixN& XB) const
+{
+  if (XB.rows() != _n)
+    throw MissizeException();
+
+  // working precision solutions are not refined
+  if (_precision == eWorking)
+  {
+    if (_type == ePositiveDefinite)
+      LinAlg::solve_chol_fast(_fA, XB);
+    else
+      LinAlg::solve_LU_fast(_fA, false, _ipiv, XB);
+    return XB;
+  }
+
+  SAFESTATIC FastThreadable<VectorN> x_x;
+  VectorN& x = x_x();
+  for (unsigned j=0; j< XB.columns(); j++)
+  {
+    XB.get_column(j, x);
+    solve(x);
+    XB.set_column(j, x);
+  }
+
+  return XB;
+}
+
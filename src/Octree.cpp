@@ -1,14 +1,18 @@
 /****************************************************************************
  * Copyright 2006 Evan Drumwright
- * This library is distributed under the terms of the GNU Lesser General Public 
+ * This library is distributed under the terms of the GNU Lesser General Public
  * License (found in COPYING).
  ****************************************************************************/
 
-#include <queue>
+#include <cassert>
 #include <limits>
+#include <algorithm>
 #include <Moby/Octree.h>
 
 using namespace Moby;
+using std::vector;
+using std::pair;
+using std::make_pair;
 
 /// Constructs an octree with zero minimum resolution
 /**
@@ -18,8 +22,8 @@ Octree::Octree()
 {
 	_bounds_lo = Vector3(-std::numeric_limits<Real>::max(), -std::numeric_limits<Real>::max(), -std::numeric_limits<Real>::max());
 	_bounds_hi = Vector3(std::numeric_limits<Real>::max(), std::numeric_limits<Real>::max(), std::numeric_limits<Real>::max());
-	_num_points = 0;
 	_minres = 0;
+	reset();
 }
 
 /// Constructs an octree with the specified minimum resolution
@@ -30,120 +34,70 @@ Octree::Octree(Real minres)
 {
 	_bounds_lo = Vector3(-std::numeric_limits<Real>::max(), -std::numeric_limits<Real>::max(), -std::numeric_limits<Real>::max());
 	_bounds_hi = Vector3(std::numeric_limits<Real>::max(), std::numeric_limits<Real>::max(), std::numeric_limits<Real>::max());
-	_num_points = 0;
 	_minres = minres;
+	reset();
 }
 
 /// Constructs an octree with the specified minimum resolution and bounds
 Octree::Octree(Real minres, const Vector3& lo_bounds, const Vector3& hi_bounds)
 {
-	_bounds_lo = lo_bounds; 
-	_bounds_hi = hi_bounds; 
-	_num_points = 0;
+	_bounds_lo = lo_bounds;
+	_bounds_hi = hi_bounds;
 	_minres = minres;
-}
-
-/// Constructs an octree with the specified parent, minimum resolution, and bounds
-Octree::Octree(OctreePtr parent, Real minres, const Vector3& lo_bounds, const Vector3& hi_bounds)
-{
-	_bounds_lo = lo_bounds; 
-	_bounds_hi = hi_bounds; 
-	_num_points = 0;
-	_minres = minres;
-	_parent = parent;
+	reset();
 }
 
 /// Inserts a point into the octree
+/**
+ * \note inserting many points at once using insert(const vector&) is much
+ *       faster than inserting them one at a time
+ */
 void Octree::insert(const Vector3& point)
 {
-	const unsigned X = 0;
-
-	#ifndef NDEBUG
-	// verify that the point is not outside of the bounds of this octree node
-	const unsigned THREE_D = 3;
-	for (unsigned i=0; i< THREE_D; i++)
-		assert(point[i] >= _bounds_lo[i] && point[i] <= _bounds_hi[i]);
-	#endif
-
-	// increment the number of points in this node
-	_num_points++;
-
-	// don't subdivide if we are below minimum resolution
-	if ((_bounds_hi[X] - _bounds_lo[X])/2 < _minres)
-		return;
+	Point p;
+	p.key = calc_key(point);
+	p.id = _num_inserted++;
 
-	// subdivide, if possible
-	if (subdivide())
-	{
-		unsigned subvolume_idx = get_sub_volume_idx(point);
-		_children[subvolume_idx]->insert(point);
-	}
+	// insert the point after all points with the same key
+	_points.insert(std::upper_bound(_points.begin(), _points.end(), p), p);
 }
 
-/// Returns the index of the subvolume being occupied
+/// Inserts a set of points into the octree
 /**
- * \return an index in the range [0,7]; assertion fails if the point is outside
- *         of the volume
+ * The keys of the points are computed in parallel and sorted using radix
+ * sort; the sorted points are then merged with the points already in the
+ * octree.  Points are identified in the order given.
  */
-unsigned Octree::get_sub_volume_idx(const Vector3& point) const
+void Octree::insert(const vector<Vector3>& points)
 {
-	const unsigned X = 0, Y = 1, Z = 2;
-
-	Vector3 half = 0.5*(_bounds_lo + _bounds_hi);
-
-	// Subdivision order
-	// 	   1---5
-  //     /|  /|
-  //    0---4 |
-  //    | 3-|-7
-  //    |/  |/
-  //    2---6
-	
-	if (point[X] < half[X])
+	// compute the keys of the new points
+	const int N = (int) points.size();
+	vector<Point> batch(N);
+	#pragma omp parallel for
+	for (int i=0; i< N; i++)
 	{
-		if (point[Y] < half[Y])
-		{
-			if (point[Z] < half[Z])
-				return 2;
-			else
-				return 3;
-		}
-		else
-		{
-			if (point[Z] < half[Z])
-				return 0;
-			else
-				return 1;
-		}
+		batch[i].key = calc_key(points[i]);
+		batch[i].id = _num_inserted + (unsigned) i;
 	}
+	_num_inserted += N;
+
+	// sort the new points
+	radix_sort(batch, _depth*3);
+
+	// merge them with the existing points
+	if (_points.empty())
+		_points.swap(batch);
 	else
 	{
-		if (point[Y] < half[Y])
-		{
-			if (point[Z] < half[Z])
-				return 6;
-			else
-				return 7;
-		}
-		else
-		{
-			if (point[Z] < half[Z])
-				return 4;
-			else
-				return 5;
-		}
+		vector<Point> merged(_points.size() + batch.size());
+		std::merge(_points.begin(), _points.end(), batch.begin(), batch.end(), merged.begin());
+		_points.swap(merged);
 	}
-
-	assert(false);
-	return std::numeric_limits<unsigned>::max();
 }
 
-/// Determines (quickly) whether any part of a rectangular region of space is occupied
+/// Determines whether any cell that intersects a rectangular region of space is occupied
 bool Octree::is_occupied(const Vector3& lo_bounds, const Vector3& hi_bounds) const
 {
-	// only should be called on top-level bounding box
-	assert(_parent.expired());
-
 	// verify that regions are correct
 	#ifndef NDEBUG
 	for (unsigned i=0; i< 3; i++)
@@ -151,297 +105,358 @@ bool Octree::is_occupied(const Vector3& lo_bounds, const Vector3& hi_bounds) con
 	#endif
 
 	// if no points, return false
-	if (_num_points == 0)
+	if (_points.empty())
 		return false;
 
-	// setup a queue, with this as the first element
-	std::queue<OctreePtr> q;
-	q.push(boost::const_pointer_cast<Octree>(shared_from_this()));
+	// get the range of cells covered by the region
+	unsigned lo[3], hi[3];
+	if (!calc_cell_range(lo_bounds, hi_bounds, lo, hi))
+		return false;
 
-	while (!q.empty())
-	{
-		// get the node at the front of the queue
-		OctreePtr node = q.front();
-		q.pop();
+	return find_points(lo, hi, NULL);
+}
 
-		// process the children, if any, for this octree
-		const std::vector<OctreePtr>& children = node->get_children();
-		for (std::vector<OctreePtr>::const_iterator i = children.begin(); i != children.end(); i++)
-		{
-			// if there are no hits for this child, continue
-			if ((*i)->get_num_points() == 0)
-				continue;
-
-			// get the bounding region for this child
-			Vector3 child_lo_bounds, child_hi_bounds;
-			(*i)->get_bounds(child_lo_bounds, child_hi_bounds);
-			
-			// determine how much of the bounding box is within the bounding region
-			BBQueryType query = within_bounding_box(std::make_pair(child_lo_bounds, child_hi_bounds), std::make_pair(lo_bounds, hi_bounds));
-
-			// if the cell is entirely within the bounding box, return now
-			if (query == eFullyInside)
-				return true;
- 
-			// if the cell lies partially within the bounding box, add it to the queue
-			if (query == ePartiallyInside)
-				q.push(*i);
-		}
-	}
+/// Determines whether any cell that intersects each of a set of rectangular regions is occupied (in parallel)
+/**
+ * \param regions the lower and upper bounds of each region
+ * \param occupied whether each region is occupied, on return
+ */
+void Octree::is_occupied(const vector<pair<Vector3, Vector3> >& regions, vector<bool>& occupied) const
+{
+	const int N = (int) regions.size();
+	vector<unsigned char> result(N);
+	#pragma omp parallel for
+	for (int i=0; i< N; i++)
+		result[i] = (is_occupied(regions[i].first, regions[i].second)) ? 1 : 0;
+
+	occupied.resize(N);
+	for (int i=0; i< N; i++)
+		occupied[i] = (result[i] != 0);
+}
+
+/// Gets the points in all cells that intersect a rectangular region of space
+/**
+ * \param points the identifiers of the points (i.e., the order in which
+ *        they were inserted), on return
+ */
+void Octree::get_points(const Vector3& lo_bounds, const Vector3& hi_bounds, vector<unsigned>& points) const
+{
+	points.clear();
 
-	// if still here, region is clear
-	return false;
+	// get the range of cells covered by the region
+	unsigned lo[3], hi[3];
+	if (_points.empty() || !calc_cell_range(lo_bounds, hi_bounds, lo, hi))
+		return;
+
+	// get the ranges of points
+	vector<pair<unsigned, unsigned> > ranges;
+	find_points(lo, hi, &ranges);
+	for (unsigned i=0; i< ranges.size(); i++)
+		for (unsigned j=ranges[i].first; j< ranges[i].second; j++)
+			points.push_back(_points[j].id);
 }
 
-/// Gets the bounds for this Octree cell
+/// Gets the bounds for this Octree
 void Octree::get_bounds(Vector3& lo, Vector3& hi) const
 {
 	lo = _bounds_lo;
 	hi = _bounds_hi;
 }
 
-/// Clears the point from the Octree
+/// Clears a point from the cell containing the given point
 /**
- * \return <b>true</b> if the point was found in the octree (and deleted),
+ * The most recently inserted point in the cell is removed.
+ * \return <b>true</b> if the cell was occupied (and a point was deleted),
  *         and <b>false</b> otherwise
  */
 bool Octree::clear_cell(const Vector3& point)
 {
-	const unsigned THREE_D = 3;
+	unsigned cell[3];
+	if (!calc_cell(point, cell))
+		return false;
 
-	// for parent, make sure cell is occupied
-	if (_parent.expired() && !is_cell_occupied(point))
+	// find the points in the cell
+	Point p;
+	p.key = calc_key(cell);
+	vector<Point>::iterator end = std::upper_bound(_points.begin(), _points.end(), p);
+	if (end == _points.begin() || (end-1)->key != p.key)
 		return false;
 
-	// check whether point is out of bounds of this node
-	for (unsigned i=0; i< THREE_D; i++)
-		if (_bounds_lo[i] > point[i] || _bounds_hi[i] < point[i])
-			return false;
+	// remove the last point in the cell
+	_points.erase(end-1);
+	return true;
+}
 
-	// if there are no points in this cell, return false
-	if (_num_points == 0)
+/// Determines whether the cell containing the given point is occupied
+bool Octree::is_cell_occupied(const Vector3& point) const
+{
+	unsigned cell[3];
+	if (!calc_cell(point, cell))
 		return false;
 
-	// recursively remove point from occupying cell
-	_num_points--;
+	Point p;
+	p.key = calc_key(cell);
+	return std::binary_search(_points.begin(), _points.end(), p);
+}
 
-	// if there are no more points left in this branch of the octree, remove
-	// all child nodes
-	if (_num_points == 0)
-		_children.clear();
-	else if (!_children.empty())
-	{
-		unsigned subvolume_idx = get_sub_volume_idx(point);
-		_children[subvolume_idx]->clear_cell(point);
-	}
+/// Determines whether the cells containing each of a set of points are occupied (in parallel)
+/**
+ * \param points the query points
+ * \param occupied whether the cell containing each point is occupied, on
+ *        return
+ */
+void Octree::is_cell_occupied(const vector<Vector3>& points, vector<bool>& occupied) const
+{
+	const int N = (int) points.size();
+	vector<unsigned char> result(N);
+	#pragma omp parallel for
+	for (int i=0; i< N; i++)
+		result[i] = (is_cell_occupied(points[i])) ? 1 : 0;
+
+	occupied.resize(N);
+	for (int i=0; i< N; i++)
+		occupied[i] = (result[i] != 0);
+}
 
-	return true;
+/// (Re)sets the bounds for this octree
+void Octree::set_bounds(const Vector3& lo_bound, const Vector3& hi_bound)
+{
+	_bounds_lo = lo_bound;
+	_bounds_hi = hi_bound;
+	reset();
 }
 
-/// Determines whether a bounding box is within another bounding box
+//// Resets the octree
+void Octree::reset()
+{
+	_points.clear();
+	_num_inserted = 0;
+	update_depth();
+}
+
+/// Determines the number of levels from the bounds and the minimum resolution
 /**
- * \return <b>eFullyInside</b> if query is fully inside box, 
- * <b>ePartiallyInside</b> if query intersects box, and <b>eOutside</b> if
- * the two bounding boxes are separate.
+ * Cells are halved (as long as the side length along x of the halves is at
+ * least the minimum resolution) up to MAX_DEPTH times.
  */
-Octree::BBQueryType Octree::within_bounding_box(const std::pair<Vector3, Vector3>& query, const std::pair<Vector3, Vector3>& reference)
+void Octree::update_depth()
 {
-	const unsigned X = 0, Y = 1, Z = 2;
+	const unsigned X = 0;
+
+	Real sidelen = _bounds_hi[X] - _bounds_lo[X];
+	for (_depth = 0; _depth < MAX_DEPTH && sidelen/2 >= _minres; _depth++)
+		sidelen /= 2;
+}
+
+/// Computes the integer coordinates of the leaf cell containing a point
+/**
+ * \param cell the coordinates of the cell, on return (clamped to the bounds
+ *        of the octree)
+ * \return <b>false</b> if the point is outside of the bounds of the octree
+ */
+bool Octree::calc_cell(const Vector3& point, unsigned cell[3]) const
+{
+	const unsigned THREE_D = 3;
+	const unsigned NCELLS = 1 << _depth;
 
-	// setup all points of the query
-	std::list<Vector3> points;
-	points.push_back(Vector3(query.first[X], query.first[Y], query.first[Z]));
-	points.push_back(Vector3(query.first[X], query.first[Y], query.second[Z]));
-	points.push_back(Vector3(query.first[X], query.second[Y], query.first[Z]));
-	points.push_back(Vector3(query.first[X], query.first[Y], query.second[Z]));
-	points.push_back(Vector3(query.second[X], query.first[Y], query.first[Z]));
-	points.push_back(Vector3(query.second[X], query.first[Y], query.second[Z]));
-	points.push_back(Vector3(query.second[X], query.second[Y], query.first[Z]));
-	points.push_back(Vector3(query.second[X], query.first[Y], query.second[Z]));
-	
-	// set indicators to false initially
-	bool outside_one = false, inside_one = false;
-	for (std::list<Vector3>::iterator i = points.begin(); i != points.end(); i++)
+	bool inside = true;
+	for (unsigned i=0; i< THREE_D; i++)
 	{
-		// check the i'th point
-		if (within_bounding_box(*i, reference))
-			inside_one = true;
+		if (point[i] < _bounds_lo[i] || point[i] > _bounds_hi[i])
+			inside = false;
+
+		// compute the fractional position of the point along the axis
+		Real sidelen = _bounds_hi[i] - _bounds_lo[i];
+		Real s = (sidelen > (Real) 0.0) ? (point[i] - _bounds_lo[i])/sidelen : (Real) 0.0;
+		if (!(s > (Real) 0.0))
+			cell[i] = 0;
+		else if (s >= (Real) 1.0)
+			cell[i] = NCELLS - 1;
 		else
-			outside_one = true;
-
-		// check whether we can exit prematurely
-		if (inside_one && outside_one)
-			return ePartiallyInside;
+			cell[i] = std::min((unsigned) (s*NCELLS), NCELLS - 1);
 	}
 
-	// return the appropriate value
-	return (inside_one) ? eFullyInside : eOutside;
+	return inside;
 }
 
-/// Determines whether a query point is within the bounding box
-bool Octree::within_bounding_box(const Vector3& query, const std::pair<Vector3, Vector3>& reference)
+/// Computes the range of leaf cells that intersect a rectangular region
+/**
+ * \return <b>false</b> if the region does not intersect the bounds of the
+ *         octree
+ */
+bool Octree::calc_cell_range(const Vector3& lo_bounds, const Vector3& hi_bounds, unsigned lo[3], unsigned hi[3]) const
 {
 	const unsigned THREE_D = 3;
 
 	for (unsigned i=0; i< THREE_D; i++)
-		if (query[i] < reference.first[i] || query[i] > reference.second[i])
+		if (hi_bounds[i] < _bounds_lo[i] || lo_bounds[i] > _bounds_hi[i])
 			return false;
 
+	calc_cell(lo_bounds, lo);
+	calc_cell(hi_bounds, hi);
 	return true;
 }
 
-/// Returns NULL if empty, Octree of leaf if occupied
-OctreePtr Octree::is_cell_occupied(const Vector3& point) const
+/// Computes the Morton key of the leaf cell containing a point
+uint64_t Octree::calc_key(const Vector3& point) const
 {
-	const unsigned THREE_D = 3;
-
-	// first test whether point is in box
-	if (_parent.expired())
-		for (unsigned i=0; i< THREE_D; i++)
-			if (point[i] < _bounds_lo[i] || point[i] > _bounds_hi[i])
-				return OctreePtr();
-
-	// if there are no points in this leaf, return NULL
-	if (_num_points == 0)
-		return OctreePtr();
-
-	// if there are no children, return this
-	if (_children.empty())
-		return boost::const_pointer_cast<Octree>(shared_from_this());
-	else
-	{
-		unsigned subvolume = get_sub_volume_idx(point);
-		return _children[subvolume]->is_cell_occupied(point);
-	}
-
-	return OctreePtr();
+	unsigned cell[3];
+	bool inside = calc_cell(point, cell);
+	assert(inside);
+	return calc_key(cell);
 }
 
-/// (Re)sets the bounds for this octree
-void Octree::set_bounds(const Vector3& lo_bound, const Vector3& hi_bound)
+/// Computes the Morton key of a cell from its integer coordinates
+uint64_t Octree::calc_key(const unsigned cell[3])
 {
-	_bounds_lo = lo_bound;
-	_bounds_hi = hi_bound;
-	reset();
+	const unsigned X = 0, Y = 1, Z = 2;
+	return (spread_bits(cell[X]) << 2) | (spread_bits(cell[Y]) << 1) | spread_bits(cell[Z]);
 }
 
-//// Resets the octree
-void Octree::reset()
+/// Spreads the lower 21 bits of x so that there are two zero bits between each bit
+uint64_t Octree::spread_bits(uint64_t x)
 {
-	// clear the number of points
-	_num_points = 0;
-
-	// recursively destroy all child nodes
-	for (unsigned i=0; i< _children.size(); i++)
-		_children[i]->reset();
-	_children.clear();
+	x &= 0x1fffffULL;
+	x = (x | (x << 32)) & 0x1f00000000ffffULL;
+	x = (x | (x << 16)) & 0x1f0000ff0000ffULL;
+	x = (x | (x << 8)) & 0x100f00f00f00f00fULL;
+	x = (x | (x << 4)) & 0x10c30c30c30c30c3ULL;
+	x = (x | (x << 2)) & 0x1249249249249249ULL;
+	return x;
 }
 
-/// Subdivides this octree (if possible)
+/// Finds the points in the leaf cells within a range of cells
 /**
- * \return <b>true</b> if successfully subdivides, <b>false</b> otherwise
+ * The octree is descended from the root; nodes that contain no points or
+ * that lie outside of the range are pruned, and the points in nodes that
+ * lie entirely within the range are contiguous in the sorted points.
+ * \param lo the lowest coordinates of the range of cells
+ * \param hi the highest coordinates of the range of cells
+ * \param ranges the index ranges [begin, end) into the sorted points of all
+ *        points within the range, on return; if NULL, the search stops as
+ *        soon as one point is found
+ * \return <b>true</b> if a point was found
  */
-bool Octree::subdivide()
+bool Octree::find_points(const unsigned lo[3], const unsigned hi[3], vector<pair<unsigned, unsigned> >* ranges) const
 {
-	const unsigned X = 0, Y = 1, Z = 2;
+	const unsigned THREE_D = 3;
 
-	if (!_children.empty())
-		return true;
+	if (ranges)
+		ranges->clear();
 
-	// compute the side length
-	Vector3 sidelen = (_bounds_hi - _bounds_lo)/2;
+	// setup the stack of nodes (the level of each node followed by its
+	// coordinates at that level)
+	vector<unsigned> S;
+	S.push_back(0);
+	S.push_back(0);
+	S.push_back(0);
+	S.push_back(0);
 
-	// check that the minimum resolution is not exceeded (we're assuming cell
-	// is a cube)
-	if (sidelen[X] < _minres)
-		return false;
+	while (!S.empty())
+	{
+		// get the node off of the stack
+		unsigned cell[3];
+		cell[2] = S.back();  S.pop_back();
+		cell[1] = S.back();  S.pop_back();
+		cell[0] = S.back();  S.pop_back();
+		const unsigned level = S.back();  S.pop_back();
+		const unsigned shift = _depth - level;
+
+		// check the range of leaf cells covered by the node against the range
+		bool outside = false, inside = true;
+		for (unsigned i=0; i< THREE_D; i++)
+		{
+			unsigned node_lo = cell[i] << shift;
+			unsigned node_hi = ((cell[i] + 1) << shift) - 1;
+			if (node_hi < lo[i] || node_lo > hi[i])
+				outside = true;
+			else if (node_lo < lo[i] || node_hi > hi[i])
+				inside = false;
+		}
+		if (outside)
+			continue;
+
+		// find the points in the node
+		Point p;
+		uint64_t key = calc_key(cell);
+		p.key = key << (shift*3);
+		vector<Point>::const_iterator begin = std::lower_bound(_points.begin(), _points.end(), p);
+		p.key = (key + 1) << (shift*3);
+		if (begin == _points.end() || !(*begin < p))
+			continue;
+
+		// if the node lies entirely within the range, all of its points do
+		if (inside)
+		{
+			if (!ranges)
+				return true;
+			vector<Point>::const_iterator end = std::lower_bound(begin, _points.end(), p);
+			ranges->push_back(make_pair(begin - _points.begin(), end - _points.begin()));
+			continue;
+		}
 
-	// allocate the vector for octree children
-	_children = std::vector<OctreePtr>(OCT_CHILDREN); 
-
-	// Subdivision order
-  // 	   1---5
-  //     /|  /|
-  //    0---4 |
-  //    | 3-|-7
-  //    |/  |/
-  //    2---6
-
-	// setup vectors for sub bounds
-	Vector3 sub_bounds_lo, sub_bounds_hi;
-
-	// box 0
-	sub_bounds_lo[X] = _bounds_lo[X];
-	sub_bounds_lo[Y] = _bounds_lo[Y] + sidelen[Y];
-	sub_bounds_lo[Z] = _bounds_lo[Z];
-	sub_bounds_hi[X] = _bounds_lo[X] + sidelen[X];
-	sub_bounds_hi[Y] = _bounds_hi[Y];
-	sub_bounds_hi[Z] = _bounds_lo[Z] + sidelen[Z];
-	_children[0] = OctreePtr(new Octree(shared_from_this(), _minres, sub_bounds_lo, sub_bounds_hi));
-	
-	// box 1
-	sub_bounds_lo[X] = _bounds_lo[X];
-	sub_bounds_lo[Y] = _bounds_lo[Y] + sidelen[Y];
-	sub_bounds_lo[Z] = _bounds_lo[Z] + sidelen[Z];
-	sub_bounds_hi[X] = _bounds_lo[X] + sidelen[X];
-	sub_bounds_hi[Y] = _bounds_hi[Y];
-	sub_bounds_hi[Z] = _bounds_hi[Z];
-	_children[1] = OctreePtr(new Octree(shared_from_this(), _minres, sub_bounds_lo, sub_bounds_hi));
-	
-	// box 2
-	sub_bounds_lo[X] = _bounds_lo[X];
-	sub_bounds_lo[Y] = _bounds_lo[Y];
-	sub_bounds_lo[Z] = _bounds_lo[Z];
-	sub_bounds_hi[X] = _bounds_lo[X] + sidelen[X];
-	sub_bounds_hi[Y] = _bounds_lo[Y] + sidelen[Y];
-	sub_bounds_hi[Z] = _bounds_lo[Z] + sidelen[Z];
-	_children[2] = OctreePtr(new Octree(shared_from_this(), _minres, sub_bounds_lo, sub_bounds_hi));
-	
-	// box 3
-	sub_bounds_lo[X] = _bounds_lo[X];
-	sub_bounds_lo[Y] = _bounds_lo[Y];
-	sub_bounds_lo[Z] = _bounds_lo[Z] + sidelen[Z];
-	sub_bounds_hi[X] = _bounds_lo[X] + sidelen[X];
-	sub_bounds_hi[Y] = _bounds_lo[Y] + sidelen[Y];
-	sub_bounds_hi[Z] = _bounds_hi[Z];
-	_children[3] = OctreePtr(new Octree(shared_from_this(), _minres, sub_bounds_lo, sub_bounds_hi));
-	
-	// box 4
-	sub_bounds_lo[X] = _bounds_lo[X] + sidelen[X];
-	sub_bounds_lo[Y] = _bounds_lo[Y] + sidelen[Y];
-	sub_bounds_lo[Z] = _bounds_lo[Z];
-	sub_bounds_hi[X] = _bounds_hi[X];
-	sub_bounds_hi[Y] = _bounds_hi[Y];
-	sub_bounds_hi[Z] = _bounds_lo[Z] + sidelen[Z];
-	_children[4] = OctreePtr(new Octree(shared_from_this(), _minres, sub_bounds_lo, sub_bounds_hi));
-	
-	// box 5
-	sub_bounds_lo[X] = _bounds_lo[X] + sidelen[X];
-	sub_bounds_lo[Y] = _bounds_lo[Y] + sidelen[Y];
-	sub_bounds_lo[Z] = _bounds_lo[Z] + sidelen[Z];
-	sub_bounds_hi[X] = _bounds_hi[X];
-	sub_bounds_hi[Y] = _bounds_hi[Y];
-	sub_bounds_hi[Z] = _bounds_hi[Z];
-	_children[5] = OctreePtr(new Octree(shared_from_this(), _minres, sub_bounds_lo, sub_bounds_hi));
-	
-	// box 6
-	sub_bounds_lo[X] = _bounds_lo[X] + sidelen[X];
-	sub_bounds_lo[Y] = _bounds_lo[Y];
-	sub_bounds_lo[Z] = _bounds_lo[Z];
-	sub_bounds_hi[X] = _bounds_hi[X];
-	sub_bounds_hi[Y] = _bounds_lo[Y] + sidelen[Y];
-	sub_bounds_hi[Z] = _bounds_lo[Z] + sidelen[Z];
-	_children[6] = OctreePtr(new Octree(shared_from_this(), _minres, sub_bounds_lo, sub_bounds_hi));
-	
-	// box 7
-	sub_bounds_lo[X] = _bounds_lo[X] + sidelen[X];
-	sub_bounds_lo[Y] = _bounds_lo[Y];
-	sub_bounds_lo[Z] = _bounds_lo[Z] + sidelen[Z];
-	sub_bounds_hi[X] = _bounds_hi[X];
-	sub_bounds_hi[Y] = _bounds_lo[Y] + sidelen[Y];
-	sub_bounds_hi[Z] = _bounds_hi[Z];
-	_children[7] = OctreePtr(new Octree(shared_from_this(), _minres, sub_bounds_lo, sub_bounds_hi));
+		// otherwise, process the children
+		assert(level < _depth);
+		for (unsigned j=0; j< 8; j++)
+		{
+			S.push_back(level+1);
+			S.push_back(cell[0]*2 + ((j >> 2) & 1));
+			S.push_back(cell[1]*2 + ((j >> 1) & 1));
+			S.push_back(cell[2]*2 + (j & 1));
+		}
+	}
 
-	return true;
+	return (ranges && !ranges->empty());
+}
+
+/// Sorts points by key using (stable) least-significant-digit radix sort
+/**
+ * Digits are counted and scattered for blocks of points in parallel.
+ * \param points the points to sort
+ * \param nbits the number of (low-order) bits of the keys to sort on
+ */
+void Octree::radix_sort(vector<Point>& points, unsigned nbits)
+{
+	const unsigned RADIX_BITS = 8, RADIX = 1 << RADIX_BITS;
+	const unsigned BLOCK_SIZE = 16384;
+	const unsigned N = points.size();
+	const int NBLOCKS = (int) ((N + BLOCK_SIZE - 1)/BLOCK_SIZE);
+
+	vector<Point> tmp(N);
+	vector<unsigned> offsets(NBLOCKS*RADIX);
+	for (unsigned shift = 0; shift < nbits; shift += RADIX_BITS)
+	{
+		// count the digits within each block
+		std::fill(offsets.begin(), offsets.end(), 0);
+		#pragma omp parallel for
+		for (int b=0; b< NBLOCKS; b++)
+		{
+			unsigned* count = &offsets[b*RADIX];
+			const unsigned end = std::min(N, (b+1)*BLOCK_SIZE);
+			for (unsigned i=b*BLOCK_SIZE; i< end; i++)
+				count[(points[i].key >> shift) & (RADIX-1)]++;
+		}
+
+		// compute the offset of each digit within each block
+		unsigned offset = 0;
+		for (unsigned d=0; d< RADIX; d++)
+			for (int b=0; b< NBLOCKS; b++)
+			{
+				unsigned count = offsets[b*RADIX+d];
+				offsets[b*RADIX+d] = offset;
+				offset += count;
+			}
+
+		// scatter the points
+		#pragma omp parallel for
+		for (int b=0; b< NBLOCKS; b++)
+		{
+			unsigned* offset = &offsets[b*RADIX];
+			const unsigned end = std::min(N, (b+1)*BLOCK_SIZE);
+			for (unsigned i=b*BLOCK_SIZE; i< end; i++)
+				tmp[offset[(points[i].key >> shift) & (RADIX-1)]++] = points[i];
+		}
+		points.swap(tmp);
+	}
 }
 
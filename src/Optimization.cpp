@@ -28,6 +28,7 @@ extern "C"
 #include <Moby/cblas.h>
 #include <Moby/select>
 #include <Moby/LinAlg.h>
+#include <Moby/BasisLU.h>
 #include <Moby/FastThreadable.h>
 #include <Moby/Log.h>
 #include <Moby/SingularException.h>
@@ -3535,7 +3536,7 @@ bool Optimization::lp(const MatrixN& A, const VectorN& b, const VectorN& c, cons
     }
 
     // modify copy of c
-    assert(std::fabs((c - aak*c[k])[k]) < NEAR_ZERO);
+    assert(std::fabs(c[k] - aak[k]*c[k]) < NEAR_ZERO);
     VectorN cprime = remove_component(c - aak*c[k], k);  
 
     // generate new lower and upper bounds for variables
@@ -3548,8 +3549,8 @@ bool Optimization::lp(const MatrixN& A, const VectorN& b, const VectorN& c, cons
     g.set_zero(d);
     f[k] = 1;
     g[k] = -1;
-    assert(std::fabs((f - aak)[k]) < NEAR_ZERO);
-    assert(std::fabs((g + aak)[k]) < NEAR_ZERO);
+    assert(std::fabs(f[k] - aak[k]) < NEAR_ZERO);
+    assert(std::fabs(g[k] + aak[k]) < NEAR_ZERO);
     f = remove_component(f - aak, k);
     g = remove_component(g + aak, k);
     Real bf = u[k] - bak;
@@ -4531,14 +4532,23 @@ void Optimization::qp_to_lcp2(const MatrixN& G, const VectorN& c, const MatrixN&
 }
 
 /// Regularized wrapper around Lemke's algorithm
+/**
+ * Solves the LCP (M + lambda*I, q) for lambda = 0 and then for lambda =
+ * 10^min_exp, 10^(min_exp+step_exp), ..., stopping at the first solution.
+ * Each problem is warm started from the final basis of the previous one, so
+ * that the pivoting sequence need not be repeated from scratch.
+ * \param z a vector "close" to the solution on input (optional); contains
+ *        the solution on output
+ */
 bool Optimization::lcp_lemke_regularized(const MatrixN& M, const VectorN& q, VectorN& z, int min_exp, unsigned step_exp, int max_exp, Real piv_tol, Real zero_tol)
 {
   FILE_LOG(LOG_OPT) << "Optimization::lcp_lemke_regularized() entered" << endl;
-  SAFESTATIC FastThreadable<VectorN> w_x, qq_x;
-  SAFESTATIC FastThreadable<MatrixN> MM_x, Me_x;
+  SAFESTATIC FastThreadable<VectorN> w_x;
+  SAFESTATIC FastThreadable<MatrixN> MM_x;
+  SAFESTATIC FastThreadable<vector<unsigned> > basis_x;
   VectorN& w = w_x();
-  VectorN& qq = qq_x();
   MatrixN& MM = MM_x();
+  vector<unsigned>& basis = basis_x();
 
   // look for fast exit
   if (q.size() == 0)
@@ -4547,15 +4557,18 @@ bool Optimization::lcp_lemke_regularized(const MatrixN& M, const VectorN& q, Vec
     return true;
   }
 
-  // copy MM and qq  
-  MM.copy_from(M);
-  qq.copy_from(q);
-
   // assign value for zero tolerance, if necessary
   const Real ZERO_TOL = (zero_tol > (Real) 0.0) ? zero_tol : q.size() * std::numeric_limits<Real>::epsilon();
 
+  // setup the initial basis from z
+  basis.clear();
+  if (z.size() == q.size())
+    for (unsigned i=0; i< z.size(); i++)
+      if (z[i] > (Real) 0.0)
+        basis.push_back(i);
+
   // try non-regularized version first
-  bool result = lcp_lemke(MM, qq, z, piv_tol, zero_tol);
+  bool result = lcp_lemke(M, q, z, basis, piv_tol, zero_tol);
   if (result)
   {
     // verify that solution truly is a solution -- check z
@@ -4579,6 +4592,7 @@ bool Optimization::lcp_lemke_regularized(const MatrixN& M, const VectorN& q, Vec
   }
 
   // start the regularization process
+  MM.copy_from(M);
   int rf = min_exp;
   while (rf < max_exp)
   {
@@ -4586,25 +4600,17 @@ bool Optimization::lcp_lemke_regularized(const MatrixN& M, const VectorN& q, Vec
     Real lambda = std::pow((Real) 10.0, (Real) rf);
 
     // regularize M
-    MM.copy_from(M);
     for (unsigned i=0; i< MM.rows(); i++)
-      MM(i,i) += lambda;
+      MM(i,i) = M(i,i) + lambda;
 
-    // recopy q
-    qq.copy_from(q);
-
-    // try to solve the LCP
-    if ((result = lcp_lemke(MM, qq, z, piv_tol, zero_tol)))
+    // try to solve the LCP, starting from the last basis
+    if ((result = lcp_lemke(MM, q, z, basis, piv_tol, zero_tol)))
     {
       // verify that solution truly is a solution -- check z
       if (*std::min_element(z.begin(), z.end()) > -ZERO_TOL)
       {
         // check w
-        MM.copy_from(M);
-        for (unsigned i=0; i< MM.rows(); i++)
-          MM(i,i) += lambda;
-        qq.copy_from(q);
-        MM.mult(z, w) += qq;
+        MM.mult(z, w) += q;
         if (*std::min_element(w.begin(), w.end()) > -ZERO_TOL)
         {
           // check z'w
@@ -4632,12 +4638,72 @@ bool Optimization::lcp_lemke_regularized(const MatrixN& M, const VectorN& q, Vec
   return false;
 }
 
+/// Solves B*x = b for the basis of Lemke's algorithm
+/**
+ * Uses the (updated) LU factorization of the basis, falling back to the
+ * pseudo-inverse if the basis is singular.
+ */
+static void solve_lemke_basis(BasisLU& LU, MatrixN& A, const VectorN& b, VectorN& x)
+{
+  x.copy_from(b);
+  if (LU.solve(x))
+    return;
+
+  try
+  {
+    // use slower SVD pseudo-inverse
+    A.copy_from(LU.get_basis());
+    LinAlg::solve_LS_fast1(A, x);
+  }
+  catch (NumericalException e)
+  {
+    A.copy_from(LU.get_basis());
+    x.copy_from(b);
+    LinAlg::solve_LS_fast2(A, x);
+  }
+}
+
+/// Gets the indices of the z variables in a basis of Lemke's algorithm
+static void get_z_basis(const vector<unsigned>& bas, unsigned n, vector<unsigned>& basis)
+{
+  basis.clear();
+  for (unsigned i=0; i< bas.size(); i++)
+    if (bas[i] < n)
+      basis.push_back(bas[i]);
+  std::sort(basis.begin(), basis.end());
+}
+
 /// Lemke's algorithm for solving linear complementarity problems
 /**
  * \param z a vector "close" to the solution on input (optional); contains
  *        the solution on output
  */
 bool Optimization::lcp_lemke(const MatrixN& M, const VectorN& q, VectorN& z, Real piv_tol, Real zero_tol)
+{
+  SAFESTATIC FastThreadable<vector<unsigned> > basis_x;
+  vector<unsigned>& basis = basis_x();
+
+  // the initial basis consists of the z variables that are positive in z
+  basis.clear();
+  if (z.size() == q.size())
+    for (unsigned i=0; i< z.size(); i++)
+      if (z[i] > (Real) 0.0)
+        basis.push_back(i);
+
+  return lcp_lemke(M, q, z, basis, piv_tol, zero_tol);
+}
+
+/// Lemke's algorithm for solving linear complementarity problems, warm started from a given basis
+/**
+ * The basis matrix is maintained using an LU factorization with product-form
+ * updates (see BasisLU), so each pivot costs O(n^2) rather than O(n^3).
+ * \param z contains the solution on output
+ * \param basis the indices of the z variables in the initial basis on input
+ *        (the remaining variables in the initial basis are w variables); the
+ *        indices of the z variables in the final basis on output, which can
+ *        be used to warm start a related problem
+ */
+bool Optimization::lcp_lemke(const MatrixN& M, const VectorN& q, VectorN& z, vector<unsigned>& basis, Real piv_tol, Real zero_tol)
 {
   const unsigned n = q.size();
   const unsigned MAXITER = std::min((unsigned) 1000, 50*n);
@@ -4650,14 +4716,15 @@ bool Optimization::lcp_lemke(const MatrixN& M, const VectorN& q, VectorN& z, Rea
   }
 
   // setup work variables
-  SAFESTATIC FastThreadable<VectorN> Be_x, U_x, z0_x, x_x, d_x, xj_x, dj_x, w_x, result_x;
+  SAFESTATIC FastThreadable<VectorN> Be_x, U_x, x_x, d_x, xj_x, dj_x, w_x, result_x;
   SAFESTATIC FastThreadable<MatrixN> B_x, A_x, t1_x, t2_x;
+  SAFESTATIC FastThreadable<BasisLU> LU_x;
   SAFESTATIC FastThreadable<vector<unsigned> > all_x, tlist_x, bas_x, nonbas_x, j_x; 
+  SAFESTATIC FastThreadable<vector<bool> > in_basis_x;
 
   // get references to all variables
   VectorN& Be = Be_x();
   VectorN& U = U_x();
-  VectorN& z0 = z0_x();
   VectorN& x = x_x();
   VectorN& d = d_x();
   VectorN& xj = xj_x();
@@ -4668,6 +4735,8 @@ bool Optimization::lcp_lemke(const MatrixN& M, const VectorN& q, VectorN& z, Rea
   MatrixN& A = A_x();
   MatrixN& t1 = t1_x();
   MatrixN& t2 = t2_x();
+  BasisLU& LU = LU_x();
+  vector<bool>& in_basis = in_basis_x();
   vector<unsigned>& all = all_x();
   vector<unsigned>& tlist = tlist_x();
   vector<unsigned>& bas = bas_x();
@@ -4681,9 +4750,6 @@ bool Optimization::lcp_lemke(const MatrixN& M, const VectorN& q, VectorN& z, Rea
   nonbas.clear();
   j.clear();
 
-  // copy z to z0
-  z0.copy_from(z);
-
   // come up with a sensible value for zero tolerance if none is given
   if (zero_tol <= (Real) 0.0)
     zero_tol = std::numeric_limits<Real>::epsilon() * M.norm_inf() * n;
@@ -4698,6 +4764,7 @@ bool Optimization::lcp_lemke(const MatrixN& M, const VectorN& q, VectorN& z, Rea
     FILE_LOG(LOG_OPT) << " -- trivial solution found" << endl;
     FILE_LOG(LOG_OPT) << "Optimization::lcp_lemke() exited" << endl;
     z.set_zero(n);
+    basis.clear();
     return true;
   }
 
@@ -4715,17 +4782,17 @@ bool Optimization::lcp_lemke(const MatrixN& M, const VectorN& q, VectorN& z, Rea
   tlist.clear();
 
   // determine initial basis
+  in_basis.assign(n, false);
+  for (unsigned i=0; i< basis.size(); i++)
+    if (basis[i] < n)
+      in_basis[basis[i]] = true;
   bas.clear();
   nonbas.clear();
-  if (z0.size() != n)
-    for (unsigned i=0; i< n; i++)
+  for (unsigned i=0; i< n; i++)
+    if (in_basis[i])
+      bas.push_back(i);
+    else
       nonbas.push_back(i);
-  else
-    for (unsigned i=0; i< n; i++)
-      if (z0[i] > 0)
-        bas.push_back(i);
-      else
-        nonbas.push_back(i);
 
   // B should ideally be a sparse matrix
   B.set_identity(n);
@@ -4747,27 +4814,8 @@ bool Optimization::lcp_lemke(const MatrixN& M, const VectorN& q, VectorN& z, Rea
   }
 
   // solve B*x = -q
-  try
-  {
-    A.copy_from(B);
-    x.copy_from(q);
-    LinAlg::solve_fast(A, x);
-  }
-  catch (SingularException e)
-  {
-    try
-    {
-      // use slower SVD pseudo-inverse
-      A.copy_from(B);
-      x.copy_from(q);
-      LinAlg::solve_LS_fast1(A, x);
-    }
-    catch (NumericalException e)
-    {
-      A.copy_from(B);
-      LinAlg::solve_LS_fast2(A, x);
-    }
-  }
+  LU.set_basis(B);
+  solve_lemke_basis(LU, A, q, x);
   x.negate();
 
   // check whether initial basis provides a solution
@@ -4776,6 +4824,7 @@ bool Optimization::lcp_lemke(const MatrixN& M, const VectorN& q, VectorN& z, Rea
     for (idx = 0, iiter = bas.begin(); iiter != bas.end(); iiter++, idx++)
       z[*iiter] = x[idx];
     z.resize(n, true);
+    get_z_basis(bas, n, basis);
 
     // check to see whether tolerances are satisfied
     FILE_LOG(LOG_OPT) << " -- initial basis provides a solution!" << std::endl;
@@ -4814,7 +4863,7 @@ bool Optimization::lcp_lemke(const MatrixN& M, const VectorN& q, VectorN& z, Rea
   Be.negate();
   x += U*tval;
   x[lvindex] = tval;
-  B.set_column(lvindex, Be);
+  LU.replace_column(lvindex, Be, U.negate());
   FILE_LOG(LOG_OPT) << "  new q: " << x << endl;
 
   // main iterations begin here
@@ -4825,10 +4874,21 @@ bool Optimization::lcp_lemke(const MatrixN& M, const VectorN& q, VectorN& z, Rea
     {
       FILE_LOG(LOG_OPT) << "pivoting " << var(leaving,n) << " and " << var(entering,n) << endl;
       FILE_LOG(LOG_OPT) << "-- solved LCP successfully!" << endl;
+
+      // recompute the basic variables using a fresh factorization of the
+      // final basis, removing the error accumulated by the updates
+      if (LU.num_updates() > 0 && LU.factor())
+      {
+        x.copy_from(q);
+        LU.solve(x);
+        x.negate();
+      }
+
       unsigned idx;
       for (idx = 0, iiter = bas.begin(); iiter != bas.end(); iiter++, idx++)
         z[*iiter] = x[idx];
       z.resize(n, true);
+      get_z_basis(bas, n, basis);
 
       // verify tolerances
       if (LOGGING(LOG_OPT))
@@ -4855,27 +4915,7 @@ bool Optimization::lcp_lemke(const MatrixN& M, const VectorN& q, VectorN& z, Rea
       entering = leaving - n;
       M.get_column(entering, Be);
     }
-    d.copy_from(Be);
-    try
-    {
-      A.copy_from(B);
-      LinAlg::solve_fast(A, d);
-    }
-    catch (SingularException e)
-    {
-      try
-      {
-        // use slower SVD pseudo-inverse
-        A.copy_from(B);
-        d.copy_from(Be);
-        LinAlg::solve_LS_fast1(A, d);
-      }
-      catch (NumericalException e)
-      {
-        A.copy_from(B);
-        LinAlg::solve_LS_fast2(A, d);
-      }
-    }
+    solve_lemke_basis(LU, A, Be, d);
 
     // use a new pivot tolerance if necessary
     const Real PIV_TOL = (piv_tol > (Real) 0.0) ? piv_tol : std::numeric_limits<Real>::epsilon() * n * std::max((Real) 1.0, Be.norm_inf());
@@ -4892,6 +4932,7 @@ bool Optimization::lcp_lemke(const MatrixN& M, const VectorN& q, VectorN& z, Rea
       FILE_LOG(LOG_OPT) << "Optimization::lcp_lemke() exited" << endl;
 
       z.resize(n, true);
+      get_z_basis(bas, n, basis);
       return false;
     }
 
@@ -4926,6 +4967,7 @@ bool Optimization::lcp_lemke(const MatrixN& M, const VectorN& q, VectorN& z, Rea
       FILE_LOG(LOG_OPT) << "zero tolerance too low?" << std::endl;
       FILE_LOG(LOG_OPT) << "Optimization::lcp_lemke() exited" << std::endl;
       z.resize(n, true);
+      get_z_basis(bas, n, basis);
       return false;
     }
 
@@ -4954,11 +4996,11 @@ bool Optimization::lcp_lemke(const MatrixN& M, const VectorN& q, VectorN& z, Rea
     leaving = *iiter;
 
     // ** perform pivot
+    LU.replace_column(lvindex, Be, d);
     Real ratio = x[lvindex]/d[lvindex];
     d*= ratio;
     x -= d;
     x[lvindex] = ratio;
-    B.set_column(lvindex, Be);
     *iiter = entering;
 
     FILE_LOG(LOG_OPT) << "pivoting " << var(leaving,n) << " and " << var(entering,n) << endl;
@@ -4969,6 +5011,7 @@ bool Optimization::lcp_lemke(const MatrixN& M, const VectorN& q, VectorN& z, Rea
 
   // max iterations exceeded
   z.resize(n, true);
+  get_z_basis(bas, n, basis);
   
   return false;
 }
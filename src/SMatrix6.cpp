@@ -11,10 +11,22 @@
 #include <cstring>
 #include <Moby/Constants.h>
 #include <Moby/SMatrix6N.h>
+#include <Moby/SpatialKernels.h>
 #include <Moby/SMatrix6.h>
 
 using namespace Moby;
 
+/// Multiplies the 6x6 matrix A by each of the n columns of B (B and C may alias)
+static void mult_columns(const Real* A, const Real* B, unsigned n, Real* C)
+{
+  Real col[6];
+  for (unsigned j=0; j< n; j++, B += 6, C += 6)
+  {
+    SpatialKernels::mult6(A, B, col);
+    std::copy(col, col+6, C);
+  }
+}
+
 /// Default constructor -- constructs an identity matrix
 SMatrix6::SMatrix6()
 {
@@ -46,11 +58,10 @@ SMatrix6::SMatrix6(const MatrixN& m)
 /// Sets this matrix to identity
 void SMatrix6::set_identity()
 {
-  const Matrix3 IDENTITY_3x3 = Matrix3::identity();
-  set_upper_left(IDENTITY_3x3);
-  set_upper_right(ZEROS_3x3);
-  set_lower_left(ZEROS_3x3);
-  set_lower_right(IDENTITY_3x3);
+  const unsigned N = 6;
+  set_zero();
+  for (unsigned i=0; i< N; i++)
+    _data[i*N+i] = (Real) 1.0;
 }
 
 /// Gets the upper left 3x3 matrix
@@ -190,14 +201,18 @@ SMatrix6 SMatrix6::inverse_inertia(const SMatrix6& I)
 SMatrix6 SMatrix6::spatial_cross(const SVector6& v)
 {
   SMatrix6 X;
-
-  Matrix3 ax = Matrix3::skew_symmetric(v.get_upper());
-  Matrix3 bx = Matrix3::skew_symmetric(v.get_lower());
-
-  X.set_upper_left(ax);
-  X.set_upper_right(ZEROS_3x3);
-  X.set_lower_left(bx);
-  X.set_lower_right(ax);
+  X.set_zero();
+
+  // X = [ax 0; bx ax], where v = [a; b]
+  Real* data = X.data();
+  const Real* a = v.data();
+  const Real* b = v.data()+3;
+  data[1] = data[22] = a[2];  data[2] = data[23] = -a[1];
+  data[6] = data[27] = -a[2]; data[8] = data[29] = a[0];
+  data[12] = data[33] = a[1]; data[13] = data[34] = -a[0];
+  data[4] = b[2];   data[5] = -b[1];
+  data[9] = -b[2];  data[11] = b[0];
+  data[15] = b[1];  data[16] = -b[0];
 
   return X;
 }
@@ -244,7 +259,7 @@ void SMatrix6::set_zero()
 SVector6 SMatrix6::operator*(const SVector6& v) const
 {
   SVector6 result; 
-  CBLAS::gemv(CblasNoTrans, *this, v, (Real) 1.0, (Real) 0.0, result); 
+  SpatialKernels::mult6(_data, v.data(), result.data());
   return result;
 }
 
@@ -252,7 +267,7 @@ SVector6 SMatrix6::operator*(const SVector6& v) const
 SMatrix6 SMatrix6::operator*(const SMatrix6& m) const
 {
   SMatrix6 result;
-  CBLAS::gemm(CblasNoTrans, CblasNoTrans, *this, m, (Real) 1.0, (Real) 0.0, result); 
+  SpatialKernels::mult6x6(_data, m.data(), result.data());
   return result;
 }
 
@@ -321,8 +336,8 @@ SMatrix6N* SMatrix6::mult(const SMatrix6N* m, SMatrix6N* result) const
   // resize the new matrix
   result->resize(ROWS, m->columns());
 
-  // carry out multiplication using BLAS
-  CBLAS::gemm(CblasNoTrans, CblasNoTrans, *this, *m, (Real) 1.0, (Real) 0.0, *result); 
+  // carry out multiplication column by column (m and result may alias)
+  mult_columns(_data, m->data(), m->columns(), result->data());
 
   return result;
 }
@@ -346,8 +361,8 @@ MatrixN& SMatrix6::mult(const SMatrix6N* m, MatrixN& result) const
   // resize the new matrix
   result.resize(ROWS, m->columns());
 
-  // carry out multiplication using BLAS
-  CBLAS::gemm(CblasNoTrans, CblasNoTrans, *this, *m, (Real) 1.0, (Real) 0.0, result); 
+  // carry out multiplication column by column
+  mult_columns(_data, m->data(), m->columns(), result.data());
 
   return result;
 }
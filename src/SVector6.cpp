@@ -9,6 +9,7 @@
 #include <functional>
 #include <algorithm>
 #include <Moby/Matrix3.h>
+#include <Moby/SpatialKernels.h>
 #include <Moby/SVector6.h>
 
 using namespace Moby;
@@ -53,16 +54,9 @@ SVector6::SVector6(const VectorN& v)
 /// Computes the spatial cross product between two vectors
 SVector6 SVector6::spatial_cross(const SVector6& v1, const SVector6& v2)
 {
-  // get the two skew symmetric matrices we need
-  Matrix3 ax = Matrix3::skew_symmetric(v1.get_upper());
-  Matrix3 bx = Matrix3::skew_symmetric(v1.get_lower());
-
-  // multiply
-  Vector3 v2top = v2.get_upper();
-  Vector3 v2bot = v2.get_lower();
-  Vector3 top = ax * v2top;
-  Vector3 bot = (bx * v2top) + (ax * v2bot);
-  return SVector6(top, bot);
+  SVector6 result;
+  SpatialKernels::spatial_cross(v1.data(), v2.data(), result.data());
+  return result;
 }
 
 /// Gets the lower 3-dimensional vector
@@ -0,0 +1,360 @@
+/****************************************************************************
+ * Copyright 2011 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#include <cmath>
+#include <set>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <Moby/Constants.h>
+#include <Moby/Log.h>
+#include <Moby/MissizeException.h>
+#include <Moby/NonsquareMatrixException.h>
+#include <Moby/SparseCholesky.h>
+
+using std::vector;
+using std::set;
+using std::pair;
+using std::make_pair;
+using boost::shared_array;
+using namespace Moby;
+
+/// Marks an empty linked list (or unset marker) in the factorization
+static const unsigned NONE = std::numeric_limits<unsigned>::max();
+
+SparseCholesky::SparseCholesky()
+{
+  _n = 0;
+  _Lp.push_back(0);
+  _factored = true;
+}
+
+/// Computes a minimum degree ordering of a symmetric matrix
+/**
+ * Eliminates, at each step, the vertex of least degree in the elimination
+ * graph of A (ties are broken by the lowest index), connecting its neighbors
+ * into a clique.  Degrees are exact (rather than the approximate degrees of
+ * AMD), which is inexpensive for the narrow-banded and tree-structured
+ * matrices that arise from mechanisms.
+ * \param A a symmetric matrix (only its nonzero structure is used)
+ * \param perm on return, perm[i] is the index of the i'th vertex eliminated
+ */
+void SparseCholesky::calc_min_degree_ordering(const SparseMatrixN& A, vector<unsigned>& perm)
+{
+  if (A.rows() != A.columns())
+    throw NonsquareMatrixException();
+
+  const unsigned N = A.rows();
+  shared_array<unsigned> ptr = A.get_ptr();
+  shared_array<unsigned> indices = A.get_indices();
+
+  // build the (symmetrized) graph of A, without self loops
+  vector<set<unsigned> > adj(N);
+  for (unsigned i=0; i< N; i++)
+    for (unsigned k=ptr[i]; k< ptr[i+1]; k++)
+      if (indices[k] != i)
+      {
+        adj[i].insert(indices[k]);
+        adj[indices[k]].insert(i);
+      }
+
+  // setup the priority queue of (degree, vertex) pairs
+  set<pair<unsigned, unsigned> > queue;
+  for (unsigned i=0; i< N; i++)
+    queue.insert(make_pair((unsigned) adj[i].size(), i));
+
+  // eliminate vertices
+  perm.clear();
+  perm.reserve(N);
+  vector<unsigned> nbrs;
+  while (!queue.empty())
+  {
+    // get the vertex of minimum degree
+    const unsigned v = queue.begin()->second;
+    queue.erase(queue.begin());
+    perm.push_back(v);
+
+    // remove v from the graph
+    nbrs.assign(adj[v].begin(), adj[v].end());
+    adj[v].clear();
+    for (unsigned i=0; i< nbrs.size(); i++)
+    {
+      queue.erase(make_pair((unsigned) adj[nbrs[i]].size(), nbrs[i]));
+      adj[nbrs[i]].erase(v);
+    }
+
+    // connect the neighbors of v into a clique and update their degrees
+    for (unsigned i=0; i< nbrs.size(); i++)
+    {
+      for (unsigned j=0; j< nbrs.size(); j++)
+        if (i != j)
+          adj[nbrs[i]].insert(nbrs[j]);
+      queue.insert(make_pair((unsigned) adj[nbrs[i]].size(), nbrs[i]));
+    }
+  }
+}
+
+/// Determines whether A has the nonzero structure of the analyzed matrix
+bool SparseCholesky::same_structure(const SparseMatrixN& A) const
+{
+  if (A.rows() != _n || A.columns() != _n || A.num_elements() != _Aindices.size())
+    return false;
+  if (_n == 0)
+    return !_Aptr.empty();
+
+  shared_array<unsigned> ptr = A.get_ptr();
+  shared_array<unsigned> indices = A.get_indices();
+  return std::equal(_Aptr.begin(), _Aptr.end(), ptr.get()) &&
+         std::equal(_Aindices.begin(), _Aindices.end(), indices.get());
+}
+
+/// Computes the symbolic factorization of A
+/**
+ * Computes the fill-reducing ordering and the nonzero structure of L.  The
+ * structure of column j of L is the structure of column j of P*A*P' below
+ * the diagonal merged with the structures of the columns of its children in
+ * the elimination tree.
+ */
+void SparseCholesky::analyze(const SparseMatrixN& A)
+{
+  if (A.rows() != A.columns())
+    throw NonsquareMatrixException();
+
+  // store the structure of A
+  _n = A.rows();
+  shared_array<unsigned> ptr = A.get_ptr();
+  shared_array<unsigned> indices = A.get_indices();
+  if (_n > 0)
+  {
+    _Aptr.assign(ptr.get(), ptr.get()+_n+1);
+    _Aindices.assign(indices.get(), indices.get()+ptr[_n]);
+  }
+  else
+  {
+    _Aptr.assign(1, 0);
+    _Aindices.clear();
+  }
+
+  // compute the ordering and its inverse
+  calc_min_degree_ordering(A, _perm);
+  _pinv.resize(_n);
+  for (unsigned i=0; i< _n; i++)
+    _pinv[_perm[i]] = i;
+
+  // compute the structure of L, column by column
+  vector<vector<unsigned> > children(_n);
+  vector<unsigned> mark(_n, NONE), pattern;
+  _Lp.resize(_n+1);
+  _Lp[0] = 0;
+  _Li.clear();
+  for (unsigned j=0; j< _n; j++)
+  {
+    mark[j] = j;
+    pattern.clear();
+
+    // add the structure of column j of P*A*P' below the diagonal
+    const unsigned r = _perm[j];
+    for (unsigned k=_Aptr[r]; k< _Aptr[r+1]; k++)
+    {
+      const unsigned i = _pinv[_Aindices[k]];
+      if (i > j && mark[i] != j)
+      {
+        mark[i] = j;
+        pattern.push_back(i);
+      }
+    }
+
+    // merge the structures of the children
+    for (unsigned c=0; c< children[j].size(); c++)
+    {
+      const unsigned child = children[j][c];
+      for (unsigned k=_Lp[child]+1; k< _Lp[child+1]; k++)
+      {
+        const unsigned i = _Li[k];
+        if (mark[i] != j)
+        {
+          mark[i] = j;
+          pattern.push_back(i);
+        }
+      }
+    }
+
+    // store the column (diagonal first); its parent is its first off-diagonal
+    std::sort(pattern.begin(), pattern.end());
+    _Li.push_back(j);
+    _Li.insert(_Li.end(), pattern.begin(), pattern.end());
+    _Lp[j+1] = _Li.size();
+    if (!pattern.empty())
+      children[pattern.front()].push_back(j);
+  }
+
+  _Lx.resize(_Li.size());
+
+  FILE_LOG(LOG_LINALG) << "SparseCholesky::analyze() - " << _n << "x" << _n << " matrix with " << _Aindices.size() << " nonzeros; factor has " << _Li.size() << " nonzeros" << std::endl;
+}
+
+/// Computes the Cholesky factorization of a symmetric positive definite matrix
+/**
+ * The symbolic factorization is computed first if A does not have the
+ * nonzero structure of the last analyzed matrix.  A pivot is rejected if it
+ * is no greater than eps*n*max_i A(i,i) (eps the machine epsilon), so that
+ * matrices that are singular up to rounding error (e.g., from redundant
+ * constraints) are reported as such rather than yielding huge solutions.
+ * \return <b>true</b> if A is (numerically) positive definite, <b>false</b>
+ *         otherwise
+ */
+bool SparseCholesky::factor(const SparseMatrixN& A)
+{
+  if (!same_structure(A))
+    analyze(A);
+
+  shared_array<Real> Adata = A.get_data();
+
+  // determine the pivot tolerance
+  Real max_diag = (Real) 0.0;
+  for (unsigned i=0; i< _n; i++)
+    for (unsigned k=_Aptr[i]; k< _Aptr[i+1]; k++)
+      if (_Aindices[k] == i)
+        max_diag = std::max(max_diag, Adata[k]);
+  const Real TOL = std::numeric_limits<Real>::epsilon()*_n*max_diag;
+
+  // link[j] is the head of the list of columns k < j with L(j,k) != 0 that
+  // have yet to update column j; next[k] is the position in column k of the
+  // next row to update
+  vector<unsigned> link(_n, NONE), next(_n);
+  vector<Real> w(_n, (Real) 0.0);
+
+  _factored = false;
+  for (unsigned j=0; j< _n; j++)
+  {
+    // scatter column j of P*A*P' (on and below the diagonal)
+    const unsigned r = _perm[j];
+    for (unsigned k=_Aptr[r]; k< _Aptr[r+1]; k++)
+    {
+      const unsigned i = _pinv[_Aindices[k]];
+      if (i >= j)
+        w[i] += Adata[k];
+    }
+
+    // apply the updates from the columns to the left
+    for (unsigned k=link[j]; k != NONE; )
+    {
+      const unsigned knext = link[k];
+      const unsigned p = next[k];
+      const Real ljk = _Lx[p];
+      for (unsigned q=p; q< _Lp[k+1]; q++)
+        w[_Li[q]] -= _Lx[q]*ljk;
+
+      // move column k to the list of the next row that it updates
+      if (++next[k] < _Lp[k+1])
+      {
+        const unsigned i = _Li[next[k]];
+        link[k] = link[i];
+        link[i] = k;
+      }
+      k = knext;
+    }
+
+    // compute the diagonal (this test also catches NaN)
+    const Real d = w[j];
+    w[j] = (Real) 0.0;
+    if (!(d > TOL))
+    {
+      FILE_LOG(LOG_LINALG) << "SparseCholesky::factor() - matrix is not positive definite (pivot " << j << " is " << d << ", tolerance " << TOL << ")" << std::endl;
+      std::fill(w.begin(), w.end(), (Real) 0.0);
+      return false;
+    }
+    const Real ljj = std::sqrt(d);
+    _Lx[_Lp[j]] = ljj;
+
+    // gather the rest of the column
+    for (unsigned q=_Lp[j]+1; q< _Lp[j+1]; q++)
+    {
+      _Lx[q] = w[_Li[q]]/ljj;
+      w[_Li[q]] = (Real) 0.0;
+    }
+
+    // column j updates the row of its first off-diagonal next
+    if (_Lp[j]+1 < _Lp[j+1])
+    {
+      next[j] = _Lp[j]+1;
+      const unsigned i = _Li[next[j]];
+      link[j] = link[i];
+      link[i] = j;
+    }
+  }
+
+  _factored = true;
+  return true;
+}
+
+/// Solves L*L'*y = y in place for a permuted right hand side
+void SparseCholesky::solve(Real* y) const
+{
+  // solve L*z = y
+  for (unsigned j=0; j< _n; j++)
+  {
+    y[j] /= _Lx[_Lp[j]];
+    for (unsigned q=_Lp[j]+1; q< _Lp[j+1]; q++)
+      y[_Li[q]] -= _Lx[q]*y[j];
+  }
+
+  // solve L'*x = z
+  for (unsigned j=_n; j-- > 0; )
+  {
+    for (unsigned q=_Lp[j]+1; q< _Lp[j+1]; q++)
+      y[j] -= _Lx[q]*y[_Li[q]];
+    y[j] /= _Lx[_Lp[j]];
+  }
+}
+
+/// Solves A*x = b using the factorization computed by factor()
+/**
+ * \param xb the right hand side on input, the solution x on return
+ */
+VectorN& SparseCholesky::solve(VectorN& xb) const
+{
+  if (xb.size() != _n)
+    throw MissizeException();
+  if (!_factored)
+    throw std::runtime_error("SparseCholesky::solve() - matrix has not been successfully factored!");
+
+  vector<Real> y(_n);
+  for (unsigned i=0; i< _n; i++)
+    y[_pinv[i]] = xb[i];
+  if (_n > 0)
+    solve(&y.front());
+  for (unsigned i=0; i< _n; i++)
+    xb[i] = y[_pinv[i]];
+
+  return xb;
+}
+
+/// Solves A*X = B using the factorization computed by factor()
+/**
+ * \param XB the right hand sides on input, the solutions X on return
+ */
+MatrixN& SparseCholesky::solve(MatrixN& XB) const
+{
+  if (XB.rows() != _n)
+    throw MissizeException();
+  if (!_factored)
+    throw std::runtime_error("SparseCholesky::solve() - matrix has not been successfully factored!");
+
+  vector<Real> y(_n);
+  for (unsigned j=0; j< XB.columns() && _n > 0; j++)
+  {
+    Real* x = XB.data() + j*_n;
+    for (unsigned i=0; i< _n; i++)
+      y[_pinv[i]] = x[i];
+    solve(&y.front());
+    for (unsigned i=0; i< _n; i++)
+      x[i] = y[_pinv[i]];
+  }
+
+  return XB;
+}
+
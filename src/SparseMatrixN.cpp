@@ -4,6 +4,8 @@
  * License (found in COPYING).
  ****************************************************************************/
 
+#include <algorithm>
+#include <limits>
 #include <Moby/FastThreadable.h>
 #include <Moby/Constants.h>
 #include <Moby/MissizeException.h>
@@ -19,6 +21,9 @@ using std::vector;
 
 using namespace Moby;
 
+/// The number of stored elements above which products are multithreaded
+static const unsigned PARALLEL_MIN_NNZ = 20000;
+
 SparseMatrixN::SparseMatrixN()
 {
   _rows = _columns = 0;
@@ -41,14 +46,43 @@ SparseMatrixN::SparseMatrixN(unsigned m, unsigned n, shared_array<unsigned> ptr,
 /// Creates a sparse matrix from a dense matrix
 SparseMatrixN::SparseMatrixN(const MatrixN& m)
 {
-  map<pair<unsigned, unsigned>, Real> values;
+  set(m, NEAR_ZERO);
+}
+
+/// Creates a sparse matrix from the elements of a dense matrix of magnitude greater than tol
+SparseMatrixN::SparseMatrixN(const MatrixN& m, Real tol)
+{
+  set(m, tol);
+}
+
+/// Sets up a sparse matrix from the elements of a dense matrix of magnitude greater than tol
+void SparseMatrixN::set(const MatrixN& m, Real tol)
+{
+  _rows = m.rows();
+  _columns = m.columns();
+
+  // count the nonzero elements
+  unsigned nv = 0;
   for (unsigned i=0; i< m.rows(); i++)
     for (unsigned j=0; j< m.columns(); j++)
-      if (std::fabs(m(i,j)) > NEAR_ZERO)
-        values[make_pair(i,j)] = m(i,j);
+      if (std::fabs(m(i,j)) > tol)
+        nv++;
 
-  // setup the matrix
-  set(m.rows(), m.columns(), values);
+  // setup the arrays
+  _data = shared_array<Real>(new Real[nv]);
+  _ptr = shared_array<unsigned>(new unsigned[_rows+1]);
+  _indices = shared_array<unsigned>(new unsigned[nv]);
+  _ptr[0] = 0;
+  for (unsigned i=0, k=0; i< m.rows(); i++)
+  {
+    for (unsigned j=0; j< m.columns(); j++)
+      if (std::fabs(m(i,j)) > tol)
+      {
+        _data[k] = m(i,j);
+        _indices[k++] = j;
+      }
+    _ptr[i+1] = k;
+  }
 }
 
 /// Sets up an identity matrix from a sparse matrix
@@ -86,26 +120,21 @@ void SparseMatrixN::set(unsigned m, unsigned n, const map<pair<unsigned, unsigne
   _ptr = shared_array<unsigned>(new unsigned[m+1]);
   _indices = shared_array<unsigned>(new unsigned[nv]);
 
-  // populate the matrix data
+  // the map is ordered by row, then by column, so the data and indices can
+  // be populated (and the row pointers counted) in a single pass
+  for (unsigned r=0; r<= m; r++)
+    _ptr[r] = 0;
   map<pair<unsigned, unsigned>, Real>::const_iterator i = values.begin();
-  unsigned j;
-  for (j=0; j< nv; j++, i++)
+  for (unsigned j=0; j< nv; j++, i++)
+  {
     _data[j] = i->second;
+    _indices[j] = i->first.second;
+    _ptr[i->first.first+1]++;
+  }
 
   // setup ptr
-  j = 0;
-  unsigned k=0;
-  _ptr[0] = j;
   for (unsigned r=0; r< m; r++)
-  {
-    for (unsigned s=0; s< n; s++)
-      if (values.find(make_pair(r, s)) != values.end())
-      {
-        j++;
-        _indices[k++] = s;
-      }
-    _ptr[r+1] = j;
-  }
+    _ptr[r+1] += _ptr[r];
 }
 
 /// Gets a column of the sparse matrix as a sparse vector
@@ -250,17 +279,23 @@ MatrixN& SparseMatrixN::mult(const MatrixN& m, MatrixN& result) const
   // setup the result matrix
   result.set_zero(_rows, m.columns());
 
-  // do the calculation
-  for (unsigned col=0; col < m.columns(); col++)
-    for (unsigned row=0; row < _rows; row++)
+  // do the calculation (rows are independent, so they are computed in
+  // parallel for large problems, using a single parallel region)
+  const int NROWS = (int) _rows;
+  const unsigned NCOLS = m.columns();
+  #pragma omp parallel for if (num_elements()*NCOLS > PARALLEL_MIN_NNZ)
+  for (int row=0; row < NROWS; row++)
+  {
+    unsigned row_start = _ptr[row];
+    unsigned row_end = _ptr[row+1];
+    for (unsigned col=0; col < NCOLS; col++)
     {
       Real dot = (Real) 0.0;
-      unsigned row_start = _ptr[row];
-      unsigned row_end = _ptr[row+1];
       for (unsigned jj= row_start; jj< row_end; jj++)
         dot += _data[jj] * m(_indices[jj], col);
       result(row,col) += dot;
     }
+  }
 
   return result;
 }
@@ -274,7 +309,10 @@ VectorN& SparseMatrixN::mult(const VectorN& x, VectorN& result) const
   // setup the result matrix
   result.set_zero(_rows);
 
-  for (unsigned row=0; row < _rows; row++)
+  // rows are independent, so they are computed in parallel for large matrices
+  const int NROWS = (int) _rows;
+  #pragma omp parallel for if (num_elements() > PARALLEL_MIN_NNZ)
+  for (int row=0; row < NROWS; row++)
   {
     Real dot = (Real) 0.0;
     unsigned row_start = _ptr[row];
@@ -376,6 +414,152 @@ MatrixN& SparseMatrixN::transpose_mult_transpose(const MatrixN& m, MatrixN& resu
   return result;
 }
 
+/// Computes A*diag(d)*B for sparse matrices A and B (d is ignored if NULL)
+/**
+ * Uses Gustavson's algorithm: each row of the result is accumulated in a
+ * dense work vector, so the cost is proportional to the number of
+ * floating point operations rather than to the dimensions of the result.
+ */
+SparseMatrixN& SparseMatrixN::mult(const SparseMatrixN& A, const Real* d, const SparseMatrixN& B, SparseMatrixN& result)
+{
+  const unsigned NONE = std::numeric_limits<unsigned>::max();
+
+  if (A._columns != B._rows)
+    throw MissizeException();
+
+  // determine the number of elements in each row of the result
+  vector<unsigned> mark(B._columns, NONE);
+  shared_array<unsigned> ptr(new unsigned[A._rows+1]);
+  ptr[0] = 0;
+  for (unsigned i=0; i< A._rows; i++)
+  {
+    ptr[i+1] = ptr[i];
+    for (unsigned k=A._ptr[i]; k< A._ptr[i+1]; k++)
+    {
+      const unsigned r = A._indices[k];
+      for (unsigned l=B._ptr[r]; l< B._ptr[r+1]; l++)
+        if (mark[B._indices[l]] != i)
+        {
+          mark[B._indices[l]] = i;
+          ptr[i+1]++;
+        }
+    }
+  }
+
+  // compute the rows of the result
+  shared_array<unsigned> indices(new unsigned[ptr[A._rows]]);
+  shared_array<Real> data(new Real[ptr[A._rows]]);
+  vector<Real> work(B._columns);
+  std::fill(mark.begin(), mark.end(), NONE);
+  for (unsigned i=0; i< A._rows; i++)
+  {
+    // accumulate the row in the work vector
+    unsigned nz = ptr[i];
+    for (unsigned k=A._ptr[i]; k< A._ptr[i+1]; k++)
+    {
+      const unsigned r = A._indices[k];
+      const Real a = (d) ? A._data[k]*d[r] : A._data[k];
+      for (unsigned l=B._ptr[r]; l< B._ptr[r+1]; l++)
+      {
+        const unsigned j = B._indices[l];
+        if (mark[j] != i)
+        {
+          mark[j] = i;
+          indices[nz++] = j;
+          work[j] = a*B._data[l];
+        }
+        else
+          work[j] += a*B._data[l];
+      }
+    }
+
+    // gather the row, keeping column indices sorted
+    std::sort(indices.get()+ptr[i], indices.get()+ptr[i+1]);
+    for (unsigned k=ptr[i]; k< ptr[i+1]; k++)
+      data[k] = work[indices[k]];
+  }
+
+  // setup the result
+  result._rows = A._rows;
+  result._columns = B._columns;
+  result._ptr = ptr;
+  result._indices = indices;
+  result._data = data;
+  return result;
+}
+
+/// Multiplies this sparse matrix by a sparse matrix
+SparseMatrixN& SparseMatrixN::mult(const SparseMatrixN& m, SparseMatrixN& result) const
+{
+  return mult(*this, NULL, m, result);
+}
+
+/// Multiplies this sparse matrix by the transpose of a sparse matrix
+SparseMatrixN& SparseMatrixN::mult_transpose(const SparseMatrixN& m, SparseMatrixN& result) const
+{
+  if (_columns != m._columns)
+    throw MissizeException();
+
+  return mult(*this, NULL, transpose(m), result);
+}
+
+/// Calculates A*diag(d)*A' and stores the result in a sparse matrix
+/**
+ * This is the form of the Delassus operator J*inv(M)*J' when the inverse of
+ * the generalized inertia is diagonal.
+ */
+SparseMatrixN& SparseMatrixN::outer_square(const SparseMatrixN& A, const VectorN& d, SparseMatrixN& result)
+{
+  if (A._columns != d.size())
+    throw MissizeException();
+
+  return mult(A, d.data(), transpose(A), result);
+}
+
+/// Gets the transpose of a sparse matrix
+SparseMatrixN SparseMatrixN::transpose(const SparseMatrixN& m)
+{
+  SparseMatrixN result;
+  m.transpose(result);
+  return result;
+}
+
+/// Gets the transpose of this sparse matrix
+SparseMatrixN& SparseMatrixN::transpose(SparseMatrixN& result) const
+{
+  const unsigned NV = num_elements();
+
+  // count the elements in each column
+  shared_array<unsigned> ptr(new unsigned[_columns+1]);
+  for (unsigned i=0; i<= _columns; i++)
+    ptr[i] = 0;
+  for (unsigned k=0; k< NV; k++)
+    ptr[_indices[k]+1]++;
+  for (unsigned i=0; i< _columns; i++)
+    ptr[i+1] += ptr[i];
+
+  // scatter the elements; visiting rows in order keeps the indices sorted
+  shared_array<unsigned> indices(new unsigned[NV]);
+  shared_array<Real> data(new Real[NV]);
+  vector<unsigned> next(ptr.get(), ptr.get()+_columns);
+  for (unsigned row=0; row< _rows; row++)
+    for (unsigned k=_ptr[row]; k< _ptr[row+1]; k++)
+    {
+      const unsigned l = next[_indices[k]]++;
+      indices[l] = row;
+      data[l] = _data[k];
+    }
+
+  // setup the result (this may alias the result, so set it up last)
+  const unsigned ROWS = _rows;
+  result._rows = _columns;
+  result._columns = ROWS;
+  result._ptr = ptr;
+  result._indices = indices;
+  result._data = data;
+  return result;
+}
+
 /// Gets a dense matrix from this sparse matrix
 MatrixN SparseMatrixN::to_dense() const
 {
@@ -7,6 +7,7 @@
 #include <Moby/Constants.h>
 #include <Moby/SMatrix6N.h>
 #include <Moby/MatrixN.h>
+#include <Moby/SpatialKernels.h>
 #include <Moby/SpatialABInertia.h>
 
 using namespace Moby;
@@ -62,18 +63,9 @@ void SpatialABInertia::set_zero()
 /// Multiplies this matrix by a vector and returns the result in a new vector
 SVector6 SpatialABInertia::operator*(const SVector6& v) const
 {
-  // get necessary components of v
-  Vector3 vtop = v.get_upper();
-  Vector3 vbot = v.get_lower();
-
-  // do some precomputation
-  Matrix3 HT = Matrix3::transpose(H);
-
-  // compute top part of result
-  Vector3 rtop = HT * vtop + (M * vbot);
-  Vector3 rbot = (J * vtop) + (H * vbot);
-
-  return SVector6(rtop, rbot); 
+  SVector6 result;
+  SpatialKernels::ab_inertia_mult(M.data(), H.data(), J.data(), v.data(), result.data());
+  return result;
 }
 
 /// Multiplies this matrix by a scalar in place
@@ -192,18 +184,11 @@ SMatrix6N& SpatialABInertia::mult(const SMatrix6N& m, SMatrix6N& result) const
     return result;
   }
 
-  // compute the transpose of H
-  Matrix3 HT = Matrix3::transpose(this->H);
-
-  // carry out multiplication one column at a time
+  // carry out multiplication one column at a time (m and result may alias)
+  const Real* mdata = m.data();
+  Real* rdata = result.data();
   for (unsigned i=0; i< NCOLS; i++)
-  {
-    SVector6 v = m.get_column(i);
-    Vector3 vtop = v.get_upper();
-    Vector3 vbot = v.get_lower();
-    v = SVector6((this->M * vbot)+(HT * vtop), (this->J * vtop)+(H * vbot));
-    result.set_column(i, v);
-  } 
+    SpatialKernels::ab_inertia_mult(M.data(), H.data(), J.data(), mdata+i*SPATIAL_DIM, rdata+i*SPATIAL_DIM);
 
   return result;
 }
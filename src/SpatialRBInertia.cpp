@@ -6,6 +6,7 @@
 
 #include <Moby/Constants.h>
 #include <Moby/SMatrix6N.h>
+#include <Moby/SpatialKernels.h>
 #include <Moby/SpatialRBInertia.h>
 
 using namespace Moby;
@@ -100,18 +101,9 @@ void SpatialRBInertia::to_matrix(Real output[]) const
 /// Multiplies this matrix by a vector and returns the result in a new vector
 SVector6 SpatialRBInertia::operator*(const SVector6& v) const
 {
-  // get necessary components of v
-  Vector3 vtop = v.get_upper();
-  Vector3 vbot = v.get_lower();
-
-  // do some precomputation
-  Matrix3 hX = Matrix3::skew_symmetric(h);
-
-  // compute top part of result
-  Vector3 rtop = (vbot * m) - (hX * vtop);
-  Vector3 rbot = (J * vtop) + (hX * vbot);
-
-  return SVector6(rtop, rbot); 
+  SVector6 result;
+  SpatialKernels::rb_inertia_mult(m, h.data(), J.data(), v.data(), result.data());
+  return result;
 }
 
 /// Multiplies this matrix by a scalar in place
@@ -189,18 +181,11 @@ SMatrix6N& SpatialRBInertia::mult(const SMatrix6N& m, SMatrix6N& result) const
     return result;
   }
 
-  // compute the skew symmetric matrix corresponding to h
-  Matrix3 hX = Matrix3::skew_symmetric(this->h);
-
-  // carry out multiplication one column at a time
+  // carry out multiplication one column at a time (m and result may alias)
+  const Real* mdata = m.data();
+  Real* rdata = result.data();
   for (unsigned i=0; i< NCOLS; i++)
-  {
-    SVector6 v = m.get_column(i);
-    Vector3 vtop = v.get_upper();
-    Vector3 vbot = v.get_lower();
-    v = SVector6((vbot * this->m)-(hX * vtop), (this->J * vtop)+(hX * vbot));
-    result.set_column(i, v);
-  } 
+    SpatialKernels::rb_inertia_mult(this->m, h.data(), J.data(), mdata+i*SPATIAL_DIM, rdata+i*SPATIAL_DIM);
 
   return result;
 }
@@ -5,10 +5,35 @@
  ****************************************************************************/
 
 #include <Moby/Constants.h>
+#include <Moby/SpatialKernels.h>
 #include <Moby/SpatialTransform.h>
 
 using namespace Moby;
 
+/// Computes E*A*E' for 3x3 matrices
+static Matrix3 congruence(const Matrix3& E, const Matrix3& A)
+{
+  Matrix3 EA, result;
+  SpatialKernels::mult3x3(E.data(), A.data(), EA.data());
+  SpatialKernels::mult_transpose3x3(EA.data(), E.data(), result.data());
+  return result;
+}
+
+/// Computes rx*(m*r)x = m*(r*r' - (r'*r)*I) 
+static Matrix3 calc_mrxrx(Real m, const Vector3& r)
+{
+  Matrix3 result;
+  Real* data = result.data();
+  const Real RR = r[0]*r[0] + r[1]*r[1] + r[2]*r[2];
+  for (unsigned j=0; j< 3; j++)
+    for (unsigned i=0; i< 3; i++)
+      data[j*3+i] = m*r[i]*r[j];
+  data[0] -= m*RR;
+  data[4] -= m*RR;
+  data[8] -= m*RR;
+  return result;
+}
+
 /// Default constructor -- constructs an identity transformation 
 SpatialTransform::SpatialTransform()
 {
@@ -106,17 +131,12 @@ SpatialTransform& SpatialTransform::operator=(const SpatialTransform& m)
 /// Transforms a rigid body inertia in its frame
 SpatialRBInertia SpatialTransform::transform(Real mass, const Matrix3& J) const
 {
-  // precompute some things we'll need
   SpatialRBInertia result;
-  Vector3 mr = r * mass;
-  Matrix3 rx = Matrix3::skew_symmetric(r);
-  Matrix3 mrxrx = rx*Matrix3::skew_symmetric(mr);
-  Matrix3 ET = Matrix3::transpose(E);
 
   // compute the result
   result.m = mass;
-  result.h = -mr;
-  result.J = (E*J*ET) - mrxrx;
+  result.h = r * -mass;
+  result.J = congruence(E, J) - calc_mrxrx(mass, r);
 
   return result;
 }
@@ -132,19 +152,17 @@ SMatrix6N SpatialTransform::transform(const SMatrix6N& m) const
 /// Transforms a spatial rigid body inertia
 SpatialRBInertia SpatialTransform::transform(const SpatialRBInertia& m) const
 {
-  // precompute some things we'll need
+  // compute E*hx*E'*rx without forming the skew symmetric matrices
   SpatialRBInertia result;
-  Vector3 mr = r * m.m;
-  Matrix3 rx = Matrix3::skew_symmetric(r);
-  Matrix3 hx = Matrix3::skew_symmetric(m.h);
-  Matrix3 mrxrx = rx*Matrix3::skew_symmetric(mr);
-  Matrix3 ET = Matrix3::transpose(E);
-  Matrix3 EhxETrx = E * hx * ET * rx;
+  Matrix3 Ehx, EhxET, EhxETrx;
+  SpatialKernels::mult_skew3x3(E.data(), m.h.data(), Ehx.data());
+  SpatialKernels::mult_transpose3x3(Ehx.data(), E.data(), EhxET.data());
+  SpatialKernels::mult_skew3x3(EhxET.data(), r.data(), EhxETrx.data());
 
   // compute the result
   result.m = m.m;
-  result.h = E * m.h - mr;
-  result.J = EhxETrx + Matrix3::transpose(EhxETrx) + (E*m.J*ET) - mrxrx;
+  result.h = E * m.h - r * m.m;
+  result.J = EhxETrx + Matrix3::transpose(EhxETrx) + congruence(E, m.J) - calc_mrxrx(m.m, r);
 
   return result;
 }
@@ -152,34 +170,29 @@ SpatialRBInertia SpatialTransform::transform(const SpatialRBInertia& m) const
 /// Transforms a spatial articulated body inertia 
 SpatialABInertia SpatialTransform::transform(const SpatialABInertia& m) const
 {
-  // precompute some things we'll need
-  Matrix3 ET = Matrix3::transpose(E);
-  Matrix3 rx = Matrix3::skew_symmetric(r);
-  Matrix3 HT = Matrix3::transpose(m.H);
-  Matrix3 EJET = E * m.J * ET;
-  Matrix3 rx_E_HT_ET = rx*E*HT*ET;
-  Matrix3 EHET = E * m.H * ET;
-  Matrix3 EMET = E * m.M * ET;
-  Matrix3 rxEMET = rx * EMET;
+  // precompute some things we'll need; note that E*H'*E' = (E*H*E')'
+  Matrix3 EJET = congruence(E, m.J);
+  Matrix3 EHET = congruence(E, m.H);
+  Matrix3 EMET = congruence(E, m.M);
+  Matrix3 EHETT = Matrix3::transpose(EHET);
+  Matrix3 rxEMET, rx_E_HT_ET, Hrx;
+  SpatialKernels::skew_mult3x3(r.data(), EMET.data(), rxEMET.data());
+  SpatialKernels::skew_mult3x3(r.data(), EHETT.data(), rx_E_HT_ET.data());
 
   SpatialABInertia result;
   result.M = EMET;
   result.H = EHET - rxEMET;
-  result.J = EJET - rx_E_HT_ET + ((EHET - rxEMET) * rx); 
+  SpatialKernels::mult_skew3x3(result.H.data(), r.data(), Hrx.data());
+  result.J = EJET - rx_E_HT_ET + Hrx; 
   return result;
 }
 
 /// Transforms the spatial vector 
 SVector6 SpatialTransform::transform(const SVector6& v) const
 {
-  // get the components of v
-  Vector3 top = v.get_upper();
-  Vector3 bottom = v.get_lower();
-
-  // do the calculations
-  Vector3 Etop = E * top;
-  Vector3 cross = Vector3::cross(r, Etop);
-  return SVector6(Etop, (E * bottom) - cross);
+  SVector6 result;
+  SpatialKernels::spatial_transform(E.data(), r.data(), v.data(), result.data());
+  return result;
 }
 
 /// Combines (concatenates) two spatial transforms 
@@ -209,13 +222,11 @@ SMatrix6N& SpatialTransform::transform(const SMatrix6N& m, SMatrix6N& result) co
   // resize the new matrix
   result.resize(SPATIAL_DIM, NCOLS);
   
-  // do multiplication on each column of m
+  // transform each column of m (the kernel permits m and result to alias)
+  const Real* mdata = m.data();
+  Real* rdata = result.data();
   for (unsigned i=0; i< NCOLS; i++)
-  {
-    SVector6 v = m.get_column(i);
-    v = transform(v);
-    result.set_column(i, v);
-  }
+    SpatialKernels::spatial_transform(E.data(), r.data(), mdata+i*SPATIAL_DIM, rdata+i*SPATIAL_DIM);
 
   return result;
 }
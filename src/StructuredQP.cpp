@@ -0,0 +1,787 @@
+/****************************************************************************
+ * Copyright 2011 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <Moby/Constants.h>
+#include <Moby/Log.h>
+#include <Moby/LinAlg.h>
+#include <Moby/Krylov.h>
+#include <Moby/FastThreadable.h>
+#include <Moby/MissizeException.h>
+#include <Moby/NonsquareMatrixException.h>
+#include <Moby/StructuredQP.h>
+
+using std::vector;
+using boost::shared_array;
+using namespace Moby;
+
+/// The maximum number of variables in a diagonal block of the KKT matrix
+static const unsigned MAX_BLOCK_SIZE = 32;
+
+/// The fraction of the step to the boundary of the feasible region taken
+static const Real STEP_FRAC = (Real) 0.995;
+
+/// The relative residual tolerance for the (preconditioned) KKT solves
+static const Real CG_TOL = std::pow(std::numeric_limits<Real>::epsilon(), (Real) 0.75);
+
+/// The maximum number of conjugate gradient iterations per KKT solve
+static const unsigned MAX_CG_ITER = 20;
+
+/// The factor by which the primal regularization is increased when the dense KKT factorization fails
+static const Real REG_INCREASE = (Real) 100.0;
+
+/// The maximum number of increases of the primal regularization per factorization
+static const unsigned MAX_REG_INCREASES = 8;
+
+/// Finds the root of an element of a union-find forest (with path halving)
+static unsigned find_root(vector<unsigned>& parent, unsigned i)
+{
+  while (parent[i] != i)
+  {
+    parent[i] = parent[parent[i]];
+    i = parent[i];
+  }
+  return i;
+}
+
+/// Reduces alpha to the largest step along dv that keeps v nonnegative
+static void calc_max_step(const VectorN& v, const VectorN& dv, Real& alpha)
+{
+  for (unsigned i=0; i< v.size(); i++)
+    if (dv[i] < (Real) 0.0)
+      alpha = std::min(alpha, -v[i]/dv[i]);
+}
+
+/// Computes the average complementarity (v1 + alpha*dv1)'*(v2 + alpha*dv2)
+static Real calc_complementarity(const VectorN& v1, const VectorN& dv1, const VectorN& v2, const VectorN& dv2, Real alpha)
+{
+  Real sum = (Real) 0.0;
+  for (unsigned i=0; i< v1.size(); i++)
+    sum += (v1[i] + alpha*dv1[i])*(v2[i] + alpha*dv2[i]);
+  return sum;
+}
+
+StructuredQP::StructuredQP()
+{
+  max_iterations = 100;
+  eps = NEAR_ZERO;
+  _H = NULL;
+  _A = NULL;
+  _P = NULL;
+  _iterations = 0;
+  _delta = _delta0 = (Real) 0.0;
+  _dense = true;
+  _low_rank = false;
+}
+
+/// Solves the quadratic program
+/**
+ * \param H the (symmetric, positive semi-definite) Hessian
+ * \param c the linear term of the objective
+ * \param P the indices of the components of the gradient H*x + c that must
+ *        be nonnegative
+ * \param A the linear inequality constraint matrix (A*x >= b)
+ * \param b the linear inequality constraint vector
+ * \param x the optimal primal variables on return
+ * \param lambda the optimal dual variables of the constraints (gradient
+ *        constraints first, then those of A*x >= b) on return
+ * \return <b>true</b> if the tolerances were met within max_iterations
+ */
+bool StructuredQP::solve(const MatrixN& H, const VectorN& c, const vector<unsigned>& P, const SparseMatrixN& A, const VectorN& b, VectorN& x, VectorN& lambda)
+{
+  SAFESTATIC VectorN z, s, h, g, Hx, Glambda;
+  SAFESTATIC VectorN dx_aff, dz_aff, ds_aff, dl_aff, dx, dz, ds, dl, xz_x, sl_s;
+  const unsigned n = c.size();
+  const unsigned m1 = P.size();
+  const unsigned m = m1 + A.rows();
+
+  if (H.rows() != H.columns())
+    throw NonsquareMatrixException();
+  if (H.rows() != n || A.columns() != n || b.size() != A.rows())
+    throw MissizeException();
+
+  // store the problem
+  _H = &H;
+  _A = &A;
+  _P = &P;
+  _iterations = 0;
+
+  // nothing to do for empty problems
+  if (n == 0)
+  {
+    x.resize(0);
+    lambda.resize(0);
+    return true;
+  }
+
+  // determine the structure of the KKT matrix
+  setup_blocks();
+  factor_H();
+  FILE_LOG(LOG_OPT) << "StructuredQP::solve() - " << n << " variables, " << m << " constraints, " << _block_vars.size() << " diagonal blocks, " << ((_dense) ? "dense KKT factorization" : "low rank KKT factorization") << std::endl;
+
+  // setup the primal regularization
+  Real hmax = (Real) 0.0;
+  for (unsigned i=0; i< n; i++)
+    hmax = std::max(hmax, std::fabs(H(i,i)));
+  _delta0 = NEAR_ZERO*((hmax > (Real) 0.0) ? hmax : (Real) 1.0);
+
+  // setup the constant term of the constraints (G*x + h >= 0)
+  h.resize(m);
+  for (unsigned i=0; i< m1; i++)
+    h[i] = c[P[i]];
+  for (unsigned i=m1; i< m; i++)
+    h[i] = -b[i-m1];
+
+  // setup the starting point
+  x.resize(n);
+  z.resize(n);
+  lambda.resize(m);
+  s.resize(m);
+  std::fill(x.begin(), x.end(), (Real) 1.0);
+  std::fill(z.begin(), z.end(), (Real) 1.0);
+  std::fill(lambda.begin(), lambda.end(), (Real) 1.0);
+  mult_H(x, Hx);
+  mult_G(x, Hx, g);
+  g += h;
+  for (unsigned i=0; i< m; i++)
+    s[i] = std::max(g[i], (Real) 1.0);
+
+  // setup norms for the convergence check
+  const Real C_NORM = (Real) 1.0 + c.norm_inf();
+  const Real H_NORM = (Real) 1.0 + ((m > 0) ? h.norm_inf() : (Real) 0.0);
+  const Real INF = std::numeric_limits<Real>::max();
+
+  while (true)
+  {
+    // compute the primal residual G*x + h - s
+    mult_H(x, Hx);
+    mult_G(x, Hx, g);
+    g += h;
+    _rp.copy_from(g) -= s;
+
+    // compute the dual residual H*x + c - z - G'*lambda
+    mult_GT(lambda, Glambda);
+    _rd.copy_from(Hx) += c;
+    _rd -= z;
+    _rd -= Glambda;
+
+    // compute the average complementarity
+    const Real mu = (x.dot(z) + s.dot(lambda))/(n + m);
+    const Real rp_norm = (m > 0) ? _rp.norm_inf() : (Real) 0.0;
+    const Real rd_norm = _rd.norm_inf();
+    FILE_LOG(LOG_OPT) << "StructuredQP::solve() - iteration " << _iterations << " mu: " << mu << "  primal residual: " << rp_norm << "  dual residual: " << rd_norm << std::endl;
+
+    // check for convergence
+    if (mu <= eps && rp_norm <= eps*H_NORM && rd_norm <= eps*C_NORM)
+    {
+      FILE_LOG(LOG_OPT) << "StructuredQP::solve() - converged after " << _iterations << " iterations" << std::endl;
+      return true;
+    }
+    if (!(mu < INF && rp_norm < INF && rd_norm < INF))
+    {
+      FILE_LOG(LOG_OPT) << "StructuredQP::solve() - iterates diverged!" << std::endl;
+      return false;
+    }
+    if (_iterations == max_iterations)
+      break;
+    _iterations++;
+
+    // setup the scaling matrices and factor the KKT matrix
+    _dx.resize(n);
+    _ds.resize(m);
+    for (unsigned i=0; i< n; i++)
+      _dx[i] = z[i]/x[i];
+    for (unsigned i=0; i< m; i++)
+      _ds[i] = lambda[i]/s[i];
+    if (!factor_KKT())
+    {
+      FILE_LOG(LOG_OPT) << "StructuredQP::solve() - unable to factor KKT matrix!" << std::endl;
+      return false;
+    }
+
+    // compute the predictor (affine scaling) step
+    if (!calc_step(z, lambda, dx_aff, dz_aff, ds_aff, dl_aff))
+    {
+      FILE_LOG(LOG_OPT) << "StructuredQP::solve() - unable to factor KKT matrix!" << std::endl;
+      return false;
+    }
+    Real alpha = (Real) 1.0;
+    calc_max_step(x, dx_aff, alpha);
+    calc_max_step(z, dz_aff, alpha);
+    calc_max_step(s, ds_aff, alpha);
+    calc_max_step(lambda, dl_aff, alpha);
+
+    // compute the centering parameter from the predicted complementarity
+    const Real mu_aff = (calc_complementarity(x, dx_aff, z, dz_aff, alpha) + calc_complementarity(s, ds_aff, lambda, dl_aff, alpha))/(n + m);
+    const Real sigma = std::pow(mu_aff/mu, (Real) 3.0);
+    const Real sigma_mu = sigma*mu;
+
+    // compute the corrector step
+    xz_x.resize(n);
+    sl_s.resize(m);
+    for (unsigned i=0; i< n; i++)
+      xz_x[i] = z[i] + (dx_aff[i]*dz_aff[i] - sigma_mu)/x[i];
+    for (unsigned i=0; i< m; i++)
+      sl_s[i] = lambda[i] + (ds_aff[i]*dl_aff[i] - sigma_mu)/s[i];
+    if (!calc_step(xz_x, sl_s, dx, dz, ds, dl))
+    {
+      FILE_LOG(LOG_OPT) << "StructuredQP::solve() - unable to factor KKT matrix!" << std::endl;
+      return false;
+    }
+
+    // take the step, staying in the interior
+    alpha = INF;
+    calc_max_step(x, dx, alpha);
+    calc_max_step(z, dz, alpha);
+    calc_max_step(s, ds, alpha);
+    calc_max_step(lambda, dl, alpha);
+    alpha = std::min((Real) 1.0, STEP_FRAC*alpha);
+    FILE_LOG(LOG_OPT) << "  sigma: " << sigma << "  step size: " << alpha << std::endl;
+    x += dx*alpha;
+    z += dz*alpha;
+    s += ds*alpha;
+    lambda += dl*alpha;
+  }
+
+  FILE_LOG(LOG_OPT) << "StructuredQP::solve() - maximum number of iterations exceeded" << std::endl;
+  return false;
+}
+
+/// Partitions the variables into the diagonal blocks of the KKT matrix
+/**
+ * Rows of A are merged into blocks (by union-find on their supports) as long
+ * as the blocks remain small; rows that would create a large block (e.g., a
+ * bound on the sum of all normal impulses) contribute to the low rank term
+ * instead.
+ */
+void StructuredQP::setup_blocks()
+{
+  const unsigned UINF = std::numeric_limits<unsigned>::max();
+  const SparseMatrixN& A = *_A;
+  const unsigned n = A.columns();
+  shared_array<unsigned> ptr = A.get_ptr();
+  shared_array<unsigned> indices = A.get_indices();
+  vector<unsigned> parent(n), size(n, 1), roots, block_rows;
+
+  // every variable starts in its own block
+  for (unsigned i=0; i< n; i++)
+    parent[i] = i;
+
+  _coupling_rows.clear();
+  for (unsigned i=0; i< A.rows(); i++)
+  {
+    // rows without nonzeros do not contribute to the KKT matrix
+    if (ptr[i] == ptr[i+1])
+      continue;
+
+    // determine the size of the block that the row would create
+    roots.clear();
+    for (unsigned k=ptr[i]; k< ptr[i+1]; k++)
+      roots.push_back(find_root(parent, indices[k]));
+    std::sort(roots.begin(), roots.end());
+    roots.erase(std::unique(roots.begin(), roots.end()), roots.end());
+    unsigned total = 0;
+    for (unsigned k=0; k< roots.size(); k++)
+      total += size[roots[k]];
+    if (total > MAX_BLOCK_SIZE)
+    {
+      _coupling_rows.push_back(i);
+      continue;
+    }
+
+    // merge the blocks
+    for (unsigned k=1; k< roots.size(); k++)
+      parent[roots[k]] = roots[0];
+    size[roots[0]] = total;
+    block_rows.push_back(i);
+  }
+
+  // setup the variables of each block
+  vector<unsigned> root_block(n, UINF);
+  _block_vars.clear();
+  _var_block.resize(n);
+  _var_pos.resize(n);
+  for (unsigned j=0; j< n; j++)
+  {
+    const unsigned r = find_root(parent, j);
+    if (root_block[r] == UINF)
+    {
+      root_block[r] = _block_vars.size();
+      _block_vars.push_back(vector<unsigned>());
+    }
+    const unsigned blk = root_block[r];
+    _var_block[j] = blk;
+    _var_pos[j] = _block_vars[blk].size();
+    _block_vars[blk].push_back(j);
+  }
+
+  // setup the rows of each block
+  _block_rows.clear();
+  _block_rows.resize(_block_vars.size());
+  for (unsigned k=0; k< block_rows.size(); k++)
+  {
+    const unsigned i = block_rows[k];
+    _block_rows[_var_block[indices[ptr[i]]]].push_back(i);
+  }
+  _blocks.resize(_block_vars.size());
+}
+
+/// Computes a low rank factor L of H (H ~= L*L') using a pivoted Cholesky factorization
+/**
+ * The factorization stops once the remaining diagonal of H is negligible.
+ * If the rank of the low rank term becomes too large for the
+ * Sherman-Morrison-Woodbury solve to pay off, the factorization is abandoned
+ * and the KKT matrix is factored densely instead.
+ */
+void StructuredQP::factor_H()
+{
+  const MatrixN& H = *_H;
+  const vector<unsigned>& P = *_P;
+  const unsigned n = H.rows();
+  const unsigned MAX_RANK = n/2;
+  const unsigned N_COUPLING = _coupling_rows.size();
+  vector<VectorN> cols;
+  vector<Real> d(n);
+  vector<bool> pivoted(n, false);
+
+  // setup the diagonal of the residual matrix
+  Real dmax = (Real) 0.0;
+  for (unsigned i=0; i< n; i++)
+  {
+    d[i] = H(i,i);
+    dmax = std::max(dmax, d[i]);
+  }
+  const Real TOL = std::numeric_limits<Real>::epsilon()*n*dmax;
+
+  cols.reserve(MAX_RANK);
+  while (cols.size() + N_COUPLING < MAX_RANK)
+  {
+    // find the largest diagonal element of the residual matrix
+    unsigned p = n;
+    for (unsigned i=0; i< n; i++)
+      if (!pivoted[i] && (p == n || d[i] > d[p]))
+        p = i;
+    if (p == n || !(d[p] > TOL))
+      break;
+
+    // compute the next column of L
+    cols.push_back(VectorN());
+    VectorN& l = cols.back();
+    H.get_column(p, l);
+    for (unsigned k=0; k+1< cols.size(); k++)
+    {
+      const Real lkp = cols[k][p];
+      if (lkp != (Real) 0.0)
+      {
+        const Real* lk = cols[k].data();
+        for (unsigned i=0; i< n; i++)
+          l[i] -= lk[i]*lkp;
+      }
+    }
+    const Real piv = std::sqrt(d[p]);
+    pivoted[p] = true;
+    for (unsigned i=0; i< n; i++)
+      l[i] = (pivoted[i]) ? (Real) 0.0 : l[i]/piv;
+    l[p] = piv;
+
+    // update the diagonal of the residual matrix
+    for (unsigned i=0; i< n; i++)
+      if (!pivoted[i])
+        d[i] -= l[i]*l[i];
+  }
+
+  // see whether the low rank term is too large
+  _dense = (cols.size() + N_COUPLING >= MAX_RANK);
+  _low_rank = !_dense;
+  if (_dense)
+    return;
+
+  // store L and its rows indexed by P
+  _L.resize(n, cols.size());
+  for (unsigned j=0; j< cols.size(); j++)
+    _L.set_column(j, cols[j]);
+  _L.select_rows(P.begin(), P.end(), _LP);
+}
+
+/// Factors the KKT matrix H + inv(X)*Z + G'*inv(S)*Lambda*G (plus regularization) for the current scaling
+/**
+ * If the low rank factorization fails, the dense factorization is used for
+ * the remainder of the solve.
+ */
+bool StructuredQP::factor_KKT()
+{
+  // reset the regularization
+  _delta = _delta0;
+
+  if (!_dense && !factor_low_rank())
+  {
+    FILE_LOG(LOG_OPT) << "StructuredQP::factor_KKT() - low rank factorization failed; using dense factorization" << std::endl;
+    _dense = true;
+  }
+
+  return (_dense) ? factor_dense() : true;
+}
+
+/// Forms and factors the KKT matrix densely
+/**
+ * If the KKT matrix is numerically indefinite (as can happen close to the
+ * solution, where it is very ill-conditioned), the primal regularization is
+ * increased until the factorization succeeds.
+ */
+bool StructuredQP::factor_dense()
+{
+  for (unsigned i=0; i<= MAX_REG_INCREASES; i++)
+  {
+    form_dense();
+    if (LinAlg::factor_chol(_K))
+      return true;
+    _delta *= REG_INCREASE;
+    FILE_LOG(LOG_OPT) << "StructuredQP::factor_dense() - KKT matrix not positive definite; increasing regularization to " << _delta << std::endl;
+  }
+
+  return false;
+}
+
+/// Forms the KKT matrix densely (in _K)
+void StructuredQP::form_dense()
+{
+  const MatrixN& H = *_H;
+  const SparseMatrixN& A = *_A;
+  const vector<unsigned>& P = *_P;
+  const unsigned n = H.rows();
+  const unsigned m1 = P.size();
+  shared_array<unsigned> ptr = A.get_ptr();
+  shared_array<unsigned> indices = A.get_indices();
+  shared_array<Real> data = A.get_data();
+
+  if (_low_rank)
+  {
+    // H + H_P'*inv(S_P)*Lambda_P*H_P = L*(I + L_P'*inv(S_P)*Lambda_P*L_P)*L'
+    calc_low_rank_middle(_C);
+    _L.mult(_C, _workM);
+    _workM.mult_transpose(_L, _K);
+  }
+  else
+  {
+    // H + H_P'*inv(S_P)*Lambda_P*H_P
+    H.select_rows(P.begin(), P.end(), _workM);
+    for (unsigned i=0; i< m1; i++)
+    {
+      const Real si = std::sqrt(_ds[i]);
+      for (unsigned j=0; j< n; j++)
+        _workM(i,j) *= si;
+    }
+    _workM.transpose_mult(_workM, _K);
+    _K += H;
+  }
+
+  // inv(X)*Z and the regularization
+  for (unsigned i=0; i< n; i++)
+    _K(i,i) += _dx[i] + _delta;
+
+  // A'*inv(S_A)*Lambda_A*A
+  for (unsigned i=0; i< A.rows(); i++)
+  {
+    const Real di = _ds[m1+i];
+    for (unsigned k=ptr[i]; k< ptr[i+1]; k++)
+      for (unsigned l=ptr[i]; l< ptr[i+1]; l++)
+        _K(indices[k], indices[l]) += di*data[k]*data[l];
+  }
+}
+
+/// Factors the block diagonal part D of the KKT matrix and the capacitance matrix of the low rank term
+bool StructuredQP::factor_low_rank()
+{
+  const SparseMatrixN& A = *_A;
+  const vector<unsigned>& P = *_P;
+  const unsigned n = _H->rows();
+  const unsigned m1 = P.size();
+  shared_array<unsigned> ptr = A.get_ptr();
+  shared_array<unsigned> indices = A.get_indices();
+  shared_array<Real> data = A.get_data();
+
+  // form and factor the diagonal blocks (D = R'*R)
+  for (unsigned blk=0; blk< _blocks.size(); blk++)
+  {
+    const vector<unsigned>& vars = _block_vars[blk];
+    const vector<unsigned>& rows = _block_rows[blk];
+    MatrixN& B = _blocks[blk];
+    B.set_zero(vars.size(), vars.size());
+    for (unsigned j=0; j< vars.size(); j++)
+      B(j,j) = _dx[vars[j]] + _delta;
+    for (unsigned r=0; r< rows.size(); r++)
+    {
+      const unsigned i = rows[r];
+      const Real di = _ds[m1+i];
+      for (unsigned k=ptr[i]; k< ptr[i+1]; k++)
+        for (unsigned l=ptr[i]; l< ptr[i+1]; l++)
+          B(_var_pos[indices[k]], _var_pos[indices[l]]) += di*data[k]*data[l];
+    }
+    if (!LinAlg::factor_chol(B))
+      return false;
+  }
+
+  // setup the low rank term: since H ~= L*L' and H_P ~= L_P*L',
+  // H + H_P'*inv(S_P)*Lambda_P*H_P ~= L*(I + L_P'*inv(S_P)*Lambda_P*L_P)*L',
+  // which is L*R'*R*L' for the Cholesky factor R of the middle matrix
+  const unsigned r = _L.columns();
+  const unsigned k = r + _coupling_rows.size();
+  _U.set_zero(n, k);
+  if (r > 0)
+  {
+    calc_low_rank_middle(_C);
+    if (!LinAlg::factor_chol(_C))
+      return false;
+    _L.mult_transpose(_C, _workM);
+    _U.set_sub_mat(0, 0, _workM);
+  }
+
+  // the coupling rows of A also contribute to the low rank term
+  for (unsigned j=0; j< _coupling_rows.size(); j++)
+  {
+    const unsigned i = _coupling_rows[j];
+    const Real si = std::sqrt(_ds[m1+i]);
+    for (unsigned l=ptr[i]; l< ptr[i+1]; l++)
+      _U(indices[l], r+j) = si*data[l];
+  }
+
+  // compute W = inv(R')*U and the capacitance matrix I + U'*inv(D)*U, which
+  // is I + W'*W (formed this way, it is positive definite numerically as well)
+  _W.copy_from(_U);
+  for (unsigned j=0; j< k; j++)
+    solve_blocks(_W.data() + j*n, true);
+  _W.transpose_mult(_W, _C);
+  for (unsigned i=0; i< k; i++)
+    _C(i,i) += (Real) 1.0;
+  return LinAlg::factor_chol(_C);
+}
+
+/// Computes the matrix I + L_P'*inv(S_P)*Lambda_P*L_P
+void StructuredQP::calc_low_rank_middle(MatrixN& W)
+{
+  const unsigned m1 = _P->size();
+  const unsigned r = _L.columns();
+
+  _workM2.copy_from(_LP);
+  for (unsigned i=0; i< m1; i++)
+  {
+    const Real si = std::sqrt(_ds[i]);
+    for (unsigned j=0; j< r; j++)
+      _workM2(i,j) *= si;
+  }
+  _workM2.transpose_mult(_workM2, W);
+  for (unsigned i=0; i< r; i++)
+    W(i,i) += (Real) 1.0;
+}
+
+/// Solves R'*y = b or R*y = b for the Cholesky factor R of the block diagonal part D = R'*R of the KKT matrix
+/**
+ * \param x the right hand side on input, the solution on return
+ * \param transpose if <b>true</b>, solves R'*y = b; otherwise, solves R*y = b
+ */
+void StructuredQP::solve_blocks(Real* x, bool transpose) const
+{
+  SAFESTATIC FastThreadable<VectorN> w_x;
+  VectorN& w = w_x();
+
+  for (unsigned blk=0; blk< _blocks.size(); blk++)
+  {
+    const vector<unsigned>& vars = _block_vars[blk];
+    w.resize(vars.size());
+    for (unsigned j=0; j< vars.size(); j++)
+      w[j] = x[vars[j]];
+    LinAlg::solve_tri_fast(_blocks[blk], true, transpose, w);
+    for (unsigned j=0; j< vars.size(); j++)
+      x[vars[j]] = w[j];
+  }
+}
+
+/// Computes y = H*x (using the low rank factor of H, if it has been computed)
+void StructuredQP::mult_H(const VectorN& x, VectorN& y) const
+{
+  SAFESTATIC FastThreadable<VectorN> w_x;
+  VectorN& w = w_x();
+
+  if (_low_rank)
+  {
+    _L.transpose_mult(x, w);
+    _L.mult(w, y);
+  }
+  else
+    _H->mult(x, y);
+}
+
+/// Computes g = G*x, given H*x
+void StructuredQP::mult_G(const VectorN& x, const VectorN& Hx, VectorN& g) const
+{
+  SAFESTATIC FastThreadable<VectorN> Ax_x;
+  VectorN& Ax = Ax_x();
+  const vector<unsigned>& P = *_P;
+  const unsigned m1 = P.size();
+
+  g.resize(m1 + _A->rows());
+  for (unsigned i=0; i< m1; i++)
+    g[i] = Hx[P[i]];
+  if (_A->rows() > 0)
+  {
+    _A->mult(x, Ax);
+    g.set_sub_vec(m1, Ax);
+  }
+}
+
+/// Computes result = G'*v
+void StructuredQP::mult_GT(const VectorN& v, VectorN& result) const
+{
+  SAFESTATIC FastThreadable<VectorN> w_x, v2_x;
+  VectorN& w = w_x();
+  VectorN& v2 = v2_x();
+  const vector<unsigned>& P = *_P;
+  const unsigned m1 = P.size();
+
+  // the rows of H indexed by P (H is symmetric)
+  w.set_zero(_H->rows());
+  for (unsigned i=0; i< m1; i++)
+    w[P[i]] += v[i];
+  mult_H(w, result);
+
+  // the rows of A
+  if (_A->rows() > 0)
+  {
+    v.get_sub_vec(m1, v.size(), v2);
+    _A->transpose_mult(v2, w);
+    result += w;
+  }
+}
+
+/// Solves the KKT system for the search direction
+/**
+ * The low rank factorization becomes inaccurate as the iterates approach
+ * the boundary (the diagonal blocks become nearly singular while the low rank
+ * term grows); if conjugate gradient fails to converge, the KKT matrix is
+ * factored densely for the remainder of the solve.
+ * \return <b>false</b> if the dense factorization failed
+ */
+bool StructuredQP::solve_KKT(const VectorN& r, VectorN& dx)
+{
+  if (!_dense)
+  {
+    // the low rank factorization preconditions conjugate gradient iterations
+    // with the exact KKT matrix
+    KrylovParams params(r.size(), &mult_KKT, this);
+    params.precond = &precond_KKT;
+    params.precond_data = this;
+    params.tol = CG_TOL;
+    params.max_iterations = MAX_CG_ITER;
+    dx.resize(0);
+    if (Krylov::pcg(params, r, dx))
+      return true;
+
+    FILE_LOG(LOG_OPT) << "StructuredQP::solve_KKT() - conjugate gradient did not converge (relative residual: " << params.residual << "); using dense factorization" << std::endl;
+    _dense = true;
+    if (!factor_dense())
+      return false;
+  }
+
+  // the dense factorization solves the system directly
+  dx.copy_from(r);
+  LinAlg::solve_chol_fast(_K, dx);
+  return true;
+}
+
+/// Computes a search direction
+/**
+ * \param xz_x inv(X) times the right hand side of the complementarity
+ *        conditions X*Z*e for the bounds
+ * \param sl_s inv(S) times the right hand side of the complementarity
+ *        conditions S*Lambda*e for the constraints
+ * \return <b>false</b> if the KKT system could not be solved
+ */
+bool StructuredQP::calc_step(const VectorN& xz_x, const VectorN& sl_s, VectorN& dx, VectorN& dz, VectorN& ds, VectorN& dlambda)
+{
+  SAFESTATIC VectorN v, r, Hdx;
+  const unsigned n = _dx.size();
+  const unsigned m = _ds.size();
+
+  // compute the right hand side -r_d - inv(X)*r_xz - G'*inv(S)*(r_sl + Lambda*r_p)
+  v.resize(m);
+  for (unsigned i=0; i< m; i++)
+    v[i] = sl_s[i] + _ds[i]*_rp[i];
+  mult_GT(v, r);
+  for (unsigned i=0; i< n; i++)
+    r[i] = -_rd[i] - xz_x[i] - r[i];
+
+  // solve for dx and recover the remaining components
+  if (!solve_KKT(r, dx))
+    return false;
+  mult_H(dx, Hdx);
+  mult_G(dx, Hdx, ds);
+  ds += _rp;
+  dlambda.resize(m);
+  for (unsigned i=0; i< m; i++)
+    dlambda[i] = -sl_s[i] - _ds[i]*ds[i];
+  dz.resize(n);
+  for (unsigned i=0; i< n; i++)
+    dz[i] = -xz_x[i] - _dx[i]*dx[i];
+  return true;
+}
+
+/// Operator callback that computes y = K*x for the exact KKT matrix K (data is a StructuredQP*)
+void StructuredQP::mult_KKT(const VectorN& x, VectorN& y, void* data)
+{
+  SAFESTATIC FastThreadable<VectorN> Hx_x, w_x;
+  VectorN& Hx = Hx_x();
+  VectorN& w = w_x();
+  const StructuredQP& qp = *((const StructuredQP*) data);
+  const vector<unsigned>& P = *qp._P;
+  const unsigned m1 = P.size();
+  const unsigned n = x.size();
+
+  // (H + H_P'*inv(S_P)*Lambda_P*H_P)*x = H*(x + P'*inv(S_P)*Lambda_P*(H*x)_P)
+  qp.mult_H(x, Hx);
+  w.copy_from(x);
+  for (unsigned i=0; i< m1; i++)
+    w[P[i]] += qp._ds[i]*Hx[P[i]];
+  qp.mult_H(w, y);
+
+  // inv(X)*Z*x and the regularization
+  for (unsigned i=0; i< n; i++)
+    y[i] += (qp._dx[i] + qp._delta)*x[i];
+
+  // A'*inv(S_A)*Lambda_A*A*x
+  if (qp._A->rows() > 0)
+  {
+    qp._A->mult(x, w);
+    for (unsigned i=0; i< w.size(); i++)
+      w[i] *= qp._ds[m1+i];
+    qp._A->transpose_mult(w, Hx);
+    y += Hx;
+  }
+}
+
+/// Preconditioner callback that computes z = inv(D + U*U')*r using the Sherman-Morrison-Woodbury formula (data is a StructuredQP*)
+void StructuredQP::precond_KKT(const VectorN& r, VectorN& z, void* data)
+{
+  SAFESTATIC FastThreadable<VectorN> u_x, t_x;
+  VectorN& u = u_x();
+  VectorN& t = t_x();
+  const StructuredQP& qp = *((const StructuredQP*) data);
+
+  // inv(D + U*U') = inv(R)*(I - W*inv(I + W'*W)*W')*inv(R'), where D = R'*R
+  // and W = inv(R')*U
+  z.copy_from(r);
+  qp.solve_blocks(z.data(), true);
+  if (qp._W.columns() > 0)
+  {
+    qp._W.transpose_mult(z, u);
+    LinAlg::solve_chol_fast(qp._C, u);
+    qp._W.mult(u, t);
+    z -= t;
+  }
+  qp.solve_blocks(z.data(), false);
+}
+
@@ -0,0 +1,153 @@
+/****************************************************************************
+ * Copyright 2011 Evan Drumwright
+ * This library is distributed under the terms of the GNU Lesser General Public
+ * License (found in COPYING).
+ ****************************************************************************/
+
+#include <cassert>
+#include <algorithm>
+#include <Moby/SweepAndPrune.h>
+
+using namespace Moby;
+using std::vector;
+using std::pair;
+using std::make_pair;
+
+/// Forces the endpoint lists to be rebuilt on the next call to find_overlaps()
+void SweepAndPrune::reset()
+{
+  _geoms.clear();
+  for (unsigned k=0; k< 3; k++)
+    _endpoints[k].clear();
+}
+
+/// Finds all pairs of geometries whose bounds overlap
+/**
+ * \param geoms the geometries to check
+ * \param bounds the lower and upper corners of the axis-aligned bounds of
+ *        each geometry (in the global frame)
+ * \param overlaps the overlapping pairs on return; each pair is ordered by
+ *        the indices of its geometries in geoms, and pairs are sorted
+ *        lexicographically by those indices
+ */
+void SweepAndPrune::find_overlaps(const vector<CollisionGeometryPtr>& geoms, const vector<pair<Vector3, Vector3> >& bounds, vector<pair<CollisionGeometryPtr, CollisionGeometryPtr> >& overlaps)
+{
+  const unsigned N = geoms.size();
+  assert(bounds.size() == N);
+
+  // clear the vector of overlaps
+  overlaps.clear();
+
+  // if a geometry was added or removed, rebuild the endpoint lists
+  const bool rebuild = (geoms != _geoms);
+  if (rebuild)
+  {
+    _geoms = geoms;
+    for (unsigned k=0; k< 3; k++)
+    {
+      _endpoints[k].resize(N*2);
+      for (unsigned i=0; i< N; i++)
+      {
+        _endpoints[k][i*2].idx = i;
+        _endpoints[k][i*2].end = false;
+        _endpoints[k][i*2+1].idx = i;
+        _endpoints[k][i*2+1].end = true;
+      }
+    }
+  }
+
+  // update the endpoints and sort them
+  for (unsigned k=0; k< 3; k++)
+  {
+    vector<Endpoint>& endpoints = _endpoints[k];
+    for (unsigned i=0; i< endpoints.size(); i++)
+    {
+      const pair<Vector3, Vector3>& b = bounds[endpoints[i].idx];
+      endpoints[i].value = (endpoints[i].end) ? b.second[k] : b.first[k];
+    }
+
+    // endpoints are nearly sorted unless the lists were just rebuilt
+    if (rebuild)
+      std::sort(endpoints.begin(), endpoints.end());
+    else
+      insertion_sort(endpoints);
+  }
+
+  // sweep along the axis with the greatest variance in the bound centers
+  Real sum[3] = { (Real) 0.0, (Real) 0.0, (Real) 0.0 };
+  Real sum_sq[3] = { (Real) 0.0, (Real) 0.0, (Real) 0.0 };
+  for (unsigned i=0; i< N; i++)
+    for (unsigned k=0; k< 3; k++)
+    {
+      Real c = (bounds[i].first[k] + bounds[i].second[k]) * (Real) 0.5;
+      sum[k] += c;
+      sum_sq[k] += c*c;
+    }
+  unsigned axis = 0;
+  Real max_var = (Real) -1.0;
+  for (unsigned k=0; k< 3; k++)
+  {
+    Real var = sum_sq[k] - sum[k]*sum[k]/std::max(N, (unsigned) 1);
+    if (var > max_var)
+    {
+      max_var = var;
+      axis = k;
+    }
+  }
+  const unsigned A1 = (axis + 1) % 3, A2 = (axis + 2) % 3;
+
+  // sweep, keeping the set of active bounds and the position of each
+  // geometry within it
+  vector<pair<unsigned, unsigned> > found;
+  vector<unsigned> active, pos(N);
+  const vector<Endpoint>& endpoints = _endpoints[axis];
+  for (unsigned i=0; i< endpoints.size(); i++)
+  {
+    const unsigned idx = endpoints[i].idx;
+    if (endpoints[i].end)
+    {
+      // remove the geometry from the active set
+      const unsigned p = pos[idx];
+      active[p] = active.back();
+      pos[active[p]] = p;
+      active.pop_back();
+    }
+    else
+    {
+      // test the bound against all active bounds on the remaining two axes
+      const pair<Vector3, Vector3>& bi = bounds[idx];
+      for (unsigned j=0; j< active.size(); j++)
+      {
+        const pair<Vector3, Vector3>& bj = bounds[active[j]];
+        if (bi.first[A1] > bj.second[A1] || bj.first[A1] > bi.second[A1] ||
+            bi.first[A2] > bj.second[A2] || bj.first[A2] > bi.second[A2])
+          continue;
+        found.push_back((idx < active[j]) ? make_pair(idx, active[j]) : make_pair(active[j], idx));
+      }
+
+      // add the geometry to the active set
+      pos[idx] = active.size();
+      active.push_back(idx);
+    }
+  }
+
+  // sort the pairs so that the output does not depend on the sweep order
+  std::sort(found.begin(), found.end());
+  overlaps.resize(found.size());
+  for (unsigned i=0; i< found.size(); i++)
+    overlaps[i] = make_pair(geoms[found[i].first], geoms[found[i].second]);
+}
+
+/// Sorts a vector of nearly sorted endpoints
+void SweepAndPrune::insertion_sort(vector<Endpoint>& endpoints)
+{
+  for (unsigned i=1; i< endpoints.size(); i++)
+  {
+    Endpoint e = endpoints[i];
+    unsigned j = i;
+    for (; j > 0 && e < endpoints[j-1]; j--)
+      endpoints[j] = endpoints[j-1];
+    endpoints[j] = e;
+  }
+}
+
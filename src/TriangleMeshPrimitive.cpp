@@ -38,6 +38,13 @@ using std::make_pair;
 using std::stack;
 using boost::dynamic_pointer_cast;
 
+// static members
+map<TriangleMeshPrimitive::MeshFileKey, boost::weak_ptr<const IndexedTriArray> > TriangleMeshPrimitive::_mesh_cache;
+map<const IndexedTriArray*, list<boost::weak_ptr<TriangleMeshPrimitive::MeshBVH> > > TriangleMeshPrimitive::_bvh_cache;
+#ifdef THREADSAFE
+pthread_mutex_t TriangleMeshPrimitive::_instance_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
 /// Creates the triangle mesh primitive
 TriangleMeshPrimitive::TriangleMeshPrimitive()
 {
@@ -54,16 +61,12 @@ TriangleMeshPrimitive::TriangleMeshPrimitive(const string& filename, bool center
   // do not sample edges by default
   _edge_sample_length = std::numeric_limits<Real>::max();
 
-  // construct a new triangle mesh from the filename
-  if (filename.find(".obj") == filename.size() - 4)
-    set_mesh(shared_ptr<IndexedTriArray>(new IndexedTriArray(IndexedTriArray::read_from_obj(filename))));
+  // construct a new triangle mesh from the filename (and center it)
+  if (IndexedTriArray::is_mesh_file(filename))
+    load_mesh(filename, center);
   else
     throw std::runtime_error("TriangleMeshPrimitive (constructor): unknown mesh file type!");
 
-  // center the mesh
-  if (center)
-    this->center();
-
   // update the visualization, if necessary
   update_visualization();
 }
@@ -77,16 +80,12 @@ TriangleMeshPrimitive::TriangleMeshPrimitive(const string& filename, const Matri
   // do not sample edges by default
   _edge_sample_length = std::numeric_limits<Real>::max();
 
-  // construct a new triangle mesh from the filename
-  if (filename.find("obj") == filename.size() - 4)
-    set_mesh(shared_ptr<IndexedTriArray>(new IndexedTriArray(IndexedTriArray::read_from_obj(filename))));
+  // construct a new triangle mesh from the filename (and center it)
+  if (IndexedTriArray::is_mesh_file(filename))
+    load_mesh(filename, center);
   else
     throw std::runtime_error("TriangleMeshPrimitive (constructor): unknown mesh file type!");
 
-  // center the mesh
-  if (center)
-    this->center();
-
   // update the visualization, if necessary
   update_visualization();
 }
@@ -98,9 +97,7 @@ void TriangleMeshPrimitive::set_deformable(bool flag)
 
   // vertices, mesh, and BVH are no longer valid 
   _mesh = shared_ptr<IndexedTriArray>();
-  _vertices = shared_ptr<vector<Vector3> >();
-  _mesh_vertices.clear();
-  _root = BVPtr();
+  _bvh = shared_ptr<MeshBVH>();
   _invalidated = true;
 }
 
@@ -109,9 +106,8 @@ void TriangleMeshPrimitive::set_edge_sample_length(Real len)
 {
   _edge_sample_length = len;
 
-  // vertices are no longer valid
-  _vertices = shared_ptr<vector<Vector3> >();
-  _mesh_vertices.clear();
+  // vertices are no longer valid (the BVH may be shared, so we drop it) 
+  _bvh = shared_ptr<MeshBVH>();
   _invalidated = true;
 }
 
@@ -237,29 +233,22 @@ void TriangleMeshPrimitive::load_from_xml(XMLTreeConstPtr node, map<string, Base
     return;
   }
 
-  // setup the file extensions
-  const char* OBJ_EXT = ".obj";
-
   // get the filename
   string fname(fname_attr->get_string_value());
 
-  // get the lowercase version of the filename
-  string fname_lower = fname;
-  std::transform(fname_lower.begin(), fname_lower.end(), fname_lower.begin(), (int(*)(int)) std::tolower);
+  // see whether to center the mesh
+  const XMLAttrib* center_attr = node->get_attrib("center");
+  bool center = (center_attr && center_attr->get_bool_value());
 
   // get the type of file and construct the triangle mesh appropriately
-  if (fname_lower.find(string(OBJ_EXT)) == fname_lower.size() - strlen(OBJ_EXT))
-    set_mesh(shared_ptr<IndexedTriArray>(new IndexedTriArray(IndexedTriArray::read_from_obj(fname))));
+  if (IndexedTriArray::is_mesh_file(fname))
+    load_mesh(fname, center);
   else
   {
     cerr << "TriangleMeshPrimitive::load_from_xml() - unrecognized filename extension" << endl;
-    cerr << "  for attribute 'filename'.  Valid extensions are '.obj' (Wavefront OBJ)" << endl;
+    cerr << "  for attribute 'filename'.  Valid extensions are '.obj' (Wavefront OBJ)," << endl;
+    cerr << "  '.stl' (STL), and '.ply' (PLY)" << endl;
   }
-  
-  // see whether to center the mesh
-  const XMLAttrib* center_attr = node->get_attrib("center");
-  if (center_attr && center_attr->get_bool_value())
-    this->center();
 
   // recompute mass properties
   calc_mass_properties();
@@ -317,6 +306,94 @@ void TriangleMeshPrimitive::save_to_xml(XMLTreePtr node, list<BaseConstPtr>& sha
     in.close();
 }
 
+/// Compares two mesh file keys (for use in a std::map)
+bool TriangleMeshPrimitive::MeshFileKey::operator<(const MeshFileKey& k) const
+{
+  if (filename != k.filename)
+    return filename < k.filename;
+  if (center != k.center)
+    return !center;
+  return std::lexicographical_compare(T.begin(), T.end(), k.T.begin(), k.T.end());
+}
+
+/// Loads the mesh from a mesh file, sharing it with other instances where possible
+/**
+ * If another (rigid) primitive has already loaded the same file, with the 
+ * same centering and under the same transform, its mesh- and, lazily, its
+ * bounding volume hierarchy- are used by this primitive too.
+ * \param filename the name of the file
+ * \param center if <b>true</b>, the mesh is centered
+ */
+void TriangleMeshPrimitive::load_mesh(const string& filename, bool center)
+{
+  // setup the key for the mesh
+  MeshFileKey key;
+  key.filename = filename;
+  key.center = center;
+  key.T = get_transform();
+
+  // see whether the mesh is already loaded 
+  shared_ptr<const IndexedTriArray> mesh;
+  if (!is_deformable())
+  {
+    #ifdef THREADSAFE
+    pthread_mutex_lock(&_instance_mutex);
+    #endif
+    map<MeshFileKey, boost::weak_ptr<const IndexedTriArray> >::iterator i = _mesh_cache.find(key);
+    if (i != _mesh_cache.end())
+    {
+      mesh = i->second.lock();
+      if (!mesh)
+        _mesh_cache.erase(i);
+    }
+    #ifdef THREADSAFE
+    pthread_mutex_unlock(&_instance_mutex);
+    #endif
+  }
+
+  // if the mesh is loaded, just use it
+  if (mesh)
+  {
+    FILE_LOG(LOG_BV) << "TriangleMeshPrimitive::load_mesh() - sharing mesh from " << filename << endl;
+    set_mesh(mesh);
+    return;
+  }
+
+  // otherwise, read the mesh and center it 
+  set_mesh(shared_ptr<IndexedTriArray>(new IndexedTriArray(IndexedTriArray::read_from_file(filename))));
+  if (center)
+    this->center();
+
+  // make the mesh available to other instances
+  if (!is_deformable())
+  {
+    #ifdef THREADSAFE
+    pthread_mutex_lock(&_instance_mutex);
+    #endif
+    _mesh_cache[key] = _mesh;
+    #ifdef THREADSAFE
+    pthread_mutex_unlock(&_instance_mutex);
+    #endif
+  }
+}
+
+/// Clears the caches used to share meshes and hierarchies between instances
+/**
+ * Existing instances keep the data they reference; only subsequently 
+ * constructed primitives are affected.
+ */
+void TriangleMeshPrimitive::clear_instance_cache()
+{
+  #ifdef THREADSAFE
+  pthread_mutex_lock(&_instance_mutex);
+  #endif
+  _mesh_cache.clear();
+  _bvh_cache.clear();
+  #ifdef THREADSAFE
+  pthread_mutex_unlock(&_instance_mutex);
+  #endif
+}
+
 /// Sets the mesh
 void TriangleMeshPrimitive::set_mesh(boost::shared_ptr<const IndexedTriArray> mesh)
 {
@@ -324,9 +401,7 @@ void TriangleMeshPrimitive::set_mesh(boost::shared_ptr<const IndexedTriArray> me
   _mesh = mesh;
 
   // vertices and bounding volumes are no longer valid
-  _vertices = shared_ptr<vector<Vector3> >();
-  _mesh_vertices.clear();
-  _root = BVPtr();
+  _bvh = shared_ptr<MeshBVH>();
   _invalidated = true;
 
   // map pointers to vertices
@@ -428,10 +503,10 @@ void TriangleMeshPrimitive::calc_mass_properties()
 BVPtr TriangleMeshPrimitive::get_BVH_root()
 {
   // build the bounding box if necessary
-  if (!_root)
+  if (!_bvh)
     build_BB_tree();
 
-  return _root; 
+  return _bvh->root; 
 }
 
 /// Determines whether the point on a thick triangle is degenerate
@@ -521,9 +596,12 @@ bool TriangleMeshPrimitive::is_degen_point_on_tri(shared_ptr<AThickTri> tri, con
 /// Gets mesh data for the geometry with the specified bounding volume
 const std::pair<boost::shared_ptr<const IndexedTriArray>, std::list<unsigned> >& TriangleMeshPrimitive::get_sub_mesh(BVPtr bv)
 {
-  assert(_mesh_tris.find(bv) != _mesh_tris.end());
-  _smesh = make_pair(_mesh, _mesh_tris.find(bv)->second);
-  return _smesh;
+  // build the bounding box tree if necessary
+  if (!_bvh)
+    build_BB_tree();
+
+  assert(_bvh->sub_meshes.find(bv) != _bvh->sub_meshes.end());
+  return _bvh->sub_meshes.find(bv)->second;
 }
 
 /// Determines whether a point is inside / on one of the thick triangles
@@ -552,8 +630,8 @@ bool TriangleMeshPrimitive::point_inside(BVPtr bv, const Vector3& p, Vector3& no
   if (bv->is_leaf())
   {
     // get the triangles of the BV
-    assert(_tris.find(bv) != _tris.end());
-    const list<shared_ptr<AThickTri> >& tris = _tris.find(bv)->second;
+    assert(_bvh->tris.find(bv) != _bvh->tris.end());
+    const list<shared_ptr<AThickTri> >& tris = _bvh->tris.find(bv)->second;
     
     // see whether the point is inside/on one of the thick triangles
     BOOST_FOREACH(shared_ptr<AThickTri> tri, tris)
@@ -597,9 +675,7 @@ bool TriangleMeshPrimitive::intersect_seg(const Vector3* u, BVPtr bv, const Line
   // get the vertex corresponding to u and get all facets incident to u
   assert(_mesh_vertex_map.find(u) != _mesh_vertex_map.end());
   unsigned vidx = _mesh_vertex_map.find(u)->second;
-  const list<unsigned>& ifacets = _mesh->get_incident_facets(vidx);
-  vector<unsigned> incident_facets(ifacets.begin(), ifacets.end());
-  std::sort(incident_facets.begin(), incident_facets.end());
+  CSRAdjacency::Row incident_facets = _mesh->get_incident_facets(vidx);
 
   // process until stack is empty
   while (!S.empty())
@@ -614,8 +690,8 @@ bool TriangleMeshPrimitive::intersect_seg(const Vector3* u, BVPtr bv, const Line
     if (bv->is_leaf())
     {
       // get the list of thick triangles 
-      assert(_tris.find(bv) != _tris.end());
-      const list<shared_ptr<AThickTri> >& tris = _tris.find(bv)->second;
+      assert(_bvh->tris.find(bv) != _bvh->tris.end());
+      const list<shared_ptr<AThickTri> >& tris = _bvh->tris.find(bv)->second;
     
       // expand the BV 
       BVPtr ebv;
@@ -643,7 +719,7 @@ bool TriangleMeshPrimitive::intersect_seg(const Vector3* u, BVPtr bv, const Line
         BOOST_FOREACH(shared_ptr<AThickTri> tri, tris)
         {
           // don't do intersection test if u comes from tri
-          if (std::binary_search(incident_facets.begin(), incident_facets.end(), tri->tri_idx))
+          if (std::binary_search(incident_facets.first, incident_facets.second, tri->tri_idx))
             continue;
 
           // otherwise, check...
@@ -755,8 +831,8 @@ bool TriangleMeshPrimitive::intersect_seg(BVPtr bv, const LineSeg3& seg, Real& t
     if (bv->is_leaf())
     {
       // get the list of thick triangles 
-      assert(_tris.find(bv) != _tris.end());
-      const list<shared_ptr<AThickTri> >& tris = _tris.find(bv)->second;
+      assert(_bvh->tris.find(bv) != _bvh->tris.end());
+      const list<shared_ptr<AThickTri> >& tris = _bvh->tris.find(bv)->second;
     
       // expand the BV 
       BVPtr ebv;
@@ -864,16 +940,16 @@ bool TriangleMeshPrimitive::intersect_seg(BVPtr bv, const LineSeg3& seg, Real& t
 void TriangleMeshPrimitive::get_vertices(BVPtr bv, vector<const Vector3*>& vertices) 
 {
   // if there are no vertices, we need to build them
-  if (!_vertices)
+  if (!_bvh)
     build_BB_tree();
 
   // get the mesh covered by the BV
-  map<BVPtr, list<unsigned> >::const_iterator v_iter = _mesh_vertices.find(bv);
+  map<BVPtr, list<unsigned> >::const_iterator v_iter = _bvh->mesh_vertices.find(bv);
   const list<unsigned>& vlist = v_iter->second;
 
   // get the vertex indices
   for (list<unsigned>::const_iterator i = vlist.begin(); i != vlist.end(); i++)
-    vertices.push_back(&(*_vertices)[*i]);
+    vertices.push_back(&_bvh->vertices[*i]);
 }
 
 /// Transforms this primitive
@@ -890,9 +966,7 @@ void TriangleMeshPrimitive::set_transform(const Matrix4& T)
     _mesh = shared_ptr<IndexedTriArray>(new IndexedTriArray(_mesh->transform(Trel)));
 
   // vertices and bounding volumes are no longer valid
-  _vertices = shared_ptr<vector<Vector3> >();
-  _mesh_vertices.clear();
-  _root = BVPtr();
+  _bvh = shared_ptr<MeshBVH>();
   _invalidated = true;
 
   // recalculate the mass properties
@@ -904,10 +978,7 @@ void TriangleMeshPrimitive::load_state(shared_ptr<void> state)
 {
   shared_ptr<TriangleMeshPrimitiveState> tps = boost::static_pointer_cast<TriangleMeshPrimitiveState>(state);
   Primitive::load_state(tps->pstate);
-  _root = tps->rootBVH;
-  _mesh_tris = tps->mesh_tris;
-  _mesh_vertices = tps->mesh_vertices;
-  _tris = tps->tris;
+  _bvh = tps->bvh;
 }
 
 /// Saves the state of this primitive
@@ -915,10 +986,7 @@ shared_ptr<void> TriangleMeshPrimitive::save_state() const
 {
   shared_ptr<TriangleMeshPrimitiveState> tps(new TriangleMeshPrimitiveState);
   tps->pstate = Primitive::save_state();
-  tps->rootBVH = _root;
-  tps->mesh_tris = _mesh_tris;
-  tps->mesh_vertices = _mesh_vertices;
-  tps->tris = _tris;
+  tps->bvh = _bvh;
 
   return tps;
 }
@@ -938,10 +1006,45 @@ void TriangleMeshPrimitive::build_BB_tree()
 
   FILE_LOG(LOG_BV) << "TriangleMeshPrimitive::build_BB_tree() entered" << endl;
 
-  // clear any existing data
-  _mesh_tris.clear();
-  _mesh_vertices.clear();
-  _tris.clear();
+  // rigid meshes may use a hierarchy already built by another instance
+  if (!is_deformable())
+  {
+    #ifdef THREADSAFE
+    pthread_mutex_lock(&_instance_mutex);
+    #endif
+    list<boost::weak_ptr<MeshBVH> >& cached = _bvh_cache[_mesh.get()];
+    for (list<boost::weak_ptr<MeshBVH> >::iterator i = cached.begin(); i != cached.end() && !_bvh; )
+    {
+      shared_ptr<MeshBVH> bvh = i->lock();
+      if (!bvh)
+        i = cached.erase(i);
+      else
+      {
+        if (bvh->mesh == _mesh && 
+            bvh->intersection_tolerance == _intersection_tolerance &&
+            bvh->edge_sample_length == _edge_sample_length)
+          _bvh = bvh;
+        i++;
+      }
+    }
+    if (cached.empty())
+      _bvh_cache.erase(_mesh.get());
+    #ifdef THREADSAFE
+    pthread_mutex_unlock(&_instance_mutex);
+    #endif
+
+    if (_bvh)
+    {
+      FILE_LOG(LOG_BV) << "  -- using BVH shared with another instance" << endl;
+      return;
+    }
+  }
+
+  // create new data 
+  _bvh = shared_ptr<MeshBVH>(new MeshBVH);
+  _bvh->mesh = _mesh;
+  _bvh->intersection_tolerance = _intersection_tolerance;
+  _bvh->edge_sample_length = _edge_sample_length;
 
   // get the vertices from the mesh
   const vector<Vector3>& vertices = _mesh->get_vertices();
@@ -959,7 +1062,7 @@ void TriangleMeshPrimitive::build_BB_tree()
     tris_idx.push_back(i);
 
   // setup mapping from BV to mesh
-  _mesh_tris[root] = tris_idx;
+  _bvh->mesh_tris[root] = tris_idx;
 
   FILE_LOG(LOG_BV) << "  -- created root: " << root << endl;
 
@@ -1005,20 +1108,20 @@ void TriangleMeshPrimitive::build_BB_tree()
       continue;
 
     // child was divisible; remove thick triangles
-    _tris.erase(bb);
+    _bvh->tris.erase(bb);
 
     // setup child pointers
     bb->children.push_back(child1);
     bb->children.push_back(child2);
 
     // get lists of triangles for children
-    assert(_mesh_tris.find(child1) != _mesh_tris.end());
-    assert(_mesh_tris.find(child2) != _mesh_tris.end());
-    const std::list<unsigned>& c1tris = _mesh_tris.find(child1)->second;
-    const std::list<unsigned>& c2tris = _mesh_tris.find(child2)->second;
+    assert(_bvh->mesh_tris.find(child1) != _bvh->mesh_tris.end());
+    assert(_bvh->mesh_tris.find(child2) != _bvh->mesh_tris.end());
+    const std::list<unsigned>& c1tris = _bvh->mesh_tris.find(child1)->second;
+    const std::list<unsigned>& c2tris = _bvh->mesh_tris.find(child2)->second;
 
     // create thick triangles for child1
-    list<shared_ptr<AThickTri> >& ttris1 = _tris[child1];
+    list<shared_ptr<AThickTri> >& ttris1 = _bvh->tris[child1];
     BOOST_FOREACH(unsigned idx, c1tris)
     {
       try
@@ -1034,7 +1137,7 @@ void TriangleMeshPrimitive::build_BB_tree()
     }
     
     // create thick triangles for child2
-    list<shared_ptr<AThickTri> >& ttris2 = _tris[child2];
+    list<shared_ptr<AThickTri> >& ttris2 = _bvh->tris[child2];
     BOOST_FOREACH(unsigned idx, c2tris)
     {
       try
@@ -1133,7 +1236,7 @@ void TriangleMeshPrimitive::build_BB_tree()
   }
 
   // save the root
-  _root = root;
+  _bvh->root = root;
 
   // output how many triangles are in each bounding box
   if (LOGGING(LOG_BV))
@@ -1148,7 +1251,7 @@ void TriangleMeshPrimitive::build_BB_tree()
       S.pop();
       
       // get the triangles in this BV
-      const list<unsigned>& tris = _mesh_tris.find(node)->second;
+      const list<unsigned>& tris = _bvh->mesh_tris.find(node)->second;
       std::ostringstream out;
       for (unsigned i=0; i< depth; i++)
         out << " ";
@@ -1161,9 +1264,25 @@ void TriangleMeshPrimitive::build_BB_tree()
     }
   }
 
+  // setup the sub meshes for each BV
+  for (map<BVPtr, list<unsigned> >::const_iterator i = _bvh->mesh_tris.begin(); i != _bvh->mesh_tris.end(); i++)
+    _bvh->sub_meshes[i->first] = make_pair(_bvh->mesh, i->second);
+
   // build set of mesh vertices
   construct_mesh_vertices(_mesh);
 
+  // make the hierarchy available to other instances of a rigid mesh
+  if (!is_deformable())
+  {
+    #ifdef THREADSAFE
+    pthread_mutex_lock(&_instance_mutex);
+    #endif
+    _bvh_cache[_mesh.get()].push_back(_bvh);
+    #ifdef THREADSAFE
+    pthread_mutex_unlock(&_instance_mutex);
+    #endif
+  }
+
   FILE_LOG(LOG_BV) << "Primitive::build_BB_tree() exited" << endl;
 }
 
@@ -1174,9 +1293,7 @@ void TriangleMeshPrimitive::set_intersection_tolerance(Real tol)
 
   // mesh, vertices, and BVH are no longer valid
   _mesh = shared_ptr<IndexedTriArray>();
-  _vertices = shared_ptr<vector<Vector3> >();
-  _mesh_vertices.clear();
-  _root = BVPtr();
+  _bvh = shared_ptr<MeshBVH>();
 }
 
 /// Creates the set of mesh vertices
@@ -1185,30 +1302,27 @@ void TriangleMeshPrimitive::construct_mesh_vertices(shared_ptr<const IndexedTriA
   const unsigned EDGES_PER_TRI = 3;
 
   // clear the map of mesh vertices
-  _mesh_vertices.clear();
+  _bvh->mesh_vertices.clear();
 
   // get the sets of vertices and facets from the mesh
   const vector<Vector3>& mesh_vertices = mesh->get_vertices();
   const vector<IndexedTri>& mesh_facets = mesh->get_facets();
 
-  // also, we'll need the vertex-to-facet map
-  vector<list<unsigned> > vf_map = mesh->determine_vertex_facet_map();
-
   // create a new vector of vertices
-  _vertices = shared_ptr<vector<Vector3> >(new vector<Vector3>(mesh_vertices));
+  _bvh->vertices = mesh_vertices;
 
   // now, modify the vertices based on the intersection tolerance
   for (unsigned i=0; i< mesh_vertices.size(); i++)
   {
-    // get list of facets indicent to vertex i
-    const list<unsigned>& ifacets = vf_map[i];
+    // get facets indicent to vertex i
+    CSRAdjacency::Row ifacets = mesh->get_incident_facets(i);
 
     // setup the current normal
     Vector3 normal = ZEROS_3;
 
     // add all coincident normals together, then normalize
-    BOOST_FOREACH(unsigned j, ifacets)
-      normal += mesh->get_triangle(j).calc_normal();
+    for (const unsigned* j = ifacets.first; j != ifacets.second; j++)
+      normal += mesh->get_triangle(*j).calc_normal();
 
     // if we can't normalize, skip this vertex 
     if (normal.norm() < NEAR_ZERO)
@@ -1217,61 +1331,54 @@ void TriangleMeshPrimitive::construct_mesh_vertices(shared_ptr<const IndexedTriA
     // otherwise, normalize the normal and add intersection tolerance (in dir
     // of normal) to vertex i
     normal.normalize();
-    (*_vertices)[i] += normal*_intersection_tolerance;
+    _bvh->vertices[i] += normal*_intersection_tolerance;
   }
 
-  // now, add additional samples based on edges in the mesh
-  map<sorted_pair<unsigned>, list<unsigned> > edge_subsamples;
-  for (unsigned i=0; i< mesh_facets.size(); i++)
+  // get the (unique) edges of the mesh
+  vector<sorted_pair<unsigned> > edges;
+  CSRAdjacency edge_facets;
+  mesh->calc_edge_facet_adjacency(edges, edge_facets);
+
+  // now, add additional samples based on edges in the mesh; samples for
+  // edge i are stored in row i of edge_subsamples
+  CSRAdjacency edge_subsamples;
+  edge_subsamples.offsets.reserve(edges.size()+1);
+  edge_subsamples.offsets.push_back(0);
+  for (unsigned i=0; i< edges.size(); i++)
   {
-    // setup sorted pairs for the three edges
-    sorted_pair<unsigned> e[EDGES_PER_TRI];
-    e[0] = make_sorted_pair(mesh_facets[i].a, mesh_facets[i].b);
-    e[1] = make_sorted_pair(mesh_facets[i].b, mesh_facets[i].c);
-    e[2] = make_sorted_pair(mesh_facets[i].c, mesh_facets[i].a);
-
-    // check the three edges
-    for (unsigned j=0; j< EDGES_PER_TRI; j++)
+    // subdivide edge to create new vertices as necessary
+    queue<sorted_pair<unsigned> > q;
+    q.push(edges[i]);
+    while (!q.empty())
     {
-      if (edge_subsamples.find(e[j]) == edge_subsamples.end())
+      // get the two vertices of the "edge"
+      unsigned vi = q.front().first;
+      unsigned vj = q.front().second;
+      q.pop();
+
+      // subdivide, adding a vertex as necessary (the midpoint is computed
+      // before push_back(), which may invalidate references)
+      if ((_bvh->vertices[vi] - _bvh->vertices[vj]).norm() > _edge_sample_length)
       {
-        // edge does not already exist..  add vertices as necessary
-        list<unsigned>& ess = edge_subsamples[e[j]];
-
-        // subdivide edge to create new vertices as necessary
-        queue<sorted_pair<unsigned> > q;
-        q.push(e[j]);
-        while (!q.empty())
-        {
-          // get the two vertices of the "edge"
-          unsigned vi = q.front().first;
-          unsigned vj = q.front().second;
-          q.pop();
-          const Vector3& v1 = (*_vertices)[vi];
-          const Vector3& v2 = (*_vertices)[vj];
-
-          // subdivide, adding a vertex as necessary
-          if ((v1-v2).norm() > _edge_sample_length)
-          {
-            unsigned vk = _vertices->size();
-            _vertices->push_back((v1+v2) * (Real) 0.5);
-            ess.push_back(vk);
-            q.push(make_sorted_pair(vi,vk));
-            q.push(make_sorted_pair(vk,vj));
-          }
-        }
+        unsigned vk = _bvh->vertices.size();
+        Vector3 midpoint = (_bvh->vertices[vi] + _bvh->vertices[vj]) * (Real) 0.5;
+        _bvh->vertices.push_back(midpoint);
+        edge_subsamples.indices.push_back(vk);
+        q.push(make_sorted_pair(vi,vk));
+        q.push(make_sorted_pair(vk,vj));
       }
     }
+    edge_subsamples.offsets.push_back(edge_subsamples.indices.size());
   }
 
   // iterate over all mesh triangles
-  for (map<BVPtr, list<unsigned> >::const_iterator i = _mesh_tris.begin(); i != _mesh_tris.end(); i++)
+  for (map<BVPtr, list<unsigned> >::const_iterator i = _bvh->mesh_tris.begin(); i != _bvh->mesh_tris.end(); i++)
   {
     // get the list of facets
     const list<unsigned>& covered_facets = i->second;
 
     // create the list of vertices for this BV
-    list<unsigned>& vlist = _mesh_vertices[i->first];
+    list<unsigned>& vlist = _bvh->mesh_vertices[i->first];
 
     // get the edges referenced by each facet
     BOOST_FOREACH(unsigned j, covered_facets)
@@ -1282,15 +1389,15 @@ void TriangleMeshPrimitive::construct_mesh_vertices(shared_ptr<const IndexedTriA
       vlist.push_back(mesh_facets[j].c);
 
       // add all vertex samples to the list
-      sorted_pair<unsigned> e[EDGES_PER_TRI];
-      e[0] = make_sorted_pair(mesh_facets[j].a, mesh_facets[j].b);
-      e[1] = make_sorted_pair(mesh_facets[j].b, mesh_facets[j].c);
-      e[2] = make_sorted_pair(mesh_facets[j].c, mesh_facets[j].a);
+      unsigned e[EDGES_PER_TRI];
+      e[0] = IndexedTriArray::find_edge(edges, mesh_facets[j].a, mesh_facets[j].b);
+      e[1] = IndexedTriArray::find_edge(edges, mesh_facets[j].b, mesh_facets[j].c);
+      e[2] = IndexedTriArray::find_edge(edges, mesh_facets[j].c, mesh_facets[j].a);
       for (unsigned k=0; k< EDGES_PER_TRI; k++)
       {
-        assert(edge_subsamples.find(e[k]) != edge_subsamples.end());
-        const list<unsigned>& ess = edge_subsamples[e[k]];
-        vlist.insert(vlist.end(), ess.begin(), ess.end());
+        assert(e[k] < edges.size());
+        CSRAdjacency::Row ess = edge_subsamples.row(e[k]);
+        vlist.insert(vlist.end(), ess.first, ess.second);
       }
     }
   }
@@ -1347,8 +1454,8 @@ bool TriangleMeshPrimitive::split(shared_ptr<const IndexedTriArray> mesh, shared
   tgt2 = shared_ptr<BV>();
 
   // get the mesh and the list of triangles
-  assert(_mesh_tris.find(source) != _mesh_tris.end());
-  const list<unsigned>& tris = _mesh_tris.find(source)->second;
+  assert(_bvh->mesh_tris.find(source) != _bvh->mesh_tris.end());
+  const list<unsigned>& tris = _bvh->mesh_tris.find(source)->second;
 
   // make sure that not trying to split a single triangle
   assert(tris.size() > 1); 
@@ -1382,8 +1489,8 @@ bool TriangleMeshPrimitive::split(shared_ptr<const IndexedTriArray> mesh, shared
   }
 
   // setup mesh data for the BVs
-  _mesh_tris[tgt1] = ptris;
-  _mesh_tris[tgt2] = ntris;
+  _bvh->mesh_tris[tgt1] = ptris;
+  _bvh->mesh_tris[tgt2] = ntris;
 
   return true;
 }
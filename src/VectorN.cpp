@@ -32,7 +32,7 @@ VectorN::VectorN(unsigned N)
   _len = N;
   _capacity = N;
 //  if (N > 0)
-    _data = shared_array<Real>(new Real[N]);
+    _data = ArrayAllocator::create(N);
 }
 
 /// Constructs a vector from a Vector2
@@ -41,7 +41,7 @@ VectorN::VectorN(const Vector2& v)
   const unsigned LEN = 2;
   _len = LEN;
   _capacity = LEN;
-  _data = shared_array<Real>(new Real[LEN]);
+  _data = ArrayAllocator::create(LEN);
   for (unsigned i=0; i< LEN; i++)
     _data[i] = v[i];
 }
@@ -52,7 +52,7 @@ VectorN::VectorN(const Vector3& v)
   const unsigned LEN = 3;
   _len = LEN;
   _capacity = LEN;
-  _data = shared_array<Real>(new Real[LEN]);
+  _data = ArrayAllocator::create(LEN);
   for (unsigned i=0; i< LEN; i++)
     _data[i] = v[i];
 }
@@ -63,7 +63,7 @@ VectorN::VectorN(const SVector6& v)
   const unsigned LEN = 6;
   _len = LEN;
   _capacity = LEN;
-  _data = shared_array<Real>(new Real[LEN]);
+  _data = ArrayAllocator::create(LEN);
   for (unsigned i=0; i< LEN; i++)
     _data[i] = v[i];
 }
@@ -76,7 +76,7 @@ VectorN::VectorN(unsigned N, const Real* array)
 {
   _len = N;
   _capacity = N;
-  _data = shared_array<Real>(new Real[N]);
+  _data = ArrayAllocator::create(N);
   CBLAS::copy(N,array,1,_data.get(),1);
 }
 
@@ -97,8 +97,8 @@ VectorN::VectorN(unsigned N, shared_array<Real> array)
 VectorN::VectorN(const VectorN& source)
 {
   _len = source._len;
-  _capacity = source._capacity;
-  _data = shared_array<Real>(new Real[_len]);
+  _capacity = source._len;
+  _data = ArrayAllocator::create(_len);
   operator=(source);
 }
 
@@ -372,7 +372,7 @@ VectorN& VectorN::resize(unsigned N, bool preserve)
   }
 
   // create a new array
-  newdata = shared_array<Real>(new Real[N]);
+  newdata = ArrayAllocator::create(N);
 
   // copy existing elements, if desired
   if (preserve)
@@ -439,14 +439,6 @@ VectorN& VectorN::operator=(Real scalar)
   return *this;
 }
 
-/// Adds this vector to another
-VectorN VectorN::operator+(const VectorN& v) const
-{
-  VectorN this_copy = *this;
-  this_copy += v;
-  return this_copy;
-}
-
 /// Adds another vector to this one in place
 VectorN& VectorN::operator+=(const VectorN& v)
 {
@@ -459,26 +451,6 @@ VectorN& VectorN::operator+=(const VectorN& v)
   return *this;
 }
 
-/// Returns the negation of this vector
-VectorN VectorN::operator-() const
-{
-  VectorN v(_len);
-  if (_len > 0)
-    std::transform(begin(), end(), v.begin(), std::negate<Real>());
-  return v;
-}
-
-/// Subtracts another vector from <b>this</b>
-/**
- * Operation order: <b>this</b> - v
- */ 
-VectorN VectorN::operator-(const VectorN& v) const
-{  
-  VectorN this_copy = *this;
-  this_copy -= v;
-  return this_copy;
-}
-
 /// Subtracts another vector from this one in place
 VectorN& VectorN::operator-=(const VectorN& v)
 {  
@@ -491,14 +463,6 @@ VectorN& VectorN::operator-=(const VectorN& v)
   return *this;
 }
 
-/// Multiplies this vector by a scalar
-VectorN VectorN::operator*(Real scalar) const
-{
-  VectorN this_copy = *this;
-  this_copy *= scalar;
-  return this_copy;
-}
-
 /// Multiplies this vector in place by a scalar
 VectorN& VectorN::operator*=(Real scalar)
 {
@@ -508,14 +472,6 @@ VectorN& VectorN::operator*=(Real scalar)
   return *this;
 }
 
-/// Divides this vector by a scalar (same as vector * 1/scalar)
-VectorN VectorN::operator/(Real scalar) const
-{
-  VectorN this_copy = *this;
-  this_copy *= (1.0/scalar);
-  return this_copy;
-}
-
 /// Writes a VectorN to the specified stream
 std::ostream& Moby::operator<<(std::ostream& out, const VectorN& v)
 {
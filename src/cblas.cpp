@@ -6,6 +6,9 @@
 
 #include <stdexcept>
 #include <Moby/cblas.h>
+#include <Moby/BLASBackend.h>
+
+using Moby::BLASBackend;
 
 template <>
 void CBLAS::rot(const int N, double *X, const int incX,
@@ -102,7 +105,7 @@ void CBLAS::ger(enum CBLAS_ORDER order, int M, int N, double alpha, const double
 template <>
 void CBLAS::trsm(enum CBLAS_SIDE side, enum CBLAS_UPLO uplo, enum CBLAS_TRANSPOSE transA, int m, int n, double alpha, const double* A, int lda, double* B, int ldb)
 {
-  cblas_dtrsm(CblasColMajor, side, uplo, transA, CblasNonUnit, m, n, alpha, A, lda, B, ldb);  
+  BLASBackend::routines().dtrsm(CblasColMajor, side, uplo, transA, CblasNonUnit, m, n, alpha, A, lda, B, ldb);  
 }
 
 template <>
@@ -121,11 +124,11 @@ template <>
 void CBLAS::gemv(enum CBLAS_ORDER order, CBLAS_TRANSPOSE transA, int M, int N, double alpha, const double* A, int lda, const double* X, int incX, double beta, double* Y, int incY)
 {
   #ifndef ADDRESS_ATLAS_BUG
-  cblas_dgemv(order, transA, M, N, alpha, A, lda, X, incX, beta, Y, incY);
+  BLASBackend::routines().dgemv(order, transA, M, N, alpha, A, lda, X, incX, beta, Y, incY);
   #else
   #define OFFSET(N, incX) ((incX) > 0 ?  0 : ((N) - 1) * (-(incX)))
   if (transA == CblasNoTrans)
-    cblas_dgemv(order, transA, M, N, alpha, A, lda, X, incX, beta, Y, incY);
+    BLASBackend::routines().dgemv(order, transA, M, N, alpha, A, lda, X, incX, beta, Y, incY);
   else
   {
     // NOTE: this code adapted from GSL
@@ -206,26 +209,26 @@ void CBLAS::gemv(enum CBLAS_ORDER order, CBLAS_TRANSPOSE transA, int M, int N, d
 template <>
 void CBLAS::gemv(enum CBLAS_ORDER order, CBLAS_TRANSPOSE transA, int M, int N, float alpha, const float* A, int lda, const float* X, int incX, float beta, float* Y, int incY)
 {
-  cblas_sgemv(order, transA, M, N, alpha, A, lda, X, incX, beta, Y, incY);
+  BLASBackend::routines().sgemv(order, transA, M, N, alpha, A, lda, X, incX, beta, Y, incY);
 }
 
 template <>
 void CBLAS::gemm(enum CBLAS_ORDER order, CBLAS_TRANSPOSE transA, CBLAS_TRANSPOSE transB, int M, int N, int K, double alpha, const double* A, int lda, const double* B, int ldb, double beta, double* C, int ldc)
 {
   assert(ldc >= 1 && ldc >= M);
-  cblas_dgemm(order, transA, transB, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc);
+  BLASBackend::routines().dgemm(order, transA, transB, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc);
 }
 
 template <>
 void CBLAS::gemm(enum CBLAS_ORDER order, CBLAS_TRANSPOSE transA, CBLAS_TRANSPOSE transB, int M, int N, int K, float alpha, const float* A, int lda, const float* B, int ldb, float beta, float* C, int ldc)
 {
-  cblas_sgemm(order, transA, transB, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc);
+  BLASBackend::routines().sgemm(order, transA, transB, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc);
 }
 
 template <>
 void CBLAS::trsm(enum CBLAS_SIDE side, enum CBLAS_UPLO uplo, enum CBLAS_TRANSPOSE transA, int m, int n, float alpha, const float* A, int lda, float* B, int ldb)
 {
-  cblas_strsm(CblasColMajor, side, uplo, transA, CblasNonUnit, m, n, alpha, A, lda, B, ldb);  
+  BLASBackend::routines().strsm(CblasColMajor, side, uplo, transA, CblasNonUnit, m, n, alpha, A, lda, B, ldb);  
 }
 
 template <>